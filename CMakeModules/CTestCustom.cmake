@@ -21,7 +21,6 @@ list(APPEND CTEST_CUSTOM_COVERAGE_EXCLUDE
   # All external and third_party libraries
   "extern/.*"
   "test/mmio/.*"
-  "src/backend/cpu/threads/.*"
   "src/backend/cuda/cub/.*"
   "cl2.hpp"
 
@@ -7,6 +7,13 @@
 #   FFTW_FOUND               ... true if fftw is found on the system
 #   FFTW_LIBRARIES           ... full path to fftw library
 #   FFTW_INCLUDES            ... fftw include directory
+#   FFTW_THREADS_FOUND       ... true if the threaded planner is available
+#   FFTW_THREADS_CALLBACK_FOUND ... true if fftw_threads_set_callback is
+#                                available (FFTW 3.3.9 and later)
+#
+# The threads of FFTW are either in the fftw3 library or in a separate
+# fftw3_threads library. The FFTW::FFTW_THREADS and FFTW::FFTWF_THREADS
+# targets are only created for the latter.
 #
 # The following variables will be checked by the function
 #   FFTW_USE_STATIC_LIBS    ... if true, only static libraries are found
@@ -49,7 +56,25 @@ find_library( FFTWF_LIBRARY
   PATH_SUFFIXES "lib" "lib64"
 )
 
-mark_as_advanced(FFTW_INCLUDE_DIR FFTW_LIBRARY FFTWF_LIBRARY)
+find_library( FFTW_THREADS_LIBRARY
+  NAMES "fftw3_threads" "libfftw3_threads-3" "fftw3_threads-3"
+  PATHS ${FFTW_ROOT}
+        ${CMAKE_SYSTEM_PREFIX_PATH}
+        ${PKG_FFTW_LIBRARY_DIRS}
+  PATH_SUFFIXES "lib" "lib64"
+)
+
+find_library( FFTWF_THREADS_LIBRARY
+  NAMES "fftw3f_threads" "libfftw3f_threads-3" "fftw3f_threads-3"
+  PATHS ${FFTW_ROOT}
+        ${CMAKE_SYSTEM_PREFIX_PATH}
+        ${CMAKE_SYSTEM_LIBRARY_PATH}
+        ${PKG_FFTW_LIBRARY_DIRS}
+  PATH_SUFFIXES "lib" "lib64"
+)
+
+mark_as_advanced(FFTW_INCLUDE_DIR FFTW_LIBRARY FFTWF_LIBRARY
+  FFTW_THREADS_LIBRARY FFTWF_THREADS_LIBRARY)
 
 include(FindPackageHandleStandardArgs)
 find_package_handle_standard_args(FFTW DEFAULT_MSG
@@ -67,5 +92,37 @@ if (FFTW_FOUND)
     IMPORTED_LINK_INTERFACE_LANGUAGE "C"
     IMPORTED_LOCATION "${FFTWF_LIBRARY}"
     INTERFACE_INCLUDE_DIRECTORIES "${FFTW_INCLUDE_DIR}")
+
+  set(_fftw_threads_libraries)
+  if (FFTW_THREADS_LIBRARY AND FFTWF_THREADS_LIBRARY)
+    set(_fftw_threads_libraries ${FFTW_THREADS_LIBRARY} ${FFTWF_THREADS_LIBRARY})
+  endif ()
+
+  find_package(Threads QUIET)
+  include(CheckSymbolExists)
+  set(CMAKE_REQUIRED_QUIET ${FFTW_FIND_QUIETLY})
+  set(CMAKE_REQUIRED_INCLUDES "${FFTW_INCLUDE_DIR}")
+  set(CMAKE_REQUIRED_LIBRARIES ${_fftw_threads_libraries}
+    ${FFTW_LIBRARY} ${FFTWF_LIBRARY} ${CMAKE_THREAD_LIBS_INIT})
+  check_symbol_exists(fftwf_plan_with_nthreads "fftw3.h" FFTW_THREADS_FOUND)
+  check_symbol_exists(fftwf_threads_set_callback "fftw3.h"
+    FFTW_THREADS_CALLBACK_FOUND)
+  unset(CMAKE_REQUIRED_QUIET)
+  unset(CMAKE_REQUIRED_INCLUDES)
+  unset(CMAKE_REQUIRED_LIBRARIES)
+
+  if (FFTW_THREADS_FOUND AND _fftw_threads_libraries)
+    add_library(FFTW::FFTW_THREADS UNKNOWN IMPORTED)
+    set_target_properties(FFTW::FFTW_THREADS PROPERTIES
+      IMPORTED_LINK_INTERFACE_LANGUAGE "C"
+      IMPORTED_LOCATION "${FFTW_THREADS_LIBRARY}"
+      INTERFACE_LINK_LIBRARIES FFTW::FFTW)
+
+    add_library(FFTW::FFTWF_THREADS UNKNOWN IMPORTED)
+    set_target_properties(FFTW::FFTWF_THREADS PROPERTIES
+      IMPORTED_LINK_INTERFACE_LANGUAGE "C"
+      IMPORTED_LOCATION "${FFTWF_THREADS_LIBRARY}"
+      INTERFACE_LINK_LIBRARIES FFTW::FFTWF)
+  endif ()
 endif (FFTW_FOUND)
 
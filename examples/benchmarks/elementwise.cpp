@@ -0,0 +1,100 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <arrayfire.h>
+#include <stdio.h>
+#include <cstdlib>
+#include <string>
+
+using namespace af;
+
+// create small wrappers to benchmark
+static array A;  // populated before each timing
+static array B;  // populated before each timing
+
+static void add() {
+    array C = A + B;
+    C.eval();
+}
+static void sub() {
+    array C = A - B;
+    C.eval();
+}
+static void mul() {
+    array C = A * B;
+    C.eval();
+}
+static void divide() {
+    array C = A / B;
+    C.eval();
+}
+static void minmax() {
+    array C = min(A, B);
+    array D = max(A, B);
+    eval(C, D);
+}
+static void compare() {
+    array C = A < B;
+    C.eval();
+}
+static void cast() {
+    array C = A.as(f64);
+    C.eval();
+}
+
+struct Benchmark {
+    const char* name;
+    void (*fn)();
+    int inputs;   // number of arrays read by fn
+    int outputs;  // number of arrays written by fn
+    af_dtype out_type;
+};
+
+int main(int argc, char** argv) {
+    try {
+        int device = argc > 1 ? atoi(argv[1]) : 0;
+        setDevice(device);
+
+        const std::string dtype(argc > 2 ? argv[2] : "f32");
+        const af_dtype dt = (dtype == "s32" ? s32 : f32);
+
+        info();
+
+        const Benchmark benchmarks[] = {
+            {"add", add, 2, 1, dt},
+            {"sub", sub, 2, 1, dt},
+            {"mul", mul, 2, 1, dt},
+            {"div", divide, 2, 1, dt},
+            {"min/max", minmax, 2, 2, dt},
+            {"compare", compare, 2, 1, b8},
+            {"cast", cast, 1, 1, f64},
+        };
+
+        printf("Benchmark element-wise operations at %s\n", dtype.c_str());
+        for (int n = 1 << 16; n <= 1 << 24; n <<= 2) {
+            A = randu(n, dt) + 1;
+            B = randu(n, dt) + 1;
+            eval(A, B);
+
+            printf("%9d elements:\n", n);
+            for (const Benchmark& b : benchmarks) {
+                double time  = timeit(b.fn);  // time in seconds
+                double bytes = (double)n * (b.inputs * getSizeOf(dt) +
+                                            b.outputs * getSizeOf(b.out_type));
+                printf("    %-8s %8.2f GB/s\n", b.name, bytes / (time * 1e9));
+            }
+            fflush(stdout);
+        }
+    } catch (af::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        throw;
+    }
+
+    return 0;
+}
@@ -11,6 +11,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <cstdlib>
+#include <string>
 
 using namespace af;
 
@@ -21,8 +22,79 @@ static void fn() {
     B.eval();           // ensure evaluated
 }
 
+static void setFFTThreads(int nthreads) {
+    std::string value = std::to_string(nthreads);
+#if defined(_WIN32)
+    _putenv_s("AF_FFTW_NUM_THREADS", value.c_str());
+#else
+    setenv("AF_FFTW_NUM_THREADS", value.c_str(), 1);
+#endif
+}
+
+// Times the N-by-N 2D fft in a new process of this program, which inherits
+// the environment of this one. The CPU backend reads AF_FFTW_NUM_THREADS
+// once, when it creates its first plan, so every thread count needs its own
+// process.
+static double timeInChild(const char* self, int device, int N) {
+    std::string cmd = std::string("\"") + self + "\" --time " +
+                      std::to_string(device) + " " + std::to_string(N);
+#if defined(_WIN32)
+    FILE* child = _popen(cmd.c_str(), "r");
+#else
+    FILE* child = popen(cmd.c_str(), "r");
+#endif
+    if (!child) { return 0; }
+
+    double time = 0;
+    if (fscanf(child, "%lf", &time) != 1) { time = 0; }
+#if defined(_WIN32)
+    _pclose(child);
+#else
+    pclose(child);
+#endif
+    return time;
+}
+
+// Runs the benchmark with 1, 2, 4, ... threads up to max_threads and reports
+// the speedup over a single thread
+static void benchThreads(const char* self, int device, int max_threads) {
+    printf("\nScaling of the N-by-N 2D fft with the number of threads\n");
+    printf("%11s", "");
+    for (int t = 1; t <= max_threads; t *= 2) { printf("  %3d threads", t); }
+    printf("\n");
+
+    for (int M = 9; M <= 12; M++) {
+        int N = (1 << M);
+
+        printf("%4d x %4d:", N, N);
+        double single = 0;
+        for (int t = 1; t <= max_threads; t *= 2) {
+            setFFTThreads(t);
+            double time = timeInChild(self, device, N);
+            if (time <= 0) {
+                printf("  %11s", "failed");
+                continue;
+            }
+            if (t == 1) { single = time; }
+            printf("  %4.0f (%3.1fx)", 10.0 * N * N * M / (time * 1e9),
+                   single / time);
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+}
+
 int main(int argc, char** argv) {
     try {
+        // Child process of benchThreads: prints the time of one size only
+        if (argc == 4 && std::string(argv[1]) == "--time") {
+            setDevice(atoi(argv[2]));
+            int N = atoi(argv[3]);
+            A     = randu(N, N);
+            printf("%g\n", timeit(fn));
+            return 0;
+        }
+
         int device = argc > 1 ? atoi(argv[1]) : 0;
         setDevice(device);
         info();
@@ -39,6 +111,11 @@ int main(int argc, char** argv) {
             printf(" %4.0f Gflops\n", gflops);
             fflush(stdout);
         }
+
+        if (getActiveBackend() == AF_BACKEND_CPU) {
+            int max_threads = argc > 2 ? atoi(argv[2]) : 8;
+            benchThreads(argv[0], device, max_threads);
+        }
     } catch (af::exception& e) { fprintf(stderr, "%s\n", e.what()); }
 
     return 0;
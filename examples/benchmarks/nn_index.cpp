@@ -0,0 +1,108 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <arrayfire.h>
+#include <stdio.h>
+#include <cstdlib>
+
+using namespace af;
+
+// create a small wrapper to benchmark
+static array train;  // populated before each timing
+static array query;  // populated before each timing
+static nnIndex *index_ptr;
+static af_match_type dist_type;
+static unsigned checks;
+static const unsigned K = 4;
+
+static void exact() {
+    array idx, dist;
+    nearestNeighbour(idx, dist, query, train, 0, K, dist_type);
+    dist.eval();
+}
+
+static void indexed() {
+    array idx, dist;
+    index_ptr->search(idx, dist, query, 0, K, checks);
+    dist.eval();
+}
+
+// Fraction of the exact neighbours of every query which are also returned by
+// the index
+static double recall(const array &gold_dist, const array &dist) {
+    // Neighbours at the same distance are interchangeable, so the distances
+    // are compared instead of the indices
+    array worst = tile(max(gold_dist, 0), K);
+    return mean<double>((dist <= worst).as(f32));
+}
+
+static void bench(const char *name, af_match_type type, const array &t,
+                  const array &q) {
+    train     = t;
+    query     = q;
+    dist_type = type;
+
+    printf("\n%s: %lld train and %lld query points of %lld features\n", name,
+           train.dims(1), query.dims(1), train.dims(0));
+
+    timer start = timer::start();
+    nnIndex index(train, 0, type);
+    index_ptr = &index;
+    printf("%12s: %8.2f ms\n", "build", timer::stop(start) * 1e3);
+
+    double exact_time = timeit(exact);
+    printf("%12s: %8.2f ms\n", "exact", exact_time * 1e3);
+
+    array gold_idx, gold_dist;
+    nearestNeighbour(gold_idx, gold_dist, query, train, 0, K, type);
+
+    const unsigned all_checks[] = {0, 4096, 1024, 256, 64};
+    for (unsigned c : all_checks) {
+        checks      = c;
+        double time = timeit(indexed);
+
+        array idx, dist;
+        index.search(idx, dist, query, 0, K, checks);
+        printf("%6s %5u: %8.2f ms (%5.1fx) recall %5.3f\n", "checks", checks,
+               time * 1e3, exact_time / time, recall(gold_dist, dist));
+        fflush(stdout);
+    }
+}
+
+int main(int argc, char **argv) {
+    try {
+        int device = argc > 1 ? atoi(argv[1]) : 0;
+        int ntrain = argc > 2 ? atoi(argv[2]) : 100000;
+        int nquery = argc > 3 ? atoi(argv[3]) : 1000;
+        setDevice(device);
+        info();
+
+        printf("Benchmark of af::nnIndex against af::nearestNeighbour\n");
+
+        // Points clustered around a few centres, like image descriptors
+        array centres = randu(16, 64) * 100;
+        array labels  = (randu(ntrain) * 64).as(u32);
+        array points  = centres(span, labels) + randn(16, ntrain) * 5;
+        array qlabels = (randu(nquery) * 64).as(u32);
+        array queries = centres(span, qlabels) + randn(16, nquery) * 5;
+        bench("SSD", AF_SSD, points, queries);
+
+        // 256 bit binary descriptors, like the ones computed by ORB
+        array bits   = (randu(32, 64) * 255).as(u8);
+        array flips  = (randu(32, ntrain) * 255).as(u8) &
+                      (randu(32, ntrain) > 0.9).as(u8);
+        array qflips = (randu(32, nquery) * 255).as(u8) &
+                       (randu(32, nquery) > 0.9).as(u8);
+        array binary  = bits(span, labels) ^ flips;
+        array qbinary = bits(span, qlabels) ^ qflips;
+        bench("SHD", AF_SHD, binary, qbinary);
+    } catch (af::exception &e) { fprintf(stderr, "%s\n", e.what()); }
+
+    return 0;
+}
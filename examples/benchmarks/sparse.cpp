@@ -0,0 +1,89 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+// Times the products of a CSR matrix with dense vectors and matrices. Run it
+// against CPU backends built with USE_CPU_MKL ON and OFF to compare the MKL
+// sparse BLAS with the native kernels.
+
+#include <arrayfire.h>
+#include <stdio.h>
+#include <cstdlib>
+#include <vector>
+
+using namespace af;
+
+// create a small wrapper to benchmark
+static array spA;  // populated before each timing
+static array rhs;  // populated before each timing
+static matProp opt;
+
+static void fn() {
+    array out = matmul(spA, rhs, opt, AF_MAT_NONE);
+    out.eval();
+}
+
+// m x n matrix with about per_row non-zeros in every row. Every skew-th row
+// is dense when skew is not zero.
+static array makeSparse(int m, int n, int per_row, int skew) {
+    std::vector<int> rowIdx(1, 0);
+    std::vector<int> colIdx;
+    for (int i = 0; i < m; i++) {
+        if (skew && i % skew == 0) {
+            for (int j = 0; j < n; j++) { colIdx.push_back(j); }
+        } else {
+            for (int k = 0; k < per_row; k++) {
+                colIdx.push_back((i * 7919 + k * (n / per_row)) % n);
+            }
+        }
+        rowIdx.push_back(colIdx.size());
+    }
+    const int nnz = colIdx.size();
+    return sparse(m, n, randu(nnz), array(m + 1, rowIdx.data()),
+                  array(nnz, colIdx.data()), AF_STORAGE_CSR);
+}
+
+static void bench(const char *name, int m, int n, int per_row, int skew) {
+    spA          = makeSparse(m, n, per_row, skew);
+    double flops = 2.0 * sparseGetNNZ(spA);
+
+    printf("\n%s: %d x %d, %lld non-zeros\n", name, m, n, sparseGetNNZ(spA));
+
+    const int cols[] = {1, 8};
+    for (int N : cols) {
+        opt        = AF_MAT_NONE;
+        rhs        = randu(n, N);
+        double mv  = timeit(fn);
+        opt        = AF_MAT_TRANS;
+        rhs        = randu(m, N);
+        double mtv = timeit(fn);
+
+        printf("%3d columns: A * x %8.3f ms %6.2f Gflops, "
+               "A' * x %8.3f ms %6.2f Gflops\n",
+               N, mv * 1e3, flops * N / (mv * 1e9), mtv * 1e3,
+               flops * N / (mtv * 1e9));
+        fflush(stdout);
+    }
+}
+
+int main(int argc, char **argv) {
+    try {
+        int device = argc > 1 ? atoi(argv[1]) : 0;
+        setDevice(device);
+        info();
+
+        bench("uniform", 200000, 200000, 16, 0);
+        bench("skewed rows", 200000, 200000, 4, 20000);
+        bench("few dense rows", 20000, 50000, 2, 400);
+    } catch (af::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        throw;
+    }
+
+    return 0;
+}
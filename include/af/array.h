@@ -1577,6 +1577,9 @@ extern "C" {
 #if AF_API_VERSION >= 34
     /**
        Evaluate multiple arrays together
+
+       The arrays must have the same dimensions. They can be of different
+       types.
     */
     AFAPI af_err af_eval_multiple(const int num, af_array *arrays);
 #endif
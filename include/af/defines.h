@@ -543,6 +543,14 @@ typedef enum {
 } af_conv_gradient_type;
 #endif
 
+#if AF_API_VERSION >= 38
+typedef enum {
+    AF_BILATERAL_EXACT   = 1,   ///< Weighs every pixel of the filter window
+    AF_BILATERAL_GRID    = 2,   ///< Bilateral grid approximation
+    AF_BILATERAL_DEFAULT = 0    ///< Default option is same as AF_BILATERAL_EXACT
+} af_bilateral_mode;
+#endif
+
 #ifdef __cplusplus
 namespace af
 {
@@ -598,6 +606,9 @@ namespace af
     typedef af_inverse_deconv_algo inverseDeconvAlgo;
     typedef af_conv_gradient_type convGradientType;
 #endif
+#if AF_API_VERSION >= 38
+    typedef af_bilateral_mode bilateralMode;
+#endif
 }
 
 #endif
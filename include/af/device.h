@@ -10,6 +10,47 @@
 #pragma once
 #include <af/defines.h>
 
+#if AF_API_VERSION >= 38
+/// Number of size buckets in \ref af_memory_stats. Bucket i holds the
+/// allocations of more than 2^(i - 1) and at most 2^i bytes.
+#define AF_MEMORY_STATS_BUCKETS 64
+
+/**
+   Counters kept by the default memory manager for a device since the memory
+   manager was created
+
+   \ingroup device_func_mem
+*/
+typedef struct {
+    /// Allocations served from a cached buffer, by size
+    unsigned long long cache_hits[AF_MEMORY_STATS_BUCKETS];
+    /// Allocations which needed a new buffer, by size
+    unsigned long long cache_misses[AF_MEMORY_STATS_BUCKETS];
+    /// Sum of the bytes requested by the allocations
+    unsigned long long requested_bytes;
+    /// Sum of the bytes of the buffers returned after rounding the requests
+    /// up to the memory step size or size class
+    unsigned long long rounded_bytes;
+    /// Total and maximum time spent in an allocation in nanoseconds
+    unsigned long long alloc_ns;
+    unsigned long long max_alloc_ns;
+    /// Number of buffers allocated and freed by the device API
+    unsigned long long native_allocs;
+    unsigned long long native_frees;
+    /// Time spent in the native allocation and free calls in nanoseconds
+    unsigned long long native_alloc_ns;
+    unsigned long long native_free_ns;
+    /// Largest number of bytes allocated from the device at once
+    size_t peak_alloc_bytes;
+    /// Largest number of bytes in use at once
+    size_t peak_lock_bytes;
+    /// Number of JIT trees evaluated early because of memory pressure
+    unsigned long long memory_pressure_evals;
+    /// Number of garbage collections which freed cached buffers
+    unsigned long long garbage_collections;
+} af_memory_stats;
+#endif
+
 #ifdef __cplusplus
 namespace af
 {
@@ -247,6 +288,18 @@ namespace af
     ///
     /// \ingroup device_func_mem
     AFAPI size_t getMemStepSize();
+
+#if AF_API_VERSION >= 38
+    /// \brief Returns the allocation counters of the memory manager. Works
+    /// only with the default memory manager - throws if a custom memory
+    /// manager is set.
+    ///
+    /// \param[in] device_id the device whose counters are returned. -1
+    ///            signifies the active device.
+    ///
+    /// \ingroup device_func_mem
+    AFAPI af_memory_stats deviceMemStats(const int device_id = -1);
+#endif
 }
 #endif
 
@@ -412,6 +465,24 @@ extern "C" {
     */
     AFAPI af_err af_get_mem_step_size(size_t *step_bytes);
 
+#if AF_API_VERSION >= 38
+    /**
+       Get the allocation counters of the memory manager. Works only with the
+       default memory manager - returns an error if a custom memory manager is
+       set.
+
+       \param [out] stats the counters of the memory manager
+       \param [in] device_id the device whose counters are returned. -1
+       signifies active device.
+
+       \returns AF_SUCCESS if successful
+
+       \ingroup device_func_mem
+    */
+    AFAPI af_err af_device_mem_stats(af_memory_stats *stats,
+                                     const int device_id);
+#endif
+
 #if AF_API_VERSION >= 31
     /**
        Lock the device buffer in the memory manager.
@@ -297,6 +297,22 @@ AFAPI array skew(const array& in, const float skew0, const float skew1, const di
 */
 AFAPI array bilateral(const array &in, const float spatial_sigma, const float chromatic_sigma, const bool is_color=false);
 
+#if AF_API_VERSION >= 38
+/**
+    C++ Interface for bilateral filter with a choice of algorithm
+
+    \param[in]  in array is the input image
+    \param[in]  spatial_sigma is the spatial variance parameter that decides the filter window
+    \param[in]  chromatic_sigma is the chromatic variance parameter
+    \param[in]  is_color indicates if the input \p in is color image or grayscale
+    \param[in]  mode selects the exact filter or the bilateral grid approximation
+    \return     the processed image
+
+    \ingroup image_func_bilateral
+*/
+AFAPI array bilateral(const array &in, const float spatial_sigma, const float chromatic_sigma, const bool is_color, const bilateralMode mode);
+#endif
+
 /**
    C++ Interface for histogram
 
@@ -1261,6 +1277,24 @@ extern "C" {
     */
     AFAPI af_err af_bilateral(af_array *out, const af_array in, const float spatial_sigma, const float chromatic_sigma, const bool isColor);
 
+#if AF_API_VERSION >= 38
+    /**
+        C Interface for bilateral filter with a choice of algorithm
+
+        \param[out] out array is the processed image
+        \param[in]  in array is the input image
+        \param[in]  spatial_sigma is the spatial variance parameter that decides the filter window
+        \param[in]  chromatic_sigma is the chromatic variance parameter
+        \param[in]  isColor indicates if the input \p in is color image or grayscale
+        \param[in]  mode selects the exact filter or the bilateral grid approximation
+        \return     \ref AF_SUCCESS if the filter is applied successfully,
+        otherwise an appropriate error code is returned.
+
+        \ingroup image_func_bilateral
+    */
+    AFAPI af_err af_bilateral_v2(af_array *out, const af_array in, const float spatial_sigma, const float chromatic_sigma, const bool isColor, const af_bilateral_mode mode);
+#endif
+
     /**
         C Interface for mean shift
 
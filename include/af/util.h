@@ -9,6 +9,7 @@
 
 #pragma once
 #include <af/defines.h>
+#include <af/seq.h>
 
 #ifdef __cplusplus
 namespace af
@@ -77,6 +78,29 @@ namespace af
     AFAPI array readArray(const char *filename, const char *key);
 #endif
 
+#if AF_API_VERSION >= 38
+    /**
+        Reads the part of an array selected by the sequences. Only the parts
+        of the file holding the selected elements are read from disk.
+
+        \param[in] filename is the path to the location on disk
+        \param[in] key is the tag/name of the array to be read. The key needs to have an exact match.
+        \param[in] s0 is the sequence indexing the first dimension
+        \param[in] s1 is the sequence indexing the second dimension
+        \param[in] s2 is the sequence indexing the third dimension
+        \param[in] s3 is the sequence indexing the fourth dimension
+
+        \returns the elements of the array selected by the sequences
+
+        \note This function will throw an exception if the key is not found.
+
+        \ingroup stream_func_read
+    */
+    AFAPI array readArray(const char *filename, const char *key,
+                          const seq &s0, const seq &s1 = span,
+                          const seq &s2 = span, const seq &s3 = span);
+#endif
+
 #if AF_API_VERSION >= 31
     /**
         When reading by key, it may be a good idea to run this function first to check for the key
@@ -221,6 +245,25 @@ extern "C" {
     AFAPI af_err af_read_array_key(af_array *out, const char *filename, const char* key);
 #endif
 
+#if AF_API_VERSION >= 38
+    /**
+        Reads the part of an array selected by the sequences. Only the parts
+        of the file holding the selected elements are read from disk.
+
+        \param[out] out is the part of the array read from key
+        \param[in] filename is the path to the location on disk
+        \param[in] key is the tag/name of the array to be read. The key needs to have an exact match.
+        \param[in] ndims is the number of sequences in \p index
+        \param[in] index is an array of \ref af_seq, one for each of the first \p ndims dimensions
+
+        \note This function will throw an exception if the key is not found.
+
+        \ingroup stream_func_read
+    */
+    AFAPI af_err af_read_array_slice(af_array *out, const char *filename, const char *key,
+                                     const unsigned ndims, const af_seq *const index);
+#endif
+
 #if AF_API_VERSION >= 31
     /**
         When reading by key, it may be a good idea to run this function first to check for the key
@@ -11,6 +11,11 @@
 #include <af/defines.h>
 #include <af/features.h>
 
+#if AF_API_VERSION >= 38
+/// Handle to an index of train samples built by \ref af_create_nn_index
+typedef void * af_nn_index;
+#endif
+
 #ifdef __cplusplus
 namespace af
 {
@@ -250,6 +255,68 @@ AFAPI void nearestNeighbour(array& idx, array& dist,
                             const af_match_type dist_type = AF_SSD);
 #endif
 
+#if AF_API_VERSION >= 38
+/**
+   C++ interface for an index of train points which answers nearest
+   neighbour queries without comparing every query with every train point
+
+   The index copies the train points when it is created, so it can be
+   searched any number of times. \ref AF_SSD and \ref AF_SAD indices are
+   k-d trees and \ref AF_SHD indices are multi-index hash tables over the
+   bits of the points.
+
+   \ingroup cv_func_nearest_neighbour
+ */
+class AFAPI nnIndex {
+    af_nn_index index;
+
+    // An index owns its train points and cannot be copied
+    nnIndex(const nnIndex &other);
+    nnIndex &operator=(const nnIndex &other);
+
+  public:
+    /**
+       Creates an index of the points in \p train
+
+       \param[in] train     is the array containing the points used as
+                            training data, with the same layout as in \ref
+                            nearestNeighbour
+       \param[in] dist_dim  is the dimension along which the coordinates of
+                            a point are described
+       \param[in] dist_type is the distance computation type. \ref AF_SAD,
+                            \ref AF_SSD and \ref AF_SHD are supported.
+    */
+    explicit nnIndex(const array &train, const dim_t dist_dim = 0,
+                     const af_match_type dist_type = AF_SSD);
+
+    ~nnIndex();
+
+    /**
+       Finds the nearest train points to every point in \p query
+
+       \param[out] idx     is the same as in \ref nearestNeighbour
+       \param[out] dist    is the same as in \ref nearestNeighbour
+       \param[in]  query   is the array containing the points to be queried
+       \param[in]  dist_dim is the dimension along which the coordinates of
+                           a point are described in \p query
+       \param[in]  n_dist  is the number of nearest neighbour points to
+                           return (currently only values <= 256 are
+                           supported)
+       \param[in]  checks  is the maximum number of train points compared
+                           with each query. 0 searches until the results are
+                           exact and match \ref nearestNeighbour. Smaller
+                           values are faster but can miss some of the
+                           nearest points.
+    */
+    void search(array &idx, array &dist, const array &query,
+                const dim_t dist_dim = 0, const unsigned n_dist = 1,
+                const unsigned checks = 0) const;
+
+    /// Returns the af_nn_index handle of the index
+    af_nn_index get() const;
+};
+#endif
+
 /**
    C++ Interface for image template matching
 
@@ -575,6 +642,65 @@ AFAPI af_err af_nearest_neighbour(af_array* idx, af_array* dist,
                                   const af_match_type dist_type);
 #endif
 
+#if AF_API_VERSION >= 38
+/**
+   C Interface to create an index of train points for nearest neighbour
+   queries
+
+   \param[out] index     is the new index. It must be released with \ref
+                         af_release_nn_index.
+   \param[in]  train     is the array containing the points used as training
+                         data, with the same layout as in \ref
+                         af_nearest_neighbour
+   \param[in]  dist_dim  is the dimension along which the coordinates of a
+                         point are described
+   \param[in]  dist_type is the distance computation type. \ref AF_SAD,
+                         \ref AF_SSD and \ref AF_SHD are supported.
+   \return     \ref AF_SUCCESS if the index is created successfully,
+               otherwise an appropriate error code is returned.
+
+   \ingroup cv_func_nearest_neighbour
+ */
+AFAPI af_err af_create_nn_index(af_nn_index *index, const af_array train,
+                                const dim_t dist_dim,
+                                const af_match_type dist_type);
+
+/**
+   C Interface to find the nearest train points of an index to a set of
+   query points
+
+   \param[out] idx      is the same as in \ref af_nearest_neighbour
+   \param[out] dist     is the same as in \ref af_nearest_neighbour
+   \param[in]  index    is the index created by \ref af_create_nn_index
+   \param[in]  query    is the array containing the points to be queried. It
+                        must have the type of the train points.
+   \param[in]  dist_dim is the dimension along which the coordinates of a
+                        point are described in \p query
+   \param[in]  n_dist   is the number of nearest neighbour points to return
+                        (currently only values <= 256 are supported)
+   \param[in]  checks   is the maximum number of train points compared with
+                        each query. 0 searches until the results are exact.
+   \return     \ref AF_SUCCESS if the search is successful, otherwise an
+               appropriate error code is returned.
+
+   \ingroup cv_func_nearest_neighbour
+ */
+AFAPI af_err af_nn_index_search(af_array *idx, af_array *dist,
+                                const af_nn_index index, const af_array query,
+                                const dim_t dist_dim, const unsigned n_dist,
+                                const unsigned checks);
+
+/**
+   C Interface to release an index created by \ref af_create_nn_index
+
+   \param[in] index is the index to release
+   \return    \ref AF_SUCCESS if the index is released successfully
+
+   \ingroup cv_func_nearest_neighbour
+ */
+AFAPI af_err af_release_nn_index(af_nn_index index);
+#endif
+
     /**
        C Interface for image template matching
 
@@ -23,48 +23,57 @@ using detail::ushort;
 
 template<typename inType, typename outType, bool isColor>
 static inline af_array bilateral(const af_array &in, const float &sp_sig,
-                                 const float &chr_sig) {
-    return getHandle(bilateral<inType, outType, isColor>(getArray<inType>(in),
-                                                         sp_sig, chr_sig));
+                                 const float &chr_sig,
+                                 const af_bilateral_mode mode) {
+    return getHandle(bilateral<inType, outType, isColor>(
+        getArray<inType>(in), sp_sig, chr_sig, mode));
 }
 
 template<bool isColor>
 static af_err bilateral(af_array *out, const af_array &in, const float &s_sigma,
-                        const float &c_sigma) {
+                        const float &c_sigma, const af_bilateral_mode mode) {
     try {
         const ArrayInfo &info = getInfo(in);
         af_dtype type         = info.getType();
         af::dim4 dims         = info.dims();
 
         DIM_ASSERT(1, (dims.ndims() >= 2));
+        ARG_ASSERT(5, (mode == AF_BILATERAL_DEFAULT ||
+                       mode == AF_BILATERAL_EXACT || mode == AF_BILATERAL_GRID));
 
         af_array output;
         switch (type) {
             case f64:
-                output =
-                    bilateral<double, double, isColor>(in, s_sigma, c_sigma);
+                output = bilateral<double, double, isColor>(in, s_sigma,
+                                                            c_sigma, mode);
                 break;
             case f32:
-                output = bilateral<float, float, isColor>(in, s_sigma, c_sigma);
+                output = bilateral<float, float, isColor>(in, s_sigma, c_sigma,
+                                                          mode);
                 break;
             case b8:
-                output = bilateral<char, float, isColor>(in, s_sigma, c_sigma);
+                output = bilateral<char, float, isColor>(in, s_sigma, c_sigma,
+                                                         mode);
                 break;
             case s32:
-                output = bilateral<int, float, isColor>(in, s_sigma, c_sigma);
+                output = bilateral<int, float, isColor>(in, s_sigma, c_sigma,
+                                                        mode);
                 break;
             case u32:
-                output = bilateral<uint, float, isColor>(in, s_sigma, c_sigma);
+                output = bilateral<uint, float, isColor>(in, s_sigma, c_sigma,
+                                                         mode);
                 break;
             case u8:
-                output = bilateral<uchar, float, isColor>(in, s_sigma, c_sigma);
+                output = bilateral<uchar, float, isColor>(in, s_sigma, c_sigma,
+                                                          mode);
                 break;
             case s16:
-                output = bilateral<short, float, isColor>(in, s_sigma, c_sigma);
+                output = bilateral<short, float, isColor>(in, s_sigma, c_sigma,
+                                                          mode);
                 break;
             case u16:
-                output =
-                    bilateral<ushort, float, isColor>(in, s_sigma, c_sigma);
+                output = bilateral<ushort, float, isColor>(in, s_sigma,
+                                                           c_sigma, mode);
                 break;
             default: TYPE_ERROR(1, type);
         }
@@ -77,11 +86,18 @@ static af_err bilateral(af_array *out, const af_array &in, const float &s_sigma,
 
 af_err af_bilateral(af_array *out, const af_array in, const float spatial_sigma,
                     const float chromatic_sigma, const bool isColor) {
+    return af_bilateral_v2(out, in, spatial_sigma, chromatic_sigma, isColor,
+                           AF_BILATERAL_DEFAULT);
+}
+
+af_err af_bilateral_v2(af_array *out, const af_array in,
+                       const float spatial_sigma, const float chromatic_sigma,
+                       const bool isColor, const af_bilateral_mode mode) {
     af_err err = AF_ERR_UNKNOWN;
     if (isColor) {
-        err = bilateral<true>(out, in, spatial_sigma, chromatic_sigma);
+        err = bilateral<true>(out, in, spatial_sigma, chromatic_sigma, mode);
     } else {
-        err = bilateral<false>(out, in, spatial_sigma, chromatic_sigma);
+        err = bilateral<false>(out, in, spatial_sigma, chromatic_sigma, mode);
     }
     return err;
 }
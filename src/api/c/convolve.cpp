@@ -11,6 +11,7 @@
 #include <arith.hpp>
 #include <backend.hpp>
 #include <cast.hpp>
+#include <common/dispatch.hpp>
 #include <common/err_common.hpp>
 #include <common/half.hpp>
 #include <fftconvolve.hpp>
@@ -22,6 +23,8 @@
 #include <af/ml.h>
 #include <af/signal.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
 
 using af::dim4;
@@ -248,6 +251,37 @@ af_err convolve2_sep(af_array *out, af_array col_filter, af_array row_filter,
     return AF_SUCCESS;
 }
 
+#if defined(AF_CPU)
+/// Cost of a butterfly of the FFT relative to a multiply-add of the spatial
+/// convolution
+constexpr double FFT_BUTTERFLY_COST = 2.0;
+
+/// Returns true if convolving in the frequency domain is cheaper on the CPU.
+/// The spatial kernel does a multiply-add per output and filter element. The
+/// FFT path transforms the zero padded signals, filters and outputs.
+template<int baseDim>
+bool isFFTCheaper(const dim4 &sdims, const dim4 &fdims) {
+    double spatial = 1.0;
+    double padded  = 1.0;
+    for (int i = 0; i < baseDim; i++) {
+        spatial *= static_cast<double>(sdims[i]) * fdims[i];
+        padded *= nextpow2(static_cast<unsigned>(sdims[i] + fdims[i] - 1));
+    }
+
+    double sbatch = 1.0;
+    double fbatch = 1.0;
+    for (int i = baseDim; i < AF_MAX_DIMS; i++) {
+        sbatch *= sdims[i];
+        fbatch *= fdims[i];
+    }
+    const double obatch = std::max(sbatch, fbatch);
+
+    const double fft = FFT_BUTTERFLY_COST * (sbatch + fbatch + obatch) *
+                       padded * std::log2(padded);
+    return fft < spatial * obatch;
+}
+#endif  // defined(AF_CPU)
+
 template<int baseDim>
 bool isFreqDomain(const af_array &signal, const af_array filter,
                   af_conv_domain domain) {
@@ -264,6 +298,19 @@ bool isFreqDomain(const af_array &signal, const af_array filter,
         return true;
     }
 
+#if defined(AF_CPU)
+    // The spatial kernels of the CPU backend handle filters of any size, so
+    // the FFT is also used for smaller filters when it does less work. The
+    // FFT converts other types to floating point and loses their precision.
+    auto isFFTType = [](af_dtype type) {
+        return type == f32 || type == f64 || type == c32 || type == c64;
+    };
+    if (isFFTType(sInfo.getType()) && isFFTType(fInfo.getType()) &&
+        isFFTCheaper<baseDim>(sdims, fdims)) {
+        return true;
+    }
+#endif  // defined(AF_CPU)
+
     int kbatch = 1;
     for (int i = 3; i >= baseDim; i--) { kbatch *= fdims[i]; }
 
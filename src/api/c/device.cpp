@@ -21,6 +21,8 @@
 
 #include <cstring>
 #include <string>
+#include <utility>
+#include <vector>
 
 using af::dim4;
 using common::half;
@@ -268,25 +270,67 @@ static inline void evalMultiple(int num, af_array* arrayPtrs) {
     evalMultiple<T>(arrays);
 }
 
+#if defined(AF_CPU)
+template<typename T>
+static inline void addOutput(std::vector<detail::jit::Output>& outputs,
+                             af_array arr) {
+    outputs.push_back(
+        detail::prepareOutput<T>(*reinterpret_cast<Array<T>*>(arr)));
+}
+
+// Evaluates arrays of different types in a single pass over their inputs
+static void evalMixedTypes(int num, af_array* arrays) {
+    std::vector<detail::jit::Output> outputs;
+    for (int i = 0; i < num; i++) {
+        af_dtype type = getInfo(arrays[i]).getType();
+        switch (type) {
+            case f32: addOutput<float>(outputs, arrays[i]); break;
+            case f64: addOutput<double>(outputs, arrays[i]); break;
+            case c32: addOutput<cfloat>(outputs, arrays[i]); break;
+            case c64: addOutput<cdouble>(outputs, arrays[i]); break;
+            case s32: addOutput<int>(outputs, arrays[i]); break;
+            case u32: addOutput<uint>(outputs, arrays[i]); break;
+            case u8: addOutput<uchar>(outputs, arrays[i]); break;
+            case b8: addOutput<char>(outputs, arrays[i]); break;
+            case s64: addOutput<intl>(outputs, arrays[i]); break;
+            case u64: addOutput<uintl>(outputs, arrays[i]); break;
+            case s16: addOutput<short>(outputs, arrays[i]); break;
+            case u16: addOutput<ushort>(outputs, arrays[i]); break;
+            case f16: addOutput<half>(outputs, arrays[i]); break;
+            default: TYPE_ERROR(0, type);
+        }
+    }
+    detail::evalOutputs(getInfo(arrays[0]).dims(), std::move(outputs));
+}
+#else
+// Arrays of different types are evaluated separately on this backend
+static void evalMixedTypes(int num, af_array* arrays) {
+    for (int i = 0; i < num; i++) { AF_CHECK(af_eval(arrays[i])); }
+}
+#endif
+
 af_err af_eval_multiple(int num, af_array* arrays) {
     try {
         const ArrayInfo& info = getInfo(arrays[0]);
         af_dtype type         = info.getType();
         const dim4& dims      = info.dims();
+        bool same_type        = true;
 
         for (int i = 1; i < num; i++) {
             const ArrayInfo& currInfo = getInfo(arrays[i]);
 
-            // FIXME: This needs to be removed when new functionality is added
-            if (type != currInfo.getType()) {
-                AF_ERROR("All arrays must be of same type", AF_ERR_TYPE);
-            }
+            same_type &= type == currInfo.getType();
 
             if (dims != currInfo.dims()) {
                 AF_ERROR("All arrays must be of same size", AF_ERR_SIZE);
             }
         }
 
+        if (!same_type) {
+            evalMixedTypes(num, arrays);
+            return AF_SUCCESS;
+        }
+
         switch (type) {
             case f32: evalMultiple<float>(num, arrays); break;
             case f64: evalMultiple<double>(num, arrays); break;
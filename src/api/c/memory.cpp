@@ -31,6 +31,7 @@ using detail::cdouble;
 using detail::cfloat;
 using detail::createDeviceDataArray;
 using detail::deviceMemoryInfo;
+using detail::deviceMemoryStats;
 using detail::getActiveDeviceId;
 using detail::getDeviceCount;
 using detail::intl;
@@ -343,6 +344,20 @@ af_err af_get_mem_step_size(size_t *step_bytes) {
     return AF_SUCCESS;
 }
 
+af_err af_device_mem_stats(af_memory_stats *stats, const int device_id) {
+    try {
+        int device = device_id;
+        if (device == -1) { device = getActiveDeviceId(); }
+
+        ARG_ASSERT(0, stats != nullptr);
+        ARG_ASSERT(1, device >= 0 && device < getDeviceCount());
+
+        deviceMemoryStats(stats, device);
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Memory Manager API
 ////////////////////////////////////////////////////////////////////////////////
@@ -782,6 +797,15 @@ size_t MemoryManagerFunctionWrapper::getMemStepSize() {
              AF_ERR_NOT_SUPPORTED);
 }
 
+void MemoryManagerFunctionWrapper::getStats(af_memory_stats *stats,
+                                            const int device) {
+    // Not implemented in the public memory manager API
+    UNUSED(stats);
+    UNUSED(device);
+    AF_ERROR("Memory stats API not implemented for custom memory manager",
+             AF_ERR_NOT_SUPPORTED);
+}
+
 void MemoryManagerFunctionWrapper::setMemStepSize(size_t new_step_size) {
     // Not implemented in the public memory manager API, but for backward
     // compatibility reasons, needs to be in the common memory manager interface
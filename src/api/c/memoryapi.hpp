@@ -43,6 +43,7 @@ class MemoryManagerFunctionWrapper final
     bool isUserLocked(const void *ptr) override;
     size_t getMemStepSize() override;
     void setMemStepSize(size_t new_step_size) override;
+    void getStats(af_memory_stats *stats, const int device) override;
     float getMemoryPressure() override;
     bool jitTreeExceedsMemoryPressure(size_t bytes) override;
 
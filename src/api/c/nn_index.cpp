@@ -0,0 +1,293 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <backend.hpp>
+#include <common/err_common.hpp>
+#include <copy.hpp>
+#include <handle.hpp>
+#include <nn_index.hpp>
+#include <af/defines.h>
+#include <af/dim4.hpp>
+#include <af/vision.h>
+
+#if defined(AF_CPU)
+#include <thread_pool.hpp>
+#endif
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using af::dim4;
+using detail::Array;
+using detail::copyData;
+using detail::createHostDataArray;
+using detail::intl;
+using detail::uchar;
+using detail::uint;
+using detail::uintl;
+using detail::ushort;
+using nn_index::BoundedHeap;
+using nn_index::KdTree;
+using nn_index::MultiIndexHash;
+using std::vector;
+
+/// Minimum number of queries searched by a thread
+static const dim_t NN_INDEX_QUERY_GRAIN = 64;
+
+class NNIndexBase {
+   public:
+    NNIndexBase(af_dtype type, af_match_type dist_type, dim_t nTrain,
+                dim_t len)
+        : type(type), dist_type(dist_type), nTrain(nTrain), len(len) {}
+    virtual ~NNIndexBase() = default;
+
+    virtual void search(af_array *idx, af_array *dist, const af_array query,
+                        const dim_t dist_dim, const uint n_dist,
+                        const uint checks) const = 0;
+
+    const af_dtype type;
+    const af_match_type dist_type;
+    const dim_t nTrain;
+    const dim_t len;
+};
+
+/// Copies the samples of \p in to the host with the features of each sample
+/// next to each other
+template<typename T>
+static vector<T> hostSamples(const af_array in, const dim_t dist_dim) {
+    const Array<T> &arr = getArray<T>(in);
+    const dim4 dims     = arr.dims();
+
+    vector<T> samples(dims.elements());
+    copyData(samples.data(), arr);
+    if (dist_dim == 1) {
+        vector<T> transposed(samples.size());
+        for (dim_t j = 0; j < dims[1]; ++j) {
+            for (dim_t i = 0; i < dims[0]; ++i) {
+                transposed[i * dims[1] + j] = samples[j * dims[0] + i];
+            }
+        }
+        samples.swap(transposed);
+    }
+    return samples;
+}
+
+template<typename T, typename To, typename Searcher>
+class NNIndex : public NNIndexBase {
+   public:
+    NNIndex(const af_array train, const dim_t dist_dim,
+            af_match_type dist_type, dim_t nTrain, dim_t len)
+        : NNIndexBase(getInfo(train).getType(), dist_type, nTrain, len)
+        , samples(hostSamples<T>(train, dist_dim))
+        , searcher(samples.data(), nTrain, len) {}
+
+    void search(af_array *idx, af_array *dist, const af_array query,
+                const dim_t dist_dim, const uint n_dist,
+                const uint checks) const override {
+        const vector<T> queries = hostSamples<T>(query, dist_dim);
+        const dim_t nQuery      = queries.size() / std::max(dim_t(1), len);
+
+        vector<uint> hIdx(n_dist * nQuery);
+        vector<To> hDist(n_dist * nQuery);
+
+        auto searchRange = [&](dim_t begin, dim_t end) {
+            Scratch scratch(
+                std::is_same<Searcher, MultiIndexHash<T>>::value ? nTrain : 0);
+            for (dim_t q = begin; q < end; ++q) {
+                BoundedHeap<To> heap(n_dist);
+                searchWith(searcher, heap, queries.data() + q * len, checks,
+                           scratch);
+
+                const auto &best = heap.sorted();
+                for (size_t r = 0; r < best.size(); ++r) {
+                    hDist[q * n_dist + r] = best[r].first;
+                    hIdx[q * n_dist + r]  = best[r].second;
+                }
+            }
+        };
+
+#if defined(AF_CPU)
+        // The queries are split between the threads of the backend
+        detail::parallel_for(0, nQuery, NN_INDEX_QUERY_GRAIN, searchRange);
+#else
+        searchRange(0, nQuery);
+#endif
+
+        const dim4 outDims(n_dist, nQuery);
+        *idx  = getHandle(createHostDataArray<uint>(outDims, hIdx.data()));
+        *dist = getHandle(createHostDataArray<To>(outDims, hDist.data()));
+    }
+
+   private:
+    /// Per thread state of the multi-index hash searches
+    struct Scratch {
+        explicit Scratch(dim_t n) : visited(n, 0), generation(0) {}
+        vector<unsigned> visited;
+        unsigned generation;
+    };
+
+    template<af_match_type dist_type>
+    static void searchWith(const KdTree<T, To, dist_type> &tree,
+                           BoundedHeap<To> &heap, const T *query, uint checks,
+                           Scratch &) {
+        tree.search(heap, query, checks);
+    }
+
+    static void searchWith(const MultiIndexHash<T> &hash,
+                           BoundedHeap<To> &heap, const T *query, uint checks,
+                           Scratch &scratch) {
+        hash.search(heap, query, checks, scratch.visited, scratch.generation);
+    }
+
+    vector<T> samples;
+    Searcher searcher;
+};
+
+template<typename T, typename To>
+static NNIndexBase *createIndex(const af_array train, const dim_t dist_dim,
+                                const af_match_type dist_type, dim_t nTrain,
+                                dim_t len) {
+    switch (dist_type) {
+        case AF_SAD:
+            return new NNIndex<T, To, KdTree<T, To, AF_SAD>>(
+                train, dist_dim, dist_type, nTrain, len);
+        case AF_SSD:
+            return new NNIndex<T, To, KdTree<T, To, AF_SSD>>(
+                train, dist_dim, dist_type, nTrain, len);
+        default: AF_ERROR("Unsupported dist_type", AF_ERR_NOT_SUPPORTED);
+    }
+}
+
+template<typename T>
+static NNIndexBase *createHashIndex(const af_array train, const dim_t dist_dim,
+                                    dim_t nTrain, dim_t len) {
+    return new NNIndex<T, uint, MultiIndexHash<T>>(train, dist_dim, AF_SHD,
+                                                   nTrain, len);
+}
+
+af_err af_create_nn_index(af_nn_index *index, const af_array train,
+                          const dim_t dist_dim, const af_match_type dist_type) {
+    try {
+        const ArrayInfo &tInfo = getInfo(train);
+        af_dtype tType         = tInfo.getType();
+        af::dim4 tDims         = tInfo.dims();
+
+        DIM_ASSERT(2, tDims[2] == 1 && tDims[3] == 1);
+        DIM_ASSERT(3, (dist_dim == 0 || dist_dim == 1));
+        ARG_ASSERT(4, dist_type == AF_SAD || dist_type == AF_SSD ||
+                          dist_type == AF_SHD);
+
+        const dim_t nTrain = tDims[dist_dim == 0 ? 1 : 0];
+        const dim_t len    = tDims[dist_dim];
+        DIM_ASSERT(2, nTrain > 0 && len > 0);
+
+        NNIndexBase *out = nullptr;
+        if (dist_type == AF_SHD) {
+            switch (tType) {
+                case u8:
+                    out = createHashIndex<uchar>(train, dist_dim, nTrain, len);
+                    break;
+                case u16:
+                    out = createHashIndex<ushort>(train, dist_dim, nTrain, len);
+                    break;
+                case u32:
+                    out = createHashIndex<uint>(train, dist_dim, nTrain, len);
+                    break;
+                case u64:
+                    out = createHashIndex<uintl>(train, dist_dim, nTrain, len);
+                    break;
+                default: TYPE_ERROR(1, tType);
+            }
+        } else {
+            switch (tType) {
+                case f32:
+                    out = createIndex<float, float>(train, dist_dim, dist_type,
+                                                    nTrain, len);
+                    break;
+                case f64:
+                    out = createIndex<double, double>(train, dist_dim,
+                                                      dist_type, nTrain, len);
+                    break;
+                case s32:
+                    out = createIndex<int, int>(train, dist_dim, dist_type,
+                                                nTrain, len);
+                    break;
+                case u32:
+                    out = createIndex<uint, uint>(train, dist_dim, dist_type,
+                                                  nTrain, len);
+                    break;
+                case s64:
+                    out = createIndex<intl, intl>(train, dist_dim, dist_type,
+                                                  nTrain, len);
+                    break;
+                case u64:
+                    out = createIndex<uintl, uintl>(train, dist_dim, dist_type,
+                                                    nTrain, len);
+                    break;
+                case s16:
+                    out = createIndex<short, int>(train, dist_dim, dist_type,
+                                                  nTrain, len);
+                    break;
+                case u16:
+                    out = createIndex<ushort, uint>(train, dist_dim, dist_type,
+                                                    nTrain, len);
+                    break;
+                case u8:
+                    out = createIndex<uchar, uint>(train, dist_dim, dist_type,
+                                                   nTrain, len);
+                    break;
+                default: TYPE_ERROR(1, tType);
+            }
+        }
+        *index = static_cast<af_nn_index>(out);
+    }
+    CATCHALL;
+
+    return AF_SUCCESS;
+}
+
+af_err af_nn_index_search(af_array *idx, af_array *dist,
+                          const af_nn_index index, const af_array query,
+                          const dim_t dist_dim, const unsigned n_dist,
+                          const unsigned checks) {
+    try {
+        ARG_ASSERT(2, index != 0);
+        const NNIndexBase *nn = static_cast<const NNIndexBase *>(index);
+
+        const ArrayInfo &qInfo = getInfo(query);
+        af::dim4 qDims         = qInfo.dims();
+
+        DIM_ASSERT(4, (dist_dim == 0 || dist_dim == 1));
+        DIM_ASSERT(3, qDims[dist_dim] == nn->len);
+        DIM_ASSERT(3, qDims[2] == 1 && qDims[3] == 1);
+        DIM_ASSERT(5, n_dist > 0 && n_dist <= (uint)nn->nTrain);
+        ARG_ASSERT(5, n_dist > 0 && n_dist <= 256);
+        TYPE_ASSERT(qInfo.getType() == nn->type);
+
+        af_array oIdx;
+        af_array oDist;
+        nn->search(&oIdx, &oDist, query, dist_dim, n_dist, checks);
+        std::swap(*idx, oIdx);
+        std::swap(*dist, oDist);
+    }
+    CATCHALL;
+
+    return AF_SUCCESS;
+}
+
+af_err af_release_nn_index(af_nn_index index) {
+    try {
+        delete static_cast<NNIndexBase *>(index);
+    }
+    CATCHALL;
+
+    return AF_SUCCESS;
+}
@@ -0,0 +1,401 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+#include <af/defines.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Host side search structures behind af_nn_index. The train samples are
+// stored row by row: the features of a sample are contiguous.
+namespace nn_index {
+
+inline unsigned popcount64(uint64_t val) {
+#if defined(_MSC_VER)
+    return static_cast<unsigned>(__popcnt64(val));
+#else
+    return static_cast<unsigned>(__builtin_popcountll(val));
+#endif
+}
+
+/// Distance between two samples with \p len contiguous features
+template<typename T, typename To, af_match_type dist_type>
+struct Distance;
+
+template<typename T, typename To>
+struct Distance<T, To, AF_SAD> {
+    To operator()(const T *a, const T *b, dim_t len) const {
+        To dist = 0;
+        for (dim_t k = 0; k < len; ++k) {
+            dist += To(std::abs(double(a[k]) - double(b[k])));
+        }
+        return dist;
+    }
+
+    /// Lower bound of the distance to the samples on the other side of a
+    /// split which is \p diff away along one feature
+    static double bound(double diff) { return std::abs(diff); }
+};
+
+template<typename T, typename To>
+struct Distance<T, To, AF_SSD> {
+    To operator()(const T *a, const T *b, dim_t len) const {
+        To dist = 0;
+        for (dim_t k = 0; k < len; ++k) {
+            const auto diff = a[k] - b[k];
+            dist += To(diff * diff);
+        }
+        return dist;
+    }
+
+    static double bound(double diff) { return diff * diff; }
+};
+
+template<typename T, typename To>
+struct Distance<T, To, AF_SHD> {
+    To operator()(const T *a, const T *b, dim_t len) const {
+        // Whole 64 bit words are compared at once
+        constexpr dim_t perWord = sizeof(uint64_t) / sizeof(T);
+        const dim_t nwords      = len / perWord;
+
+        To dist = 0;
+        for (dim_t w = 0; w < nwords; ++w) {
+            uint64_t aw, bw;
+            std::memcpy(&aw, a + w * perWord, sizeof(uint64_t));
+            std::memcpy(&bw, b + w * perWord, sizeof(uint64_t));
+            dist += popcount64(aw ^ bw);
+        }
+        for (dim_t k = nwords * perWord; k < len; ++k) {
+            dist += popcount64(uint64_t(a[k] ^ b[k]));
+        }
+        return dist;
+    }
+};
+
+/// Keeps the \p k smallest (distance, index) pairs pushed into it
+template<typename To>
+class BoundedHeap {
+   public:
+    using Entry = std::pair<To, unsigned>;
+
+    explicit BoundedHeap(unsigned k) : k(k) { entries.reserve(k); }
+
+    bool full() const { return entries.size() == k; }
+
+    /// Largest distance kept. Only valid when the heap is full.
+    To worst() const { return entries.front().first; }
+
+    void push(To dist, unsigned idx) {
+        const Entry entry(dist, idx);
+        if (entries.size() < k) {
+            entries.push_back(entry);
+            std::push_heap(entries.begin(), entries.end());
+        } else if (entry < entries.front()) {
+            std::pop_heap(entries.begin(), entries.end());
+            entries.back() = entry;
+            std::push_heap(entries.begin(), entries.end());
+        }
+    }
+
+    /// Sorts the entries from the smallest to the largest distance
+    const std::vector<Entry> &sorted() {
+        std::sort_heap(entries.begin(), entries.end());
+        return entries;
+    }
+
+   private:
+    unsigned k;
+    std::vector<Entry> entries;
+};
+
+/// k-d tree searched best bin first, for the SAD and SSD distances
+///
+/// Every node splits its samples at the median of the feature with the
+/// largest variance. A search first descends to the leaf of the query and
+/// then visits the other branches in the order of a lower bound of their
+/// distance to the query. It stops when no branch can hold a closer sample,
+/// which is exact, or after \p checks distances, which is approximate.
+template<typename T, typename To, af_match_type dist_type>
+class KdTree {
+   public:
+    /// Maximum number of samples in a leaf
+    static constexpr unsigned LEAF_SIZE = 16;
+
+    /// Number of samples used to estimate the variance of the features
+    static constexpr unsigned VARIANCE_SAMPLES = 128;
+
+    KdTree(const T *data, dim_t n, dim_t len) : data(data), len(len) {
+        order.resize(n);
+        for (dim_t i = 0; i < n; ++i) { order[i] = static_cast<unsigned>(i); }
+        build(0, static_cast<unsigned>(n));
+    }
+
+    void search(BoundedHeap<To> &heap, const T *query, unsigned checks) const {
+        using Branch = std::pair<double, unsigned>;
+        std::priority_queue<Branch, std::vector<Branch>, std::greater<Branch>>
+            branches;
+        Distance<T, To, dist_type> distance;
+
+        unsigned checked = 0;
+        branches.push(Branch(0.0, 0));
+        while (!branches.empty()) {
+            const Branch branch = branches.top();
+            branches.pop();
+            if (heap.full() && branch.first > double(heap.worst())) { break; }
+
+            unsigned n = branch.second;
+            while (nodes[n].left != 0) {
+                const Node &node  = nodes[n];
+                const double diff = double(query[node.feature]) - node.split;
+                const bool right  = diff >= 0.0;
+                const double far  = std::max(
+                    branch.first, Distance<T, To, dist_type>::bound(diff));
+                branches.push(Branch(far, right ? node.left : node.right));
+                n = right ? node.right : node.left;
+            }
+
+            for (unsigned i = nodes[n].begin; i < nodes[n].end; ++i) {
+                const unsigned sample = order[i];
+                heap.push(distance(query, data + sample * len, len), sample);
+            }
+            checked += nodes[n].end - nodes[n].begin;
+            if (checks != 0 && checked >= checks) { break; }
+        }
+    }
+
+   private:
+    struct Node {
+        unsigned begin;
+        unsigned end;
+        // Children of an internal node. Leaves have no children.
+        unsigned left;
+        unsigned right;
+        dim_t feature;
+        double split;
+    };
+
+    unsigned build(unsigned begin, unsigned end) {
+        const unsigned n = static_cast<unsigned>(nodes.size());
+        nodes.push_back(Node{begin, end, 0, 0, 0, 0.0});
+        if (end - begin <= LEAF_SIZE) { return n; }
+
+        const dim_t feature = widestFeature(begin, end);
+        const unsigned mid  = begin + (end - begin) / 2;
+        auto less = [this, feature](unsigned a, unsigned b) {
+            return data[a * len + feature] < data[b * len + feature];
+        };
+        std::nth_element(order.begin() + begin, order.begin() + mid,
+                         order.begin() + end, less);
+
+        const double split   = double(data[order[mid] * len + feature]);
+        const unsigned left  = build(begin, mid);
+        const unsigned right = build(mid, end);
+
+        nodes[n].left    = left;
+        nodes[n].right   = right;
+        nodes[n].feature = feature;
+        nodes[n].split   = split;
+        return n;
+    }
+
+    dim_t widestFeature(unsigned begin, unsigned end) const {
+        const unsigned step = std::max(1u, (end - begin) / VARIANCE_SAMPLES);
+        std::vector<double> sum(len, 0.0), sumSq(len, 0.0);
+        unsigned count = 0;
+        for (unsigned i = begin; i < end; i += step, ++count) {
+            const T *sample = data + order[i] * len;
+            for (dim_t k = 0; k < len; ++k) {
+                sum[k] += double(sample[k]);
+                sumSq[k] += double(sample[k]) * double(sample[k]);
+            }
+        }
+
+        dim_t widest     = 0;
+        double widestVar = -1.0;
+        for (dim_t k = 0; k < len; ++k) {
+            const double mean = sum[k] / count;
+            const double var  = sumSq[k] / count - mean * mean;
+            if (var > widestVar) {
+                widest    = k;
+                widestVar = var;
+            }
+        }
+        return widest;
+    }
+
+    const T *data;
+    dim_t len;
+    std::vector<unsigned> order;
+    std::vector<Node> nodes;
+};
+
+/// Multi-index hashing for the SHD distance
+///
+/// The bits of every sample are split into substrings of up to 16 bits and
+/// each substring indexes its own hash table. A search probes the buckets of
+/// each table in the order of their Hamming distance to the same substring
+/// of the query. After all the buckets at distance r have been probed, any
+/// sample which was not found is at least m * (r + 1) away from the query,
+/// where m is the number of tables, so the search stops as soon as the heap
+/// holds closer samples or after \p checks distances.
+template<typename T>
+class MultiIndexHash {
+   public:
+    static constexpr unsigned MAX_SUBSTRING_BITS = 16;
+
+    MultiIndexHash(const T *data, dim_t n, dim_t len)
+        : data(data), n(n), len(len) {
+        const dim_t nbits = len * 8 * sizeof(T);
+
+        // Buckets hold about one sample each with log2(n) bit substrings
+        unsigned bits = 1;
+        while (bits < MAX_SUBSTRING_BITS && (dim_t(1) << (bits + 1)) <= n) {
+            ++bits;
+        }
+        bits = static_cast<unsigned>(std::min<dim_t>(bits, nbits));
+
+        for (dim_t first = 0; first < nbits; first += bits) {
+            Table table;
+            table.first = first;
+            table.bits =
+                static_cast<unsigned>(std::min<dim_t>(bits, nbits - first));
+
+            const size_t nkeys = size_t(1) << table.bits;
+            table.offsets.assign(nkeys + 1, 0);
+            std::vector<uint32_t> keys(n);
+            for (dim_t i = 0; i < n; ++i) {
+                keys[i] = substring(data + i * len, table);
+                table.offsets[keys[i] + 1]++;
+            }
+            for (size_t k = 0; k < nkeys; ++k) {
+                table.offsets[k + 1] += table.offsets[k];
+            }
+            table.samples.resize(n);
+            std::vector<unsigned> next(table.offsets.begin(),
+                                       table.offsets.end() - 1);
+            for (dim_t i = 0; i < n; ++i) {
+                table.samples[next[keys[i]]++] = static_cast<unsigned>(i);
+            }
+            tables.push_back(std::move(table));
+        }
+    }
+
+    /// Searches for the closest samples to \p query. \p visited must hold n
+    /// elements and is reused between the searches of a thread.
+    template<typename To>
+    void search(BoundedHeap<To> &heap, const T *query, unsigned checks,
+                std::vector<unsigned> &visited, unsigned &generation) const {
+        if (++generation == 0) {
+            std::fill(visited.begin(), visited.end(), 0);
+            generation = 1;
+        }
+        Distance<T, To, AF_SHD> distance;
+
+        const dim_t limit = checks == 0 ? n : std::min<dim_t>(checks, n);
+        dim_t checked     = 0;
+        auto visit        = [&](unsigned sample) {
+            if (visited[sample] == generation) { return; }
+            visited[sample] = generation;
+            heap.push(distance(query, data + sample * len, len), sample);
+            ++checked;
+        };
+
+        std::vector<uint32_t> keys(tables.size());
+        for (size_t t = 0; t < tables.size(); ++t) {
+            keys[t] = substring(query, tables[t]);
+        }
+
+        const unsigned maxBits = tables.front().bits;
+        for (unsigned r = 0; r <= maxBits && checked < limit; ++r) {
+            // Enumerating the buckets costs more than scanning the samples
+            // which are left once there are more buckets than samples
+            if (probes(r) > double(n - checked)) {
+                for (dim_t i = 0; i < n && checked < limit; ++i) {
+                    visit(static_cast<unsigned>(i));
+                }
+                return;
+            }
+
+            for (size_t t = 0; t < tables.size() && checked < limit; ++t) {
+                const Table &table = tables[t];
+                if (r > table.bits) { continue; }
+
+                // Visits every mask of table.bits bits with r bits set
+                const uint32_t end = uint32_t(1) << table.bits;
+                uint32_t mask      = (uint32_t(1) << r) - 1;
+                while (mask < end && checked < limit) {
+                    const uint32_t key = keys[t] ^ mask;
+                    for (unsigned i = table.offsets[key];
+                         i < table.offsets[key + 1] && checked < limit; ++i) {
+                        visit(table.samples[i]);
+                    }
+                    if (mask == 0) { break; }
+                    const uint32_t low  = mask & (~mask + 1);
+                    const uint32_t high = mask + low;
+                    mask = high | (((mask ^ high) >> 2) / low);
+                }
+            }
+
+            const double unseen = double(tables.size()) * (r + 1);
+            if (heap.full() && double(heap.worst()) < unseen) { return; }
+        }
+    }
+
+   private:
+    struct Table {
+        dim_t first;
+        unsigned bits;
+        std::vector<unsigned> offsets;
+        std::vector<unsigned> samples;
+    };
+
+    uint32_t substring(const T *sample, const Table &table) const {
+        constexpr dim_t elemBits = 8 * sizeof(T);
+        uint32_t key             = 0;
+        for (unsigned b = 0; b < table.bits; ++b) {
+            const dim_t bit     = table.first + b;
+            const uint64_t elem = uint64_t(sample[bit / elemBits]);
+            key |= uint32_t((elem >> (bit % elemBits)) & 1) << b;
+        }
+        return key;
+    }
+
+    /// Number of buckets probed at distance \p r in all the tables
+    double probes(unsigned r) const {
+        double total = 0.0;
+        for (const Table &table : tables) {
+            if (r > table.bits) { continue; }
+            double combinations = 1.0;
+            for (unsigned i = 0; i < r; ++i) {
+                combinations = combinations * (table.bits - i) / (i + 1);
+            }
+            total += combinations;
+        }
+        return total;
+    }
+
+    const T *data;
+    dim_t n;
+    dim_t len;
+    std::vector<Table> tables;
+};
+
+}  // namespace nn_index
@@ -7,15 +7,28 @@
  * http://arrayfire.com/licenses/BSD-3-Clause
  ********************************************************/
 
+#if defined(OS_WIN)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <backend.hpp>
 #include <common/ArrayInfo.hpp>
+#include <common/dispatch.hpp>
 #include <common/err_common.hpp>
+#include <copy.hpp>
 #include <handle.hpp>
 #include <type_util.hpp>
 
 #include <af/array.h>
 #include <af/index.h>
+#include <af/util.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <vector>
@@ -26,6 +39,8 @@ using std::vector;
 using af::dim4;
 using detail::cdouble;
 using detail::cfloat;
+using detail::copyData;
+using detail::createEmptyArray;
 using detail::createHostDataArray;
 using detail::intl;
 using detail::uchar;
@@ -33,12 +48,300 @@ using detail::uint;
 using detail::uintl;
 using detail::ushort;
 
-#define STREAM_FORMAT_VERSION 0x1
+#define STREAM_FORMAT_VERSION 0x2
 static const char sfv_char = STREAM_FORMAT_VERSION;
 
+// The data of the arrays in version 2 files starts at multiples of this many
+// bytes. The header is padded to the same size.
+static const intl STREAM_ALIGNMENT = 64;
+
+namespace {
+
+/// An array stored in a version 2 file
+struct StreamEntry {
+    string key;
+    af_dtype type;
+    dim4 dims;
+    // Position of the data from the start of the file
+    intl offset;
+};
+
+/// Maps the bytes [offset, offset + bytes) of a file into memory. A writable
+/// mapping extends the file if it ends before the range.
+class FileMapping {
+   public:
+    FileMapping(const string &filename, intl offset, intl bytes,
+                bool writable);
+    ~FileMapping() { release(); }
+
+    FileMapping(const FileMapping &) = delete;
+    FileMapping &operator=(const FileMapping &) = delete;
+
+    char *data() const { return static_cast<char *>(base) + skip; }
+
+   private:
+    void release();
+
+    void *base  = nullptr;
+    size_t skip = 0;
+    size_t length;
+#if defined(OS_WIN)
+    HANDLE file    = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    int fd = -1;
+#endif
+};
+
+FileMapping::FileMapping(const string &filename, intl offset, intl bytes,
+                         bool writable) {
+    const intl end = offset + bytes;
+#if defined(OS_WIN)
+    file = CreateFileA(filename.c_str(),
+                       writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                       FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        AF_ERROR(("Failed to open: " + filename).c_str(), AF_ERR_ARG);
+    }
+
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    if (size.QuadPart < end && !writable) {
+        release();
+        AF_ERROR((filename + " is truncated").c_str(), AF_ERR_ARG);
+    }
+
+    // A writable mapping larger than the file extends it
+    ULARGE_INTEGER max_size;
+    max_size.QuadPart = size.QuadPart < end ? end : size.QuadPart;
+    mapping = CreateFileMappingA(file, NULL,
+                                 writable ? PAGE_READWRITE : PAGE_READONLY,
+                                 max_size.HighPart, max_size.LowPart, NULL);
+
+    SYSTEM_INFO sys_info;
+    GetSystemInfo(&sys_info);
+    skip   = offset % sys_info.dwAllocationGranularity;
+    length = bytes + skip;
+
+    ULARGE_INTEGER start;
+    start.QuadPart = offset - skip;
+    if (mapping != NULL) {
+        base = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+                             start.HighPart, start.LowPart, length);
+    }
+#else
+    fd = open(filename.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd == -1) {
+        AF_ERROR(("Failed to open: " + filename).c_str(), AF_ERR_ARG);
+    }
+
+    struct stat status;
+    fstat(fd, &status);
+    if (status.st_size < end) {
+        if (!writable) {
+            release();
+            AF_ERROR((filename + " is truncated").c_str(), AF_ERR_ARG);
+        }
+        if (ftruncate(fd, end) != 0) {
+            release();
+            AF_ERROR(("Failed to resize: " + filename).c_str(), AF_ERR_ARG);
+        }
+    }
+
+    skip   = offset % sysconf(_SC_PAGESIZE);
+    length = bytes + skip;
+
+    base = mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                MAP_SHARED, fd, offset - skip);
+    if (base == MAP_FAILED) { base = nullptr; }
+#endif
+    if (base == nullptr) {
+        release();
+        AF_ERROR(("Failed to map: " + filename).c_str(), AF_ERR_ARG);
+    }
+}
+
+void FileMapping::release() {
+#if defined(OS_WIN)
+    if (base) { UnmapViewOfFile(base); }
+    if (mapping != NULL) { CloseHandle(mapping); }
+    if (file != INVALID_HANDLE_VALUE) { CloseHandle(file); }
+#else
+    if (base) { munmap(base, length); }
+    if (fd != -1) { close(fd); }
+#endif
+}
+
+}  // namespace
+
+// Returns the version of the file or 0 if the file is missing or empty
+static char fileVersion(const string &filename) {
+    char version = 0;
+    std::ifstream fs(filename, std::ifstream::in | std::ifstream::binary);
+    if (fs.is_open()) { fs.read(&version, sizeof(char)); }
+    return fs ? version : 0;
+}
+
+static char checkVersion(const string &filename) {
+    std::ifstream fs(filename, std::ifstream::in | std::ifstream::binary);
+
+    // Throw exception if file is not open
+    if (!fs.is_open()) {
+        std::string errStr = "Failed to open: " + filename;
+        AF_ERROR(errStr.c_str(), AF_ERR_ARG);
+    }
+
+    if (fs.peek() == std::ifstream::traits_type::eof()) {
+        std::string errStr = filename + " is empty";
+        AF_ERROR(errStr.c_str(), AF_ERR_ARG);
+    }
+
+    char version = 0;
+    fs.read(&version, sizeof(char));
+    return version;
+}
+
+static vector<StreamEntry> readIndexV2(const string &filename,
+                                       intl *data_end = nullptr) {
+    // (char   )   Version
+    // (char   )   Padding (x 3)
+    // (int    )   No. of Arrays
+    // (intl   )   Position of the index from the start of the file
+    // (intl   )   Size of the index in bytes
+    std::ifstream fs(filename, std::ifstream::in | std::ifstream::binary);
+    if (!fs.is_open()) {
+        std::string errStr = "Failed to open: " + filename;
+        AF_ERROR(errStr.c_str(), AF_ERR_ARG);
+    }
+
+    fs.seekg(0, std::ios_base::end);
+    const intl file_size = fs.tellg();
+
+    int n_arrays      = 0;
+    intl index_offset = 0;
+    intl index_bytes  = 0;
+    fs.seekg(4);
+    fs.read(reinterpret_cast<char *>(&n_arrays), sizeof(int));
+    fs.read(reinterpret_cast<char *>(&index_offset), sizeof(intl));
+    fs.read(reinterpret_cast<char *>(&index_bytes), sizeof(intl));
+
+    // Every entry of the index takes at least this many bytes
+    const intl min_entry_bytes = sizeof(int) + sizeof(char) + 5 * sizeof(intl);
+    if (!fs || n_arrays < 0 || index_offset < STREAM_ALIGNMENT ||
+        index_bytes < n_arrays * min_entry_bytes ||
+        index_bytes > file_size - index_offset) {
+        std::string errStr = "Corrupt header in " + filename;
+        AF_ERROR(errStr.c_str(), AF_ERR_ARG);
+    }
+
+    vector<char> index(index_bytes);
+    fs.seekg(index_offset);
+    fs.read(index.data(), index_bytes);
+    if (!fs) {
+        std::string errStr = "Failed to read the index of " + filename;
+        AF_ERROR(errStr.c_str(), AF_ERR_ARG);
+    }
+    if (data_end) { *data_end = index_offset; }
+
+    // Per array
+    // (int    )   Length of the key
+    // (cstring)   Key
+    // (char   )   Type
+    // (intl   )   dim4 (x 4)
+    // (intl   )   Position of the data from the start of the file
+    const std::string corrupt = "Corrupt index in " + filename;
+    size_t pos = 0;
+    auto read  = [&](void *dst, size_t bytes) {
+        if (bytes > index.size() - pos) {
+            AF_ERROR(corrupt.c_str(), AF_ERR_ARG);
+        }
+        std::copy(&index[pos], &index[pos] + bytes, static_cast<char *>(dst));
+        pos += bytes;
+    };
+
+    vector<StreamEntry> entries(n_arrays);
+    for (StreamEntry &entry : entries) {
+        int klen = 0;
+        read(&klen, sizeof(int));
+        if (klen < 0 || static_cast<size_t>(klen) > index.size() - pos) {
+            AF_ERROR(corrupt.c_str(), AF_ERR_ARG);
+        }
+        entry.key.resize(klen);
+        read(&entry.key[0], klen);
+
+        char type = 0;
+        read(&type, sizeof(char));
+        entry.type = static_cast<af_dtype>(type);
+
+        intl dims[4];
+        read(dims, 4 * sizeof(intl));
+        entry.dims = dim4(dims[0], dims[1], dims[2], dims[3]);
+        read(&entry.offset, sizeof(intl));
+
+        // The data of the array has to lie between the header and the index.
+        // The size is accumulated so that it can not overflow.
+        intl bytes = size_of(entry.type);
+        bool valid = bytes > 0 && entry.offset >= STREAM_ALIGNMENT;
+        for (int i = 0; i < 4 && valid; i++) {
+            valid = dims[i] == 0 ||
+                    (dims[i] > 0 && bytes <= index_offset / dims[i]);
+            if (valid) { bytes *= dims[i]; }
+        }
+        if (!valid || bytes > index_offset - entry.offset) {
+            AF_ERROR(corrupt.c_str(), AF_ERR_ARG);
+        }
+    }
+    return entries;
+}
+
+static void writeIndexV2(const string &filename,
+                         const vector<StreamEntry> &entries,
+                         intl index_offset) {
+    vector<char> index;
+    auto write = [&index](const void *src, size_t bytes) {
+        const char *ptr = static_cast<const char *>(src);
+        index.insert(index.end(), ptr, ptr + bytes);
+    };
+
+    for (const StreamEntry &entry : entries) {
+        int klen  = entry.key.size();
+        char type = entry.type;
+        intl dims[4];
+        for (int i = 0; i < 4; i++) { dims[i] = entry.dims[i]; }
+
+        write(&klen, sizeof(int));
+        write(entry.key.c_str(), klen);
+        write(&type, sizeof(char));
+        write(dims, 4 * sizeof(intl));
+        write(&entry.offset, sizeof(intl));
+    }
+
+    std::fstream fs(filename, std::fstream::in | std::fstream::out |
+                                  std::fstream::binary);
+    if (!fs.is_open()) { AF_ERROR("File failed to open", AF_ERR_ARG); }
+
+    // The index is written before the header so that the header never points
+    // to an index which was not completely written
+    fs.seekp(index_offset);
+    fs.write(index.data(), index.size());
+
+    const char padding[3] = {0, 0, 0};
+    int n_arrays          = entries.size();
+    intl index_bytes      = index.size();
+    fs.seekp(0);
+    fs.write(&sfv_char, 1);
+    fs.write(padding, 3);
+    fs.write(reinterpret_cast<char *>(&n_arrays), sizeof(int));
+    fs.write(reinterpret_cast<char *>(&index_offset), sizeof(intl));
+    fs.write(reinterpret_cast<char *>(&index_bytes), sizeof(intl));
+    fs.close();
+
+    if (fs.fail()) { AF_ERROR("Failed to write to file", AF_ERR_ARG); }
+}
+
 template<typename T>
-static int save(const char *key, const af_array arr, const char *filename,
-                const bool append = false) {
+static int saveV1(const char *key, const af_array arr, const char *filename) {
     // (char     )   Version (Once)
     // (int      )   No. of Arrays (Once)
     // (int    )   Length of the key
@@ -55,7 +358,7 @@ static int save(const char *key, const af_array arr, const char *filename,
     const ArrayInfo &info = getInfo(arr);
     std::vector<T> data(info.elements());
 
-    AF_CHECK(af_get_data_ptr(&data.front(), arr));
+    AF_CHECK(af_get_data_ptr(data.data(), arr));
 
     char type = info.getType();
 
@@ -65,65 +368,84 @@ static int save(const char *key, const af_array arr, const char *filename,
     intl offset = sizeof(char) + 4 * sizeof(intl) + info.elements() * sizeof(T);
     ///////////////////////////////////////////////////////////////////////////
 
-    std::fstream fs;
-    int n_arrays = 0;
-
-    if (append) {
-        std::ifstream checkIfExists(filename);
-        bool exists = checkIfExists.good();
-        checkIfExists.close();
-        if (exists) {
-            fs.open(filename, std::fstream::in | std::fstream::out |
+    // Only used to append to files written in version 1
+    std::fstream fs(filename, std::fstream::in | std::fstream::out |
                                   std::fstream::binary);
-        } else {
-            fs.open(filename, std::fstream::out | std::fstream::binary);
-        }
 
-        // Throw exception if file is not open
-        if (!fs.is_open()) { AF_ERROR("File failed to open", AF_ERR_ARG); }
-
-        // Assert Version
-        if (fs.peek() == std::fstream::traits_type::eof()) {
-            // File is empty
-            fs.clear();
-        } else {
-            char prev_version = 0;
-            fs.read(&prev_version, sizeof(char));
-
-            AF_ASSERT(
-                prev_version == sfv_char,
-                "ArrayFire data format has changed. Can't append to file");
-
-            fs.read(reinterpret_cast<char *>(&n_arrays), sizeof(int));
-        }
-    } else {
-        fs.open(filename,
-                std::fstream::out | std::fstream::binary | std::fstream::trunc);
+    // Throw exception if file is not open
+    if (!fs.is_open()) { AF_ERROR("File failed to open", AF_ERR_ARG); }
 
-        // Throw exception if file is not open
-        if (!fs.is_open()) { AF_ERROR("File failed to open", AF_ERR_ARG); }
-    }
+    int n_arrays = 0;
+    fs.seekg(1);
+    fs.read(reinterpret_cast<char *>(&n_arrays), sizeof(int));
 
     n_arrays++;
 
-    // Write version and n_arrays to top of file
-    fs.seekp(0);
-    fs.write(&sfv_char, 1);
+    // Write n_arrays to top of file
+    fs.seekp(1);
     fs.write(reinterpret_cast<char *>(&n_arrays), sizeof(int));
 
-    // Write array to end of file. Irrespective of new or append
+    // Write array to end of file
     fs.seekp(0, std::ios_base::end);
     fs.write(reinterpret_cast<char *>(&klen), sizeof(int));
     fs.write(k.c_str(), klen);
     fs.write(reinterpret_cast<char *>(&offset), sizeof(intl));
     fs.write(&type, sizeof(char));
     fs.write(reinterpret_cast<char *>(&odims), sizeof(intl) * 4);
-    fs.write(reinterpret_cast<char *>(&data.front()), sizeof(T) * data.size());
+    fs.write(reinterpret_cast<char *>(data.data()), sizeof(T) * data.size());
     fs.close();
 
     return n_arrays - 1;
 }
 
+template<typename T>
+static int save(const char *key, const af_array arr, const char *filename,
+                const bool append = false) {
+    // Version 2 files start with a header and end with an index of the
+    // arrays. The data of an appended array is aligned to STREAM_ALIGNMENT
+    // bytes and overwrites the old index, which starts right after the data
+    // of the last array. The new index is written after the data and the
+    // header last, so the file only grows by the new data and index entry.
+    // An append which fails before the header is written can leave the
+    // header pointing to a partly overwritten index.
+    const ArrayInfo &info = getInfo(arr);
+    const char version    = append ? fileVersion(filename) : 0;
+    if (version == 1) { return saveV1<T>(key, arr, filename); }
+
+    vector<StreamEntry> entries;
+    intl data_end = 0;
+    if (version == sfv_char) {
+        entries = readIndexV2(filename, &data_end);
+    } else {
+        AF_ASSERT(version == 0,
+                  "ArrayFire data format has changed. Can't append to file");
+
+        // Create the file or discard its contents
+        std::ofstream fs(filename, std::ofstream::out | std::ofstream::binary |
+                                       std::ofstream::trunc);
+        if (!fs.is_open()) { AF_ERROR("File failed to open", AF_ERR_ARG); }
+    }
+
+    StreamEntry entry;
+    entry.key    = key;
+    entry.type   = info.getType();
+    entry.dims   = info.dims();
+    entry.offset = std::max(STREAM_ALIGNMENT, data_end);
+    entry.offset = divup(entry.offset, STREAM_ALIGNMENT) * STREAM_ALIGNMENT;
+
+    // Copy the array straight into the file
+    const intl bytes = info.elements() * sizeof(T);
+    if (bytes > 0) {
+        FileMapping mapping(filename, entry.offset, bytes, true);
+        copyData(reinterpret_cast<T *>(mapping.data()), getArray<T>(arr));
+    }
+
+    entries.push_back(entry);
+    writeIndexV2(filename, entries, entry.offset + bytes);
+
+    return entries.size() - 1;
+}
+
 af_err af_save_array(int *index, const char *key, const af_array arr,
                      const char *filename, const bool append) {
     try {
@@ -252,53 +574,124 @@ static af_array readArrayV1(const char *filename, const unsigned index) {
     return out;
 }
 
-static af_array checkVersionAndRead(const char *filename,
-                                    const unsigned index) {
-    char version = 0;
+template<typename T>
+static af_array readDataV2(const string &filename, const StreamEntry &entry,
+                           const vector<af_seq> &index) {
+    const dim4 &idims = entry.dims;
+    if (idims.elements() == 0) {
+        return getHandle(createEmptyArray<T>(idims));
+    }
 
-    std::string filenameStr = std::string(filename);
-    std::fstream fs(filenameStr, std::fstream::in | std::fstream::binary);
-    // Throw exception if file is not open
-    if (!fs.is_open()) {
-        std::string errStr = "Failed to open: " + filenameStr;
-        AF_ERROR(errStr.c_str(), AF_ERR_ARG);
+    dim4 istrides = calcStrides(idims);
+    dim4 odims    = toDims(index, idims);
+    dim4 offsets  = toOffset(index, idims);
+
+    // Positions of the first element of the slice and of the lowest and
+    // highest elements it reads
+    dim_t start = 0;
+    dim_t first = 0;
+    dim_t last  = 0;
+    dim4 strides;
+    for (int i = 0; i < 4; i++) {
+        dim_t step = index[i].step == 0 ? 1 : index[i].step;
+        dim_t end  = offsets[i] + (odims[i] - 1) * step;
+        AF_ASSERT(offsets[i] >= 0 && offsets[i] < idims[i] && end >= 0 &&
+                      end < idims[i],
+                  "Index out of bounds");
+
+        strides[i] = step * istrides[i];
+        start += offsets[i] * istrides[i];
+        first += std::min(end, offsets[i]) * istrides[i];
+        last += std::max(end, offsets[i]) * istrides[i];
     }
 
-    if (fs.peek() == std::fstream::traits_type::eof()) {
-        std::string errStr = filenameStr + " is empty";
-        AF_ERROR(errStr.c_str(), AF_ERR_ARG);
-    } else {
-        fs.read(&version, sizeof(char));
+    // Only the pages of the file holding the slice are read
+    FileMapping mapping(filename, entry.offset + first * sizeof(T),
+                        (last - first + 1) * sizeof(T), false);
+    const T *in = reinterpret_cast<const T *>(mapping.data());
+
+    // The elements of contiguous slices are copied from the file directly
+    if (start == first && last - first + 1 == odims.elements()) {
+        return getHandle(createHostDataArray<T>(odims, in));
     }
-    fs.close();
+
+    vector<T> data(odims.elements());
+    T *out = data.data();
+    in += start - first;
+    for (dim_t l = 0; l < odims[3]; l++) {
+        for (dim_t k = 0; k < odims[2]; k++) {
+            for (dim_t j = 0; j < odims[1]; j++) {
+                const T *col = in + l * strides[3] + k * strides[2] +
+                               j * strides[1];
+                for (dim_t i = 0; i < odims[0]; i++) {
+                    *out++ = col[i * strides[0]];
+                }
+            }
+        }
+    }
+    return getHandle(createHostDataArray<T>(odims, data.data()));
+}
+
+static af_array readArrayV2(const string &filename, const StreamEntry &entry,
+                            vector<af_seq> index) {
+    index.resize(4, af_span);
+
+    af_array out;
+    switch (entry.type) {
+        case f32: out = readDataV2<float>(filename, entry, index); break;
+        case c32: out = readDataV2<cfloat>(filename, entry, index); break;
+        case f64: out = readDataV2<double>(filename, entry, index); break;
+        case c64: out = readDataV2<cdouble>(filename, entry, index); break;
+        case b8: out = readDataV2<char>(filename, entry, index); break;
+        case s32: out = readDataV2<int>(filename, entry, index); break;
+        case u32: out = readDataV2<uint>(filename, entry, index); break;
+        case u8: out = readDataV2<uchar>(filename, entry, index); break;
+        case s64: out = readDataV2<intl>(filename, entry, index); break;
+        case u64: out = readDataV2<uintl>(filename, entry, index); break;
+        case s16: out = readDataV2<short>(filename, entry, index); break;
+        case u16: out = readDataV2<ushort>(filename, entry, index); break;
+        default: TYPE_ERROR(1, entry.type);
+    }
+    return out;
+}
+
+static af_array checkVersionAndRead(const char *filename, const unsigned index,
+                                    const vector<af_seq> &slice = {}) {
+    std::string filenameStr = std::string(filename);
+    char version            = checkVersion(filenameStr);
 
     switch (version) {  // NOLINT(hicpp-multiway-paths-covered)
-        case 1: return readArrayV1(filename, index);
+        case 1: {
+            af_array out = readArrayV1(filename, index);
+            if (slice.empty()) { return out; }
+
+            // Version 1 files are read whole and then indexed
+            af_array sliced = 0;
+            af_err err = af_index(&sliced, out, slice.size(), slice.data());
+            AF_CHECK(af_release_array(out));
+            AF_CHECK(err);
+            return sliced;
+        }
+        case STREAM_FORMAT_VERSION: {
+            vector<StreamEntry> entries = readIndexV2(filenameStr);
+            AF_ASSERT(index < entries.size(), "Index out of bounds");
+            return readArrayV2(filenameStr, entries[index], slice);
+        }
         default: AF_ERROR("Invalid version", AF_ERR_ARG);
     }
 }
 
 int checkVersionAndFindIndex(const char *filename, const char *k) {
-    char version = 0;
     std::string key(k);
     std::string filenameStr(filename);
-    std::ifstream fs(filenameStr, std::ifstream::in | std::ifstream::binary);
-
-    // Throw exception if file is not open
-    if (!fs.is_open()) {
-        std::string errStr = "Failed to open: " + filenameStr;
-        AF_ERROR(errStr.c_str(), AF_ERR_ARG);
-    }
-
-    if (fs.peek() == std::ifstream::traits_type::eof()) {
-        std::string errStr = filenameStr + " is empty";
-        AF_ERROR(errStr.c_str(), AF_ERR_ARG);
-    } else {
-        fs.read(&version, sizeof(char));
-    }
+    char version = checkVersion(filenameStr);
 
     int index = -1;
     if (version == 1) {
+        std::ifstream fs(filenameStr,
+                         std::ifstream::in | std::ifstream::binary);
+        fs.seekg(1);
+
         int n_arrays = -1;
         fs.read(reinterpret_cast<char *>(&n_arrays), sizeof(int));
         for (int i = 0; i < n_arrays; i++) {
@@ -318,10 +711,19 @@ int checkVersionAndFindIndex(const char *filename, const char *k) {
             fs.read(reinterpret_cast<char *>(&offset), sizeof(intl));
             fs.seekg(offset, std::ios_base::cur);
         }
+        fs.close();
+    } else if (version == STREAM_FORMAT_VERSION) {
+        // Only the index is read, not the data of the arrays before the key
+        vector<StreamEntry> entries = readIndexV2(filenameStr);
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].key == key) {
+                index = i;
+                break;
+            }
+        }
     } else {
         AF_ERROR("Invalid version", AF_ERR_ARG);
     }
-    fs.close();
 
     return index;
 }
@@ -358,6 +760,28 @@ af_err af_read_array_key(af_array *out, const char *filename, const char *key) {
     return AF_SUCCESS;
 }
 
+af_err af_read_array_slice(af_array *out, const char *filename,
+                           const char *key, const unsigned ndims,
+                           const af_seq *const index) {
+    try {
+        AF_CHECK(af_init());
+        ARG_ASSERT(1, filename != NULL);
+        ARG_ASSERT(2, key != NULL);
+        ARG_ASSERT(3, ndims > 0 && ndims <= 4);
+        ARG_ASSERT(4, index != NULL);
+
+        int id = checkVersionAndFindIndex(filename, key);
+
+        if (id == -1) { AF_ERROR("Key not found", AF_ERR_INVALID_ARRAY); }
+
+        af_array output = checkVersionAndRead(
+            filename, id, vector<af_seq>(index, index + ndims));
+        std::swap(*out, output);
+    }
+    CATCHALL;
+    return AF_SUCCESS;
+}
+
 af_err af_read_array_key_check(int *index, const char *filename,
                                const char *key) {
     try {
@@ -145,6 +145,12 @@ void deviceMemInfo(size_t *alloc_bytes, size_t *alloc_buffers,
                                 lock_buffers));
 }
 
+af_memory_stats deviceMemStats(const int device_id) {
+    af_memory_stats stats;
+    AF_THROW(af_device_mem_stats(&stats, device_id));
+    return stats;
+}
+
 void setMemStepSize(const size_t step_bytes) {
     AF_THROW(af_set_mem_step_size(step_bytes));
 }
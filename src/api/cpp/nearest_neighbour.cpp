@@ -24,4 +24,27 @@ void nearestNeighbour(array& idx, array& dist, const array& query,
     dist = array(temp_dist);
 }
 
+nnIndex::nnIndex(const array& train, const dim_t dist_dim,
+                 const af_match_type dist_type)
+    : index(0) {
+    AF_THROW(af_create_nn_index(&index, train.get(), dist_dim, dist_type));
+}
+
+nnIndex::~nnIndex() {
+    if (index) { af_release_nn_index(index); }
+}
+
+void nnIndex::search(array& idx, array& dist, const array& query,
+                     const dim_t dist_dim, const unsigned n_dist,
+                     const unsigned checks) const {
+    af_array temp_idx  = 0;
+    af_array temp_dist = 0;
+    AF_THROW(af_nn_index_search(&temp_idx, &temp_dist, index, query.get(),
+                                dist_dim, n_dist, checks));
+    idx  = array(temp_idx);
+    dist = array(temp_dist);
+}
+
+af_nn_index nnIndex::get() const { return index; }
+
 }  // namespace af
@@ -42,6 +42,14 @@ array readArray(const char *filename, const char *key) {
     return array(out);
 }
 
+array readArray(const char *filename, const char *key, const seq &s0,
+                const seq &s1, const seq &s2, const seq &s3) {
+    af_array out      = 0;
+    af_seq indices[4] = {s0.s, s1.s, s2.s, s3.s};
+    AF_THROW(af_read_array_slice(&out, filename, key, 4, indices));
+    return array(out);
+}
+
 int readArrayCheck(const char *filename, const char *key) {
     int out = -1;
     AF_THROW(af_read_array_key_check(&out, filename, key));
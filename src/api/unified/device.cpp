@@ -120,6 +120,10 @@ af_err af_get_mem_step_size(size_t *step_bytes) {
     CALL(af_get_mem_step_size, step_bytes);
 }
 
+af_err af_device_mem_stats(af_memory_stats *stats, const int device_id) {
+    CALL(af_device_mem_stats, stats, device_id);
+}
+
 af_err af_lock_device_ptr(const af_array arr) {
     CHECK_ARRAYS(arr);
 #pragma GCC diagnostic push
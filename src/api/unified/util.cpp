@@ -37,6 +37,12 @@ af_err af_read_array_key(af_array *out, const char *filename, const char *key) {
     CALL(af_read_array_key, out, filename, key);
 }
 
+af_err af_read_array_slice(af_array *out, const char *filename,
+                           const char *key, const unsigned ndims,
+                           const af_seq *const index) {
+    CALL(af_read_array_slice, out, filename, key, ndims, index);
+}
+
 af_err af_read_array_key_check(int *index, const char *filename,
                                const char *key) {
     CALL(af_read_array_key_check, index, filename, key);
@@ -72,6 +72,25 @@ af_err af_nearest_neighbour(af_array *idx, af_array *dist, const af_array query,
          dist_type);
 }
 
+af_err af_create_nn_index(af_nn_index *index, const af_array train,
+                          const dim_t dist_dim, const af_match_type dist_type) {
+    CHECK_ARRAYS(train);
+    CALL(af_create_nn_index, index, train, dist_dim, dist_type);
+}
+
+af_err af_nn_index_search(af_array *idx, af_array *dist,
+                          const af_nn_index index, const af_array query,
+                          const dim_t dist_dim, const unsigned n_dist,
+                          const unsigned checks) {
+    CHECK_ARRAYS(query);
+    CALL(af_nn_index_search, idx, dist, index, query, dist_dim, n_dist,
+         checks);
+}
+
+af_err af_release_nn_index(af_nn_index index) {
+    CALL(af_release_nn_index, index);
+}
+
 af_err af_match_template(af_array *out, const af_array search_img,
                          const af_array template_img,
                          const af_match_type m_type) {
@@ -0,0 +1,396 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <common/ArenaMemoryManager.hpp>
+#include <common/DefaultMemoryManager.hpp>
+#include <common/Logger.hpp>
+#include <common/dispatch.hpp>
+#include <common/err_common.hpp>
+#include <common/util.hpp>
+#include <af/memory.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+using std::max;
+using std::stoi;
+using std::string;
+using std::vector;
+
+namespace common {
+
+constexpr unsigned ArenaMemoryManager::NUM_SHARDS;
+constexpr unsigned ArenaMemoryManager::NUM_CLASSES;
+
+namespace {
+
+// Smallest size class. Sizes below it cannot be split into four sub-bins.
+constexpr size_t MIN_CLASS_BYTES = 8;
+
+/// Returns the index of the smallest size class holding \p bytes. Classes
+/// 4p to 4p + 3 hold the sizes between 2^p and 2^(p + 1) in steps of
+/// 2^(p - 2).
+unsigned sizeClass(size_t bytes) {
+    unsigned p = 2;
+    while (((bytes - 1) >> (p + 1)) != 0) { p++; }
+    size_t step = size_t(1) << (p - 2);
+    return 4 * p + static_cast<unsigned>(divup(bytes, step)) - 5;
+}
+
+/// Returns the size of the buffers in \p size_class
+size_t classBytes(unsigned size_class) {
+    return size_t(size_class % 4 + 5) << (size_class / 4 - 2);
+}
+
+/// Returns the shard the calling thread allocates from and frees to
+unsigned homeShard(unsigned num_shards) {
+    static std::atomic<unsigned> next_shard{0};
+    thread_local unsigned home = next_shard++ % num_shards;
+    return home;
+}
+
+}  // namespace
+
+ArenaMemoryManager::arena_info::arena_info()
+    // Calling getMaxMemorySize() here calls the virtual function that
+    // returns 0. Call it from outside the constructor.
+    : max_bytes(ONE_GB)
+    , total_bytes(0)
+    , total_buffers(0)
+    , lock_bytes(0)
+    , lock_buffers(0) {}
+
+ArenaMemoryManager::ArenaMemoryManager(int num_devices, unsigned max_buffers)
+    : min_bytes(1024), max_buffers(max_buffers), arenas(num_devices) {
+    for (auto &arena : arenas) { arena.reset(new arena_info()); }
+
+    // Max Buffer count
+    string env_var = getEnvVar("AF_MAX_BUFFERS");
+    if (!env_var.empty()) { this->max_buffers = max(1, stoi(env_var)); }
+}
+
+ArenaMemoryManager::arena_info &ArenaMemoryManager::getCurrentArenaInfo() {
+    return *arenas[this->getActiveDeviceId()];
+}
+
+ArenaMemoryManager::shard &ArenaMemoryManager::lockedShard(arena_info &arena,
+                                                           const void *ptr) {
+    uintptr_t p = reinterpret_cast<uintptr_t>(ptr);
+    return arena.shards[((p >> 4) ^ (p >> 12) ^ (p >> 20)) % NUM_SHARDS];
+}
+
+void *ArenaMemoryManager::popFreeBuffer(arena_info &arena,
+                                        unsigned size_class) {
+    unsigned home = homeShard(NUM_SHARDS);
+    for (unsigned i = 0; i < NUM_SHARDS; i++) {
+        shard &s = arena.shards[(home + i) % NUM_SHARDS];
+        lock_guard_t lock(s.mutex);
+        vector<void *> &free_list = s.free_lists[size_class];
+        if (!free_list.empty()) {
+            void *ptr = free_list.back();
+            free_list.pop_back();
+            return ptr;
+        }
+    }
+    return nullptr;
+}
+
+void ArenaMemoryManager::cleanDeviceMemoryManager(int device) {
+    arena_info &current = *arenas[device];
+    // Return if all buffers are locked
+    if (current.total_buffers == current.lock_buffers) { return; }
+
+    // The pointers are freed once all the locks are released because the
+    // CPU backend calls sync.
+    vector<void *> free_ptrs;
+    size_t bytes_freed = 0;
+    for (shard &s : current.shards) {
+        lock_guard_t lock(s.mutex);
+        for (unsigned c = 0; c < NUM_CLASSES; c++) {
+            vector<void *> &free_list = s.free_lists[c];
+            bytes_freed += free_list.size() * classBytes(c);
+            std::move(begin(free_list), end(free_list),
+                      back_inserter(free_ptrs));
+            free_list.clear();
+        }
+    }
+    current.total_bytes -= bytes_freed;
+    current.total_buffers -= free_ptrs.size();
+
+    AF_TRACE("GC: Clearing {} buffers {}", free_ptrs.size(),
+             bytesToString(bytes_freed));
+    if (!free_ptrs.empty()) { current.stats.garbageCollection(); }
+    for (auto ptr : free_ptrs) {
+        auto start = MemoryStats::clock::now();
+        this->nativeFree(ptr);
+        current.stats.nativeFree(MemoryStats::elapsed(start));
+    }
+}
+
+void ArenaMemoryManager::initialize() { this->setMaxMemorySize(); }
+
+void ArenaMemoryManager::shutdown() { signalMemoryCleanup(); }
+
+void ArenaMemoryManager::addMemoryManagement(int device) {
+    if (static_cast<size_t>(device) < arenas.size()) { return; }
+
+    size_t old_size = arenas.size();
+    arenas.resize(old_size + device + 1);
+    for (size_t i = old_size; i < arenas.size(); i++) {
+        arenas[i].reset(new arena_info());
+    }
+}
+
+void ArenaMemoryManager::removeMemoryManagement(int device) {
+    if (static_cast<size_t>(device) >= arenas.size()) {
+        AF_ERROR("No matching device found", AF_ERR_ARG);
+    }
+    cleanDeviceMemoryManager(device);
+}
+
+void ArenaMemoryManager::setMaxMemorySize() {
+    for (unsigned n = 0; n < arenas.size(); n++) {
+        // Same limits as the DefaultMemoryManager
+        size_t memsize = this->getMaxMemorySize(n);
+        arenas[n]->max_bytes =
+            memsize == 0
+                ? ONE_GB
+                : max(memsize * 0.75, static_cast<double>(memsize - ONE_GB));
+    }
+}
+
+float ArenaMemoryManager::getMemoryPressure() {
+    arena_info &current = this->getCurrentArenaInfo();
+    if (current.lock_bytes > current.max_bytes ||
+        current.lock_buffers > max_buffers) {
+        return 1.0;
+    } else {
+        return 0.0;
+    }
+}
+
+bool ArenaMemoryManager::jitTreeExceedsMemoryPressure(size_t bytes) {
+    arena_info &current = this->getCurrentArenaInfo();
+    bool exceeds        = 2 * bytes > current.lock_bytes;
+    if (exceeds) { current.stats.memoryPressureEval(); }
+    return exceeds;
+}
+
+void *ArenaMemoryManager::alloc(bool user_lock, const unsigned ndims,
+                                dim_t *dims, const unsigned element_size) {
+    size_t bytes = element_size;
+    for (unsigned i = 0; i < ndims; ++i) { bytes *= dims[i]; }
+    if (bytes == 0) { return nullptr; }
+
+    auto start          = MemoryStats::clock::now();
+    unsigned size_class = sizeClass(max(bytes, min_bytes.load()));
+    size_t alloc_bytes  = classBytes(size_class);
+    arena_info &current = this->getCurrentArenaInfo();
+
+    if (current.lock_bytes >= current.max_bytes ||
+        current.total_buffers >= this->max_buffers) {
+        this->signalMemoryCleanup();
+    }
+
+    void *ptr      = popFreeBuffer(current, size_class);
+    bool cache_hit = ptr != nullptr;
+    if (!cache_hit) {
+        auto native_start = MemoryStats::clock::now();
+        try {
+            ptr = this->nativeAlloc(alloc_bytes);
+        } catch (const AfError &ex) {
+            // If out of memory, run garbage collect and try again
+            if (ex.getError() != AF_ERR_NO_MEM) { throw; }
+            this->signalMemoryCleanup();
+            ptr = this->nativeAlloc(alloc_bytes);
+        }
+        current.stats.nativeAlloc(MemoryStats::elapsed(native_start));
+        current.total_bytes += alloc_bytes;
+        current.total_buffers++;
+    }
+
+    {
+        shard &s = lockedShard(current, ptr);
+        lock_guard_t lock(s.mutex);
+        s.locked_map[ptr] = {!user_lock, user_lock, alloc_bytes};
+    }
+    current.lock_bytes += alloc_bytes;
+    current.lock_buffers++;
+
+    current.stats.usage(current.total_bytes, current.lock_bytes);
+    current.stats.alloc(bytes, alloc_bytes, cache_hit,
+                        MemoryStats::elapsed(start));
+
+    return ptr;
+}
+
+size_t ArenaMemoryManager::allocated(void *ptr) {
+    if (!ptr) { return 0; }
+    arena_info &current = this->getCurrentArenaInfo();
+    shard &s            = lockedShard(current, ptr);
+    lock_guard_t lock(s.mutex);
+    auto locked_iter = s.locked_map.find(ptr);
+    if (locked_iter == s.locked_map.end()) { return 0; }
+    return locked_iter->second.bytes;
+}
+
+void ArenaMemoryManager::unlock(void *ptr, bool user_unlock) {
+    // Shortcut for empty arrays
+    if (!ptr) { return; }
+
+    arena_info &current = this->getCurrentArenaInfo();
+    size_t bytes        = 0;
+    {
+        shard &s = lockedShard(current, ptr);
+        lock_guard_t lock(s.mutex);
+
+        auto locked_iter = s.locked_map.find(ptr);
+        if (locked_iter != s.locked_map.end()) {
+            locked_info &info = locked_iter->second;
+            if (user_unlock) {
+                info.user_lock = false;
+            } else {
+                info.manager_lock = false;
+            }
+
+            // Return early if either one is locked
+            if (info.user_lock || info.manager_lock) { return; }
+
+            bytes = info.bytes;
+            s.locked_map.erase(locked_iter);
+        }
+    }
+
+    // Pointer was not allocated by the manager. Probably came from the
+    // user, just free it.
+    if (bytes == 0) {
+        auto start = MemoryStats::clock::now();
+        this->nativeFree(ptr);
+        current.stats.nativeFree(MemoryStats::elapsed(start));
+        return;
+    }
+
+    current.lock_bytes -= bytes;
+    current.lock_buffers--;
+
+    shard &home = current.shards[homeShard(NUM_SHARDS)];
+    lock_guard_t lock(home.mutex);
+    home.free_lists[sizeClass(bytes)].push_back(ptr);
+}
+
+void ArenaMemoryManager::signalMemoryCleanup() {
+    cleanDeviceMemoryManager(this->getActiveDeviceId());
+}
+
+void ArenaMemoryManager::printInfo(const char *msg, const int device) {
+    UNUSED(device);
+    arena_info &current = this->getCurrentArenaInfo();
+
+    auto printBuffer = [](void *ptr, size_t bytes, const char *status_mngr,
+                          const char *status_user) {
+        const char *unit = "KB";
+        double size      = static_cast<double>(bytes) / 1024;
+        if (size >= 1024) {
+            size = size / 1024;
+            unit = "MB";
+        }
+        printf("|  %14p  |  %6.f %s | %9s | %9s |\n", ptr, size, unit,
+               status_mngr, status_user);
+    };
+
+    printf("%s\n", msg);
+    printf(
+        "---------------------------------------------------------\n"
+        "|     POINTER      |    SIZE    |  AF LOCK  | USER LOCK |\n"
+        "---------------------------------------------------------\n");
+
+    for (shard &s : current.shards) {
+        lock_guard_t lock(s.mutex);
+        for (auto &kv : s.locked_map) {
+            printBuffer(kv.first, kv.second.bytes,
+                        kv.second.manager_lock ? "Yes" : " No",
+                        kv.second.user_lock ? "Yes" : " No");
+        }
+        for (unsigned c = 0; c < NUM_CLASSES; c++) {
+            for (void *ptr : s.free_lists[c]) {
+                printBuffer(ptr, classBytes(c), "No", "No");
+            }
+        }
+    }
+
+    printf("---------------------------------------------------------\n");
+
+    af_memory_stats stats;
+    current.stats.get(&stats);
+    unsigned long long cache_hits = 0;
+    unsigned long long allocs     = 0;
+    for (int i = 0; i < AF_MEMORY_STATS_BUCKETS; i++) {
+        cache_hits += stats.cache_hits[i];
+        allocs += stats.cache_hits[i] + stats.cache_misses[i];
+    }
+    printf("Allocations: %llu (%llu from cache)\n", allocs, cache_hits);
+    printf("Rounding overhead: %s of %s requested\n",
+           bytesToString(stats.rounded_bytes - stats.requested_bytes).c_str(),
+           bytesToString(stats.requested_bytes).c_str());
+    printf("Alloc latency: %.0f ns average, %llu ns max\n",
+           allocs ? static_cast<double>(stats.alloc_ns) / allocs : 0.0,
+           stats.max_alloc_ns);
+}
+
+void ArenaMemoryManager::usageInfo(size_t *alloc_bytes, size_t *alloc_buffers,
+                                   size_t *lock_bytes, size_t *lock_buffers) {
+    const arena_info &current = this->getCurrentArenaInfo();
+    if (alloc_bytes) { *alloc_bytes = current.total_bytes; }
+    if (alloc_buffers) { *alloc_buffers = current.total_buffers; }
+    if (lock_bytes) { *lock_bytes = current.lock_bytes; }
+    if (lock_buffers) { *lock_buffers = current.lock_buffers; }
+}
+
+void ArenaMemoryManager::userLock(const void *ptr) {
+    arena_info &current = this->getCurrentArenaInfo();
+    shard &s            = lockedShard(current, ptr);
+    lock_guard_t lock(s.mutex);
+
+    auto locked_iter = s.locked_map.find(const_cast<void *>(ptr));
+    if (locked_iter != s.locked_map.end()) {
+        locked_iter->second.user_lock = true;
+    } else {
+        s.locked_map[const_cast<void *>(ptr)] = {false, true, 0};
+    }
+}
+
+void ArenaMemoryManager::userUnlock(const void *ptr) {
+    this->unlock(const_cast<void *>(ptr), true);
+}
+
+bool ArenaMemoryManager::isUserLocked(const void *ptr) {
+    arena_info &current = this->getCurrentArenaInfo();
+    shard &s            = lockedShard(current, ptr);
+    lock_guard_t lock(s.mutex);
+    auto locked_iter = s.locked_map.find(const_cast<void *>(ptr));
+    if (locked_iter == s.locked_map.end()) { return false; }
+    return locked_iter->second.user_lock;
+}
+
+size_t ArenaMemoryManager::getMemStepSize() { return min_bytes; }
+
+void ArenaMemoryManager::setMemStepSize(size_t new_step_size) {
+    // The smallest buffer must be a power of two to be the boundary of a
+    // size class
+    size_t bytes = MIN_CLASS_BYTES;
+    while (bytes < new_step_size) { bytes <<= 1; }
+    min_bytes = bytes;
+}
+
+void ArenaMemoryManager::getStats(af_memory_stats *stats, const int device) {
+    arenas[device]->stats.get(stats);
+}
+
+}  // namespace common
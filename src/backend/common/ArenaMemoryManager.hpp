@@ -0,0 +1,109 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+
+#include <common/MemoryManagerBase.hpp>
+#include <common/MemoryStats.hpp>
+#include <common/defines.hpp>
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace common {
+
+/// A memory manager which caches free buffers in size classes
+///
+/// The sizes are rounded up to one of four classes between consecutive
+/// powers of two so buffers of similar sizes are reused and no more than 25%
+/// of a buffer is wasted by the rounding. Each class has its own free list so
+/// finding a free buffer takes constant time.
+///
+/// The buffers of a device are split into shards, each with its own lock.
+/// Every thread frees buffers into and allocates them from its own shard so
+/// threads rarely contend for a lock. A thread only looks at the other shards
+/// if its own does not have a buffer of the requested class.
+///
+/// The manager is used instead of the DefaultMemoryManager when the
+/// AF_MEM_ARENA environment variable is set.
+class ArenaMemoryManager final : public common::memory::MemoryManagerBase {
+   public:
+    ArenaMemoryManager(int num_devices, unsigned max_buffers);
+
+    void initialize() override;
+    void shutdown() override;
+    void addMemoryManagement(int device) override;
+    void removeMemoryManagement(int device) override;
+    void setMaxMemorySize();
+
+    void *alloc(bool user_lock, const unsigned ndims, dim_t *dims,
+                const unsigned element_size) override;
+    size_t allocated(void *ptr) override;
+    void unlock(void *ptr, bool user_unlock) override;
+    void signalMemoryCleanup() override;
+    void printInfo(const char *msg, const int device) override;
+    void usageInfo(size_t *alloc_bytes, size_t *alloc_buffers,
+                   size_t *lock_bytes, size_t *lock_buffers) override;
+    void userLock(const void *ptr) override;
+    void userUnlock(const void *ptr) override;
+    bool isUserLocked(const void *ptr) override;
+    size_t getMemStepSize() override;
+    void setMemStepSize(size_t new_step_size) override;
+    void getStats(af_memory_stats *stats, const int device) override;
+    float getMemoryPressure() override;
+    bool jitTreeExceedsMemoryPressure(size_t bytes) override;
+
+    ~ArenaMemoryManager() = default;
+
+   private:
+    static constexpr unsigned NUM_SHARDS  = 8;
+    static constexpr unsigned NUM_CLASSES = 256;
+
+    struct locked_info {
+        bool manager_lock;
+        bool user_lock;
+        // Zero for buffers which were not allocated by the manager
+        size_t bytes;
+    };
+
+    struct shard {
+        common::mutex_t mutex;
+        std::unordered_map<void *, locked_info> locked_map;
+        std::vector<std::vector<void *>> free_lists;
+
+        shard() : free_lists(NUM_CLASSES) {}
+    };
+
+    struct arena_info {
+        shard shards[NUM_SHARDS];
+
+        std::atomic<size_t> max_bytes;
+        std::atomic<size_t> total_bytes;
+        std::atomic<size_t> total_buffers;
+        std::atomic<size_t> lock_bytes;
+        std::atomic<size_t> lock_buffers;
+
+        MemoryStats stats;
+
+        arena_info();
+    };
+
+    arena_info &getCurrentArenaInfo();
+    shard &lockedShard(arena_info &arena, const void *ptr);
+    void *popFreeBuffer(arena_info &arena, unsigned size_class);
+    void cleanDeviceMemoryManager(int device);
+
+    std::atomic<size_t> min_bytes;
+    unsigned max_buffers;
+    std::vector<std::unique_ptr<arena_info>> arenas;
+};
+
+}  // namespace common
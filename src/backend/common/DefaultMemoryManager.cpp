@@ -7,6 +7,7 @@
  * http://arrayfire.com/licenses/BSD-3-Clause
  ********************************************************/
 
+#include <common/ArenaMemoryManager.hpp>
 #include <common/DefaultMemoryManager.hpp>
 #include <common/Logger.hpp>
 #include <common/dispatch.hpp>
@@ -24,6 +25,7 @@ using std::max;
 using std::move;
 using std::stoi;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 
 namespace common {
@@ -64,8 +66,13 @@ void DefaultMemoryManager::cleanDeviceMemoryManager(int device) {
 
     AF_TRACE("GC: Clearing {} buffers {}", free_ptrs.size(),
              bytesToString(bytes_freed));
+    if (!free_ptrs.empty()) { current.stats->garbageCollection(); }
     // Free memory outside of the lock
-    for (auto ptr : free_ptrs) { this->nativeFree(ptr); }
+    for (auto ptr : free_ptrs) {
+        auto start = MemoryStats::clock::now();
+        this->nativeFree(ptr);
+        current.stats->nativeFree(MemoryStats::elapsed(start));
+    }
 }
 
 DefaultMemoryManager::DefaultMemoryManager(int num_devices,
@@ -138,7 +145,9 @@ float DefaultMemoryManager::getMemoryPressure() {
 bool DefaultMemoryManager::jitTreeExceedsMemoryPressure(size_t bytes) {
     lock_guard_t lock(this->memory_mutex);
     memory_info &current = this->getCurrentMemoryInfo();
-    return 2 * bytes > current.lock_bytes;
+    bool exceeds         = 2 * bytes > current.lock_bytes;
+    if (exceeds) { current.stats->memoryPressureEval(); }
+    return exceeds;
 }
 
 void *DefaultMemoryManager::alloc(bool user_lock, const unsigned ndims,
@@ -152,8 +161,10 @@ void *DefaultMemoryManager::alloc(bool user_lock, const unsigned ndims,
                              : (divup(bytes, mem_step_size) * mem_step_size);
 
     if (bytes > 0) {
+        auto start           = MemoryStats::clock::now();
         memory_info &current = this->getCurrentMemoryInfo();
         locked_info info     = {!user_lock, user_lock, alloc_bytes};
+        bool cache_hit       = false;
 
         // There is no memory cache in debug mode
         if (!this->debug_mode) {
@@ -176,11 +187,14 @@ void *DefaultMemoryManager::alloc(bool user_lock, const unsigned ndims,
                 current.locked_map[ptr] = info;
                 current.lock_bytes += alloc_bytes;
                 current.lock_buffers++;
+                current.stats->usage(current.total_bytes, current.lock_bytes);
+                cache_hit = true;
             }
         }
 
         // Only comes here if buffer size not found or in debug mode
         if (ptr == nullptr) {
+            auto native_start = MemoryStats::clock::now();
             // Perform garbage collection if memory can not be allocated
             try {
                 ptr = this->nativeAlloc(alloc_bytes);
@@ -190,6 +204,8 @@ void *DefaultMemoryManager::alloc(bool user_lock, const unsigned ndims,
                 this->signalMemoryCleanup();
                 ptr = this->nativeAlloc(alloc_bytes);
             }
+            current.stats->nativeAlloc(MemoryStats::elapsed(native_start));
+
             lock_guard_t lock(this->memory_mutex);
             // Increment these two only when it succeeds to come here.
             current.total_bytes += alloc_bytes;
@@ -197,7 +213,10 @@ void *DefaultMemoryManager::alloc(bool user_lock, const unsigned ndims,
             current.locked_map[ptr] = info;
             current.lock_bytes += alloc_bytes;
             current.lock_buffers++;
+            current.stats->usage(current.total_bytes, current.lock_bytes);
         }
+        current.stats->alloc(bytes, alloc_bytes, cache_hit,
+                             MemoryStats::elapsed(start));
     }
 
     return ptr;
@@ -216,7 +235,12 @@ void DefaultMemoryManager::unlock(void *ptr, bool user_unlock) {
     if (!ptr) { return; }
 
     // Frees the pointer outside the lock.
-    uptr_t freed_ptr(nullptr, [this](void *p) { this->nativeFree(p); });
+    uptr_t freed_ptr(nullptr, [this](void *p) {
+        auto start = MemoryStats::clock::now();
+        this->nativeFree(p);
+        this->getCurrentMemoryInfo().stats->nativeFree(
+            MemoryStats::elapsed(start));
+    });
     {
         lock_guard_t lock(this->memory_mutex);
         memory_info &current = this->getCurrentMemoryInfo();
@@ -362,4 +386,22 @@ void DefaultMemoryManager::setMemStepSize(size_t new_step_size) {
     this->mem_step_size = new_step_size;
 }
 
+void DefaultMemoryManager::getStats(af_memory_stats *stats, const int device) {
+    memory[device].stats->get(stats);
+}
+
+unique_ptr<memory::MemoryManagerBase> createDefaultMemoryManager(
+    int num_devices, unsigned max_buffers, bool debug) {
+    string env_var = getEnvVar("AF_MEM_DEBUG");
+    if (!env_var.empty()) { debug = env_var[0] != '0'; }
+
+    env_var = getEnvVar("AF_MEM_ARENA");
+    if (!debug && !env_var.empty() && env_var[0] != '0') {
+        return unique_ptr<memory::MemoryManagerBase>(
+            new ArenaMemoryManager(num_devices, max_buffers));
+    }
+    return unique_ptr<memory::MemoryManagerBase>(
+        new DefaultMemoryManager(num_devices, max_buffers, debug));
+}
+
 }  // namespace common
@@ -10,9 +10,11 @@
 #pragma once
 
 #include <common/MemoryManagerBase.hpp>
+#include <common/MemoryStats.hpp>
 #include <common/defines.hpp>
 
 #include <functional>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -48,6 +50,8 @@ class DefaultMemoryManager final : public common::memory::MemoryManagerBase {
         size_t lock_bytes;
         size_t lock_buffers;
 
+        std::unique_ptr<MemoryStats> stats;
+
         memory_info()
             // Calling getMaxMemorySize() here calls the virtual function
             // that returns 0 Call it from outside the constructor.
@@ -55,7 +59,8 @@ class DefaultMemoryManager final : public common::memory::MemoryManagerBase {
             , total_bytes(0)
             , total_buffers(0)
             , lock_bytes(0)
-            , lock_buffers(0) {}
+            , lock_buffers(0)
+            , stats(new MemoryStats()) {}
 
         memory_info(memory_info &other)  = delete;
         memory_info(memory_info &&other) = default;
@@ -115,6 +120,7 @@ class DefaultMemoryManager final : public common::memory::MemoryManagerBase {
     bool isUserLocked(const void *ptr) override;
     size_t getMemStepSize() override;
     void setMemStepSize(size_t new_step_size) override;
+    void getStats(af_memory_stats *stats, const int device) override;
     float getMemoryPressure() override;
     bool jitTreeExceedsMemoryPressure(size_t bytes) override;
 
@@ -133,4 +139,10 @@ class DefaultMemoryManager final : public common::memory::MemoryManagerBase {
     void cleanDeviceMemoryManager(int device);
 };
 
+/// Creates the memory manager used when the user has not set one. This is an
+/// ArenaMemoryManager if the AF_MEM_ARENA environment variable is set and
+/// debug mode is off, and a DefaultMemoryManager otherwise.
+std::unique_ptr<memory::MemoryManagerBase> createDefaultMemoryManager(
+    int num_devices, unsigned max_buffers, bool debug);
+
 }  // namespace common
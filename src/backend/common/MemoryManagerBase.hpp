@@ -11,6 +11,7 @@
 
 #include <Event.hpp>
 #include <common/AllocatorInterface.hpp>
+#include <af/device.h>
 
 #include <cstddef>
 #include <memory>
@@ -53,6 +54,7 @@ class MemoryManagerBase {
     virtual bool isUserLocked(const void *ptr)                       = 0;
     virtual size_t getMemStepSize()                                  = 0;
     virtual void setMemStepSize(size_t new_step_size)                = 0;
+    virtual void getStats(af_memory_stats *stats, const int device)  = 0;
 
     /// Backend-specific functions
     // OpenCL
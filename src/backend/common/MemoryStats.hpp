@@ -0,0 +1,141 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+
+#include <af/device.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+namespace common {
+
+/// The allocation counters of a device returned by af_device_mem_stats
+///
+/// The counters are atomic so the memory managers can update them without
+/// holding their locks.
+class MemoryStats {
+    using counter_t = std::atomic<unsigned long long>;
+
+    counter_t cache_hits[AF_MEMORY_STATS_BUCKETS];
+    counter_t cache_misses[AF_MEMORY_STATS_BUCKETS];
+    counter_t requested_bytes;
+    counter_t rounded_bytes;
+    counter_t alloc_ns;
+    counter_t max_alloc_ns;
+    counter_t native_allocs;
+    counter_t native_frees;
+    counter_t native_alloc_ns;
+    counter_t native_free_ns;
+    std::atomic<size_t> peak_alloc_bytes;
+    std::atomic<size_t> peak_lock_bytes;
+    counter_t memory_pressure_evals;
+    counter_t garbage_collections;
+
+    static void setMax(counter_t &counter, unsigned long long value) {
+        unsigned long long prev = counter;
+        while (prev < value && !counter.compare_exchange_weak(prev, value)) {}
+    }
+
+    static void setMax(std::atomic<size_t> &counter, size_t value) {
+        size_t prev = counter;
+        while (prev < value && !counter.compare_exchange_weak(prev, value)) {}
+    }
+
+    // Index of the smallest power of two which is at least bytes
+    static unsigned bucket(size_t bytes) {
+        unsigned b = 0;
+        while (b + 1 < AF_MEMORY_STATS_BUCKETS && (size_t(1) << b) < bytes) {
+            b++;
+        }
+        return b;
+    }
+
+   public:
+    using clock = std::chrono::steady_clock;
+
+    MemoryStats()
+        : requested_bytes(0)
+        , rounded_bytes(0)
+        , alloc_ns(0)
+        , max_alloc_ns(0)
+        , native_allocs(0)
+        , native_frees(0)
+        , native_alloc_ns(0)
+        , native_free_ns(0)
+        , peak_alloc_bytes(0)
+        , peak_lock_bytes(0)
+        , memory_pressure_evals(0)
+        , garbage_collections(0) {
+        for (int i = 0; i < AF_MEMORY_STATS_BUCKETS; i++) {
+            cache_hits[i]   = 0;
+            cache_misses[i] = 0;
+        }
+    }
+
+    static unsigned long long elapsed(clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   clock::now() - start)
+            .count();
+    }
+
+    /// Records an allocation of \p bytes which returned a buffer of
+    /// \p rounded bytes after \p ns nanoseconds
+    void alloc(size_t bytes, size_t rounded, bool cache_hit,
+               unsigned long long ns) {
+        counter_t *counts = cache_hit ? cache_hits : cache_misses;
+        counts[bucket(rounded)]++;
+        requested_bytes += bytes;
+        rounded_bytes += rounded;
+        alloc_ns += ns;
+        setMax(max_alloc_ns, ns);
+    }
+
+    void nativeAlloc(unsigned long long ns) {
+        native_allocs++;
+        native_alloc_ns += ns;
+    }
+
+    void nativeFree(unsigned long long ns) {
+        native_frees++;
+        native_free_ns += ns;
+    }
+
+    /// Records the bytes allocated from the device and in use
+    void usage(size_t alloc_bytes, size_t lock_bytes) {
+        setMax(peak_alloc_bytes, alloc_bytes);
+        setMax(peak_lock_bytes, lock_bytes);
+    }
+
+    void memoryPressureEval() { memory_pressure_evals++; }
+
+    void garbageCollection() { garbage_collections++; }
+
+    void get(af_memory_stats *stats) const {
+        for (int i = 0; i < AF_MEMORY_STATS_BUCKETS; i++) {
+            stats->cache_hits[i]   = cache_hits[i];
+            stats->cache_misses[i] = cache_misses[i];
+        }
+        stats->requested_bytes       = requested_bytes;
+        stats->rounded_bytes         = rounded_bytes;
+        stats->alloc_ns              = alloc_ns;
+        stats->max_alloc_ns          = max_alloc_ns;
+        stats->native_allocs         = native_allocs;
+        stats->native_frees          = native_frees;
+        stats->native_alloc_ns       = native_alloc_ns;
+        stats->native_free_ns        = native_free_ns;
+        stats->peak_alloc_bytes      = peak_alloc_bytes;
+        stats->peak_lock_bytes       = peak_lock_bytes;
+        stats->memory_pressure_evals = memory_pressure_evals;
+        stats->garbage_collections   = garbage_collections;
+    }
+};
+
+}  // namespace common
@@ -47,6 +47,7 @@ using std::adjacent_find;
 using std::copy;
 using std::is_standard_layout;
 using std::move;
+using std::remove_if;
 using std::vector;
 
 namespace cpu {
@@ -203,6 +204,34 @@ void evalMultiple(vector<Array<T> *> array_ptrs) {
     }
 }
 
+template<typename T>
+jit::Output prepareOutput(Array<T> &array) {
+    if (array.ready) { return {nullptr, nullptr, 0, jit::writeOutput<T>}; }
+    if (getQueue().is_worker()) {
+        AF_ERROR("Array not evaluated", AF_ERR_INTERNAL);
+    }
+
+    array.setId(getActiveDeviceId());
+    array.data =
+        shared_ptr<T>(memAlloc<T>(array.elements()).release(), memFree<T>);
+
+    jit::Output output{array.node, array.get(), array.elements() * sizeof(T),
+                       jit::writeOutput<T>};
+    array.node  = bufferNodePtr<T>();
+    array.ready = true;
+    return output;
+}
+
+void evalOutputs(const dim4 &dims, vector<jit::Output> outputs) {
+    outputs.erase(remove_if(begin(outputs), end(outputs),
+                            [](const jit::Output &o) { return !o.node; }),
+                  end(outputs));
+    if (outputs.empty()) { return; }
+
+    getQueue().enqueue(kernel::evalOutputs, dims, calcStrides(dims),
+                       move(outputs));
+}
+
 template<typename T>
 Node_ptr Array<T>::getNode() const {
     if (node->isBuffer()) {
@@ -353,6 +382,7 @@ void Array<T>::setDataDims(const dim4 &new_dims) {
     template void writeDeviceDataArray<T>(                                    \
         Array<T> & arr, const void *const data, const size_t bytes);          \
     template void evalMultiple<T>(vector<Array<T> *> arrays);                 \
+    template jit::Output prepareOutput<T>(Array<T> & array);                  \
     template void Array<T>::setDataDims(const dim4 &new_dims);
 
 INSTANTIATE(float)
@@ -45,6 +45,17 @@ using std::shared_ptr;
 template<typename T>
 void evalMultiple(std::vector<Array<T> *> array_ptrs);
 
+/// Allocates the buffer of \p array and returns the tree which computes it.
+/// The array is marked as evaluated so the returned output must be passed to
+/// evalOutputs. If the array is already evaluated, the node of the returned
+/// output is null.
+template<typename T>
+jit::Output prepareOutput(Array<T> &array);
+
+/// Evaluates the outputs returned by prepareOutput in a single pass. The
+/// arrays can be of different types but must have the same dimensions.
+void evalOutputs(const af::dim4 &dims, std::vector<jit::Output> outputs);
+
 // Creates a new Array object on the heap and returns a reference to it.
 template<typename T>
 Array<T> createNodeArray(const af::dim4 &dims, jit::Node_ptr node);
@@ -229,6 +240,7 @@ class Array {
     jit::Node_ptr getNode() const;
 
     friend void evalMultiple<T>(std::vector<Array<T> *> arrays);
+    friend jit::Output prepareOutput<T>(Array<T> &array);
 
     friend Array<T> createValueArray<T>(const af::dim4 &dims, const T &value);
     friend Array<T> createHostDataArray<T>(const af::dim4 &dims,
@@ -119,8 +119,8 @@ template<typename T>
 class Array;
 
 // These functions are needed to convert Array<T> to Param<T> when queueing up
-// functions. This is fine becacuse we only have 1 compute queue. This ensures
-// there's no race conditions.
+// functions. The queue orders the functions which access the same memory so
+// there are no race conditions.
 
 /// \brief Converts Array<T> to Param<T> or CParam<T> based on the constness
 ///        of the Array<T> object. If called on anything else, the object is
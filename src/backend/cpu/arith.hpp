@@ -12,6 +12,7 @@
 #include <Array.hpp>
 #include <err_cpu.hpp>
 #include <jit/BinaryNode.hpp>
+#include <jit/vector_ops.hpp>
 #include <optypes.hpp>
 #include <af/dim4.hpp>
 #include <cmath>
@@ -24,6 +25,10 @@ namespace cpu {
         void eval(jit::array<compute_t<T>> &out,                         \
                   const jit::array<compute_t<T>> &lhs,                   \
                   const jit::array<compute_t<T>> &rhs, int lim) const {  \
+            using Tc = compute_t<T>;                                     \
+            if (jit::evalVector<Tc, Tc, OP>(out, lhs, rhs, lim)) {       \
+                return;                                                  \
+            }                                                            \
             for (int i = 0; i < lim; i++) { out[i] = lhs[i] op rhs[i]; } \
         }                                                                \
     };
@@ -69,6 +74,10 @@ STATIC_ double __rem<double>(double lhs, double rhs) {
         void eval(jit::array<compute_t<T>> &out,                           \
                   const jit::array<compute_t<T>> &lhs,                     \
                   const jit::array<compute_t<T>> &rhs, int lim) {          \
+            using Tc = compute_t<T>;                                       \
+            if (jit::evalVector<Tc, Tc, OP>(out, lhs, rhs, lim)) {         \
+                return;                                                    \
+            }                                                              \
             for (int i = 0; i < lim; i++) { out[i] = FN(lhs[i], rhs[i]); } \
         }                                                                  \
     };
@@ -21,19 +21,21 @@ namespace cpu {
 
 template<typename inType, typename outType, bool isColor>
 Array<outType> bilateral(const Array<inType> &in, const float &s_sigma,
-                         const float &c_sigma) {
+                         const float &c_sigma, const af_bilateral_mode mode) {
     const dim4 &dims   = in.dims();
     Array<outType> out = createEmptyArray<outType>(dims);
     getQueue().enqueue(kernel::bilateral<outType, inType, isColor>, out, in,
-                       s_sigma, c_sigma);
+                       s_sigma, c_sigma, mode);
     return out;
 }
 
-#define INSTANTIATE(inT, outT)                                             \
-    template Array<outT> bilateral<inT, outT, true>(                       \
-        const Array<inT> &in, const float &s_sigma, const float &c_sigma); \
-    template Array<outT> bilateral<inT, outT, false>(                      \
-        const Array<inT> &in, const float &s_sigma, const float &c_sigma);
+#define INSTANTIATE(inT, outT)                                            \
+    template Array<outT> bilateral<inT, outT, true>(                      \
+        const Array<inT> &in, const float &s_sigma, const float &c_sigma, \
+        const af_bilateral_mode mode);                                    \
+    template Array<outT> bilateral<inT, outT, false>(                     \
+        const Array<inT> &in, const float &s_sigma, const float &c_sigma, \
+        const af_bilateral_mode mode);
 
 INSTANTIATE(double, double)
 INSTANTIATE(float, float)
@@ -11,6 +11,7 @@
 #include <Array.hpp>
 #include <err_cpu.hpp>
 #include <jit/UnaryNode.hpp>
+#include <jit/vector_ops.hpp>
 #include <math.hpp>
 #include <optypes.hpp>
 #include <types.hpp>
@@ -22,6 +23,7 @@ namespace cpu {
 template<typename To, typename Ti>
 struct UnOp<To, Ti, af_cast_t> {
     void eval(jit::array<To> &out, const jit::array<Ti> &in, int lim) {
+        if (jit::evalCast<To, Ti>(out, in, lim)) { return; }
         for (int i = 0; i < lim; i++) { out[i] = To(in[i]); }
     }
 };
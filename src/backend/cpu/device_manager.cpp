@@ -28,7 +28,9 @@ CPUInfo::CPUInfo()
     , mNumSMT(0)
     , mNumCores(0)
     , mNumLogCpus(0)
-    , mIsHTT(false) {
+    , mIsHTT(false)
+    , mHasAVX2(false)
+    , mHasAVX512(false) {
     // Get vendor name EAX=0
     CPUID cpuID1(1, 0);
     mIsHTT = cpuID1.EDX() & HTT_POS;
@@ -105,6 +107,21 @@ CPUInfo::CPUInfo()
         mModelName += string(reinterpret_cast<const char*>(&cpuID.EDX()), 4);
     }
     mModelName.shrink_to_fit();
+
+    // Vector extensions can only be used if the OS saves their registers
+    const bool osxsave = HFS >= 1 && (cpuID1.ECX() & OSXSAVE_POS) &&
+                         (cpuID1.ECX() & AVX_POS);
+    if (osxsave && HFS >= 7) {
+        const uint64_t xcr0 = getXCR0();
+        const uint32_t ebx7 = CPUID(7, 0).EBX();
+        mHasAVX2 =
+            (xcr0 & XCR0_AVX_MASK) == XCR0_AVX_MASK && (ebx7 & AVX2_POS);
+        const uint32_t avx512 =
+            AVX512F_POS | AVX512DQ_POS | AVX512BW_POS | AVX512VL_POS;
+        mHasAVX512 = mHasAVX2 &&
+                     (xcr0 & XCR0_AVX512_MASK) == XCR0_AVX512_MASK &&
+                     (ebx7 & avx512) == avx512;
+    }
 }
 
 #else
@@ -115,7 +132,9 @@ CPUInfo::CPUInfo()
     , mNumSMT(1)
     , mNumCores(1)
     , mNumLogCpus(1)
-    , mIsHTT(false) {}
+    , mIsHTT(false)
+    , mHasAVX2(false)
+    , mHasAVX512(false) {}
 
 #endif
 
@@ -123,8 +142,9 @@ namespace cpu {
 
 DeviceManager::DeviceManager()
     : queues(MAX_QUEUES)
+    , threadPool(new ThreadPool(getNumThreads()))
     , fgMngr(new graphics::ForgeManager())
-    , memManager(new common::DefaultMemoryManager(
+    , memManager(common::createDefaultMemoryManager(
           getDeviceCount(), common::MAX_BUFFERS,
           AF_MEM_DEBUG || AF_CPU_MEM_DEBUG)) {
     // Use the default ArrayFire memory manager
@@ -142,9 +162,9 @@ CPUInfo DeviceManager::getCPUInfo() const { return cinfo; }
 
 void DeviceManager::resetMemoryManager() {
     // Replace with default memory manager
-    std::unique_ptr<MemoryManagerBase> mgr(
-        new common::DefaultMemoryManager(getDeviceCount(), common::MAX_BUFFERS,
-                                         AF_MEM_DEBUG || AF_CPU_MEM_DEBUG));
+    std::unique_ptr<MemoryManagerBase> mgr = common::createDefaultMemoryManager(
+        getDeviceCount(), common::MAX_BUFFERS,
+        AF_MEM_DEBUG || AF_CPU_MEM_DEBUG);
     setMemoryManager(std::move(mgr));
 }
 
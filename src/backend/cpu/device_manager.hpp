@@ -11,6 +11,7 @@
 
 #include <platform.hpp>
 #include <queue.hpp>
+#include <thread_pool.hpp>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -28,6 +29,7 @@ using common::memory::MemoryManagerBase;
 #endif
 
 #ifdef _WIN32
+#include <immintrin.h>
 #include <intrin.h>
 #include <limits.h>
 typedef unsigned __int32 uint32_t;
@@ -61,6 +63,17 @@ class CPUID {
     inline const uint32_t& EDX() const { return regs[3]; }
 };
 
+// Returns the state components enabled by the OS in the XCR0 register
+static inline uint64_t getXCR0() {
+#ifdef _WIN32
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    asm volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32U) | eax;
+#endif
+}
+
 #endif
 
 class CPUInfo {
@@ -69,6 +82,8 @@ class CPUInfo {
     std::string vendor() const { return mVendorId; }
     std::string model() const { return mModelName; }
     int threads() const { return mNumLogCpus; }
+    bool hasAVX2() const { return mHasAVX2; }
+    bool hasAVX512() const { return mHasAVX512; }
 
    private:
     // Bit positions for data extractions
@@ -77,6 +92,19 @@ class CPUInfo {
     static const uint32_t LVL_CORES = 0x0000FFFF;
     static const uint32_t HTT_POS   = 0x10000000;
 
+    // Feature bits of CPUID leaf 1 ECX
+    static const uint32_t OSXSAVE_POS = 1U << 27U;
+    static const uint32_t AVX_POS     = 1U << 28U;
+    // Feature bits of CPUID leaf 7 EBX
+    static const uint32_t AVX2_POS     = 1U << 5U;
+    static const uint32_t AVX512F_POS  = 1U << 16U;
+    static const uint32_t AVX512DQ_POS = 1U << 17U;
+    static const uint32_t AVX512BW_POS = 1U << 30U;
+    static const uint32_t AVX512VL_POS = 1U << 31U;
+    // XCR0 bits which are set when the OS saves the YMM and ZMM registers
+    static const uint64_t XCR0_AVX_MASK    = 0x06;
+    static const uint64_t XCR0_AVX512_MASK = 0xE6;
+
     // Attributes
     std::string mVendorId;
     std::string mModelName;
@@ -84,6 +112,8 @@ class CPUInfo {
     unsigned mNumCores;
     unsigned mNumLogCpus;
     bool mIsHTT;
+    bool mHasAVX2;
+    bool mHasAVX512;
 };
 
 namespace cpu {
@@ -102,6 +132,8 @@ class DeviceManager {
 
     friend queue& getQueue(int device);
 
+    friend ThreadPool& getThreadPool();
+
     friend MemoryManagerBase& memoryManager();
 
     friend void setMemoryManager(std::unique_ptr<MemoryManagerBase> mgr);
@@ -136,6 +168,7 @@ class DeviceManager {
 
     // Attributes
     std::vector<queue> queues;
+    std::unique_ptr<ThreadPool> threadPool;
     std::unique_ptr<graphics::ForgeManager> fgMngr;
     const CPUInfo cinfo;
     std::unique_ptr<MemoryManagerBase> memManager;
@@ -11,32 +11,38 @@
 
 #include <Array.hpp>
 #include <copy.hpp>
+#include <fftw.hpp>
 #include <fftw3.h>
 #include <platform.hpp>
 #include <types.hpp>
 #include <af/dim4.hpp>
 
+#include <string>
 #include <type_traits>
 
 using af::dim4;
+using std::string;
 
 namespace cpu {
 
 template<typename T>
 struct fftw_transform;
 
-#define TRANSFORM(PRE, TY)                                             \
-    template<>                                                         \
-    struct fftw_transform<TY> {                                        \
-        typedef PRE##_plan plan_t;                                     \
-        typedef PRE##_complex ctype_t;                                 \
-                                                                       \
-        template<typename... Args>                                     \
-        plan_t create(Args... args) {                                  \
-            return PRE##_plan_many_dft(args...);                       \
-        }                                                              \
-        void execute(plan_t plan) { return PRE##_execute(plan); }      \
-        void destroy(plan_t plan) { return PRE##_destroy_plan(plan); } \
+#define TRANSFORM(PRE, TY)                                                 \
+    template<>                                                             \
+    struct fftw_transform<TY> {                                            \
+        typedef PRE##_plan plan_t;                                         \
+        typedef PRE##_complex ctype_t;                                     \
+        static constexpr bool is_double = std::is_same<TY, cdouble>::value; \
+                                                                           \
+        template<typename... Args>                                         \
+        plan_t create(Args... args) {                                      \
+            return PRE##_plan_many_dft(args...);                           \
+        }                                                                  \
+        template<typename... Args>                                         \
+        void execute(PlanType *plan, Args... args) {                       \
+            PRE##_execute_dft(static_cast<plan_t>(plan), args...);         \
+        }                                                                  \
     };
 
 TRANSFORM(fftwf, cfloat)
@@ -45,18 +51,23 @@ TRANSFORM(fftw, cdouble)
 template<typename To, typename Ti>
 struct fftw_real_transform;
 
-#define TRANSFORM_REAL(PRE, To, Ti, POST)                              \
-    template<>                                                         \
-    struct fftw_real_transform<To, Ti> {                               \
-        typedef PRE##_plan plan_t;                                     \
-        typedef PRE##_complex ctype_t;                                 \
-                                                                       \
-        template<typename... Args>                                     \
-        plan_t create(Args... args) {                                  \
-            return PRE##_plan_many_dft_##POST(args...);                \
-        }                                                              \
-        void execute(plan_t plan) { return PRE##_execute(plan); }      \
-        void destroy(plan_t plan) { return PRE##_destroy_plan(plan); } \
+#define TRANSFORM_REAL(PRE, To, Ti, POST)                                  \
+    template<>                                                             \
+    struct fftw_real_transform<To, Ti> {                                   \
+        typedef PRE##_plan plan_t;                                         \
+        typedef PRE##_complex ctype_t;                                     \
+        static constexpr bool is_double =                                  \
+            std::is_same<To, cdouble>::value ||                            \
+            std::is_same<To, double>::value;                               \
+                                                                           \
+        template<typename... Args>                                         \
+        plan_t create(Args... args) {                                      \
+            return PRE##_plan_many_dft_##POST(args...);                    \
+        }                                                                  \
+        template<typename... Args>                                         \
+        void execute(PlanType *plan, Args... args) {                       \
+            PRE##_execute_dft_##POST(static_cast<plan_t>(plan), args...);  \
+        }                                                                  \
     };
 
 TRANSFORM_REAL(fftwf, cfloat, float, r2c)
@@ -69,8 +80,6 @@ void computeDims(int rdims[rank], const af::dim4 &idims) {
     for (int i = 0; i < rank; i++) { rdims[i] = idims[(rank - 1) - i]; }
 }
 
-void setFFTPlanCacheSize(size_t numPlans) { UNUSED(numPlans); }
-
 template<typename T, int rank, bool direction>
 void fft_inplace(Array<T> &in) {
     auto func = [=](Param<T> in, const af::dim4 iDataDims) {
@@ -85,24 +94,37 @@ void fft_inplace(Array<T> &in) {
         const af::dim4 istrides = in.strides();
 
         using ctype_t = typename fftw_transform<T>::ctype_t;
-        typename fftw_transform<T>::plan_t plan;
 
         fftw_transform<T> transform;
 
         int batch = 1;
         for (int i = rank; i < 4; i++) { batch *= idims[i]; }
 
-        plan = transform.create(
-            rank, t_dims, batch, reinterpret_cast<ctype_t *>(in.get()),
-            in_embed, static_cast<int>(istrides[0]),
-            static_cast<int>(istrides[rank]),
-            reinterpret_cast<ctype_t *>(in.get()), in_embed,
-            static_cast<int>(istrides[0]), static_cast<int>(istrides[rank]),
-            direction ? FFTW_FORWARD : FFTW_BACKWARD,
-            FFTW_ESTIMATE);  // NOLINT(hicpp-signed-bitwise)
-
-        transform.execute(plan);
-        transform.destroy(plan);
+        const int istride = static_cast<int>(istrides[0]);
+        const int idist   = static_cast<int>(istrides[rank]);
+        const int sign    = direction ? FFTW_FORWARD : FFTW_BACKWARD;
+
+        auto *data = reinterpret_cast<ctype_t *>(in.get());
+        const size_t elements =
+            fftwPlanElements(rank, t_dims, batch, in_embed, istride, idist);
+
+        const string key =
+            string(direction ? "c2c:fwd:" : "c2c:inv:") +
+            fftwPlanKey(rank, t_dims, batch, data, in_embed, istride, idist,
+                        data, in_embed, istride, idist);
+
+        SharedPlan plan = findPlan(
+            key, transform.is_double, elements, [&](unsigned flags) {
+                return createPlan(
+                    flags, data, elements, data, elements,
+                    [&](ctype_t *pin, ctype_t *pout) {
+                        return transform.create(
+                            rank, t_dims, batch, pin, in_embed, istride, idist,
+                            pout, in_embed, istride, idist, sign, flags);
+                    });
+            });
+
+        transform.execute(plan.get(), data, data);
     };
     getQueue().enqueue(func, in, in.getDataDims());
 }
@@ -129,23 +151,41 @@ Array<Tc> fft_r2c(const Array<Tr> &in) {
         const af::dim4 ostrides = out.strides();
 
         using ctype_t = typename fftw_real_transform<Tc, Tr>::ctype_t;
-        using plan_t  = typename fftw_real_transform<Tc, Tr>::plan_t;
-        plan_t plan;
 
         fftw_real_transform<Tc, Tr> transform;
 
         int batch = 1;
         for (int i = rank; i < 4; i++) { batch *= idims[i]; }
 
-        plan = transform.create(
-            rank, t_dims, batch, const_cast<Tr *>(in.get()), in_embed,
-            static_cast<int>(istrides[0]), static_cast<int>(istrides[rank]),
-            reinterpret_cast<ctype_t *>(out.get()), out_embed,
-            static_cast<int>(ostrides[0]), static_cast<int>(ostrides[rank]),
-            FFTW_ESTIMATE);
-
-        transform.execute(plan);
-        transform.destroy(plan);
+        const int istride = static_cast<int>(istrides[0]);
+        const int idist   = static_cast<int>(istrides[rank]);
+        const int ostride = static_cast<int>(ostrides[0]);
+        const int odist   = static_cast<int>(ostrides[rank]);
+
+        auto *idata = const_cast<Tr *>(in.get());
+        auto *odata = reinterpret_cast<ctype_t *>(out.get());
+
+        const size_t ielements =
+            fftwPlanElements(rank, t_dims, batch, in_embed, istride, idist);
+        const size_t oelements =
+            fftwPlanElements(rank, t_dims, batch, out_embed, ostride, odist);
+
+        const string key =
+            "r2c:" + fftwPlanKey(rank, t_dims, batch, idata, in_embed, istride,
+                                 idist, odata, out_embed, ostride, odist);
+
+        SharedPlan plan = findPlan(
+            key, transform.is_double, ielements, [&](unsigned flags) {
+                return createPlan(
+                    flags, idata, ielements, odata, oelements,
+                    [&](Tr *pin, ctype_t *pout) {
+                        return transform.create(
+                            rank, t_dims, batch, pin, in_embed, istride, idist,
+                            pout, out_embed, ostride, odist, flags);
+                    });
+            });
+
+        transform.execute(plan.get(), idata, odata);
     };
 
     getQueue().enqueue(func, out, out.getDataDims(), in, in.getDataDims());
@@ -171,34 +211,49 @@ Array<Tr> fft_c2r(const Array<Tc> &in, const dim4 &odims) {
         const af::dim4 ostrides = out.strides();
 
         using ctype_t = typename fftw_real_transform<Tr, Tc>::ctype_t;
-        using plan_t  = typename fftw_real_transform<Tr, Tc>::plan_t;
-        plan_t plan;
 
         fftw_real_transform<Tr, Tc> transform;
 
         int batch = 1;
         for (int i = rank; i < 4; i++) { batch *= odims[i]; }
 
+        const int istride = static_cast<int>(istrides[0]);
+        const int idist   = static_cast<int>(istrides[rank]);
+        const int ostride = static_cast<int>(ostrides[0]);
+        const int odist   = static_cast<int>(ostrides[rank]);
+
+        auto *idata = reinterpret_cast<ctype_t *>(const_cast<Tc *>(in.get()));
+        auto *odata = out.get();
+
+        const size_t ielements =
+            fftwPlanElements(rank, t_dims, batch, in_embed, istride, idist);
+        const size_t oelements =
+            fftwPlanElements(rank, t_dims, batch, out_embed, ostride, odist);
+
+        const string key =
+            "c2r:" + fftwPlanKey(rank, t_dims, batch, idata, in_embed, istride,
+                                 idist, odata, out_embed, ostride, odist);
+
         // By default, fftw estimate flag is sufficient for most transforms.
         // However, complex to real transforms modify the input data memory
         // while performing the transformation. To avoid that, we need to pass
         // FFTW_PRESERVE_INPUT also. This flag however only works for 1D
         // transforms and for higher level transformations, a copy of input
         // data is passed onto the upstream FFTW calls.
-        unsigned int flags = FFTW_ESTIMATE;  // NOLINT(hicpp-signed-bitwise)
-        if (rank == 1) {
-            flags |= FFTW_PRESERVE_INPUT;  // NOLINT(hicpp-signed-bitwise)
-        }
-
-        plan = transform.create(
-            rank, t_dims, batch,
-            reinterpret_cast<ctype_t *>(const_cast<Tc *>(in.get())), in_embed,
-            static_cast<int>(istrides[0]), static_cast<int>(istrides[rank]),
-            out.get(), out_embed, static_cast<int>(ostrides[0]),
-            static_cast<int>(ostrides[rank]), flags);
-
-        transform.execute(plan);
-        transform.destroy(plan);
+        SharedPlan plan = findPlan(
+            key, transform.is_double, oelements, [&](unsigned flags) {
+                // NOLINTNEXTLINE(hicpp-signed-bitwise)
+                if (rank == 1) { flags |= FFTW_PRESERVE_INPUT; }
+                return createPlan(
+                    flags, idata, ielements, odata, oelements,
+                    [&](ctype_t *pin, Tr *pout) {
+                        return transform.create(
+                            rank, t_dims, batch, pin, in_embed, istride, idist,
+                            pout, out_embed, ostride, odist, flags);
+                    });
+            });
+
+        transform.execute(plan.get(), idata, odata);
     };
 
 #ifdef USE_MKL
@@ -11,6 +11,7 @@
 
 #include <Array.hpp>
 #include <common/dispatch.hpp>
+#include <fftw.hpp>
 #include <fftw3.h>
 #include <kernel/fftconvolve.hpp>
 #include <queue.hpp>
@@ -18,14 +19,75 @@
 
 #include <array>
 #include <cmath>
+#include <string>
 #include <type_traits>
 
 using af::dim4;
 using std::array;
 using std::ceil;
+using std::string;
 
 namespace cpu {
 
+static PlanType* planMany(unsigned flags, int rank, const int* n, int batch,
+                          double* data, int stride, int dist, int sign) {
+    auto* cdata = reinterpret_cast<fftw_complex*>(data);
+    return fftw_plan_many_dft(rank, n, batch, cdata, nullptr, stride, dist,
+                              cdata, nullptr, stride, dist, sign, flags);
+}
+
+static PlanType* planMany(unsigned flags, int rank, const int* n, int batch,
+                          float* data, int stride, int dist, int sign) {
+    auto* cdata = reinterpret_cast<fftwf_complex*>(data);
+    return fftwf_plan_many_dft(rank, n, batch, cdata, nullptr, stride, dist,
+                               cdata, nullptr, stride, dist, sign, flags);
+}
+
+static void executePlan(PlanType* plan, double* data) {
+    auto* cdata = reinterpret_cast<fftw_complex*>(data);
+    fftw_execute_dft(static_cast<fftw_plan>(plan), cdata, cdata);
+}
+
+static void executePlan(PlanType* plan, float* data) {
+    auto* cdata = reinterpret_cast<fftwf_complex*>(data);
+    fftwf_execute_dft(static_cast<fftwf_plan>(plan), cdata, cdata);
+}
+
+// Computes the in place transforms of the packed signal and filter
+template<typename T, dim_t baseDim>
+void transformPacked(Param<T> packed, const array<int, baseDim> fftDims,
+                     int sign) {
+    const dim4 packedDims     = packed.dims();
+    const dim4 packed_strides = packed.strides();
+
+    const int rank   = baseDim;
+    const int batch  = packedDims[baseDim];
+    const int stride = packed_strides[0];
+    const int dist   = packed_strides[baseDim] / 2;
+
+    T* data = packed.get();
+    const size_t elements =
+        fftwPlanElements(rank, fftDims.data(), batch, nullptr, stride, dist);
+
+    const string key =
+        string(sign == FFTW_FORWARD ? "c2c:fwd:" : "c2c:inv:") +
+        fftwPlanKey(rank, fftDims.data(), batch, data, nullptr, stride, dist,
+                    data, nullptr, stride, dist);
+
+    SharedPlan plan = findPlan(
+        key, std::is_same<T, double>::value, elements, [&](unsigned flags) {
+            // Each complex value takes two elements of T
+            return createPlan(flags, data, 2 * elements, data, 2 * elements,
+                              [&](T* in, T*) {
+                                  return planMany(flags, rank, fftDims.data(),
+                                                  batch, in, stride, dist,
+                                                  sign);
+                              });
+        });
+
+    executePlan(plan.get(), data);
+}
+
 template<typename T, dim_t baseDim>
 Array<T> fftconvolve(Array<T> const& signal, Array<T> const& filter,
                      const bool expand, AF_BATCH_KIND kind) {
@@ -33,8 +95,6 @@ Array<T> fftconvolve(Array<T> const& signal, Array<T> const& filter,
                                                 std::is_same<T, float>::value,
                                             float, double>::type;
 
-    constexpr bool IsTypeDouble = std::is_same<T, double>::value;
-
     const dim4& sd = signal.dims();
     const dim4& fd = filter.dims();
     dim_t fftScale = 1;
@@ -86,74 +146,18 @@ Array<T> fftconvolve(Array<T> const& signal, Array<T> const& filter,
     getQueue().enqueue(kernel::padArray<convT, T>, packed, paddedFilDims,
                        paddedFilStrides, filter, offset);
 
-    // NOLINTNEXTLINE(performance-unnecessary-value-param)
-    auto upstream_dft = [=](Param<convT> packed,
-                            const array<int, baseDim> fftDims) {
-        const dim4 packedDims     = packed.dims();
-        const dim4 packed_strides = packed.strides();
-        // Compute forward FFT
-        if (IsTypeDouble) {
-            fftw_plan plan = fftw_plan_many_dft(
-                baseDim, fftDims.data(), packedDims[baseDim],
-                reinterpret_cast<fftw_complex*>(packed.get()), nullptr,
-                packed_strides[0], packed_strides[baseDim] / 2,
-                reinterpret_cast<fftw_complex*>(packed.get()), nullptr,
-                packed_strides[0], packed_strides[baseDim] / 2, FFTW_FORWARD,
-                FFTW_ESTIMATE);  // NOLINT(hicpp-signed-bitwise)
-
-            fftw_execute(plan);
-            fftw_destroy_plan(plan);
-        } else {
-            fftwf_plan plan = fftwf_plan_many_dft(
-                baseDim, fftDims.data(), packedDims[baseDim],
-                reinterpret_cast<fftwf_complex*>(packed.get()), nullptr,
-                packed_strides[0], packed_strides[baseDim] / 2,
-                reinterpret_cast<fftwf_complex*>(packed.get()), nullptr,
-                packed_strides[0], packed_strides[baseDim] / 2, FFTW_FORWARD,
-                FFTW_ESTIMATE);  // NOLINT(hicpp-signed-bitwise)
-
-            fftwf_execute(plan);
-            fftwf_destroy_plan(plan);
-        }
-    };
-    getQueue().enqueue(upstream_dft, packed, fftDims);
+    // Compute forward FFT
+    getQueue().enqueue(transformPacked<convT, baseDim>, packed, fftDims,
+                       FFTW_FORWARD);
 
     // Multiply filter and signal FFT arrays
     getQueue().enqueue(kernel::complexMultiply<convT>, packed, paddedSigDims,
                        paddedSigStrides, paddedFilDims, paddedFilStrides, kind,
                        offset);
 
-    // NOLINTNEXTLINE(performance-unnecessary-value-param)
-    auto upstream_idft = [=](Param<convT> packed,
-                             const array<int, baseDim> fftDims) {
-        const dim4 packedDims     = packed.dims();
-        const dim4 packed_strides = packed.strides();
-        // Compute inverse FFT
-        if (IsTypeDouble) {
-            fftw_plan plan = fftw_plan_many_dft(
-                baseDim, fftDims.data(), packedDims[baseDim],
-                reinterpret_cast<fftw_complex*>(packed.get()), nullptr,
-                packed_strides[0], packed_strides[baseDim] / 2,
-                reinterpret_cast<fftw_complex*>(packed.get()), nullptr,
-                packed_strides[0], packed_strides[baseDim] / 2, FFTW_BACKWARD,
-                FFTW_ESTIMATE);  // NOLINT(hicpp-signed-bitwise)
-
-            fftw_execute(plan);
-            fftw_destroy_plan(plan);
-        } else {
-            fftwf_plan plan = fftwf_plan_many_dft(
-                baseDim, fftDims.data(), packedDims[baseDim],
-                reinterpret_cast<fftwf_complex*>(packed.get()), nullptr,
-                packed_strides[0], packed_strides[baseDim] / 2,
-                reinterpret_cast<fftwf_complex*>(packed.get()), nullptr,
-                packed_strides[0], packed_strides[baseDim] / 2, FFTW_BACKWARD,
-                FFTW_ESTIMATE);  // NOLINT(hicpp-signed-bitwise)
-
-            fftwf_execute(plan);
-            fftwf_destroy_plan(plan);
-        }
-    };
-    getQueue().enqueue(upstream_idft, packed, fftDims);
+    // Compute inverse FFT
+    getQueue().enqueue(transformPacked<convT, baseDim>, packed, fftDims,
+                       FFTW_BACKWARD);
 
     // Compute output dimensions
     dim4 oDims(1);
@@ -0,0 +1,256 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <fftw.hpp>
+
+#include <common/FFTPlanCache.hpp>
+#include <common/defines.hpp>
+#include <common/err_common.hpp>
+#include <common/util.hpp>
+#include <fft.hpp>
+#include <fftw3.h>
+#include <platform.hpp>
+#include <thread_pool.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+
+using std::lock_guard;
+using std::recursive_mutex;
+using std::string;
+
+namespace cpu {
+
+namespace {
+class PlanCache : public common::FFTPlanCache<PlanCache, PlanType> {};
+
+// Alignment of the plans. The SIMD code paths of FFTW need at most 64 bytes.
+constexpr uintptr_t PLAN_ALIGNMENT = 64;
+
+// Smallest number of elements transformed by each FFTW thread. Smaller
+// transforms spend more time synchronizing the threads than computing.
+constexpr size_t MIN_ELEMENTS_PER_THREAD = 1 << 15;
+
+// The FFTW planner is not thread safe. The plans are destroyed with the lock
+// held too, which can happen while the cache is updated in findPlan.
+recursive_mutex &plannerMutex() {
+    static recursive_mutex mutex;
+    return mutex;
+}
+
+string wisdomFile(bool is_double) {
+    string file = getEnvVar("AF_FFTW_WISDOM");
+    if (file.empty()) { return file; }
+    return file + (is_double ? ".f64" : ".f32");
+}
+
+PlanCache &fftManager() {
+    // The mutex is created first so that it outlives the cached plans
+    plannerMutex();
+    static PlanCache cache;
+    return cache;
+}
+
+void importWisdom() {
+#ifndef USE_MKL
+    static std::once_flag flag;
+    std::call_once(flag, [] {
+        string file = wisdomFile(true);
+        if (file.empty()) { return; }
+        fftw_import_wisdom_from_filename(file.c_str());
+        fftwf_import_wisdom_from_filename(wisdomFile(false).c_str());
+    });
+#endif
+}
+
+#ifdef AF_FFTW_THREADS_CALLBACK
+// Runs the jobs of the FFTW threads on the backend thread pool so that FFTW
+// does not start threads of its own which compete with the pool for cores
+void parallelLoop(void *(*work)(char *), char *jobdata, size_t elsize,
+                  int njobs, void *) {
+    getThreadPool().run(njobs, [&](int job) { work(jobdata + elsize * job); });
+}
+#endif
+
+void initThreads() {
+#ifdef AF_FFTW_THREADS
+    static std::once_flag flag;
+    std::call_once(flag, [] {
+        fftw_init_threads();
+        fftwf_init_threads();
+#ifdef AF_FFTW_THREADS_CALLBACK
+        fftw_threads_set_callback(parallelLoop, nullptr);
+        fftwf_threads_set_callback(parallelLoop, nullptr);
+#endif
+    });
+#endif
+}
+
+void exportWisdom(bool is_double) {
+#ifndef USE_MKL
+    string file = wisdomFile(is_double);
+    if (file.empty()) { return; }
+    if (is_double) {
+        fftw_export_wisdom_to_filename(file.c_str());
+    } else {
+        fftwf_export_wisdom_to_filename(file.c_str());
+    }
+#else
+    UNUSED(is_double);
+#endif
+}
+
+// Writes the wisdom gathered by the planner to the wisdom files once, when
+// the library is unloaded, instead of rewriting them after every plan
+class WisdomExporter {
+    bool changed[2] = {false, false};
+
+   public:
+    void planned(bool is_double) { changed[is_double] = true; }
+
+    ~WisdomExporter() {
+        lock_guard<recursive_mutex> lock(plannerMutex());
+        if (changed[false]) { exportWisdom(false); }
+        if (changed[true]) { exportWisdom(true); }
+    }
+};
+
+WisdomExporter &wisdomExporter() {
+    // The mutex is created first so that it outlives the exporter
+    plannerMutex();
+    static WisdomExporter exporter;
+    return exporter;
+}
+}  // namespace
+
+void setFFTPlanCacheSize(size_t numPlans) {
+    lock_guard<recursive_mutex> lock(plannerMutex());
+    fftManager().setMaxCacheSize(numPlans);
+}
+
+unsigned fftwPlannerFlags() {
+    static const unsigned flags = [] {
+        string mode = getEnvVar("AF_FFTW_PLANNER");
+        std::transform(mode.begin(), mode.end(), mode.begin(), ::tolower);
+        if (mode == "measure") { return unsigned(FFTW_MEASURE); }
+        if (mode == "patient") { return unsigned(FFTW_PATIENT); }
+        return unsigned(FFTW_ESTIMATE);
+    }();
+    return flags;
+}
+
+string fftwPlanKey(int rank, const int *n, int batch, const void *in,
+                   const int *inembed, int istride, int idist, const void *out,
+                   const int *onembed, int ostride, int odist) {
+    if (inembed == nullptr) { inembed = n; }
+    if (onembed == nullptr) { onembed = n; }
+
+    string key = std::to_string(rank) + ":" + std::to_string(batch);
+    for (int i = 0; i < rank; ++i) {
+        key += ":" + std::to_string(n[i]) + ":" + std::to_string(inembed[i]) +
+               ":" + std::to_string(onembed[i]);
+    }
+    // The plans need arrays with the same alignment as the ones they were
+    // created for
+    const uintptr_t ialign = reinterpret_cast<uintptr_t>(in) % PLAN_ALIGNMENT;
+    const uintptr_t oalign = reinterpret_cast<uintptr_t>(out) % PLAN_ALIGNMENT;
+    key += ":" + std::to_string(istride) + ":" + std::to_string(idist) + ":" +
+           std::to_string(ialign) + ":" + std::to_string(ostride) + ":" +
+           std::to_string(odist) + ":" + std::to_string(oalign) +
+           (in == out ? ":inplace" : "");
+    return key;
+}
+
+size_t fftwPlanElements(int rank, const int *n, int batch, const int *nembed,
+                        int stride, int dist) {
+    if (nembed == nullptr) { nembed = n; }
+
+    size_t elements = 1;
+    for (int i = 0; i < rank; ++i) { elements *= nembed[i]; }
+    return size_t(batch - 1) * dist + elements * stride;
+}
+
+PlannerBuffer::PlannerBuffer(const void *like, size_t bytes)
+    : data(bytes + 2 * PLAN_ALIGNMENT) {
+    uintptr_t base   = reinterpret_cast<uintptr_t>(data.data());
+    uintptr_t offset = reinterpret_cast<uintptr_t>(like) % PLAN_ALIGNMENT;
+    uintptr_t start  = (base + PLAN_ALIGNMENT - 1) / PLAN_ALIGNMENT;
+    ptr = reinterpret_cast<char *>(start * PLAN_ALIGNMENT + offset);
+}
+
+int fftwNumThreads(size_t elements) {
+#ifdef AF_FFTW_THREADS
+    // Malformed values fall back to the number of threads of the backend
+    static const int env_threads = [] {
+        try {
+            string env = getEnvVar("AF_FFTW_NUM_THREADS");
+            if (!env.empty()) { return std::max(std::stoi(env), 1); }
+        } catch (const std::logic_error &) {}
+        return 0;
+    }();
+    int nthreads =
+        env_threads > 0 ? env_threads : static_cast<int>(getNumThreads());
+
+    const size_t limit = elements / MIN_ELEMENTS_PER_THREAD;
+    nthreads = static_cast<int>(std::min<size_t>(nthreads, limit));
+    return std::max(nthreads, 1);
+#else
+    UNUSED(elements);
+    return 1;
+#endif
+}
+
+SharedPlan findPlan(const string &key, bool is_double, size_t elements,
+                    const PlanCreator &create) {
+    const unsigned flags  = fftwPlannerFlags();
+    const int nthreads    = fftwNumThreads(elements);
+    const string plan_key = key + (is_double ? ":f64:" : ":f32:") +
+                            std::to_string(flags) + ":" +
+                            std::to_string(nthreads);
+
+    lock_guard<recursive_mutex> lock(plannerMutex());
+
+    PlanCache &planner = fftManager();
+    SharedPlan plan    = planner.find(plan_key);
+    if (plan) { return plan; }
+
+    importWisdom();
+    initThreads();
+#ifdef AF_FFTW_THREADS
+    if (is_double) {
+        fftw_plan_with_nthreads(nthreads);
+    } else {
+        fftwf_plan_with_nthreads(nthreads);
+    }
+#endif
+    PlanType *ptr = create(flags);
+    if (ptr == nullptr) {
+        AF_ERROR("Failed to create an FFTW plan", AF_ERR_INTERNAL);
+    }
+
+    plan.reset(ptr, [is_double](PlanType *p) {
+        lock_guard<recursive_mutex> lock(plannerMutex());
+        if (is_double) {
+            fftw_destroy_plan(static_cast<fftw_plan>(p));
+        } else {
+            fftwf_destroy_plan(static_cast<fftwf_plan>(p));
+        }
+    });
+    planner.push(plan_key, plan);
+
+    // FFTW_ESTIMATE does not measure the transforms and creates no wisdom
+    if (flags != FFTW_ESTIMATE) { wisdomExporter().planned(is_double); }
+
+    return plan;
+}
+
+}  // namespace cpu
@@ -0,0 +1,100 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+
+#include <fftw3.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cpu {
+// fftw_plan and fftwf_plan point to different opaque structs
+typedef void PlanType;
+typedef std::shared_ptr<PlanType> SharedPlan;
+
+/// Creates a plan with the given planner flags
+typedef std::function<PlanType *(unsigned flags)> PlanCreator;
+
+/// Returns the plan identified by \p key from the plan cache. If the plan is
+/// not in the cache, it is created by \p create and added to the cache.
+///
+/// The plans are executed with the new-array execute functions of FFTW, so
+/// the key only needs to describe the layout and alignment of the arrays.
+/// \p elements is the number of elements transformed by the plan, which
+/// decides how many threads the plan is executed on.
+SharedPlan findPlan(const std::string &key, bool is_double, size_t elements,
+                    const PlanCreator &create);
+
+/// Returns the number of threads used to transform \p elements elements.
+/// Defaults to the number of threads of the backend or the value of the
+/// AF_FFTW_NUM_THREADS environment variable, but small transforms use fewer
+/// threads. Always one if FFTW was built without threads.
+int fftwNumThreads(size_t elements);
+
+/// Returns the flags passed to the FFTW planner. FFTW_ESTIMATE by default or
+/// the mode selected with the AF_FFTW_PLANNER environment variable.
+unsigned fftwPlannerFlags();
+
+/// Returns a key describing a batched transform of \p rank dimensions. The
+/// layout of the arrays is described as in fftw_plan_many_dft. If \p inembed
+/// or \p onembed is null, the array has the dimensions of the transform.
+std::string fftwPlanKey(int rank, const int *n, int batch, const void *in,
+                        const int *inembed, int istride, int idist,
+                        const void *out, const int *onembed, int ostride,
+                        int odist);
+
+/// Returns the number of elements spanned by the batched transform of an
+/// array with the layout described as in fftw_plan_many_dft
+size_t fftwPlanElements(int rank, const int *n, int batch, const int *nembed,
+                        int stride, int dist);
+
+/// Memory for the FFTW planner to overwrite when it measures the transforms
+///
+/// The memory has the same alignment as the array the plan is created for
+/// so that the plan can be executed on the array.
+class PlannerBuffer {
+    std::vector<char> data;
+    char *ptr;
+
+   public:
+    PlannerBuffer(const void *like, size_t bytes);
+
+    template<typename T>
+    T *get() const {
+        return reinterpret_cast<T *>(ptr);
+    }
+};
+
+/// Creates a plan for the arrays \p in and \p out with \p create, which is
+/// called with the pointers to the arrays the plan is created for.
+///
+/// The FFTW planner overwrites the arrays when it measures the transforms,
+/// so the plan is then created for PlannerBuffers with the same alignment.
+template<typename Ti, typename To, typename F>
+PlanType *createPlan(unsigned flags, Ti *in, size_t in_elements, To *out,
+                     size_t out_elements, F create) {
+    if (flags == FFTW_ESTIMATE) { return create(in, out); }
+
+    const size_t in_bytes  = in_elements * sizeof(Ti);
+    const size_t out_bytes = out_elements * sizeof(To);
+    if (static_cast<void *>(in) == static_cast<void *>(out)) {
+        PlannerBuffer buffer(in, std::max(in_bytes, out_bytes));
+        return create(buffer.get<Ti>(), buffer.get<To>());
+    }
+    PlannerBuffer in_buffer(in, in_bytes);
+    PlannerBuffer out_buffer(out, out_bytes);
+    return create(in_buffer.get<Ti>(), out_buffer.get<To>());
+}
+
+}  // namespace cpu
@@ -8,17 +8,17 @@
  ********************************************************/
 
 #include <Array.hpp>
-#include <arith.hpp>
 #include <err_cpu.hpp>
 #include <homography.hpp>
 #include <platform.hpp>
 #include <queue.hpp>
+#include <thread_pool.hpp>
 #include <af/dim4.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cfloat>
 #include <cmath>
-#include <cstring>
 #include <vector>
 
 using af::dim4;
@@ -39,12 +39,19 @@ T sq(T a) {
     return a * a;
 }
 
-#define APTR(Y, X) (A_ptr[(Y)*Adims[0] + (X)])
+#define APTR(Y, X) (A_ptr[(Y)*9 + (X)])
 
 static const float RANSACConfidence  = 0.99f;
 static const float LMEDSConfidence   = 0.99f;
 static const float LMEDSOutlierRatio = 0.4f;
 
+// Number of points whose errors are computed before checking if a
+// hypothesis can still win
+static const unsigned HomographyBlock = 256;
+// Number of hypotheses evaluated by each thread between updates of the best
+// result
+static const unsigned HomographyRound = 4;
+
 template<typename T>
 struct EPS {
     T eps() { return FLT_EPSILON; }
@@ -151,30 +158,20 @@ unsigned updateIterations(float inlier_ratio, unsigned iter) {
 }
 
 template<typename T>
-int computeHomography(T* H_ptr, const float* rnd_ptr, const float* x_src_ptr,
+int computeHomography(T* H_ptr, const unsigned* idx, const float* x_src_ptr,
                       const float* y_src_ptr, const float* x_dst_ptr,
                       const float* y_dst_ptr) {
-    if (static_cast<unsigned>(rnd_ptr[0]) ==
-            static_cast<unsigned>(rnd_ptr[1]) ||
-        static_cast<unsigned>(rnd_ptr[0]) ==
-            static_cast<unsigned>(rnd_ptr[2]) ||
-        static_cast<unsigned>(rnd_ptr[0]) ==
-            static_cast<unsigned>(rnd_ptr[3]) ||
-        static_cast<unsigned>(rnd_ptr[1]) ==
-            static_cast<unsigned>(rnd_ptr[2]) ||
-        static_cast<unsigned>(rnd_ptr[1]) ==
-            static_cast<unsigned>(rnd_ptr[3]) ||
-        static_cast<unsigned>(rnd_ptr[2]) ==
-            static_cast<unsigned>(rnd_ptr[3])) {
+    if (idx[0] == idx[1] || idx[0] == idx[2] || idx[0] == idx[3] ||
+        idx[1] == idx[2] || idx[1] == idx[3] || idx[2] == idx[3]) {
         return 1;
     }
 
     float src_pt_x[4], src_pt_y[4], dst_pt_x[4], dst_pt_y[4];
     for (unsigned j = 0; j < 4; j++) {
-        src_pt_x[j] = x_src_ptr[static_cast<unsigned>(rnd_ptr[j])];
-        src_pt_y[j] = y_src_ptr[static_cast<unsigned>(rnd_ptr[j])];
-        dst_pt_x[j] = x_dst_ptr[static_cast<unsigned>(rnd_ptr[j])];
-        dst_pt_y[j] = y_dst_ptr[static_cast<unsigned>(rnd_ptr[j])];
+        src_pt_x[j] = x_src_ptr[idx[j]];
+        src_pt_y[j] = y_src_ptr[idx[j]];
+        dst_pt_x[j] = x_dst_ptr[idx[j]];
+        dst_pt_y[j] = y_dst_ptr[idx[j]];
     }
 
     float x_src_mean =
@@ -198,10 +195,8 @@ int computeHomography(T* H_ptr, const float* rnd_ptr, const float* x_src_ptr,
     float src_scale = sqrt(2.0f) / sqrt(src_var);
     float dst_scale = sqrt(2.0f) / sqrt(dst_var);
 
-    Array<T> A     = createValueArray<T>(af::dim4(9, 9), static_cast<T>(0));
-    af::dim4 Adims = A.dims();
-    T* A_ptr       = A.get();
-    getQueue().sync();
+    array<T, 81> A{};
+    T* A_ptr = A.data();
 
     for (unsigned j = 0; j < 4; j++) {
         float srcx = (src_pt_x[j] - x_src_mean) * src_scale;
@@ -224,17 +219,11 @@ int computeHomography(T* H_ptr, const float* rnd_ptr, const float* x_src_ptr,
         APTR(8, j * 2 + 1) = -dstx;
     }
 
-    Array<T> V =
-        createValueArray<T>(af::dim4(Adims[1], Adims[1]), static_cast<T>(0));
-    V.eval();
-    getQueue().sync();
-    JacobiSVD<T, 9, 9>(A.get(), V.get());
-
-    dim4 Vdims = V.dims();
-    T* V_ptr   = V.get();
+    array<T, 81> V{};
+    JacobiSVD<T, 9, 9>(A.data(), V.data());
 
     array<T, 9> vH{};
-    for (unsigned j = 0; j < 9; j++) { vH[j] = V_ptr[8 * Vdims[0] + j]; }
+    for (unsigned j = 0; j < 9; j++) { vH[j] = V[8 * 9 + j]; }
 
     H_ptr[0] = src_scale * x_dst_mean * vH[6] + src_scale * vH[0] / dst_scale;
     H_ptr[1] = src_scale * x_dst_mean * vH[7] + src_scale * vH[1] / dst_scale;
@@ -260,98 +249,183 @@ int computeHomography(T* H_ptr, const float* rnd_ptr, const float* x_src_ptr,
     return 0;
 }
 
+/// Writes the squared reprojection errors of the points [\p begin, \p end)
+/// under the homography \p H_ptr to \p dist
+template<typename T>
+void reprojectionErrors(float* dist, const T* H_ptr, const float* x_src_ptr,
+                        const float* y_src_ptr, const float* x_dst_ptr,
+                        const float* y_dst_ptr, unsigned begin, unsigned end) {
+    // Local copies keep the loop from reloading H through dist
+    array<T, 9> H;
+    std::copy(H_ptr, H_ptr + 9, H.begin());
+
+    for (unsigned j = begin; j < end; j++) {
+        float z = H[6] * x_src_ptr[j] + H[7] * y_src_ptr[j] + H[8];
+        float x = (H[0] * x_src_ptr[j] + H[1] * y_src_ptr[j] + H[2]) / z;
+        float y = (H[3] * x_src_ptr[j] + H[4] * y_src_ptr[j] + H[5]) / z;
+
+        dist[j - begin] = sq(x_dst_ptr[j] - x) + sq(y_dst_ptr[j] - y);
+    }
+}
+
+/// Counts the inliers of \p H_ptr
+///
+/// Stops early once the hypothesis can no longer have more than \p bound
+/// inliers and returns the partial count in that case.
+template<typename T>
+int countInliers(float* dist, const T* H_ptr, const float* x_src_ptr,
+                 const float* y_src_ptr, const float* x_dst_ptr,
+                 const float* y_dst_ptr, unsigned nsamples,
+                 float inlier_thr, int bound) {
+    const float thr2  = inlier_thr * inlier_thr;
+    int inliers_count = 0;
+    for (unsigned b = 0; b < nsamples; b += HomographyBlock) {
+        unsigned e = min(nsamples, b + HomographyBlock);
+        reprojectionErrors(dist, H_ptr, x_src_ptr, y_src_ptr, x_dst_ptr,
+                           y_dst_ptr, b, e);
+
+        int count = 0;
+        for (unsigned j = 0; j < e - b; j++) { count += dist[j] < thr2; }
+        inliers_count += count;
+
+        if (inliers_count + static_cast<int>(nsamples - e) <= bound) { break; }
+    }
+    return inliers_count;
+}
+
+/// Returns the median reprojection error of \p H_ptr
+///
+/// Returns FLT_MAX without finishing once too many errors are at least
+/// \p bound for the median to be smaller than it.
+template<typename T>
+float medianError(float* dist, const T* H_ptr, const float* x_src_ptr,
+                  const float* y_src_ptr, const float* x_dst_ptr,
+                  const float* y_dst_ptr, unsigned nsamples, float bound) {
+    // The median is below bound only if the lower middle error is
+    const unsigned mid      = nsamples / 2;
+    const unsigned maxLarge = nsamples - 1 - (nsamples % 2 ? mid : mid - 1);
+
+    unsigned large = 0;
+    for (unsigned b = 0; b < nsamples; b += HomographyBlock) {
+        unsigned e = min(nsamples, b + HomographyBlock);
+        reprojectionErrors(dist + b, H_ptr, x_src_ptr, y_src_ptr, x_dst_ptr,
+                           y_dst_ptr, b, e);
+
+        unsigned count = 0;
+        for (unsigned j = b; j < e; j++) { count += sqrt(dist[j]) >= bound; }
+        large += count;
+
+        if (large > maxLarge) { return FLT_MAX; }
+    }
+
+    // The square root preserves the order, so it is only taken of the middle
+    // errors
+    std::nth_element(dist, dist + mid, dist + nsamples);
+    float median = sqrt(dist[mid]);
+    if (nsamples % 2 == 0) {
+        median = (median + sqrt(*std::max_element(dist, dist + mid))) * 0.5f;
+    }
+    return median;
+}
+
 // LMedS:
 // http://research.microsoft.com/en-us/um/people/zhang/INRIA/Publis/Tutorial-Estim/node25.html
+//
+// The hypotheses are evaluated in parallel in rounds of a few per thread.
+// Hypotheses that cannot beat the best result of the earlier rounds stop
+// scoring early. Their partial scores can neither be selected nor lower
+// the RANSAC iteration count, so the result matches a sequential search.
 template<typename T>
 int findBestHomography(Array<T>& bestH, const Array<float>& x_src,
                        const Array<float>& y_src, const Array<float>& x_dst,
-                       const Array<float>& y_dst, const Array<float>& rnd,
+                       const Array<float>& y_dst, const Array<float>& initial,
                        const unsigned iterations, const unsigned nsamples,
                        const float inlier_thr, const af_homography_type htype) {
     const float* x_src_ptr = x_src.get();
     const float* y_src_ptr = y_src.get();
     const float* x_dst_ptr = x_dst.get();
     const float* y_dst_ptr = y_dst.get();
-
-    Array<T> H =
-        createValueArray<T>(af::dim4(9, iterations), static_cast<T>(0));
-    H.eval();
+    const float* init_ptr  = initial.get();
     getQueue().sync();
 
-    const af::dim4& rdims = rnd.dims();
-    const af::dim4& Hdims = H.dims();
-
-    unsigned iter    = iterations;
-    unsigned bestIdx = 0;
-    int bestInliers  = 0;
-    float minMedian  = FLT_MAX;
-
-    for (unsigned i = 0; i < iter; i++) {
-        const unsigned Hidx = Hdims[0] * i;
-        T* H_ptr            = H.get() + Hidx;
-
-        const unsigned ridx  = rdims[0] * i;
-        const float* rnd_ptr = rnd.get() + ridx;
-
-        if (computeHomography<T>(H_ptr, rnd_ptr, x_src_ptr, y_src_ptr,
-                                 x_dst_ptr, y_dst_ptr)) {
-            continue;
-        }
+    ThreadPool& pool     = getThreadPool();
+    const unsigned batch = pool.size() * HomographyRound;
+
+    vector<T> H(9 * batch);
+    vector<int> valid(batch);
+    vector<int> inliers(batch);
+    vector<float> medians(batch);
+
+    unsigned iter   = iterations;
+    int bestInliers = 0;
+    float minMedian = FLT_MAX;
+    array<T, 9> best{};
+
+    for (unsigned first = 0; first < iter; first += batch) {
+        const unsigned last     = min(iter, first + batch);
+        const int inlierBound   = bestInliers;
+        const float medianBound = minMedian;
+
+        parallel_for(first, last, 1, [&](dim_t begin, dim_t end) {
+            vector<float> dist(htype == AF_HOMOGRAPHY_LMEDS ? nsamples
+                                                            : HomographyBlock);
+            for (dim_t i = begin; i < end; i++) {
+                const unsigned k = static_cast<unsigned>(i - first);
+                T* H_ptr         = H.data() + 9 * k;
+
+                unsigned idx[4];
+                for (unsigned j = 0; j < 4; j++) {
+                    idx[j] = static_cast<unsigned>(
+                        init_ptr[4 * i + j] * static_cast<float>(nsamples));
+                }
 
-        if (htype == AF_HOMOGRAPHY_RANSAC) {
-            int inliers_count = 0;
-            for (unsigned j = 0; j < nsamples; j++) {
-                float z = H_ptr[6] * x_src_ptr[j] + H_ptr[7] * y_src_ptr[j] +
-                          H_ptr[8];
-                float x = (H_ptr[0] * x_src_ptr[j] + H_ptr[1] * y_src_ptr[j] +
-                           H_ptr[2]) /
-                          z;
-                float y = (H_ptr[3] * x_src_ptr[j] + H_ptr[4] * y_src_ptr[j] +
-                           H_ptr[5]) /
-                          z;
-
-                float dist = sq(x_dst_ptr[j] - x) + sq(y_dst_ptr[j] - y);
-                if (dist < (inlier_thr * inlier_thr)) { inliers_count++; }
-            }
-            iter =
-                updateIterations(static_cast<float>(nsamples - inliers_count) /
-                                     static_cast<float>(nsamples),
-                                 iter);
-            if (inliers_count > bestInliers) {
-                bestIdx     = i;
-                bestInliers = inliers_count;
-            }
-        } else if (htype == AF_HOMOGRAPHY_LMEDS) {
-            vector<float> err(nsamples);
-            for (unsigned j = 0; j < nsamples; j++) {
-                float z = H_ptr[6] * x_src_ptr[j] + H_ptr[7] * y_src_ptr[j] +
-                          H_ptr[8];
-                float x = (H_ptr[0] * x_src_ptr[j] + H_ptr[1] * y_src_ptr[j] +
-                           H_ptr[2]) /
-                          z;
-                float y = (H_ptr[3] * x_src_ptr[j] + H_ptr[4] * y_src_ptr[j] +
-                           H_ptr[5]) /
-                          z;
-
-                float dist = sq(x_dst_ptr[j] - x) + sq(y_dst_ptr[j] - y);
-                err[j]     = sqrt(dist);
+                valid[k] = !computeHomography<T>(H_ptr, idx, x_src_ptr,
+                                                 y_src_ptr, x_dst_ptr,
+                                                 y_dst_ptr);
+                if (!valid[k]) { continue; }
+
+                if (htype == AF_HOMOGRAPHY_RANSAC) {
+                    inliers[k] = countInliers(
+                        dist.data(), H_ptr, x_src_ptr, y_src_ptr, x_dst_ptr,
+                        y_dst_ptr, nsamples, inlier_thr, inlierBound);
+                } else if (htype == AF_HOMOGRAPHY_LMEDS) {
+                    medians[k] =
+                        medianError(dist.data(), H_ptr, x_src_ptr, y_src_ptr,
+                                    x_dst_ptr, y_dst_ptr, nsamples,
+                                    medianBound);
+                }
             }
+        });
 
-            stable_sort(err.begin(), err.end());
+        for (unsigned i = first; i < last && i < iter; i++) {
+            const unsigned k = i - first;
+            if (!valid[k]) { continue; }
 
-            float median = err[nsamples / 2];
-            if (nsamples % 2 == 0) {
-                median = (median + err[nsamples / 2 - 1]) * 0.5f;
-            }
+            const T* H_ptr = H.data() + 9 * k;
+            if (i == 0) { std::copy(H_ptr, H_ptr + 9, best.begin()); }
+
+            if (htype == AF_HOMOGRAPHY_RANSAC) {
+                int inliers_count = inliers[k];
 
-            if (median < minMedian && median > FLT_EPSILON) {
-                minMedian = median;
-                bestIdx   = i;
+                iter = updateIterations(
+                    static_cast<float>(nsamples - inliers_count) /
+                        static_cast<float>(nsamples),
+                    iter);
+                if (inliers_count > bestInliers) {
+                    std::copy(H_ptr, H_ptr + 9, best.begin());
+                    bestInliers = inliers_count;
+                }
+            } else if (htype == AF_HOMOGRAPHY_LMEDS) {
+                float median = medians[k];
+                if (median < minMedian && median > FLT_EPSILON) {
+                    std::copy(H_ptr, H_ptr + 9, best.begin());
+                    minMedian = median;
+                }
             }
         }
     }
 
-    memcpy(bestH.get(), H.get() + bestIdx * 9, 9 * sizeof(T));
+    std::copy(best.begin(), best.end(), bestH.get());
 
     if (htype == AF_HOMOGRAPHY_LMEDS) {
         float sigma =
@@ -359,20 +433,15 @@ int findBestHomography(Array<T>& bestH, const Array<float>& x_src,
                     static_cast<float>(sqrt(minMedian)),
                 1e-6f);
         float dist_thr = sq(2.5f * sigma);
-        T* bestH_ptr   = bestH.get();
-
-        for (unsigned j = 0; j < nsamples; j++) {
-            float z = bestH_ptr[6] * x_src_ptr[j] +
-                      bestH_ptr[7] * y_src_ptr[j] + bestH_ptr[8];
-            float x = (bestH_ptr[0] * x_src_ptr[j] +
-                       bestH_ptr[1] * y_src_ptr[j] + bestH_ptr[2]) /
-                      z;
-            float y = (bestH_ptr[3] * x_src_ptr[j] +
-                       bestH_ptr[4] * y_src_ptr[j] + bestH_ptr[5]) /
-                      z;
-
-            float dist = sq(x_dst_ptr[j] - x) + sq(y_dst_ptr[j] - y);
-            if (dist <= dist_thr) { bestInliers++; }
+
+        vector<float> dist(HomographyBlock);
+        for (unsigned b = 0; b < nsamples; b += HomographyBlock) {
+            unsigned e = min(nsamples, b + HomographyBlock);
+            reprojectionErrors(dist.data(), best.data(), x_src_ptr, y_src_ptr,
+                               x_dst_ptr, y_dst_ptr, b, e);
+            for (unsigned j = 0; j < e - b; j++) {
+                if (dist[j] <= dist_thr) { bestInliers++; }
+            }
         }
     }
 
@@ -395,15 +464,8 @@ int homography(Array<T>& bestH, const Array<float>& x_src,
                              log(1.f - pow(1.f - LMEDSOutlierRatio, 4.f))));
     }
 
-    af::dim4 rdims(4, iter);
-    Array<float> fctr =
-        createValueArray<float>(rdims, static_cast<float>(nsamples));
-    Array<float> rnd = arithOp<float, af_mul_t>(initial, fctr, rdims);
-    rnd.eval();
-    getQueue().sync();
-
-    return findBestHomography<T>(bestH, x_src, y_src, x_dst, y_dst, rnd, iter,
-                                 nsamples, inlier_thr, htype);
+    return findBestHomography<T>(bestH, x_src, y_src, x_dst, y_dst, initial,
+                                 iter, nsamples, inlier_thr, htype);
 }
 
 #define INSTANTIATE(T)                                          \
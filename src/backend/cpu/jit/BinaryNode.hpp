@@ -11,7 +11,9 @@
 
 #include <math.hpp>
 #include <optypes.hpp>
+#include <algorithm>
 #include <array>
+#include <type_traits>
 #include <vector>
 #include "Node.hpp"
 
@@ -48,6 +50,43 @@ class BinaryNode : public TNode<compute_t<To>> {
         UNUSED(idx);
         m_op.eval(this->m_val, m_lhs->m_val, m_rhs->m_val, lim);
     }
+
+    Node_ptr clone(
+        const std::array<Node_ptr, Node::kMaxChildren> &children) const final {
+        return Node_ptr(new BinaryNode<To, Ti, op>(children[0], children[1]));
+    }
+
+    /// Operations over two buffers or scalars read their operands in place
+    /// and write the result straight to the output
+    FusedFunc getFusedFunc() const final {
+        dim_t step;
+        bool leaves = m_lhs->getLeafData(step) && m_rhs->getLeafData(step);
+        return (std::is_same<To, compute_t<To>>::value && leaves) ? fusedLeaves
+                                                                  : nullptr;
+    }
+
+   private:
+    static void fusedLeaves(void *out, const Node *node, dim_t begin,
+                            dim_t end) {
+        using Tc  = compute_t<To>;
+        using Tic = compute_t<Ti>;
+
+        dim_t lstep, rstep;
+        const auto *lhs =
+            static_cast<const Tic *>(node->getChild(0)->getLeafData(lstep));
+        const auto *rhs =
+            static_cast<const Tic *>(node->getChild(1)->getLeafData(rstep));
+        auto *dst = static_cast<Tc *>(out);
+
+        BinOp<Tc, Tic, op> bop;
+        for (dim_t i = begin; i < end; i += VECTOR_LENGTH) {
+            int lim = static_cast<int>(std::min(dim_t(VECTOR_LENGTH), end - i));
+            bop.eval(*reinterpret_cast<array<Tc> *>(dst + i),
+                     *reinterpret_cast<const array<Tic> *>(lhs + lstep * i),
+                     *reinterpret_cast<const array<Tic> *>(rhs + rstep * i),
+                     lim);
+        }
+    }
 };
 
 }  // namespace jit
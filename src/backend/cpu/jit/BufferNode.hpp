@@ -10,6 +10,7 @@
 #pragma once
 #include <optypes.hpp>
 #include <mutex>
+#include <type_traits>
 #include <vector>
 #include "Node.hpp"
 namespace cpu {
@@ -82,6 +83,8 @@ class BufferNode : public TNode<T> {
 
     size_t getBytes() const final { return m_bytes; }
 
+    const void *getData() const final { return m_sptr.get(); }
+
     bool isLinear(const dim_t *dims) const final {
         return m_linear_buffer && dims[0] == m_dims[0] &&
                dims[1] == m_dims[1] && dims[2] == m_dims[2] &&
@@ -89,6 +92,20 @@ class BufferNode : public TNode<T> {
     }
 
     bool isBuffer() const final { return true; }
+
+    const void *getLeafData(dim_t &step) const final {
+        step = 1;
+        return std::is_same<T, compute_t<T>>::value ? m_ptr : nullptr;
+    }
+
+    Node_ptr clone(
+        const std::array<Node_ptr, Node::kMaxChildren> &children) const final {
+        UNUSED(children);
+        auto *node = new BufferNode<T>();
+        node->setData(m_sptr, m_bytes, m_ptr - m_sptr.get(), m_dims,
+                      m_strides, m_linear_buffer);
+        return Node_ptr(node);
+    }
 };
 
 }  // namespace jit
@@ -12,6 +12,7 @@
 #include <common/half.hpp>
 #include <optypes.hpp>
 
+#include <algorithm>
 #include <array>
 #include <memory>
 #include <unordered_map>
@@ -28,6 +29,9 @@ namespace jit {
 class Node;
 constexpr int VECTOR_LENGTH = 256;
 
+// Minimum number of VECTOR_LENGTH chunks evaluated by a thread
+constexpr dim_t MIN_CHUNKS_PER_THREAD = 64;
+
 using Node_ptr      = std::shared_ptr<Node>;
 using Node_map_t    = std::unordered_map<Node *, int>;
 using Node_map_iter = Node_map_t::iterator;
@@ -35,6 +39,11 @@ using Node_map_iter = Node_map_t::iterator;
 template<typename T>
 using array = std::array<T, VECTOR_LENGTH>;
 
+/// Evaluates the elements [\p begin, \p end) of a linear tree rooted at
+/// \p node directly into \p out
+using FusedFunc = void (*)(void *out, const Node *node, dim_t begin,
+                           dim_t end);
+
 class Node {
    public:
     static const int kMaxChildren = 2;
@@ -66,6 +75,8 @@ class Node {
 
     int getHeight() { return m_height; }
 
+    Node *getChild(int i) const { return m_children[i].get(); }
+
     virtual void calc(int x, int y, int z, int w, int lim) {
         UNUSED(x);
         UNUSED(y);
@@ -91,9 +102,35 @@ class Node {
         return true;
     }
     virtual bool isBuffer() const { return false; }
+
+    /// Returns true if calc does not change the values of this node
+    virtual bool isConstant() const { return false; }
+
+    /// Returns the values of a leaf which can be read in place when the tree
+    /// is linear. \p step is set to the distance between consecutive
+    /// elements, 0 for a broadcast scalar. Returns nullptr if the values
+    /// are only available through calc.
+    virtual const void *getLeafData(dim_t &step) const {
+        UNUSED(step);
+        return nullptr;
+    }
+
+    /// Returns a loop which evaluates the tree rooted at this node in a
+    /// single pass over its leaves, or nullptr if the tree has no such loop
+    virtual FusedFunc getFusedFunc() const { return nullptr; }
+
+    /// Creates a node which computes the same values as this node but owns
+    /// its own scratch buffer. \p children are the copies of the children of
+    /// this node. This allows multiple threads to evaluate a tree at once.
+    virtual Node_ptr clone(
+        const std::array<Node_ptr, kMaxChildren> &children) const = 0;
+
     virtual ~Node() {}
 
     virtual size_t getBytes() const { return 0; }
+
+    /// Returns the memory read by this node. getBytes() is its size.
+    virtual const void *getData() const { return nullptr; }
 };
 
 template<typename T>
@@ -113,5 +150,24 @@ class TNode : public Node {
 template<typename T>
 using TNode_ptr = std::shared_ptr<TNode<T>>;
 
+/// Copies the first \p lim values of \p node to \p ptr + \p offset
+using WriteFunc = void (*)(void *ptr, dim_t offset, const Node *node, int lim);
+
+template<typename T>
+void writeOutput(void *ptr, dim_t offset, const Node *node, int lim) {
+    const auto *tnode = reinterpret_cast<const TNode<T> *>(node);
+    std::copy(tnode->m_val.begin(), tnode->m_val.begin() + lim,
+              static_cast<T *>(ptr) + offset);
+}
+
+/// An output of a tree evaluated by kernel::evalOutputs. Type erased so that
+/// trees with different output types can be evaluated together.
+struct Output {
+    Node_ptr node;
+    void *ptr;
+    size_t bytes;
+    WriteFunc write;
+};
+
 }  // namespace jit
 }  // namespace cpu
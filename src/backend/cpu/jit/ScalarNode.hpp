@@ -9,6 +9,7 @@
 
 #pragma once
 #include <optypes.hpp>
+#include <type_traits>
 #include <vector>
 #include "Node.hpp"
 
@@ -19,7 +20,24 @@ namespace jit {
 template<typename T>
 class ScalarNode : public TNode<T> {
    public:
-    ScalarNode(T val) : TNode<T>(val, 0, {}) {}
+    ScalarNode(T val) : TNode<T>(val, 0, {}), m_scalar(val) {}
+
+    bool isConstant() const final { return true; }
+
+    const void *getLeafData(dim_t &step) const final {
+        step = 0;
+        return std::is_same<T, compute_t<T>>::value ? this->m_val.data()
+                                                    : nullptr;
+    }
+
+    Node_ptr clone(
+        const std::array<Node_ptr, Node::kMaxChildren> &children) const final {
+        UNUSED(children);
+        return Node_ptr(new ScalarNode<T>(m_scalar));
+    }
+
+   private:
+    T m_scalar;
 };
 }  // namespace jit
 
@@ -13,6 +13,8 @@
 #include <types.hpp>
 #include "Node.hpp"
 
+#include <algorithm>
+#include <type_traits>
 #include <vector>
 
 namespace cpu {
@@ -49,6 +51,39 @@ class UnaryNode : public TNode<To> {
         UNUSED(idx);
         m_op.eval(TNode<To>::m_val, m_child->m_val, lim);
     }
+
+    Node_ptr clone(
+        const std::array<Node_ptr, Node::kMaxChildren> &children) const final {
+        return Node_ptr(new UnaryNode<To, Ti, op>(children[0]));
+    }
+
+    /// Operations over a buffer read it in place and write the result
+    /// straight to the output
+    FusedFunc getFusedFunc() const final {
+        dim_t step;
+        bool leaf = m_child->getLeafData(step) != nullptr;
+        return (std::is_same<To, compute_t<To>>::value && leaf) ? fusedLeaf
+                                                                : nullptr;
+    }
+
+   private:
+    static void fusedLeaf(void *out, const Node *node, dim_t begin,
+                          dim_t end) {
+        using Tc  = compute_t<To>;
+        using Tic = compute_t<Ti>;
+
+        dim_t step;
+        const auto *in =
+            static_cast<const Tic *>(node->getChild(0)->getLeafData(step));
+        auto *dst = static_cast<Tc *>(out);
+
+        UnOp<To, Ti, op> uop;
+        for (dim_t i = begin; i < end; i += VECTOR_LENGTH) {
+            int lim = static_cast<int>(std::min(dim_t(VECTOR_LENGTH), end - i));
+            uop.eval(*reinterpret_cast<array<Tc> *>(dst + i),
+                     *reinterpret_cast<const array<Tic> *>(in + step * i), lim);
+        }
+    }
 };
 
 }  // namespace jit
@@ -0,0 +1,48 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+// Declarations of the element-wise loops compiled for each instruction set.
+// This header is included by the vector_ops_*.cpp files which are compiled
+// with different instruction set flags. It must not define or include any
+// inline function, because the linker could then pick a copy which uses
+// instructions the machine does not support.
+
+#pragma once
+#include <optypes.hpp>
+
+namespace cpu {
+namespace jit {
+
+/// Instruction sets the element-wise loops of the JIT are compiled for. The
+/// loops are compiled once per instruction set in the vector_ops_*.cpp files
+/// and the one used is selected at runtime by getVectorIsa().
+enum class VectorIsa { Generic, AVX2, AVX512 };
+
+template<typename To, typename Ti>
+using BinaryFunc = void (*)(To *out, const Ti *lhs, const Ti *rhs, int lim);
+
+template<typename To, typename Ti>
+using UnaryFunc = void (*)(To *out, const Ti *in, int lim);
+
+#define AF_DECLARE_VECTOR_OPS(ISA)                               \
+    namespace ISA {                                              \
+    template<typename To, typename Ti, af_op_t op>               \
+    void binary(To *out, const Ti *lhs, const Ti *rhs, int lim); \
+    template<typename To, typename Ti>                           \
+    void cast(To *out, const Ti *in, int lim);                   \
+    }
+
+AF_DECLARE_VECTOR_OPS(generic)
+AF_DECLARE_VECTOR_OPS(avx2)
+AF_DECLARE_VECTOR_OPS(avx512)
+
+#undef AF_DECLARE_VECTOR_OPS
+
+}  // namespace jit
+}  // namespace cpu
@@ -0,0 +1,128 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+#include <optypes.hpp>
+#include <platform.hpp>
+#include <types.hpp>
+#include "Node.hpp"
+#include "vector_isa.hpp"
+
+#include <type_traits>
+
+namespace cpu {
+namespace jit {
+
+template<typename T>
+struct is_vector_type : std::false_type {};
+
+#define VECTOR_TYPE(T) \
+    template<>         \
+    struct is_vector_type<T> : std::true_type {};
+
+VECTOR_TYPE(float)
+VECTOR_TYPE(double)
+VECTOR_TYPE(int)
+VECTOR_TYPE(uint)
+VECTOR_TYPE(intl)
+VECTOR_TYPE(uintl)
+VECTOR_TYPE(short)
+VECTOR_TYPE(ushort)
+VECTOR_TYPE(uchar)
+VECTOR_TYPE(char)
+
+#undef VECTOR_TYPE
+
+template<af_op_t op>
+struct is_arith_op
+    : std::integral_constant<bool, op == af_add_t || op == af_sub_t ||
+                                       op == af_mul_t || op == af_div_t ||
+                                       op == af_min_t || op == af_max_t> {};
+
+template<af_op_t op>
+struct is_compare_op
+    : std::integral_constant<bool, op == af_eq_t || op == af_neq_t ||
+                                       op == af_lt_t || op == af_gt_t ||
+                                       op == af_le_t || op == af_ge_t> {};
+
+/// True if the binary operation has vectorized loops
+template<typename To, typename Ti, af_op_t op>
+struct is_vector_binary
+    : std::integral_constant<
+          bool, is_vector_type<Ti>::value &&
+                    ((is_arith_op<op>::value && std::is_same<To, Ti>::value) ||
+                     (is_compare_op<op>::value &&
+                      std::is_same<To, char>::value))> {};
+
+/// True if the cast has vectorized loops. Casts to b8 compare against zero
+/// and are handled by UnOp.
+template<typename To, typename Ti>
+struct is_vector_cast
+    : std::integral_constant<bool, is_vector_type<To>::value &&
+                                       is_vector_type<Ti>::value &&
+                                       !std::is_same<To, char>::value> {};
+
+template<typename To, typename Ti, af_op_t op>
+BinaryFunc<To, Ti> getBinaryFunc() {
+#if defined(AF_WITH_X86_VECTOR_OPS)
+    switch (getVectorIsa()) {
+        case VectorIsa::AVX512: return avx512::binary<To, Ti, op>;
+        case VectorIsa::AVX2: return avx2::binary<To, Ti, op>;
+        default: break;
+    }
+#endif
+    return generic::binary<To, Ti, op>;
+}
+
+template<typename To, typename Ti>
+UnaryFunc<To, Ti> getCastFunc() {
+#if defined(AF_WITH_X86_VECTOR_OPS)
+    switch (getVectorIsa()) {
+        case VectorIsa::AVX512: return avx512::cast<To, Ti>;
+        case VectorIsa::AVX2: return avx2::cast<To, Ti>;
+        default: break;
+    }
+#endif
+    return generic::cast<To, Ti>;
+}
+
+/// Evaluates the binary operation using the loop compiled for the
+/// instruction set of this machine. Returns false if the operation does not
+/// have vectorized loops.
+template<typename To, typename Ti, af_op_t op>
+typename std::enable_if<is_vector_binary<To, Ti, op>::value, bool>::type
+evalVector(array<To> &out, const array<Ti> &lhs, const array<Ti> &rhs,
+           int lim) {
+    static const BinaryFunc<To, Ti> func = getBinaryFunc<To, Ti, op>();
+    func(out.data(), lhs.data(), rhs.data(), lim);
+    return true;
+}
+
+template<typename To, typename Ti, af_op_t op>
+typename std::enable_if<!is_vector_binary<To, Ti, op>::value, bool>::type
+evalVector(array<To> &, const array<Ti> &, const array<Ti> &, int) {
+    return false;
+}
+
+template<typename To, typename Ti>
+typename std::enable_if<is_vector_cast<To, Ti>::value, bool>::type evalCast(
+    array<To> &out, const array<Ti> &in, int lim) {
+    static const UnaryFunc<To, Ti> func = getCastFunc<To, Ti>();
+    func(out.data(), in.data(), lim);
+    return true;
+}
+
+template<typename To, typename Ti>
+typename std::enable_if<!is_vector_cast<To, Ti>::value, bool>::type evalCast(
+    array<To> &, const array<Ti> &, int) {
+    return false;
+}
+
+}  // namespace jit
+}  // namespace cpu
@@ -0,0 +1,122 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+// This file is included by the vector_ops_*.cpp files after defining
+// AF_VECTOR_ISA to the namespace of the instruction set they are compiled
+// for. Everything called by the loops is defined in an unnamed namespace so
+// the linker cannot merge code compiled for different instruction sets. For
+// the same reason only headers without inline functions are included here,
+// and the types are spelled out instead of using the aliases of types.hpp.
+
+#include <jit/vector_isa.hpp>
+
+#include <type_traits>
+
+#ifndef AF_VECTOR_ISA
+#error "AF_VECTOR_ISA must be defined before including vector_ops_impl.hpp"
+#endif
+
+namespace cpu {
+namespace jit {
+namespace AF_VECTOR_ISA {
+namespace {
+
+template<af_op_t op>
+struct Apply;
+
+#define APPLY_OP(OP, EXPR)                                 \
+    template<>                                             \
+    struct Apply<OP> {                                     \
+        template<typename T>                               \
+        static auto eval(T l, T r) ->                      \
+            typename std::decay<decltype(EXPR)>::type {    \
+            return EXPR;                                   \
+        }                                                  \
+    };
+
+APPLY_OP(af_add_t, l + r)
+APPLY_OP(af_sub_t, l - r)
+APPLY_OP(af_mul_t, l * r)
+APPLY_OP(af_div_t, l / r)
+// Same as std::min and std::max which are used by the scalar versions
+APPLY_OP(af_min_t, (r < l) ? r : l)
+APPLY_OP(af_max_t, (l < r) ? r : l)
+APPLY_OP(af_eq_t, l == r)
+APPLY_OP(af_neq_t, l != r)
+APPLY_OP(af_lt_t, l < r)
+APPLY_OP(af_gt_t, l > r)
+APPLY_OP(af_le_t, l <= r)
+APPLY_OP(af_ge_t, l >= r)
+
+#undef APPLY_OP
+
+}  // namespace
+
+template<typename To, typename Ti, af_op_t op>
+void binary(To *out, const Ti *lhs, const Ti *rhs, int lim) {
+    To *__restrict o       = out;
+    const Ti *__restrict l = lhs;
+    const Ti *__restrict r = rhs;
+    for (int i = 0; i < lim; i++) { o[i] = Apply<op>::eval(l[i], r[i]); }
+}
+
+template<typename To, typename Ti>
+void cast(To *out, const Ti *in, int lim) {
+    To *__restrict o       = out;
+    const Ti *__restrict v = in;
+    for (int i = 0; i < lim; i++) { o[i] = To(v[i]); }
+}
+
+#define INSTANTIATE_BINARY(To, Ti, OP) \
+    template void binary<To, Ti, OP>(To *, const Ti *, const Ti *, int);
+
+#define INSTANTIATE_CAST(To, Ti) \
+    template void cast<To, Ti>(To *, const Ti *, int);
+
+#define INSTANTIATE_TYPE(T)                     \
+    INSTANTIATE_BINARY(T, T, af_add_t)          \
+    INSTANTIATE_BINARY(T, T, af_sub_t)          \
+    INSTANTIATE_BINARY(T, T, af_mul_t)          \
+    INSTANTIATE_BINARY(T, T, af_div_t)          \
+    INSTANTIATE_BINARY(T, T, af_min_t)          \
+    INSTANTIATE_BINARY(T, T, af_max_t)          \
+    INSTANTIATE_BINARY(char, T, af_eq_t)        \
+    INSTANTIATE_BINARY(char, T, af_neq_t)       \
+    INSTANTIATE_BINARY(char, T, af_lt_t)        \
+    INSTANTIATE_BINARY(char, T, af_gt_t)        \
+    INSTANTIATE_BINARY(char, T, af_le_t)        \
+    INSTANTIATE_BINARY(char, T, af_ge_t)        \
+    INSTANTIATE_CAST(float, T)                  \
+    INSTANTIATE_CAST(double, T)                 \
+    INSTANTIATE_CAST(int, T)                    \
+    INSTANTIATE_CAST(unsigned, T)               \
+    INSTANTIATE_CAST(long long, T)              \
+    INSTANTIATE_CAST(unsigned long long, T)     \
+    INSTANTIATE_CAST(short, T)                  \
+    INSTANTIATE_CAST(unsigned short, T)         \
+    INSTANTIATE_CAST(unsigned char, T)
+
+INSTANTIATE_TYPE(float)
+INSTANTIATE_TYPE(double)
+INSTANTIATE_TYPE(int)
+INSTANTIATE_TYPE(unsigned)
+INSTANTIATE_TYPE(long long)
+INSTANTIATE_TYPE(unsigned long long)
+INSTANTIATE_TYPE(short)
+INSTANTIATE_TYPE(unsigned short)
+INSTANTIATE_TYPE(unsigned char)
+INSTANTIATE_TYPE(char)
+
+#undef INSTANTIATE_TYPE
+#undef INSTANTIATE_CAST
+#undef INSTANTIATE_BINARY
+
+}  // namespace AF_VECTOR_ISA
+}  // namespace jit
+}  // namespace cpu
@@ -11,77 +11,175 @@
 #include <Param.hpp>
 #include <jit/Node.hpp>
 #include <platform.hpp>
+#include <thread_pool.hpp>
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <utility>
 #include <vector>
 
 namespace cpu {
 namespace kernel {
 
-template<typename T>
-void evalMultiple(std::vector<Param<T>> arrays,
-                  std::vector<jit::Node_ptr> output_nodes_) {
-    af::dim4 odims = arrays[0].dims();
-    af::dim4 ostrs = arrays[0].strides();
+/// Returns the nodes which need to be calculated for every chunk. Nodes
+/// with constant values are skipped to avoid the virtual call.
+inline std::vector<jit::Node *> calcNodes(
+    const std::vector<jit::Node *> &full_nodes) {
+    std::vector<jit::Node *> calc_nodes;
+    calc_nodes.reserve(full_nodes.size());
+    std::copy_if(full_nodes.begin(), full_nodes.end(),
+                 std::back_inserter(calc_nodes),
+                 [](const jit::Node *n) { return !n->isConstant(); });
+    return calc_nodes;
+}
+
+/// Copies the nodes of a tree so that it can be evaluated on a different
+/// thread. \p full_nodes must be in the order returned by getNodesMap so that
+/// the children of a node are copied before the node itself.
+inline void cloneNodes(std::vector<jit::Node_ptr> &clones,
+                       std::vector<jit::Node *> &output_nodes,
+                       const jit::Node_map_t &nodes,
+                       const std::vector<jit::Node *> &full_nodes,
+                       const std::vector<jit::Output> &outputs) {
+    clones.reserve(full_nodes.size());
+    for (jit::Node *node : full_nodes) {
+        std::array<jit::Node_ptr, jit::Node::kMaxChildren> children;
+        for (int c = 0; c < jit::Node::kMaxChildren; c++) {
+            jit::Node *child = node->getChild(c);
+            if (child == nullptr) { break; }
+            children[c] = clones[nodes.at(child)];
+        }
+        clones.push_back(node->clone(children));
+    }
+    for (const jit::Output &output : outputs) {
+        output_nodes.push_back(clones[nodes.at(output.node.get())].get());
+    }
+}
 
+/// Evaluates the trees in \p outputs in a single pass. The outputs can be of
+/// different types but must have the dimensions \p odims and the strides
+/// \p ostrs.
+inline void evalOutputs(af::dim4 odims, af::dim4 ostrs,
+                        std::vector<jit::Output> outputs) {
     jit::Node_map_t nodes;
-    std::vector<T *> ptrs;
-    std::vector<jit::TNode<T> *> output_nodes;
     std::vector<jit::Node *> full_nodes;
 
-    int narrays = static_cast<int>(arrays.size());
-    for (int i = 0; i < narrays; i++) {
-        ptrs.push_back(arrays[i].get());
-        output_nodes.push_back(
-            reinterpret_cast<jit::TNode<T> *>(output_nodes_[i].get()));
-        output_nodes_[i]->getNodesMap(nodes, full_nodes);
+    for (const jit::Output &output : outputs) {
+        output.node->getNodesMap(nodes, full_nodes);
     }
 
     bool is_linear = true;
     for (auto node : full_nodes) { is_linear &= node->isLinear(odims.get()); }
 
+    // A single operation over buffers and scalars is evaluated by a loop
+    // which reads the operands in place and writes the output directly. The
+    // tree has no intermediate values, so it is neither cloned nor copied
+    // through the scratch buffers of its nodes.
+    jit::FusedFunc fused = nullptr;
+    if (is_linear && outputs.size() == 1) {
+        fused = outputs[0].node->getFusedFunc();
+    }
+    if (fused) {
+        const jit::Node *root = outputs[0].node.get();
+        void *out             = outputs[0].ptr;
+        dim_t num             = odims.elements();
+        dim_t nchunks = (num + jit::VECTOR_LENGTH - 1) / jit::VECTOR_LENGTH;
+
+        parallel_for(0, nchunks, jit::MIN_CHUNKS_PER_THREAD,
+                     [&](dim_t begin, dim_t end) {
+                         fused(out, root, begin * jit::VECTOR_LENGTH,
+                               std::min(num, end * jit::VECTOR_LENGTH));
+                     });
+        return;
+    }
+
+    // Every block of work evaluates its own copy of the tree because the
+    // nodes store the intermediate values of the chunk being processed. The
+    // original tree is never evaluated since its nodes can be shared with
+    // trees evaluated concurrently by other tasks of the queue.
+    auto evalBlock = [&](dim_t begin, dim_t end, auto &&func) {
+        std::vector<jit::Node_ptr> clones;
+        std::vector<jit::Node *> output_nodes;
+        cloneNodes(clones, output_nodes, nodes, full_nodes, outputs);
+        std::vector<jit::Node *> block_nodes(clones.size());
+        std::transform(clones.begin(), clones.end(), block_nodes.begin(),
+                       [](const jit::Node_ptr &n) { return n.get(); });
+        func(begin, end, calcNodes(block_nodes), output_nodes);
+    };
+
     if (is_linear) {
-        int num = arrays[0].dims().elements();
-        int cnum =
-            jit::VECTOR_LENGTH * std::ceil(double(num) / jit::VECTOR_LENGTH);
-        for (int i = 0; i < cnum; i += jit::VECTOR_LENGTH) {
-            int lim = std::min(jit::VECTOR_LENGTH, num - i);
-            for (int n = 0; n < (int)full_nodes.size(); n++) {
-                full_nodes[n]->calc(i, lim);
-            }
-            for (int n = 0; n < (int)output_nodes.size(); n++) {
-                std::copy(output_nodes[n]->m_val.begin(),
-                          output_nodes[n]->m_val.begin() + lim, ptrs[n] + i);
+        dim_t num     = odims.elements();
+        dim_t nchunks = (num + jit::VECTOR_LENGTH - 1) / jit::VECTOR_LENGTH;
+
+        auto linearChunks = [&](dim_t begin, dim_t end,
+                                const std::vector<jit::Node *> &block_nodes,
+                                const std::vector<jit::Node *> &outs) {
+            for (dim_t c = begin; c < end; c++) {
+                dim_t i = c * jit::VECTOR_LENGTH;
+                int lim = static_cast<int>(
+                    std::min(dim_t(jit::VECTOR_LENGTH), num - i));
+                for (jit::Node *node : block_nodes) {
+                    node->calc(static_cast<int>(i), lim);
+                }
+                for (int n = 0; n < (int)outs.size(); n++) {
+                    outputs[n].write(outputs[n].ptr, i, outs[n], lim);
+                }
             }
-        }
+        };
+
+        parallel_for(0, nchunks, jit::MIN_CHUNKS_PER_THREAD,
+                     [&](dim_t begin, dim_t end) {
+                         evalBlock(begin, end, linearChunks);
+                     });
     } else {
-        for (int w = 0; w < (int)odims[3]; w++) {
-            dim_t offw = w * ostrs[3];
-
-            for (int z = 0; z < (int)odims[2]; z++) {
-                dim_t offz = z * ostrs[2] + offw;
-
-                for (int y = 0; y < (int)odims[1]; y++) {
-                    dim_t offy = y * ostrs[1] + offz;
-
-                    int dim0  = odims[0];
-                    int cdim0 = jit::VECTOR_LENGTH *
-                                std::ceil(double(dim0) / jit::VECTOR_LENGTH);
-                    for (int x = 0; x < (int)cdim0; x += jit::VECTOR_LENGTH) {
-                        int lim  = std::min(jit::VECTOR_LENGTH, dim0 - x);
-                        dim_t id = x + offy;
-
-                        for (int n = 0; n < (int)full_nodes.size(); n++) {
-                            full_nodes[n]->calc(x, y, z, w, lim);
-                        }
-                        for (int n = 0; n < (int)output_nodes.size(); n++) {
-                            std::copy(output_nodes[n]->m_val.begin(),
-                                      output_nodes[n]->m_val.begin() + lim,
-                                      ptrs[n] + id);
-                        }
+        int dim0   = odims[0];
+        dim_t rows = odims[1] * odims[2] * odims[3];
+        // Number of rows that make up MIN_CHUNKS_PER_THREAD chunks
+        dim_t grain =
+            std::max(dim_t(1), jit::MIN_CHUNKS_PER_THREAD * jit::VECTOR_LENGTH /
+                                   std::max(dim0, 1));
+
+        auto stridedRows = [&](dim_t begin, dim_t end,
+                               const std::vector<jit::Node *> &block_nodes,
+                               const std::vector<jit::Node *> &outs) {
+            for (dim_t r = begin; r < end; r++) {
+                int y = static_cast<int>(r % odims[1]);
+                int z = static_cast<int>((r / odims[1]) % odims[2]);
+                int w = static_cast<int>(r / (odims[1] * odims[2]));
+
+                dim_t offy = w * ostrs[3] + z * ostrs[2] + y * ostrs[1];
+
+                for (int x = 0; x < dim0; x += jit::VECTOR_LENGTH) {
+                    int lim  = std::min(jit::VECTOR_LENGTH, dim0 - x);
+                    dim_t id = x + offy;
+
+                    for (jit::Node *node : block_nodes) {
+                        node->calc(x, y, z, w, lim);
+                    }
+                    for (int n = 0; n < (int)outs.size(); n++) {
+                        outputs[n].write(outputs[n].ptr, id, outs[n], lim);
                     }
                 }
             }
-        }
+        };
+
+        parallel_for(0, rows, grain, [&](dim_t begin, dim_t end) {
+            evalBlock(begin, end, stridedRows);
+        });
+    }
+}
+
+template<typename T>
+void evalMultiple(std::vector<Param<T>> arrays,
+                  std::vector<jit::Node_ptr> output_nodes) {
+    std::vector<jit::Output> outputs;
+    for (size_t i = 0; i < arrays.size(); i++) {
+        outputs.push_back({output_nodes[i], arrays[i].get(),
+                           arrays[i].dims().elements() * sizeof(T),
+                           jit::writeOutput<T>});
     }
+    evalOutputs(arrays[0].dims(), arrays[0].strides(), std::move(outputs));
 }
 
 template<typename T>
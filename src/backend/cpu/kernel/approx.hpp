@@ -10,8 +10,11 @@
 #pragma once
 #include <Param.hpp>
 #include <math.hpp>
+#include <thread_pool.hpp>
 #include "interp.hpp"
 
+#include <algorithm>
+
 namespace cpu {
 namespace kernel {
 
@@ -36,40 +39,44 @@ void approx1(Param<InT> yo, CParam<InT> yi, CParam<LocT> xo, const int xdim,
     bool is_yi_off[] = {true, true, true, true};
     is_yi_off[xdim]  = false;
 
-    for (dim_t idw = 0; idw < yo_dims[3]; idw++) {
-        for (dim_t idz = 0; idz < yo_dims[2]; idz++) {
-            dim_t yo_off_zw = idw * yo_strides[3] + idz * yo_strides[2];
-            dim_t yi_off_zw = idw * yi_strides[3] * is_yi_off[3] +
-                              idz * yi_strides[2] * is_yi_off[2];
-            dim_t xo_off_zw = idw * xo_strides[3] * is_xo_off[3] +
-                              idz * xo_strides[2] * is_xo_off[2];
-
-            for (dim_t idy = 0; idy < yo_dims[1]; idy++) {
-                dim_t yo_off = yo_off_zw + idy * yo_strides[1];
-                dim_t yi_off = yi_off_zw + idy * yi_strides[1] * is_yi_off[1];
-                dim_t xo_off = xo_off_zw + idy * xo_strides[1] * is_xo_off[1];
-
-                for (dim_t idx = 0; idx < yo_dims[0]; idx++) {
-                    dim_t yi_idx = idx * is_yi_off[0];
-                    const LocT x =
-                        (xo_ptr[xo_off + idx * is_xo_off[0]] - xi_beg) /
-                        xi_step;
-
-                    // FIXME: Only cubic interpolation is doing clamping
-                    // We need to make it consistent across all methods
-                    // Not changing the behavior because tests will fail
-                    bool clamp = order == 3;
-
-                    if (x < 0 || yi_dims[xdim] < x + 1) {
-                        yo_ptr[yo_off + idx] = scalar<InT>(offGrid);
-                    } else {
-                        interp(yo, yo_off + idx, yi, yi_off + yi_idx, x, method,
-                               1, clamp, xdim);
-                    }
+    // FIXME: Only cubic interpolation is doing clamping
+    // We need to make it consistent across all methods
+    // Not changing the behavior because tests will fail
+    const bool clamp = order == 3;
+
+    const dim_t nrows = yo_dims[1] * yo_dims[2] * yo_dims[3];
+    const dim_t grain =
+        std::max(dim_t(1), INTERP_GRAIN / std::max(yo_dims[0], dim_t(1)));
+
+    parallel_for(0, nrows, grain, [&](dim_t begin, dim_t end) {
+        for (dim_t row = begin; row < end; row++) {
+            const dim_t idy = row % yo_dims[1];
+            const dim_t idz = (row / yo_dims[1]) % yo_dims[2];
+            const dim_t idw = row / (yo_dims[1] * yo_dims[2]);
+
+            dim_t yo_off = idw * yo_strides[3] + idz * yo_strides[2] +
+                           idy * yo_strides[1];
+            dim_t yi_off = idw * yi_strides[3] * is_yi_off[3] +
+                           idz * yi_strides[2] * is_yi_off[2] +
+                           idy * yi_strides[1] * is_yi_off[1];
+            dim_t xo_off = idw * xo_strides[3] * is_xo_off[3] +
+                           idz * xo_strides[2] * is_xo_off[2] +
+                           idy * xo_strides[1] * is_xo_off[1];
+
+            for (dim_t idx = 0; idx < yo_dims[0]; idx++) {
+                dim_t yi_idx = idx * is_yi_off[0];
+                const LocT x =
+                    (xo_ptr[xo_off + idx * is_xo_off[0]] - xi_beg) / xi_step;
+
+                if (x < 0 || yi_dims[xdim] < x + 1) {
+                    yo_ptr[yo_off + idx] = scalar<InT>(offGrid);
+                } else {
+                    interp(yo, yo_off + idx, yi, yi_off + yi_idx, x, method, 1,
+                           clamp, xdim);
                 }
             }
         }
-    }
+    });
 }
 
 template<typename InT, typename LocT, int order>
@@ -96,44 +103,49 @@ void approx2(Param<InT> zo, CParam<InT> zi, CParam<LocT> xo, const int xdim,
     is_zi_off[xdim]  = false;
     is_zi_off[ydim]  = false;
 
-    for (dim_t idw = 0; idw < zo_dims[3]; idw++) {
-        for (dim_t idz = 0; idz < zo_dims[2]; idz++) {
-            dim_t zo_off_zw = idw * zo_strides[3] + idz * zo_strides[2];
-            dim_t zi_off_zw = idw * zi_strides[3] * is_zi_off[3] +
-                              idz * zi_strides[2] * is_zi_off[2];
-            dim_t xo_off_zw = idw * xo_strides[3] * is_xo_off[3] +
-                              idz * xo_strides[2] * is_xo_off[2];
-            dim_t yo_off_zw = idw * yo_strides[3] * is_xo_off[3] +
-                              idz * yo_strides[2] * is_xo_off[2];
-
-            for (dim_t idy = 0; idy < zo_dims[1]; idy++) {
-                dim_t xo_off = xo_off_zw + idy * xo_strides[1] * is_xo_off[1];
-                dim_t yo_off = yo_off_zw + idy * yo_strides[1] * is_xo_off[1];
-                dim_t zi_off = zi_off_zw + idy * zi_strides[1] * is_zi_off[1];
-                dim_t zo_off = zo_off_zw + idy * zo_strides[1];
-
-                for (dim_t idx = 0; idx < zo_dims[0]; idx++) {
-                    const LocT x = (xo_ptr[xo_off + idx] - xi_beg) / xi_step;
-                    const LocT y = (yo_ptr[yo_off + idx] - yi_beg) / yi_step;
-
-                    dim_t zi_idx = idx * zi_strides[0] * is_zi_off[0];
-
-                    // FIXME: Only cubic interpolation is doing clamping
-                    // We need to make it consistent across all methods
-                    // Not changing the behavior because tests will fail
-                    bool clamp = order == 3;
-
-                    if (x < 0 || zi_dims[xdim] < x + 1 || y < 0 ||
-                        zi_dims[ydim] < y + 1) {
-                        zo_ptr[zo_off + idx] = scalar<InT>(offGrid);
-                    } else {
-                        interp(zo, zo_off + idx, zi, zi_off + zi_idx, x, y,
-                               method, 1, clamp, xdim, ydim);
-                    }
+    // FIXME: Only cubic interpolation is doing clamping
+    // We need to make it consistent across all methods
+    // Not changing the behavior because tests will fail
+    const bool clamp = order == 3;
+
+    const dim_t nrows = zo_dims[1] * zo_dims[2] * zo_dims[3];
+    const dim_t grain =
+        std::max(dim_t(1), INTERP_GRAIN / std::max(zo_dims[0], dim_t(1)));
+
+    parallel_for(0, nrows, grain, [&](dim_t begin, dim_t end) {
+        for (dim_t row = begin; row < end; row++) {
+            const dim_t idy = row % zo_dims[1];
+            const dim_t idz = (row / zo_dims[1]) % zo_dims[2];
+            const dim_t idw = row / (zo_dims[1] * zo_dims[2]);
+
+            dim_t xo_off = idw * xo_strides[3] * is_xo_off[3] +
+                           idz * xo_strides[2] * is_xo_off[2] +
+                           idy * xo_strides[1] * is_xo_off[1];
+            dim_t yo_off = idw * yo_strides[3] * is_xo_off[3] +
+                           idz * yo_strides[2] * is_xo_off[2] +
+                           idy * yo_strides[1] * is_xo_off[1];
+            dim_t zi_off = idw * zi_strides[3] * is_zi_off[3] +
+                           idz * zi_strides[2] * is_zi_off[2] +
+                           idy * zi_strides[1] * is_zi_off[1];
+            dim_t zo_off = idw * zo_strides[3] + idz * zo_strides[2] +
+                           idy * zo_strides[1];
+
+            for (dim_t idx = 0; idx < zo_dims[0]; idx++) {
+                const LocT x = (xo_ptr[xo_off + idx] - xi_beg) / xi_step;
+                const LocT y = (yo_ptr[yo_off + idx] - yi_beg) / yi_step;
+
+                dim_t zi_idx = idx * zi_strides[0] * is_zi_off[0];
+
+                if (x < 0 || zi_dims[xdim] < x + 1 || y < 0 ||
+                    zi_dims[ydim] < y + 1) {
+                    zo_ptr[zo_off + idx] = scalar<InT>(offGrid);
+                } else {
+                    interp(zo, zo_off + idx, zi, zi_off + zi_idx, x, y, method,
+                           1, clamp, xdim, ydim);
                 }
             }
         }
-    }
+    });
 }
 }  // namespace kernel
 }  // namespace cpu
@@ -10,15 +10,231 @@
 #pragma once
 #include <Param.hpp>
 #include <math.hpp>
+#include <thread_pool.hpp>
 #include <utility.hpp>
+
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
 
 namespace cpu {
 namespace kernel {
 
+/// Minimum number of filter taps evaluated by a thread
+constexpr dim_t BILATERAL_GRAIN = 65536;
+
+/// Integer inputs of at most this many bytes look up the chromatic weights in
+/// a table with an entry for every difference of two values
+constexpr size_t BILATERAL_LUT_BYTES = 2;
+
+/// Filters one image with the full filter window. The image is copied into a
+/// buffer padded by \p radius replicated pixels, so the window is read
+/// without clamping its indices. \p spatial holds the spatial weights of the
+/// window and \p range, if it is not empty, the chromatic weight of every
+/// absolute difference of two values. Otherwise the chromatic weight of a
+/// difference d is exp(d * d * \p rscale).
+template<typename OutT, typename InT, bool UseLut>
+void bilateralExact(OutT *outData, af::dim4 const &ostrides,
+                    InT const *inData, af::dim4 const &istrides,
+                    af::dim4 const &dims, dim_t const radius,
+                    std::vector<OutT> const &spatial,
+                    std::vector<OutT> const &range, OutT const rscale) {
+    dim_t const pdim0 = dims[0] + 2 * radius;
+    dim_t const pdim1 = dims[1] + 2 * radius;
+    dim_t const wlen  = 2 * radius + 1;
+
+    std::vector<OutT> padded(pdim0 * pdim1);
+    for (dim_t j = 0; j < pdim1; ++j) {
+        dim_t const tj = clamp(j - radius, dim_t(0), dims[1] - 1);
+        for (dim_t i = 0; i < pdim0; ++i) {
+            dim_t const ti = clamp(i - radius, dim_t(0), dims[0] - 1);
+            padded[i + j * pdim0] = (OutT)inData[getIdx(istrides, ti, tj)];
+        }
+    }
+
+    dim_t const grain = std::max(
+        dim_t(1), BILATERAL_GRAIN / std::max(dim_t(1), dims[0] * wlen * wlen));
+    parallel_for(0, dims[1], grain, [&](dim_t begin, dim_t end) {
+        for (dim_t j = begin; j < end; ++j) {
+            for (dim_t i = 0; i < dims[0]; ++i) {
+                OutT const *window = padded.data() + i + j * pdim0;
+                OutT const center  = window[radius + radius * pdim0];
+                OutT const *sw     = spatial.data();
+
+                OutT norm = 0.0;
+                OutT res  = 0.0;
+                for (dim_t wj = 0; wj < wlen; ++wj) {
+                    OutT const *col = window + wj * pdim0;
+                    for (dim_t wi = 0; wi < wlen; ++wi) {
+                        OutT const val  = col[wi];
+                        OutT const diff = center - val;
+                        OutT const gauss_range =
+                            UseLut ? range[static_cast<size_t>(std::abs(diff))]
+                                   : std::exp(diff * diff * rscale);
+                        OutT const weight = *sw++ * gauss_range;
+                        norm += weight;
+                        res += val * weight;
+                    }
+                }
+                outData[getIdx(ostrides, i, j)] = res / norm;
+            }
+        }
+    });
+}
+
+/// Blurs the two channels of \p n grid cells spaced \p stride cells apart
+/// with the taps \p taps[0], \p taps[1] and \p taps[2] at distances 0, 1 and
+/// 2. Cells outside the line are zero.
+template<typename T>
+void bilateralGridBlur(T *line, dim_t const stride, dim_t const n,
+                       T const *taps, std::vector<T> &tmp) {
+    tmp.assign(2 * (n + 4), T(0));
+    for (dim_t c = 0; c < n; ++c) {
+        tmp[2 * (c + 2)]     = line[2 * c * stride];
+        tmp[2 * (c + 2) + 1] = line[2 * c * stride + 1];
+    }
+    for (dim_t c = 0; c < n; ++c) {
+        for (dim_t ch = 0; ch < 2; ++ch) {
+            T const *t = tmp.data() + 2 * (c + 2) + ch;
+            line[2 * c * stride + ch] =
+                taps[0] * t[0] + taps[1] * (t[-2] + t[2]) +
+                taps[2] * (t[-4] + t[4]);
+        }
+    }
+}
+
+/// Approximates the filter of one image with a bilateral grid
+///
+/// Every pixel is accumulated with trilinear weights into a grid of cells
+/// spanning \p space_ pixels along the image dimensions and \p color_ along
+/// the values. The grid holds the weighted values and the weights, is
+/// blurred along its three axes and is interpolated at every pixel.
+///
+/// The two trilinear interpolations blur by a variance of a third of a cell,
+/// so the grid is blurred by the remaining two thirds to get a spatial and
+/// chromatic standard deviation of one cell.
+template<typename OutT, typename InT>
+void bilateralGrid(OutT *outData, af::dim4 const &ostrides, InT const *inData,
+                   af::dim4 const &istrides, af::dim4 const &dims,
+                   OutT const vmin, dim_t const nz, float const space_,
+                   float const color_) {
+    OutT const ss = space_;
+    OutT const sr = color_;
+    dim_t const nx =
+        static_cast<dim_t>(OutT(std::max(dims[0] - 1, dim_t(0))) / ss) + 2;
+    dim_t const ny =
+        static_cast<dim_t>(OutT(std::max(dims[1] - 1, dim_t(0))) / ss) + 2;
+
+    auto cell = [&](dim_t x, dim_t y, dim_t z) {
+        return 2 * (z + nz * (x + nx * y));
+    };
+    std::vector<OutT> grid(2 * nx * ny * nz, OutT(0));
+
+    // Columns whose samples start in every slab of grid cells along y
+    std::vector<dim_t> slabs(ny + 1, dims[1]);
+    for (dim_t j = dims[1] - 1; j >= 0; --j) {
+        slabs[static_cast<dim_t>(OutT(j) / ss)] = j;
+    }
+    for (dim_t y = ny - 1; y > 0; --y) {
+        slabs[y - 1] = std::min(slabs[y - 1], slabs[y]);
+    }
+
+    // The samples of a slab touch the slab and the next one, so even and odd
+    // slabs are accumulated in separate passes
+    for (dim_t parity = 0; parity < 2; ++parity) {
+        parallel_for(0, (ny + 1 - parity) / 2, 1, [&](dim_t begin, dim_t end) {
+            for (dim_t s = begin; s < end; ++s) {
+                dim_t const y = 2 * s + parity;
+                for (dim_t j = slabs[y]; j < slabs[y + 1]; ++j) {
+                    OutT const fy = OutT(j) / ss - OutT(y);
+                    for (dim_t i = 0; i < dims[0]; ++i) {
+                        OutT const v  = (OutT)inData[getIdx(istrides, i, j)];
+                        OutT const px = OutT(i) / ss;
+                        OutT const pz = (v - vmin) / sr;
+                        dim_t const x = static_cast<dim_t>(px);
+                        dim_t const z = static_cast<dim_t>(pz);
+                        OutT const fx = px - OutT(x);
+                        OutT const fz = pz - OutT(z);
+                        for (dim_t c = 0; c < 8; ++c) {
+                            OutT const w = ((c & 1) ? fx : 1 - fx) *
+                                           ((c & 2) ? fy : 1 - fy) *
+                                           ((c & 4) ? fz : 1 - fz);
+                            OutT *g = grid.data() + cell(x + (c & 1),
+                                                         y + ((c >> 1) & 1),
+                                                         z + ((c >> 2) & 1));
+                            g[0] += w * v;
+                            g[1] += w;
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    // Gaussian taps with a variance of two thirds of a cell
+    OutT const taps[3] = {OutT(1), OutT(std::exp(-0.75)), OutT(std::exp(-3.0))};
+    parallel_for(0, ny, 1, [&](dim_t begin, dim_t end) {
+        std::vector<OutT> tmp;
+        for (dim_t y = begin; y < end; ++y) {
+            for (dim_t x = 0; x < nx; ++x) {
+                bilateralGridBlur(grid.data() + cell(x, y, 0), 1, nz, taps,
+                                  tmp);
+            }
+            for (dim_t z = 0; z < nz; ++z) {
+                bilateralGridBlur(grid.data() + cell(0, y, z), nz, nx, taps,
+                                  tmp);
+            }
+        }
+    });
+    parallel_for(0, nx, 1, [&](dim_t begin, dim_t end) {
+        std::vector<OutT> tmp;
+        for (dim_t x = begin; x < end; ++x) {
+            for (dim_t z = 0; z < nz; ++z) {
+                bilateralGridBlur(grid.data() + cell(x, 0, z), nz * nx, ny,
+                                  taps, tmp);
+            }
+        }
+    });
+
+    dim_t const grain =
+        std::max(dim_t(1), BILATERAL_GRAIN / std::max(dim_t(1), 16 * dims[0]));
+    parallel_for(0, dims[1], grain, [&](dim_t begin, dim_t end) {
+        for (dim_t j = begin; j < end; ++j) {
+            OutT const py = OutT(j) / ss;
+            dim_t const y = static_cast<dim_t>(py);
+            OutT const fy = py - OutT(y);
+            for (dim_t i = 0; i < dims[0]; ++i) {
+                OutT const v  = (OutT)inData[getIdx(istrides, i, j)];
+                OutT const px = OutT(i) / ss;
+                OutT const pz = (v - vmin) / sr;
+                dim_t const x = static_cast<dim_t>(px);
+                dim_t const z = static_cast<dim_t>(pz);
+                OutT const fx = px - OutT(x);
+                OutT const fz = pz - OutT(z);
+
+                OutT res  = 0.0;
+                OutT norm = 0.0;
+                for (dim_t c = 0; c < 8; ++c) {
+                    OutT const w = ((c & 1) ? fx : 1 - fx) *
+                                   ((c & 2) ? fy : 1 - fy) *
+                                   ((c & 4) ? fz : 1 - fz);
+                    OutT const *g = grid.data() + cell(x + (c & 1),
+                                                       y + ((c >> 1) & 1),
+                                                       z + ((c >> 2) & 1));
+                    res += w * g[0];
+                    norm += w * g[1];
+                }
+                outData[getIdx(ostrides, i, j)] = res / norm;
+            }
+        }
+    });
+}
+
 template<typename OutT, typename InT, bool IsColor>
 void bilateral(Param<OutT> out, CParam<InT> in, float const s_sigma,
-               float const c_sigma) {
+               float const c_sigma, af_bilateral_mode const mode) {
     af::dim4 const dims     = in.dims();
     af::dim4 const istrides = in.strides();
     af::dim4 const ostrides = out.strides();
@@ -29,6 +245,27 @@ void bilateral(Param<OutT> out, CParam<InT> in, float const s_sigma,
     dim_t const radius = std::max((dim_t)(space_ * 1.5f), (dim_t)1);
     float const svar   = space_ * space_;
     float const cvar   = color_ * color_;
+    dim_t const wlen   = 2 * radius + 1;
+
+    std::vector<OutT> spatial(wlen * wlen);
+    for (dim_t wj = -radius; wj <= radius; ++wj) {
+        for (dim_t wi = -radius; wi <= radius; ++wi) {
+            spatial[(wi + radius) + (wj + radius) * wlen] =
+                std::exp((wi * wi + wj * wj) / (-2.0 * svar));
+        }
+    }
+
+    OutT const rscale = -0.5 / cvar;
+    constexpr bool UseLut =
+        std::is_integral<InT>::value && sizeof(InT) <= BILATERAL_LUT_BYTES;
+    std::vector<OutT> range;
+    if (UseLut) {
+        range.resize(size_t(1) << (8 * sizeof(InT)));
+        for (size_t d = 0; d < range.size(); ++d) {
+            OutT const diff = d;
+            range[d]        = std::exp(diff * diff * rscale);
+        }
+    }
 
     for (dim_t b3 = 0; b3 < dims[3]; ++b3) {
         OutT *outData     = out.get() + b3 * ostrides[3];
@@ -43,37 +280,43 @@ void bilateral(Param<OutT> out, CParam<InT> in, float const s_sigma,
             //  - channels
             //  - input based batch
             //      - when input is 3d array for grayscale images
-            for (dim_t j = 0; j < dims[1]; ++j) {
-                // j steps along 2nd dimension
-                for (dim_t i = 0; i < dims[0]; ++i) {
-                    // i steps along 1st dimension
-                    OutT norm         = 0.0;
-                    OutT res          = 0.0;
-                    OutT const center = (OutT)inData[getIdx(istrides, i, j)];
-                    for (dim_t wj = -radius; wj <= radius; ++wj) {
-                        // clamps offsets
-                        dim_t tj = clamp(j + wj, dim_t(0), dims[1] - 1);
-                        for (dim_t wi = -radius; wi <= radius; ++wi) {
-                            // clamps offsets
-                            dim_t ti = clamp(i + wi, dim_t(0), dims[0] - 1);
-                            // proceed
-                            OutT const val =
-                                (OutT)inData[getIdx(istrides, ti, tj)];
-                            OutT const gauss_space =
-                                (wi * wi + wj * wj) / (-2.0 * svar);
-                            OutT const gauss_range =
-                                ((center - val) * (center - val)) /
-                                (-2.0 * cvar);
-                            OutT const weight =
-                                std::exp(gauss_space + gauss_range);
-                            norm += weight;
-                            res += val * weight;
-                        }
-                    }  // filter loop ends here
+            bool useGrid = mode == AF_BILATERAL_GRID && space_ > 0.f &&
+                           color_ > 0.f;
+            OutT vmin = 0.0, vmax = 0.0;
+            if (useGrid) {
+                vmin = std::numeric_limits<OutT>::max();
+                vmax = std::numeric_limits<OutT>::lowest();
+                for (dim_t j = 0; j < dims[1] && useGrid; ++j) {
+                    for (dim_t i = 0; i < dims[0]; ++i) {
+                        OutT const v = (OutT)inData[getIdx(istrides, i, j)];
+                        useGrid &= std::isfinite(v);
+                        vmin = std::min(vmin, v);
+                        vmax = std::max(vmax, v);
+                    }
+                }
+            }
+
+            // The grid is used when splatting and slicing every pixel and
+            // blurring both channels of every cell costs less than the window
+            double const pixels = double(dims[0]) * double(dims[1]);
+            double const cells  = useGrid
+                                     ? (double(dims[0]) / space_ + 2.0) *
+                                          (double(dims[1]) / space_ + 2.0) *
+                                          (double(vmax - vmin) / color_ + 2.0)
+                                     : 0.0;
+            useGrid &= 16.0 * pixels + 30.0 * cells <
+                       double(wlen * wlen) * pixels;
 
-                    outData[getIdx(ostrides, i, j)] = res / norm;
-                }  // 1st dimension loop ends here
-            }      // 2nd dimension loop ends here
+            if (useGrid) {
+                dim_t const nz =
+                    static_cast<dim_t>((vmax - vmin) / OutT(color_)) + 2;
+                bilateralGrid<OutT, InT>(outData, ostrides, inData, istrides,
+                                         dims, vmin, nz, space_, color_);
+            } else {
+                bilateralExact<OutT, InT, UseLut>(outData, ostrides, inData,
+                                                  istrides, dims, radius,
+                                                  spatial, range, rscale);
+            }
             outData += ostrides[2];
             inData += istrides[2];
         }
@@ -9,122 +9,46 @@
 
 #pragma once
 #include <Param.hpp>
+#include <common/dispatch.hpp>
 #include <math.hpp>
+#include <thread_pool.hpp>
 #include <af/defines.h>
 
+#include <algorithm>
+
 namespace cpu {
 namespace kernel {
 
-template<typename InT, typename AccT, bool Expand>
-void one2one_1d(InT *optr, InT const *const iptr, AccT const *const fptr,
-                af::dim4 const &oDims, af::dim4 const &sDims,
-                af::dim4 const &fDims, af::dim4 const &sStrides) {
-    dim_t start = (Expand ? 0 : fDims[0] / 2);
-    dim_t end   = (Expand ? oDims[0] : start + sDims[0]);
-    for (dim_t i = start; i < end; ++i) {
-        AccT accum = 0.0;
-        for (dim_t f = 0; f < fDims[0]; ++f) {
-            dim_t iIdx = i - f;
-            InT s_val =
-                ((iIdx >= 0 && iIdx < sDims[0]) ? iptr[iIdx * sStrides[0]]
-                                                : InT(0));
-            accum += AccT(s_val * fptr[f]);
-        }
-        optr[i - start] = InT(accum);
-    }
-}
-
-template<typename InT, typename AccT, bool Expand>
-void one2one_2d(InT *optr, InT const *const iptr, AccT const *const fptr,
-                af::dim4 const &oDims, af::dim4 const &sDims,
-                af::dim4 const &fDims, af::dim4 const &oStrides,
-                af::dim4 const &sStrides, af::dim4 const &fStrides) {
-    dim_t jStart = (Expand ? 0 : fDims[1] / 2);
-    dim_t jEnd   = (Expand ? oDims[1] : jStart + sDims[1]);
-    dim_t iStart = (Expand ? 0 : fDims[0] / 2);
-    dim_t iEnd   = (Expand ? oDims[0] : iStart + sDims[0]);
-
-    for (dim_t j = jStart; j < jEnd; ++j) {
-        dim_t joff = (j - jStart) * oStrides[1];
-
-        for (dim_t i = iStart; i < iEnd; ++i) {
-            AccT accum = AccT(0);
-            for (dim_t wj = 0; wj < fDims[1]; ++wj) {
-                dim_t jIdx    = j - wj;
-                dim_t w_joff  = wj * fStrides[1];
-                dim_t s_joff  = jIdx * sStrides[1];
-                bool isJValid = (jIdx >= 0 && jIdx < sDims[1]);
-
-                for (dim_t wi = 0; wi < fDims[0]; ++wi) {
-                    dim_t iIdx = i - wi;
-
-                    InT s_val = InT(0);
-                    if (isJValid && (iIdx >= 0 && iIdx < sDims[0])) {
-                        s_val = iptr[s_joff + iIdx * sStrides[0]];
-                    }
-
-                    accum += AccT(s_val * fptr[w_joff + wi * fStrides[0]]);
-                }
-            }
-            optr[joff + i - iStart] = InT(accum);
+/// Number of outputs along dimension 0 which are accumulated together. The
+/// partial sums of a tile stay in the L1 cache while every filter tap is
+/// applied to them.
+constexpr dim_t CONVOLVE_TILE = 256;
+
+/// Minimum number of multiply-adds computed by a thread
+constexpr dim_t CONVOLVE_GRAIN = 65536;
+
+/// Adds the products of the filter tap \p f and \p len signal values to the
+/// partial sums \p acc. The loop over the contiguous partial sums is
+/// vectorized by the compiler.
+template<typename InT, typename AccT, typename FilterT>
+void convolveTap(AccT *acc, InT const *in, dim_t stride, dim_t len,
+                 FilterT f) {
+    if (stride == 1) {
+        for (dim_t i = 0; i < len; ++i) { acc[i] += AccT(in[i] * f); }
+    } else {
+        for (dim_t i = 0; i < len; ++i) {
+            acc[i] += AccT(in[i * stride] * f);
         }
     }
 }
 
-template<typename InT, typename AccT, bool Expand>
-void one2one_3d(InT *optr, InT const *const iptr, AccT const *const fptr,
-                af::dim4 const &oDims, af::dim4 const &sDims,
-                af::dim4 const &fDims, af::dim4 const &oStrides,
-                af::dim4 const &sStrides, af::dim4 const &fStrides) {
-    dim_t kStart = (Expand ? 0 : fDims[2] / 2);
-    dim_t kEnd   = (Expand ? oDims[2] : kStart + sDims[2]);
-    dim_t jStart = (Expand ? 0 : fDims[1] / 2);
-    dim_t jEnd   = (Expand ? oDims[1] : jStart + sDims[1]);
-    dim_t iStart = (Expand ? 0 : fDims[0] / 2);
-    dim_t iEnd   = (Expand ? oDims[0] : iStart + sDims[0]);
-
-    for (dim_t k = kStart; k < kEnd; ++k) {
-        dim_t koff = (k - kStart) * oStrides[2];
-
-        for (dim_t j = jStart; j < jEnd; ++j) {
-            dim_t joff = (j - jStart) * oStrides[1];
-
-            for (dim_t i = iStart; i < iEnd; ++i) {
-                AccT accum = AccT(0);
-                for (dim_t wk = 0; wk < fDims[2]; ++wk) {
-                    dim_t kIdx    = k - wk;
-                    dim_t w_koff  = wk * fStrides[2];
-                    dim_t s_koff  = kIdx * sStrides[2];
-                    bool isKValid = (kIdx >= 0 && kIdx < sDims[2]);
-
-                    for (dim_t wj = 0; wj < fDims[1]; ++wj) {
-                        dim_t jIdx    = j - wj;
-                        dim_t w_joff  = wj * fStrides[1];
-                        dim_t s_joff  = jIdx * sStrides[1];
-                        bool isJValid = (jIdx >= 0 && jIdx < sDims[1]);
-
-                        for (dim_t wi = 0; wi < fDims[0]; ++wi) {
-                            dim_t iIdx = i - wi;
-
-                            InT s_val = InT(0);
-                            if (isKValid && isJValid &&
-                                (iIdx >= 0 && iIdx < sDims[0])) {
-                                s_val =
-                                    iptr[s_koff + s_joff + iIdx * sStrides[0]];
-                            }
-
-                            accum +=
-                                AccT(s_val *
-                                     fptr[w_koff + w_joff + wi * fStrides[0]]);
-                        }
-                    }
-                }
-                optr[koff + joff + i - iStart] = InT(accum);
-            }  // i loop ends here
-        }      // j loop ends here
-    }          // k loop ends here
-}
-
+/// Convolves the first \p baseDim dimensions of \p signal with \p filter
+///
+/// The outputs are computed in tiles of CONVOLVE_TILE elements along
+/// dimension 0. Each filter tap is applied to the whole tile at once, so the
+/// taps which fall outside of the signal are skipped instead of being tested
+/// for every output. The tiles of all the rows and batches are split between
+/// the threads of the thread pool.
 template<typename InT, typename AccT, dim_t baseDim, bool Expand>
 void convolve_nd(Param<InT> out, CParam<InT> signal, CParam<AccT> filter,
                  AF_BATCH_KIND kind) {
@@ -175,113 +99,158 @@ void convolve_nd(Param<InT> out, CParam<InT> signal, CParam<AccT> filter,
         }
     }
 
-    for (dim_t b3 = 0; b3 < batch[3]; ++b3) {
-        for (dim_t b2 = 0; b2 < batch[2]; ++b2) {
-            for (dim_t b1 = 0; b1 < batch[1]; ++b1) {
-                InT *out = optr + b1 * out_step[1] + b2 * out_step[2] +
-                           b3 * out_step[3];
-                InT const *in =
-                    iptr + b1 * in_step[1] + b2 * in_step[2] + b3 * in_step[3];
-                AccT const *filt = fptr + b1 * filt_step[1] +
-                                   b2 * filt_step[2] + b3 * filt_step[3];
-
-                switch (baseDim) {
-                    case 1:
-                        one2one_1d<InT, AccT, Expand>(out, in, filt, oDims,
-                                                      sDims, fDims, sStrides);
-                        break;
-                    case 2:
-                        one2one_2d<InT, AccT, Expand>(out, in, filt, oDims,
-                                                      sDims, fDims, oStrides,
-                                                      sStrides, fStrides);
-                        break;
-                    case 3:
-                        one2one_3d<InT, AccT, Expand>(out, in, filt, oDims,
-                                                      sDims, fDims, oStrides,
-                                                      sStrides, fStrides);
-                        break;
+    // Sizes of the convolved dimensions. The other ones are batched.
+    dim_t sd[3]    = {1, 1, 1};
+    dim_t fd[3]    = {1, 1, 1};
+    dim_t len[3]   = {1, 1, 1};
+    dim_t start[3] = {0, 0, 0};
+    for (dim_t d = 0; d < baseDim; ++d) {
+        sd[d]    = sDims[d];
+        fd[d]    = fDims[d];
+        len[d]   = oDims[d];
+        start[d] = (Expand ? 0 : fDims[d] / 2);
+    }
+
+    const dim_t ntiles  = divup(len[0], CONVOLVE_TILE);
+    const dim_t nrows   = len[1] * len[2];
+    const dim_t nitems  = batch[1] * batch[2] * batch[3] * nrows * ntiles;
+    const dim_t tileOps =
+        std::min(len[0], CONVOLVE_TILE) * fd[0] * fd[1] * fd[2];
+    const dim_t grain   = std::max(dim_t(1), CONVOLVE_GRAIN / tileOps);
+
+    parallel_for(0, nitems, grain, [&](dim_t begin, dim_t end) {
+        AccT acc[CONVOLVE_TILE];
+        for (dim_t item = begin; item < end; ++item) {
+            const dim_t tile = item % ntiles;
+            const dim_t row  = (item / ntiles) % nrows;
+            const dim_t b    = item / (ntiles * nrows);
+            const dim_t b1   = b % batch[1];
+            const dim_t b2   = (b / batch[1]) % batch[2];
+            const dim_t b3   = b / (batch[1] * batch[2]);
+            const dim_t j    = row % len[1] + start[1];
+            const dim_t k    = row / len[1] + start[2];
+
+            InT const *in = iptr + b1 * in_step[1] + b2 * in_step[2] +
+                            b3 * in_step[3];
+            AccT const *filt = fptr + b1 * filt_step[1] + b2 * filt_step[2] +
+                               b3 * filt_step[3];
+
+            const dim_t iBegin = start[0] + tile * CONVOLVE_TILE;
+            const dim_t iEnd =
+                std::min(start[0] + len[0], iBegin + CONVOLVE_TILE);
+            std::fill(acc, acc + (iEnd - iBegin), scalar<AccT>(0));
+
+            for (dim_t wk = 0; wk < fd[2]; ++wk) {
+                dim_t kIdx = k - wk;
+                if (kIdx < 0 || kIdx >= sd[2]) { continue; }
+
+                for (dim_t wj = 0; wj < fd[1]; ++wj) {
+                    dim_t jIdx = j - wj;
+                    if (jIdx < 0 || jIdx >= sd[1]) { continue; }
+
+                    InT const *srow =
+                        in + kIdx * sStrides[2] + jIdx * sStrides[1];
+                    AccT const *frow =
+                        filt + wk * fStrides[2] + wj * fStrides[1];
+
+                    for (dim_t wi = 0; wi < fd[0]; ++wi) {
+                        // Outputs whose signal index i - wi is in the signal
+                        dim_t first = std::max(iBegin, wi);
+                        dim_t last  = std::min(iEnd, sd[0] + wi);
+                        if (first >= last) { continue; }
+
+                        convolveTap(acc + (first - iBegin),
+                                    srow + (first - wi) * sStrides[0],
+                                    sStrides[0], last - first,
+                                    frow[wi * fStrides[0]]);
+                    }
                 }
             }
+
+            InT *orow = optr + b1 * out_step[1] + b2 * out_step[2] +
+                        b3 * out_step[3] + (k - start[2]) * oStrides[2] +
+                        (j - start[1]) * oStrides[1];
+            for (dim_t i = iBegin; i < iEnd; ++i) {
+                orow[i - start[0]] = InT(acc[i - iBegin]);
+            }
         }
-    }
+    });
 }
 
+/// Convolves dimension \p conv_dim of every 2D slice of \p signal with the
+/// vector \p filter. The filter taps are converted to the signal type.
 template<typename InT, typename AccT, dim_t conv_dim, bool Expand>
-void convolve2_separable(InT *optr, InT const *const iptr,
-                         AccT const *const fptr, af::dim4 const &oDims,
-                         af::dim4 const &sDims, af::dim4 const &orgDims,
-                         dim_t fDim, af::dim4 const &oStrides,
-                         af::dim4 const &sStrides, dim_t fStride) {
-    UNUSED(orgDims);
-    UNUSED(sStrides);
-    UNUSED(fStride);
-    for (dim_t j = 0; j < oDims[1]; ++j) {
-        dim_t jOff = j * oStrides[1];
-        dim_t cj   = j + (conv_dim == 1) * (Expand ? 0 : fDim >> 1);
-
-        for (dim_t i = 0; i < oDims[0]; ++i) {
-            dim_t iOff = i * oStrides[0];
-            dim_t ci   = i + (conv_dim == 0) * (Expand ? 0 : fDim >> 1);
-
-            AccT accum = scalar<AccT>(0);
+void convolve2_separable(Param<InT> out, CParam<InT> signal,
+                         CParam<AccT> filter) {
+    InT *optr              = out.get();
+    InT const *const iptr  = signal.get();
+    AccT const *const fptr = filter.get();
+
+    af::dim4 const oDims    = out.dims();
+    af::dim4 const sDims    = signal.dims();
+    af::dim4 const oStrides = out.strides();
+    af::dim4 const sStrides = signal.strides();
+
+    const dim_t fDim   = filter.dims().elements();
+    const dim_t offset = (Expand ? 0 : fDim >> 1);
+
+    const dim_t ntiles  = divup(oDims[0], CONVOLVE_TILE);
+    const dim_t nrows   = oDims[1] * oDims[2] * oDims[3];
+    const dim_t tileOps = std::min(oDims[0], CONVOLVE_TILE) * fDim;
+    const dim_t grain   = std::max(dim_t(1), CONVOLVE_GRAIN / tileOps);
+
+    parallel_for(0, nrows * ntiles, grain, [&](dim_t begin, dim_t end) {
+        AccT acc[CONVOLVE_TILE];
+        for (dim_t item = begin; item < end; ++item) {
+            const dim_t tile = item % ntiles;
+            const dim_t row  = item / ntiles;
+            const dim_t j    = row % oDims[1];
+            const dim_t b2   = (row / oDims[1]) % oDims[2];
+            const dim_t b3   = row / (oDims[1] * oDims[2]);
+
+            InT const *in = iptr + b2 * sStrides[2] + b3 * sStrides[3];
+
+            const dim_t iBegin = tile * CONVOLVE_TILE;
+            const dim_t iEnd   = std::min(oDims[0], iBegin + CONVOLVE_TILE);
+            std::fill(acc, acc + (iEnd - iBegin), scalar<AccT>(0));
 
             for (dim_t f = 0; f < fDim; ++f) {
                 InT f_val = fptr[f];
-                InT s_val;
 
                 if (conv_dim == 0) {
-                    dim_t offi     = ci - f;
-                    bool isCIValid = offi >= 0 && offi < sDims[0];
-                    bool isCJValid = cj >= 0 && cj < sDims[1];
-                    s_val = (isCJValid && isCIValid ? iptr[cj * sDims[0] + offi]
-                                                    : scalar<InT>(0));
+                    // Outputs whose signal index i + offset - f is valid
+                    dim_t first = std::max(iBegin, f - offset);
+                    dim_t last  = std::min(iEnd, sDims[0] + f - offset);
+                    if (first >= last) { continue; }
+
+                    convolveTap(acc + (first - iBegin),
+                                in + j * sStrides[1] +
+                                    (first + offset - f) * sStrides[0],
+                                sStrides[0], last - first, f_val);
                 } else {
-                    dim_t offj     = cj - f;
-                    bool isCIValid = ci >= 0 && ci < sDims[0];
-                    bool isCJValid = offj >= 0 && offj < sDims[1];
-                    s_val = (isCJValid && isCIValid ? iptr[offj * sDims[0] + ci]
-                                                    : scalar<InT>(0));
+                    dim_t offj = j + offset - f;
+                    if (offj < 0 || offj >= sDims[1]) { continue; }
+
+                    convolveTap(acc,
+                                in + offj * sStrides[1] + iBegin * sStrides[0],
+                                sStrides[0], iEnd - iBegin, f_val);
                 }
+            }
 
-                accum += AccT(s_val * f_val);
+            InT *orow = optr + b2 * oStrides[2] + b3 * oStrides[3] +
+                        j * oStrides[1];
+            for (dim_t i = iBegin; i < iEnd; ++i) {
+                orow[i * oStrides[0]] = InT(acc[i - iBegin]);
             }
-            optr[iOff + jOff] = InT(accum);
         }
-    }
+    });
 }
 
 template<typename InT, typename AccT, bool Expand>
 void convolve2(Param<InT> out, CParam<InT> signal, CParam<AccT> c_filter,
                CParam<AccT> r_filter, Param<InT> temp) {
-    dim_t cflen = (dim_t)c_filter.dims().elements();
-    dim_t rflen = (dim_t)r_filter.dims().elements();
-
-    auto oDims = out.dims();
-    auto sDims = signal.dims();
-
-    auto oStrides = out.strides();
-    auto sStrides = signal.strides();
-    auto tStrides = temp.strides();
-
-    for (dim_t b3 = 0; b3 < oDims[3]; ++b3) {
-        dim_t i_b3Off = b3 * sStrides[3];
-        dim_t t_b3Off = b3 * tStrides[3];
-        dim_t o_b3Off = b3 * oStrides[3];
-
-        for (dim_t b2 = 0; b2 < oDims[2]; ++b2) {
-            InT const *const iptr = signal.get() + b2 * sStrides[2] + i_b3Off;
-            InT *tptr             = temp.get() + b2 * tStrides[2] + t_b3Off;
-            InT *optr             = out.get() + b2 * oStrides[2] + o_b3Off;
-
-            convolve2_separable<InT, AccT, 0, Expand>(
-                tptr, iptr, c_filter.get(), temp.dims(), sDims, sDims, cflen,
-                tStrides, sStrides, c_filter.strides(0));
-
-            convolve2_separable<InT, AccT, 1, Expand>(
-                optr, tptr, r_filter.get(), oDims, temp.dims(), sDims, rflen,
-                oStrides, tStrides, r_filter.strides(0));
-        }
-    }
+    convolve2_separable<InT, AccT, 0, Expand>(temp, signal, c_filter);
+    convolve2_separable<InT, AccT, 1, Expand>(out, temp, r_filter);
 }
 
 }  // namespace kernel
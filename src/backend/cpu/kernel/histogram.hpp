@@ -9,36 +9,172 @@
 
 #pragma once
 #include <Param.hpp>
+#include <common/dispatch.hpp>
+#include <thread_pool.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
 
 namespace cpu {
 namespace kernel {
 
+/// Minimum number of elements binned by a thread
+constexpr dim_t HISTOGRAM_GRAIN = 65536;
+
+/// Maps values to bins with the single precision step of the other backends
+struct HistogramBinner {
+    double minval;
+    double step;
+    int nbins;
+
+    HistogramBinner(unsigned nbins, double minval, double maxval)
+        : minval(minval)
+        , step(static_cast<float>((maxval - minval) / (float)nbins))
+        , nbins(static_cast<int>(nbins)) {}
+
+    int operator()(double val) const {
+        double const pos = (val - minval) / step;
+        return pos >= 0 ? (pos < nbins ? static_cast<int>(pos) : nbins - 1)
+                        : 0;
+    }
+};
+
+/// Adds \p ncols columns of \p len contiguous values spaced \p stride
+/// apart to the bins \p hist
+template<typename OutT, typename InT>
+void histogramColumns(OutT* hist, InT const* in, dim_t len, dim_t stride,
+                      dim_t ncols, HistogramBinner const& binner,
+                      std::false_type) {
+    for (dim_t j = 0; j < ncols; ++j) {
+        InT const* col = in + j * stride;
+        for (dim_t k = 0; k < len; ++k) { hist[binner(col[k])]++; }
+    }
+}
+
+/// Adds \p ncols columns of \p len contiguous 8 or 16-bit values spaced
+/// \p stride apart to the bins \p hist
+///
+/// Counts every value of the type and then adds the counts to the bins of the
+/// values. The 8-bit counts are kept in four interleaved tables, which keeps
+/// repeated values from waiting on each other. Inputs with fewer elements
+/// than values of the type are binned directly.
+template<typename OutT, typename InT>
+void histogramColumns(OutT* hist, InT const* in, dim_t len, dim_t stride,
+                      dim_t ncols, HistogramBinner const& binner,
+                      std::true_type) {
+    constexpr int nvals  = 1 << (8 * sizeof(InT));
+    constexpr int ntabs  = sizeof(InT) == 1 ? 4 : 1;
+    constexpr int lowest =
+        static_cast<int>(std::numeric_limits<InT>::lowest());
+    if (len * ncols < nvals) {
+        histogramColumns(hist, in, len, stride, ncols, binner,
+                         std::false_type());
+        return;
+    }
+
+    std::vector<dim_t> counts(ntabs * nvals, 0);
+    dim_t* const tab = counts.data() - lowest * ntabs;
+
+    for (dim_t j = 0; j < ncols; ++j) {
+        InT const* col = in + j * stride;
+        dim_t k        = 0;
+        for (; k + ntabs <= len; k += ntabs) {
+            for (int t = 0; t < ntabs; ++t) {
+                tab[static_cast<int>(col[k + t]) * ntabs + t]++;
+            }
+        }
+        for (; k < len; ++k) { tab[static_cast<int>(col[k]) * ntabs]++; }
+    }
+
+    for (int v = 0; v < nvals; ++v) {
+        dim_t count = 0;
+        for (int t = 0; t < ntabs; ++t) { count += counts[v * ntabs + t]; }
+        if (count == 0) { continue; }
+        hist[binner(v + lowest)] += OutT(count);
+    }
+}
+
+/// Histogram of the values of every image of \p in
+///
+/// Small batches of large images split the columns of each image between the
+/// threads, which fill private copies of the bins that are added together at
+/// the end. Other inputs give every thread whole images.
 template<typename OutT, typename InT, bool IsLinear>
 void histogram(Param<OutT> out, CParam<InT> in, unsigned const nbins,
                double const minval, double const maxval) {
+    using IsSmallInt =
+        std::integral_constant<bool, std::is_integral<InT>::value &&
+                                         sizeof(InT) <= 2>;
+
     dim4 const outDims  = out.dims();
-    float const step    = (maxval - minval) / (float)nbins;
     dim4 const inDims   = in.dims();
     dim4 const iStrides = in.strides();
     dim4 const oStrides = out.strides();
     dim_t const nElems  = inDims[0] * inDims[1];
+    dim_t const nimages = outDims[2] * outDims[3];
+
+    HistogramBinner const binner(nbins, minval, maxval);
 
-    for (dim_t b3 = 0; b3 < outDims[3]; b3++) {
-        OutT* outData     = out.get() + b3 * oStrides[3];
-        const InT* inData = in.get() + b3 * iStrides[3];
-        for (dim_t b2 = 0; b2 < outDims[2]; b2++) {
-            for (dim_t i = 0; i < nElems; i++) {
-                int idx =
-                    IsLinear
-                        ? i
-                        : ((i % inDims[0]) + (i / inDims[0]) * iStrides[1]);
-                int bin = (int)((inData[idx] - minval) / step);
-                bin     = std::max(bin, 0);
-                bin     = std::min(bin, (int)(nbins - 1));
-                outData[bin]++;
+    // Linear images are binned as a single column
+    dim_t const colLen = IsLinear ? nElems : inDims[0];
+    dim_t const ncols  = IsLinear ? 1 : inDims[1];
+
+    auto imageIn = [&](dim_t image) {
+        return in.get() + (image % outDims[2]) * iStrides[2] +
+               (image / outDims[2]) * iStrides[3];
+    };
+    auto imageOut = [&](dim_t image) {
+        return out.get() + (image % outDims[2]) * oStrides[2] +
+               (image / outDims[2]) * oStrides[3];
+    };
+    auto addColumns = [&](OutT* hist, InT const* inData, dim_t begin,
+                          dim_t end) {
+        histogramColumns(hist, inData + begin * iStrides[1], colLen,
+                         iStrides[1], end - begin, binner, IsSmallInt());
+    };
+
+    ThreadPool& pool     = getThreadPool();
+    dim_t const nthreads = pool.size();
+    if (nimages >= nthreads || nElems < 2 * HISTOGRAM_GRAIN) {
+        dim_t const grain =
+            std::max(dim_t(1), HISTOGRAM_GRAIN / std::max(nElems, dim_t(1)));
+        parallel_for(0, nimages, grain, [&](dim_t begin, dim_t end) {
+            for (dim_t image = begin; image < end; ++image) {
+                addColumns(imageOut(image), imageIn(image), 0, ncols);
+            }
+        });
+        return;
+    }
+
+    dim_t nparts = std::min(nthreads, divup(nElems, HISTOGRAM_GRAIN));
+    if (!IsLinear) { nparts = std::min(nparts, ncols); }
+    std::vector<OutT> parts(nparts * nbins);
+    for (dim_t image = 0; image < nimages; ++image) {
+        InT const* inData = imageIn(image);
+        std::fill(parts.begin(), parts.end(), OutT(0));
+        pool.run(static_cast<int>(nparts), [&](int part) {
+            OutT* hist = parts.data() + part * nbins;
+            if (IsLinear) {
+                dim_t const len   = divup(nElems, nparts);
+                dim_t const begin = std::min(nElems, part * len);
+                dim_t const end   = std::min(nElems, begin + len);
+                histogramColumns(hist, inData + begin, end - begin, 0, 1,
+                                 binner, IsSmallInt());
+            } else {
+                dim_t const len   = divup(ncols, nparts);
+                dim_t const begin = std::min(ncols, part * len);
+                addColumns(hist, inData, begin, std::min(ncols, begin + len));
             }
-            inData += iStrides[2];
-            outData += oStrides[2];
+        });
+
+        OutT* outData = imageOut(image);
+        for (dim_t part = 0; part < nparts; ++part) {
+            OutT const* hist = parts.data() + part * nbins;
+            for (unsigned b = 0; b < nbins; ++b) { outData[b] += hist[b]; }
         }
     }
 }
@@ -9,44 +9,155 @@
 
 #pragma once
 #include <Param.hpp>
+#include <common/dispatch.hpp>
+#include <thread_pool.hpp>
+
+#include <algorithm>
+#include <vector>
 
 namespace cpu {
 namespace kernel {
 
+/// Minimum number of samples filtered by a thread
+constexpr dim_t IIR_GRAIN = 65536;
+
+/// Filters \p len samples of \p c into \p y starting from the state \p h_z
+///
+/// \p h_z holds \p num_a values, the last of which is always zero. It is left
+/// with the state after the last sample.
 template<typename T>
-void iir(Param<T> y, Param<T> c, CParam<T> a) {
-    dim4 ydims = c.dims();
-    int num_a  = a.dims(0);
-
-    for (int l = 0; l < (int)ydims[3]; l++) {
-        dim_t yidx3 = l * y.strides(3);
-        dim_t cidx3 = l * c.strides(3);
-        dim_t aidx3 = l * a.strides(3);
-
-        for (int k = 0; k < (int)ydims[2]; k++) {
-            dim_t yidx2 = k * y.strides(2) + yidx3;
-            dim_t cidx2 = k * c.strides(2) + cidx3;
-            dim_t aidx2 = k * a.strides(2) + aidx3;
-
-            for (int j = 0; j < (int)ydims[1]; j++) {
-                dim_t yidx1 = j * y.strides(1) + yidx2;
-                dim_t cidx1 = j * c.strides(1) + cidx2;
-                dim_t aidx1 = j * a.strides(1) + aidx2;
-
-                std::vector<T> h_z(num_a);
-
-                const T *h_a = a.get() + (a.dims().ndims() > 1 ? aidx1 : 0);
-                T *h_c       = c.get() + cidx1;
-                T *h_y       = y.get() + yidx1;
-
-                for (int i = 0; i < (int)ydims[0]; i++) {
-                    T y = h_y[i] = (h_c[i] + h_z[0]) / h_a[0];
-                    for (int ii = 1; ii < num_a; ii++) {
-                        h_z[ii - 1] = h_z[ii] - h_a[ii] * y;
-                    }
+void iirRun(T *h_y, const T *h_c, const T *h_a, int num_a, dim_t len,
+            T *h_z) {
+    for (dim_t i = 0; i < len; i++) {
+        T y = h_y[i] = (h_c[i] + h_z[0]) / h_a[0];
+        for (int ii = 1; ii < num_a; ii++) {
+            h_z[ii - 1] = h_z[ii] - h_a[ii] * y;
+        }
+    }
+}
+
+/// Returns the row major matrix that advances the state of the filter by
+/// \p len samples of zero input
+template<typename T>
+std::vector<T> iirTransition(const T *h_a, int num_a, dim_t len) {
+    int const p = num_a - 1;
+    std::vector<T> step(p * p, T(0));
+    std::vector<T> result(p * p, T(0));
+    std::vector<T> tmp(p * p);
+
+    for (int m = 0; m < p; m++) {
+        step[m * p] = -h_a[m + 1] / h_a[0];
+        if (m + 1 < p) { step[m * p + m + 1] += T(1); }
+        result[m * p + m] = T(1);
+    }
+
+    auto multiply = [&](std::vector<T> &out, const std::vector<T> &rhs) {
+        for (int m = 0; m < p; m++) {
+            for (int n = 0; n < p; n++) {
+                T sum = T(0);
+                for (int k = 0; k < p; k++) {
+                    sum += out[m * p + k] * rhs[k * p + n];
                 }
+                tmp[m * p + n] = sum;
             }
         }
+        out.swap(tmp);
+    };
+
+    for (; len > 0; len >>= 1) {
+        if (len & 1) { multiply(result, step); }
+        if (len > 1) { multiply(step, step); }
+    }
+    return result;
+}
+
+/// Filters a single long signal in \p nchunks chunks
+///
+/// Every chunk but the last is first filtered in parallel from a zero state.
+/// The true state at the start of each chunk is then found serially from the
+/// zero state results and the state transition over a chunk, and the chunks
+/// after the first are filtered again from their true state.
+template<typename T>
+void iirChunks(T *h_y, const T *h_c, const T *h_a, int num_a, dim_t len,
+               dim_t nchunks) {
+    ThreadPool &pool = getThreadPool();
+    dim_t const clen = divup(len, nchunks);
+    nchunks          = divup(len, clen);
+    int const p      = num_a - 1;
+
+    std::vector<T> ends(nchunks * num_a, T(0));
+    std::vector<T> starts(nchunks * num_a, T(0));
+
+    pool.run(static_cast<int>(nchunks - 1), [&](int k) {
+        iirRun(h_y + k * clen, h_c + k * clen, h_a, num_a, clen,
+               ends.data() + k * num_a);
+    });
+
+    std::vector<T> const trans = iirTransition(h_a, num_a, clen);
+    for (dim_t k = 1; k < nchunks; k++) {
+        const T *prev = starts.data() + (k - 1) * num_a;
+        const T *end  = ends.data() + (k - 1) * num_a;
+        T *z          = starts.data() + k * num_a;
+        for (int m = 0; m < p; m++) {
+            T sum = end[m];
+            for (int n = 0; n < p; n++) { sum += trans[m * p + n] * prev[n]; }
+            z[m] = sum;
+        }
+    }
+
+    // The first chunk started from the true state and is already done
+    pool.run(static_cast<int>(nchunks - 1), [&](int t) {
+        dim_t const k = t + 1;
+        iirRun(h_y + k * clen, h_c + k * clen, h_a, num_a,
+               std::min(clen, len - k * clen), starts.data() + k * num_a);
+    });
+}
+
+template<typename T>
+void iir(Param<T> y, Param<T> c, CParam<T> a) {
+    af::dim4 const ydims = c.dims();
+    int const num_a      = a.dims(0);
+    dim_t const len      = ydims[0];
+    dim_t const ncols    = ydims[1] * ydims[2] * ydims[3];
+
+    auto column = [&](dim_t col, T *&h_y, const T *&h_c, const T *&h_a) {
+        dim_t const j = col % ydims[1];
+        dim_t const k = (col / ydims[1]) % ydims[2];
+        dim_t const l = col / (ydims[1] * ydims[2]);
+
+        dim_t const aidx =
+            j * a.strides(1) + k * a.strides(2) + l * a.strides(3);
+        h_a = a.get() + (a.dims().ndims() > 1 ? aidx : 0);
+        h_c = c.get() + j * c.strides(1) + k * c.strides(2) + l * c.strides(3);
+        h_y = y.get() + j * y.strides(1) + k * y.strides(2) + l * y.strides(3);
+    };
+
+    // Chunked filtering does twice the work of the recursion, so it is only
+    // used when there are fewer columns than threads and at least three
+    // chunks.
+    dim_t const nthreads = getThreadPool().size();
+    dim_t const nchunks  = std::min(nthreads, len / IIR_GRAIN);
+    if (ncols >= nthreads || nchunks < 3) {
+        dim_t const grain =
+            std::max(dim_t(1), IIR_GRAIN / std::max(len, dim_t(1)));
+        parallel_for(0, ncols, grain, [&](dim_t begin, dim_t end) {
+            std::vector<T> h_z(num_a);
+            for (dim_t col = begin; col < end; col++) {
+                T *h_y;
+                const T *h_c, *h_a;
+                column(col, h_y, h_c, h_a);
+                std::fill(h_z.begin(), h_z.end(), T(0));
+                iirRun(h_y, h_c, h_a, num_a, len, h_z.data());
+            }
+        });
+        return;
+    }
+
+    for (dim_t col = 0; col < ncols; col++) {
+        T *h_y;
+        const T *h_c, *h_a;
+        column(col, h_y, h_c, h_a);
+        iirChunks(h_y, h_c, h_a, num_a, len, nchunks);
     }
 }
 
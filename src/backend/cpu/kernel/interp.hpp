@@ -11,6 +11,7 @@
 #include <common/complex.hpp>
 #include <math.hpp>
 #include <af/constants.h>
+#include <thread_pool.hpp>
 #include <type_traits>
 
 namespace cpu {
@@ -19,6 +20,9 @@ namespace kernel {
 using std::conditional;
 using std::is_same;
 
+/// Minimum number of output elements interpolated by a thread
+constexpr dim_t INTERP_GRAIN = 16384;
+
 template<typename T>
 using wtype_t =
     typename conditional<is_same<T, double>::value, double, float>::type;
@@ -347,5 +351,155 @@ struct Interp2<InT, LocT, 3> {
     }
 };
 
+/// Number of output columns of a row interpolated together by InterpRow
+constexpr int INTERP_ROW_WIDTH = 256;
+
+/// Interpolates every column of the row separately with Interp2
+template<typename InT, typename LocT, int order>
+void interpColumns(Param<InT> &out, int ooff, CParam<InT> &in, int ioff,
+                   const LocT *xs, const LocT *ys, const bool *inside, int len,
+                   af_interp_type method, int nimages, bool clamp) {
+    Interp2<InT, LocT, order> interp;
+    InT *outptr         = out.get();
+    const dim4 ostrides = out.strides();
+    for (int i = 0; i < len; i++) {
+        if (inside[i]) {
+            interp(out, ooff + i, in, ioff, xs[i], ys[i], method, nimages,
+                   clamp);
+        } else {
+            for (int n = 0; n < nimages; n++) {
+                outptr[ooff + i + n * ostrides[2]] = scalar<InT>(0);
+            }
+        }
+    }
+}
+
+/// Interpolates \p len consecutive output columns of a row of every image in
+/// the batch. \p xs and \p ys are the input coordinates of the columns and
+/// the columns where \p inside is false are set to zero.
+template<typename InT, typename LocT, int order>
+struct InterpRow {
+    void operator()(Param<InT> &out, int ooff, CParam<InT> &in, int ioff,
+                    const LocT *xs, const LocT *ys, const bool *inside,
+                    int len, af_interp_type method, int nimages, bool clamp) {
+        interpColumns<InT, LocT, order>(out, ooff, in, ioff, xs, ys, inside,
+                                        len, method, nimages, clamp);
+    }
+};
+
+/// Nearest neighbour. The input offset of every column is computed once and
+/// each image of the batch is a gather over the offsets.
+template<typename InT, typename LocT>
+struct InterpRow<InT, LocT, 1> {
+    void operator()(Param<InT> &out, int ooff, CParam<InT> &in, int ioff,
+                    const LocT *xs, const LocT *ys, const bool *inside,
+                    int len, af_interp_type method, int nimages, bool clamp) {
+        const InT *inptr    = in.get();
+        const dim4 idims    = in.dims();
+        const dim4 istrides = in.strides();
+        InT *outptr         = out.get();
+        const dim4 ostrides = out.strides();
+
+        const int x_lim = idims[0];
+        const int y_lim = idims[1];
+
+        bool valid[INTERP_ROW_WIDTH];
+        dim_t offs[INTERP_ROW_WIDTH];
+        for (int i = 0; i < len; i++) {
+            int xid = (method == AF_INTERP_LOWER ? std::floor(xs[i])
+                                                 : std::round(xs[i]));
+            int yid = (method == AF_INTERP_LOWER ? std::floor(ys[i])
+                                                 : std::round(ys[i]));
+            bool cond = xid >= 0 && xid < x_lim && yid >= 0 && yid < y_lim;
+            if (clamp) {
+                xid = std::max(0, std::min(xid, x_lim - 1));
+                yid = std::max(0, std::min(yid, y_lim - 1));
+            }
+            valid[i] = inside[i] && (clamp || cond);
+            offs[i]  = valid[i] ? yid * istrides[1] + xid * istrides[0] : 0;
+        }
+
+        const InT zero = scalar<InT>(0);
+        for (int n = 0; n < nimages; n++) {
+            const InT *iptr = inptr + ioff + n * istrides[2];
+            InT *optr       = outptr + ooff + n * ostrides[2];
+            for (int i = 0; i < len; i++) {
+                optr[i] = valid[i] ? iptr[offs[i]] : zero;
+            }
+        }
+    }
+};
+
+/// Bilinear interpolation of real images. The offsets and fractions of every
+/// column are computed once and each image of the batch is a weighted gather
+/// of four neighbours.
+template<typename T>
+struct InterpRow<T, T, 2> {
+    void operator()(Param<T> &out, int ooff, CParam<T> &in, int ioff,
+                    const T *xs, const T *ys, const bool *inside, int len,
+                    af_interp_type method, int nimages, bool clamp) {
+        // Neighbours past the edge are read as zero without clamping
+        if (!clamp) {
+            interpColumns<T, T, 2>(out, ooff, in, ioff, xs, ys, inside, len,
+                                   method, nimages, clamp);
+            return;
+        }
+
+        const T *inptr      = in.get();
+        const dim4 idims    = in.dims();
+        const dim4 istrides = in.strides();
+        T *outptr           = out.get();
+        const dim4 ostrides = out.strides();
+
+        const int x_lim = idims[0];
+        const int y_lim = idims[1];
+
+        dim_t offs[INTERP_ROW_WIDTH];
+        dim_t offx[INTERP_ROW_WIDTH];
+        dim_t offy[INTERP_ROW_WIDTH];
+        T fx[INTERP_ROW_WIDTH];
+        T fy[INTERP_ROW_WIDTH];
+        for (int i = 0; i < len; i++) {
+            if (!inside[i]) {
+                offs[i] = offx[i] = offy[i] = 0;
+                fx[i] = fy[i] = 0;
+                continue;
+            }
+            int grid_x = std::floor(xs[i]);
+            int grid_y = std::floor(ys[i]);
+            fx[i]      = xs[i] - grid_x;
+            fy[i]      = ys[i] - grid_y;
+
+            // Coordinates slightly below zero are inside the image. Read the
+            // first pixel instead of the one before it.
+            if (grid_x < 0) {
+                grid_x = 0;
+                fx[i]  = 0;
+            }
+            if (grid_y < 0) {
+                grid_y = 0;
+                fy[i]  = 0;
+            }
+
+            offs[i] = grid_y * istrides[1] + grid_x * istrides[0];
+            offx[i] = xs[i] + 1 < x_lim ? istrides[0] : 0;
+            offy[i] = ys[i] + 1 < y_lim ? istrides[1] : 0;
+        }
+
+        for (int n = 0; n < nimages; n++) {
+            const T *iptr = inptr + ioff + n * istrides[2];
+            T *optr       = outptr + ooff + n * ostrides[2];
+            for (int i = 0; i < len; i++) {
+                const T *p = iptr + offs[i];
+                T top      = (1 - fx[i]) * p[0] + fx[i] * p[offx[i]];
+                T bottom =
+                    (1 - fx[i]) * p[offy[i]] + fx[i] * p[offy[i] + offx[i]];
+                T val   = (1 - fy[i]) * top + fy[i] * bottom;
+                optr[i] = inside[i] ? val : T(0);
+            }
+        }
+    }
+};
+
 }  // namespace kernel
 }  // namespace cpu
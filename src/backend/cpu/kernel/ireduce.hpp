@@ -9,8 +9,14 @@
 
 #pragma once
 #include <Param.hpp>
+#include <common/dispatch.hpp>
+#include <kernel/reduce.hpp>
 #include <ops.hpp>
+#include <thread_pool.hpp>
+
 #include <algorithm>
+#include <array>
+#include <vector>
 
 namespace cpu {
 namespace kernel {
@@ -61,46 +67,120 @@ struct MinMaxOp<af_max_t, T> {
     }
 };
 
-template<af_op_t op, typename T, int D>
-struct ireduce_dim {
-    void operator()(Param<T> output, Param<uint> locParam,
-                    const dim_t outOffset, CParam<T> input,
-                    const dim_t inOffset, const int dim, CParam<uint> rlen) {
-        const af::dim4 odims    = output.dims();
-        const af::dim4 ostrides = output.strides();
-        const af::dim4 istrides = input.strides();
-        const int D1            = D - 1;
-        for (dim_t i = 0; i < odims[D1]; i++) {
-            ireduce_dim<op, T, D1>()(output, locParam,
-                                     outOffset + i * ostrides[D1], input,
-                                     inOffset + i * istrides[D1], dim, rlen);
+/// Finds the minimum or maximum of each row along \p dim
+template<af_op_t op, typename T>
+void ireduce_dim_rows(Param<T> output, Param<uint> locParam, CParam<T> input,
+                      const int dim, CParam<uint> rlen) {
+    const af::dim4 odims        = output.dims();
+    const af::dim4 ostrides     = output.strides();
+    const af::dim4 istrides     = input.strides();
+    const std::array<int, 3> od = otherDims(dim);
+
+    const dim_t n      = input.dims(dim);
+    const dim_t stride = istrides[dim];
+    const dim_t nrows  = odims[od[0]] * odims[od[1]] * odims[od[2]];
+
+    T const *const in   = input.get();
+    T *const out        = output.get();
+    uint *const loc     = locParam.get();
+    const uint *rlenptr = rlen.get();
+
+    auto offset = [&](dim_t r, const af::dim4 &strides) {
+        const dim_t i0 = r % odims[od[0]];
+        r /= odims[od[0]];
+        const dim_t i1 = r % odims[od[1]];
+        const dim_t i2 = r / odims[od[1]];
+        return i0 * strides[od[0]] + i1 * strides[od[1]] +
+               i2 * strides[od[2]];
+    };
+
+    const dim_t grain =
+        std::max(dim_t(1), REDUCE_GRAIN / std::max(n, dim_t(1)));
+    parallel_for(0, nrows, grain, [&](dim_t begin, dim_t end) {
+        for (dim_t r = begin; r < end; r++) {
+            const dim_t ioff = offset(r, istrides);
+            const dim_t ooff = offset(r, ostrides);
+            const dim_t lim  = rlenptr ? std::min(n, (dim_t)rlenptr[ooff]) : n;
+
+            MinMaxOp<op, T> Op(in[ioff], 0);
+            for (dim_t i = 0; i < lim; i++) { Op(in[ioff + i * stride], i); }
+
+            out[ooff] = Op.m_val;
+            loc[ooff] = Op.m_idx;
         }
-    }
-};
+    });
+}
 
+/// Finds the minimum or maximum along \p dim > 0 by sweeping over tiles of
+/// contiguous elements along dimension 0
 template<af_op_t op, typename T>
-struct ireduce_dim<op, T, 0> {
-    void operator()(Param<T> output, Param<uint> locParam,
-                    const dim_t outOffset, CParam<T> input,
-                    const dim_t inOffset, const int dim, CParam<uint> rlen) {
-        const af::dim4 idims    = input.dims();
-        const af::dim4 istrides = input.strides();
-
-        T const *const in   = input.get();
-        T *out              = output.get();
-        uint *loc           = locParam.get();
-        const uint *rlenptr = (rlen.get()) ? rlen.get() + outOffset : nullptr;
-
-        dim_t stride = istrides[dim];
-        MinMaxOp<op, T> Op(in[inOffset], 0);
-        int lim =
-            (rlenptr) ? std::min(idims[dim], (dim_t)*rlenptr) : idims[dim];
-        for (dim_t i = 0; i < lim; i++) { Op(in[inOffset + i * stride], i); }
-
-        out[outOffset] = Op.m_val;
-        loc[outOffset] = Op.m_idx;
+void ireduce_dim_tiles(Param<T> output, Param<uint> locParam, CParam<T> input,
+                       const int dim, CParam<uint> rlen) {
+    const af::dim4 odims        = output.dims();
+    const af::dim4 ostrides     = output.strides();
+    const af::dim4 istrides     = input.strides();
+    const std::array<int, 3> od = otherDims(dim);
+
+    const dim_t n      = input.dims(dim);
+    const dim_t n0     = odims[0];
+    const dim_t ntiles = divup(n0, REDUCE_TILE);
+    const dim_t nitems = ntiles * odims[od[1]] * odims[od[2]];
+
+    T const *const in   = input.get();
+    T *const out        = output.get();
+    uint *const loc     = locParam.get();
+    const uint *rlenptr = rlen.get();
+
+    const dim_t tile  = std::min(n0, REDUCE_TILE);
+    const dim_t grain = std::max(dim_t(1), REDUCE_GRAIN / (tile * n));
+    parallel_for(0, nitems, grain, [&](dim_t begin, dim_t end) {
+        std::vector<MinMaxOp<op, T>> ops;
+        dim_t lims[REDUCE_TILE];
+        for (dim_t item = begin; item < end; item++) {
+            const dim_t first = (item % ntiles) * REDUCE_TILE;
+            const dim_t len   = std::min(n0, first + REDUCE_TILE) - first;
+            const dim_t r     = item / ntiles;
+            const dim_t i1    = r % odims[od[1]];
+            const dim_t i2    = r / odims[od[1]];
+
+            const dim_t ioff = i1 * istrides[od[1]] + i2 * istrides[od[2]] +
+                               first * istrides[0];
+            const dim_t ooff = i1 * ostrides[od[1]] + i2 * ostrides[od[2]] +
+                               first * ostrides[0];
+
+            ops.clear();
+            for (dim_t i = 0; i < len; i++) {
+                const dim_t oidx = ooff + i * ostrides[0];
+                ops.emplace_back(in[ioff + i * istrides[0]], 0);
+                lims[i] = rlenptr ? std::min(n, (dim_t)rlenptr[oidx]) : n;
+            }
+            for (dim_t j = 0; j < n; j++) {
+                const T *row = in + ioff + j * istrides[dim];
+                for (dim_t i = 0; i < len; i++) {
+                    if (j < lims[i]) { ops[i](row[i * istrides[0]], j); }
+                }
+            }
+
+            for (dim_t i = 0; i < len; i++) {
+                out[ooff + i * ostrides[0]] = ops[i].m_val;
+                loc[ooff + i * ostrides[0]] = ops[i].m_idx;
+            }
+        }
+    });
+}
+
+/// Finds the minimum or maximum of \p input along \p dim and its location
+/// using all the threads of the ThreadPool. If \p rlen is not empty, only
+/// the first rlen elements of each row are considered.
+template<af_op_t op, typename T>
+void ireduce_dim(Param<T> output, Param<uint> locParam, CParam<T> input,
+                 const int dim, CParam<uint> rlen) {
+    if (dim == 0 || input.dims(0) == 1) {
+        ireduce_dim_rows<op, T>(output, locParam, input, dim, rlen);
+    } else {
+        ireduce_dim_tiles<op, T>(output, locParam, input, dim, rlen);
     }
-};
+}
 
 }  // namespace kernel
 }  // namespace cpu
@@ -9,172 +9,360 @@
 
 #pragma once
 #include <Param.hpp>
+#include <thread_pool.hpp>
+
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
 #include <vector>
 
 namespace cpu {
 namespace kernel {
 
+/// Minimum number of outputs computed by a thread
+constexpr dim_t MEDFILT_GRAIN = 32768;
+
+/// Returns the index read by the filter for the padded index \p idx along a
+/// dimension of length \p len, or -1 if the filter reads a zero there
+template<af_border_type Pad>
+dim_t medfiltIndex(dim_t idx, dim_t len) {
+    if (Pad == AF_PAD_SYM) {
+        if (idx < 0) { idx = -idx; }
+        if (idx >= len) { idx = 2 * (len - 1) - idx; }
+        return std::min(std::max(idx, dim_t(0)), len - 1);
+    }
+    return (idx < 0 || idx >= len) ? -1 : idx;
+}
+
+/// One image of the input of a median filter read with padding
 template<typename T, af_border_type Pad>
-void medfilt1(Param<T> out, CParam<T> in, dim_t w_wid) {
-    const af::dim4 dims     = in.dims();
-    const af::dim4 istrides = in.strides();
-    const af::dim4 ostrides = out.strides();
+struct MedfiltImage {
+    const T *ptr;
+    dim_t rows;
+    dim_t cols;
+    dim_t rowStride;
+    dim_t colStride;
+
+    T operator()(dim_t row, dim_t col) const {
+        const dim_t r = medfiltIndex<Pad>(row, rows);
+        const dim_t c = medfiltIndex<Pad>(col, cols);
+        return (r < 0 || c < 0) ? T(0) : ptr[r * rowStride + c * colStride];
+    }
+};
+
+/// Median of a window given its lower and upper middle values. Windows with
+/// an even number of values average the two.
+template<typename T>
+T medianOf(T lower, T upper, bool even) {
+    return even ? static_cast<T>((upper + lower) / 2) : upper;
+}
+
+/// Order of the values in a sorted window. NaNs are ordered after all the
+/// other values so that they can be found and replaced like any other value.
+template<typename T, bool = std::is_floating_point<T>::value>
+struct MedfiltLess {
+    bool operator()(T lhs, T rhs) const { return lhs < rhs; }
+};
+
+template<typename T>
+struct MedfiltLess<T, true> {
+    bool operator()(T lhs, T rhs) const {
+        return lhs < rhs || (std::isnan(rhs) && !std::isnan(lhs));
+    }
+};
+
+/// Replaces \p oldVal by \p newVal in the sorted window \p wind. Only the
+/// values between the two positions are moved.
+template<typename T>
+void replaceSorted(std::vector<T> &wind, T oldVal, T newVal) {
+    const MedfiltLess<T> less;
+    auto pos = std::lower_bound(wind.begin(), wind.end(), oldVal, less);
+    if (less(oldVal, newVal)) {
+        auto ins = std::lower_bound(pos + 1, wind.end(), newVal, less);
+        std::move(pos + 1, ins, pos);
+        *(ins - 1) = newVal;
+    } else {
+        auto ins = std::upper_bound(wind.begin(), pos, newVal, less);
+        std::move_backward(ins, pos, pos + 1);
+        *ins = newVal;
+    }
+}
+
+/// Histogram of the values of an integer type of \p Bits bits with a coarse
+/// level of 2^(Bits / 2) bins, so that the k-th value is found by scanning
+/// 2^(Bits / 2 + 1) bins at most
+template<typename T, int Bits, typename Count>
+struct MedfiltHistogram {
+    static constexpr int FINE   = 1 << Bits;
+    static constexpr int SHIFT  = Bits / 2;
+    static constexpr int COARSE = FINE >> SHIFT;
+
+    Count fine[FINE];
+    Count coarse[COARSE];
+
+    static unsigned bin(T val) {
+        return static_cast<unsigned>(static_cast<int>(val) -
+                                     std::numeric_limits<T>::min());
+    }
+
+    void clear() {
+        std::fill(fine, fine + FINE, Count(0));
+        std::fill(coarse, coarse + COARSE, Count(0));
+    }
+
+    void add(T val) {
+        const unsigned b = bin(val);
+        fine[b]++;
+        coarse[b >> SHIFT]++;
+    }
+
+    void remove(T val) {
+        const unsigned b = bin(val);
+        fine[b]--;
+        coarse[b >> SHIFT]--;
+    }
+
+    /// Returns the k-th smallest value, counting from 0
+    T kth(dim_t k) const {
+        int c = 0;
+        for (; k >= dim_t(coarse[c]); ++c) { k -= coarse[c]; }
+        int b = c << SHIFT;
+        for (; k >= dim_t(fine[b]); ++b) { k -= fine[b]; }
+        return static_cast<T>(b + std::numeric_limits<T>::min());
+    }
+};
+
+/// Filters the column \p col of \p img with a sorted window which slides
+/// down the column. Each step replaces one row of the window.
+template<typename T, af_border_type Pad>
+void medfiltSortedColumn(T *out, dim_t outStride,
+                         const MedfiltImage<T, Pad> &img, dim_t col,
+                         dim_t w_len, dim_t w_wid, std::vector<T> &wind) {
+    const dim_t row0 = -(w_len / 2);
+    const dim_t col0 = col - w_wid / 2;
+    const dim_t mid  = (w_len * w_wid) / 2;
+    const bool even  = (w_len * w_wid) % 2 == 0;
+
+    wind.clear();
+    for (dim_t c = col0; c < col0 + w_wid; ++c) {
+        for (dim_t r = row0; r < row0 + w_len; ++r) {
+            wind.push_back(img(r, c));
+        }
+    }
+    std::sort(wind.begin(), wind.end(), MedfiltLess<T>());
+
+    for (dim_t row = 0; row < img.rows; ++row) {
+        out[row * outStride] =
+            medianOf(even ? wind[mid - 1] : wind[mid], wind[mid], even);
+        if (row + 1 == img.rows) { break; }
+
+        const dim_t r = row0 + row;
+        for (dim_t c = col0; c < col0 + w_wid; ++c) {
+            replaceSorted(wind, img(r, c), img(r + w_len, c));
+        }
+    }
+}
+
+/// Filters the column \p col of \p img with a histogram of the window which
+/// slides down the column. Each step removes and adds one row of the window
+/// and the median is found in the coarse and fine bins.
+template<typename T, af_border_type Pad, typename Hist>
+void medfiltHistogramColumn(T *out, dim_t outStride,
+                            const MedfiltImage<T, Pad> &img, dim_t col,
+                            dim_t w_len, dim_t w_wid, Hist &hist) {
+    const dim_t row0 = -(w_len / 2);
+    const dim_t col0 = col - w_wid / 2;
+    const dim_t mid  = (w_len * w_wid) / 2;
+    const bool even  = (w_len * w_wid) % 2 == 0;
+
+    for (dim_t c = col0; c < col0 + w_wid; ++c) {
+        for (dim_t r = row0; r < row0 + w_len; ++r) { hist.add(img(r, c)); }
+    }
 
-    std::vector<T> wind_vals;
-    wind_vals.reserve(w_wid);
-
-    for (int b3 = 0; b3 < (int)dims[3]; b3++) {
-        T const* in_ptr = in.get() + b3 * istrides[3];
-        T* out_ptr      = out.get() + b3 * ostrides[3];
-
-        for (int b2 = 0; b2 < (int)dims[2]; b2++) {
-            for (int col = 0; col < (int)dims[1]; col++) {
-                int ocol_off = col * ostrides[1];
-
-                for (int row = 0; row < (int)dims[0]; row++) {
-                    wind_vals.clear();
-                    for (int wi = 0; wi < (int)w_wid; ++wi) {
-                        int im_row = row + wi - w_wid / 2;
-                        int im_roff;
-                        switch (Pad) {
-                            case AF_PAD_ZERO:
-                                im_roff = im_row * istrides[0];
-                                if (im_row < 0 || im_row >= (int)dims[0])
-                                    wind_vals.push_back(0);
-                                else
-                                    wind_vals.push_back(in_ptr[im_roff]);
-                                break;
-                            case AF_PAD_SYM: {
-                                if (im_row < 0) { im_row *= -1; }
-
-                                if (im_row >= (int)dims[0]) {
-                                    im_row = 2 * ((int)dims[0] - 1) - im_row;
-                                }
-
-                                im_roff = im_row * istrides[0];
-                                wind_vals.push_back(in_ptr[im_roff]);
-                            } break;
-                        }
-                    }
-
-                    int off = wind_vals.size() / 2;
-                    std::stable_sort(wind_vals.begin(), wind_vals.end());
-                    if (wind_vals.size() % 2 == 0)
-                        out_ptr[ocol_off + row * ostrides[0]] =
-                            (wind_vals[off] + wind_vals[off - 1]) / 2;
-                    else {
-                        out_ptr[ocol_off + row * ostrides[0]] = wind_vals[off];
-                    }
-                }
+    for (dim_t row = 0; row < img.rows; ++row) {
+        out[row * outStride] = medianOf(even ? hist.kth(mid - 1) : T(0),
+                                        hist.kth(mid), even);
+
+        const dim_t r = row0 + row;
+        for (dim_t c = col0; c < col0 + w_wid; ++c) {
+            hist.remove(img(r, c));
+            if (row + 1 < img.rows) { hist.add(img(r + w_len, c)); }
+        }
+    }
+
+    // The rows which are still in the window are removed so that the
+    // histogram is empty for the next column without clearing all the bins
+    for (dim_t c = col0; c < col0 + w_wid; ++c) {
+        for (dim_t r = row0 + img.rows; r < row0 + img.rows + w_len - 1;
+             ++r) {
+            hist.remove(img(r, c));
+        }
+    }
+}
+
+/// Filters the columns [\p colBegin, \p colEnd) of \p img in constant time
+/// per output
+///
+/// Every padded row has a histogram of the w_wid values of the row in the
+/// window. Moving to the next column updates each row histogram with one
+/// removal and one addition, and moving down a column adds the histogram of
+/// the new row to the window histogram and subtracts the one of the old row.
+/// Neither depends on the size of the window.
+template<typename T, af_border_type Pad>
+void medfiltLineHistograms(T *out, dim_t outStride, dim_t outColStride,
+                           const MedfiltImage<T, Pad> &img, dim_t colBegin,
+                           dim_t colEnd, dim_t w_len, dim_t w_wid) {
+    using Line   = MedfiltHistogram<T, 8, uint16_t>;
+    using Window = MedfiltHistogram<T, 8, uint32_t>;
+
+    constexpr int FINE   = Line::FINE;
+    constexpr int COARSE = Line::COARSE;
+    const dim_t row0     = -(w_len / 2);
+    const dim_t nlines   = img.rows + w_len - 1;
+    const dim_t mid      = (w_len * w_wid) / 2;
+    const bool even      = (w_len * w_wid) % 2 == 0;
+
+    std::vector<Line> lines(nlines);
+    const dim_t col0 = colBegin - w_wid / 2;
+    for (dim_t l = 0; l < nlines; ++l) {
+        lines[l].clear();
+        for (dim_t c = col0; c < col0 + w_wid; ++c) {
+            lines[l].add(img(row0 + l, c));
+        }
+    }
+
+    Window wind;
+    for (dim_t col = colBegin; col < colEnd; ++col) {
+        if (col > colBegin) {
+            const dim_t oldCol = col - 1 - w_wid / 2;
+            for (dim_t l = 0; l < nlines; ++l) {
+                lines[l].remove(img(row0 + l, oldCol));
+                lines[l].add(img(row0 + l, oldCol + w_wid));
+            }
+        }
+
+        wind.clear();
+        for (dim_t l = 0; l < w_len; ++l) {
+            for (int b = 0; b < FINE; ++b) { wind.fine[b] += lines[l].fine[b]; }
+            for (int b = 0; b < COARSE; ++b) {
+                wind.coarse[b] += lines[l].coarse[b];
+            }
+        }
+
+        T *outCol = out + col * outColStride;
+        for (dim_t row = 0; row < img.rows; ++row) {
+            outCol[row * outStride] = medianOf(
+                even ? wind.kth(mid - 1) : T(0), wind.kth(mid), even);
+            if (row + 1 == img.rows) { break; }
+
+            const Line &oldLine = lines[row];
+            const Line &newLine = lines[row + w_len];
+            for (int b = 0; b < FINE; ++b) {
+                wind.fine[b] += uint32_t(newLine.fine[b]) - oldLine.fine[b];
+            }
+            for (int b = 0; b < COARSE; ++b) {
+                wind.coarse[b] +=
+                    uint32_t(newLine.coarse[b]) - oldLine.coarse[b];
             }
-            in_ptr += istrides[2];
-            out_ptr += ostrides[2];
         }
     }
 }
 
+/// Number of bits of the types whose median filters use histograms, or 0
+/// for the types which use sorted windows
+template<typename T>
+using MedfiltBits = std::integral_constant<
+    int, std::is_integral<T>::value && sizeof(T) <= 2 ? 8 * sizeof(T) : 0>;
+
+/// Filters the columns [\p colBegin, \p colEnd) of one image
+template<typename T, af_border_type Pad>
+void medfiltColumns(T *out, dim_t outStride, dim_t outColStride,
+                    const MedfiltImage<T, Pad> &img, dim_t colBegin,
+                    dim_t colEnd, dim_t w_len, dim_t w_wid,
+                    std::integral_constant<int, 0>) {
+    std::vector<T> wind;
+    wind.reserve(w_len * w_wid);
+    for (dim_t col = colBegin; col < colEnd; ++col) {
+        medfiltSortedColumn(out + col * outColStride, outStride, img, col,
+                            w_len, w_wid, wind);
+    }
+}
+
+template<typename T, af_border_type Pad>
+void medfiltColumns(T *out, dim_t outStride, dim_t outColStride,
+                    const MedfiltImage<T, Pad> &img, dim_t colBegin,
+                    dim_t colEnd, dim_t w_len, dim_t w_wid,
+                    std::integral_constant<int, 8>) {
+    // The row histograms count up to w_wid values in 16 bits
+    if (w_wid > dim_t(std::numeric_limits<uint16_t>::max())) {
+        medfiltColumns(out, outStride, outColStride, img, colBegin, colEnd,
+                       w_len, w_wid, std::integral_constant<int, 0>());
+    } else {
+        medfiltLineHistograms(out, outStride, outColStride, img, colBegin,
+                              colEnd, w_len, w_wid);
+    }
+}
+
+template<typename T, af_border_type Pad>
+void medfiltColumns(T *out, dim_t outStride, dim_t outColStride,
+                    const MedfiltImage<T, Pad> &img, dim_t colBegin,
+                    dim_t colEnd, dim_t w_len, dim_t w_wid,
+                    std::integral_constant<int, 16>) {
+    std::vector<MedfiltHistogram<T, 16, uint32_t>> hist(1);
+    hist[0].clear();
+    for (dim_t col = colBegin; col < colEnd; ++col) {
+        medfiltHistogramColumn(out + col * outColStride, outStride, img, col,
+                               w_len, w_wid, hist[0]);
+    }
+}
+
+/// Median filter with a window of \p w_len rows and \p w_wid columns
+///
+/// 8-bit types use row histograms and take constant time per output, 16-bit
+/// types slide a two level histogram down each column and the other types
+/// slide a sorted window in which NaNs are larger than every other value. The
+/// columns of all the images are split between the threads of the thread
+/// pool.
 template<typename T, af_border_type Pad>
 void medfilt2(Param<T> out, CParam<T> in, dim_t w_len, dim_t w_wid) {
     const af::dim4 dims     = in.dims();
     const af::dim4 istrides = in.strides();
     const af::dim4 ostrides = out.strides();
 
-    std::vector<T> wind_vals;
-    wind_vals.reserve(w_len * w_wid);
-
-    for (int b3 = 0; b3 < (int)dims[3]; b3++) {
-        T const* in_ptr = in.get() + b3 * istrides[3];
-        T* out_ptr      = out.get() + b3 * ostrides[3];
-
-        for (int b2 = 0; b2 < (int)dims[2]; b2++) {
-            for (int col = 0; col < (int)dims[1]; col++) {
-                int ocol_off = col * ostrides[1];
-
-                for (int row = 0; row < (int)dims[0]; row++) {
-                    wind_vals.clear();
-
-                    for (int wj = 0; wj < (int)w_wid; ++wj) {
-                        bool isColOff = false;
-
-                        int im_col = col + wj - w_wid / 2;
-                        int im_coff;
-                        switch (Pad) {
-                            case AF_PAD_ZERO:
-                                im_coff = im_col * istrides[1];
-                                if (im_col < 0 || im_col >= (int)dims[1])
-                                    isColOff = true;
-                                break;
-                            case AF_PAD_SYM: {
-                                if (im_col < 0) {
-                                    im_col *= -1;
-                                    isColOff = true;
-                                }
-
-                                if (im_col >= (int)dims[1]) {
-                                    im_col   = 2 * ((int)dims[1] - 1) - im_col;
-                                    isColOff = true;
-                                }
-
-                                im_coff = im_col * istrides[1];
-                            } break;
-                        }
-
-                        for (int wi = 0; wi < (int)w_len; ++wi) {
-                            bool isRowOff = false;
-
-                            int im_row = row + wi - w_len / 2;
-                            int im_roff;
-                            switch (Pad) {
-                                case AF_PAD_ZERO:
-                                    im_roff = im_row * istrides[0];
-                                    if (im_row < 0 || im_row >= (int)dims[0])
-                                        isRowOff = true;
-                                    break;
-                                case AF_PAD_SYM: {
-                                    if (im_row < 0) {
-                                        im_row *= -1;
-                                        isRowOff = true;
-                                    }
-
-                                    if (im_row >= (int)dims[0]) {
-                                        im_row =
-                                            2 * ((int)dims[0] - 1) - im_row;
-                                        isRowOff = true;
-                                    }
-
-                                    im_roff = im_row * istrides[0];
-                                } break;
-                            }
-
-                            if (isRowOff || isColOff) {
-                                switch (Pad) {
-                                    case AF_PAD_ZERO:
-                                        wind_vals.push_back(0);
-                                        break;
-                                    case AF_PAD_SYM:
-                                        wind_vals.push_back(
-                                            in_ptr[im_coff + im_roff]);
-                                        break;
-                                }
-                            } else
-                                wind_vals.push_back(in_ptr[im_coff + im_roff]);
-                        }
-                    }
-
-                    std::stable_sort(wind_vals.begin(), wind_vals.end());
-                    int off = wind_vals.size() / 2;
-                    if (wind_vals.size() % 2 == 0)
-                        out_ptr[ocol_off + row * ostrides[0]] =
-                            (wind_vals[off] + wind_vals[off - 1]) / 2;
-                    else
-                        out_ptr[ocol_off + row * ostrides[0]] = wind_vals[off];
-                }
-            }
-            in_ptr += istrides[2];
-            out_ptr += ostrides[2];
+    const dim_t ncols   = dims[1];
+    const dim_t nimages = dims[2] * dims[3];
+    dim_t grain =
+        std::max(dim_t(1), MEDFILT_GRAIN / std::max(dims[0], dim_t(1)));
+    // The row histograms are rebuilt for every block of columns
+    if (MedfiltBits<T>::value == 8) { grain = std::max(grain, 4 * w_wid); }
+
+    parallel_for(0, ncols * nimages, grain, [&](dim_t begin, dim_t end) {
+        while (begin < end) {
+            const dim_t image = begin / ncols;
+            const dim_t col   = begin % ncols;
+            const dim_t last  = std::min(end, (image + 1) * ncols);
+            const dim_t b2    = image % dims[2];
+            const dim_t b3    = image / dims[2];
+
+            const MedfiltImage<T, Pad> img{
+                in.get() + b2 * istrides[2] + b3 * istrides[3], dims[0],
+                dims[1], istrides[0], istrides[1]};
+            T *optr = out.get() + b2 * ostrides[2] + b3 * ostrides[3];
+
+            medfiltColumns(optr, ostrides[0], ostrides[1], img, col,
+                           col + last - begin, w_len, w_wid, MedfiltBits<T>());
+            begin = last;
         }
-    }
+    });
+}
+
+/// Median filter along the first dimension with a window of \p w_wid
+/// values
+template<typename T, af_border_type Pad>
+void medfilt1(Param<T> out, CParam<T> in, dim_t w_wid) {
+    medfilt2<T, Pad>(out, in, w_wid, 1);
 }
 
 }  // namespace kernel
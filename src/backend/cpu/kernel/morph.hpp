@@ -9,69 +9,265 @@
 
 #pragma once
 #include <Param.hpp>
+#include <common/dispatch.hpp>
 #include <ops.hpp>
+#include <thread_pool.hpp>
 #include <utility.hpp>
+
+#include <algorithm>
 #include <limits>
+#include <vector>
 
 namespace cpu {
 namespace kernel {
+
+/// Number of outputs along each dimension which are computed together. The
+/// running extrema of a tile stay in the cache between the two passes.
+constexpr dim_t MORPH_TILE = 128;
+
+/// Minimum number of outputs computed by a thread
+constexpr dim_t MORPH_GRAIN = 65536;
+
+/// Shortest run of ones in a mask which is reduced with a running extremum.
+/// Shorter runs are applied one mask value at a time.
+constexpr dim_t MORPH_RUNNING_MIN = 3;
+
+template<typename T, bool IsDilation>
+struct MorphFilterOp {
+    T operator()(const T& a, const T& b) const {
+        return IsDilation ? std::max(a, b) : std::min(a, b);
+    }
+};
+
+/// A rectangle of ones in a mask. The output (i, j) reads the padded input
+/// rows [i + row, i + row + len) and columns [j + col, j + col + width).
+struct MorphRect {
+    dim_t row;
+    dim_t len;
+    dim_t col;
+    dim_t width;
+};
+
+/// Splits the ones of \p mask into rectangles sorted by their length
+///
+/// Every column of the mask is split into runs of ones and a run is merged
+/// with the same run of the previous column. Runs and rectangles shorter than
+/// MORPH_RUNNING_MIN are split into single values and single columns.
 template<typename T>
-void getOffsets(std::vector<dim_t>& offsets, const af::dim4& strides,
-                const CParam<T>& mask) {
+std::vector<MorphRect> getRects(const CParam<T>& mask) {
     const af::dim4 fstrides = mask.strides();
     const T* filter         = mask.get();
     const dim_t dim0 = mask.dims()[0], dim1 = mask.dims()[1];
-    const dim_t R0 = dim0 / 2;
-    const dim_t R1 = dim1 / 2;
 
-    offsets.reserve(mask.dims().elements());
+    std::vector<MorphRect> rects;
+    std::vector<size_t> open, next;
     for (dim_t j = 0; j < dim1; ++j) {
-        for (dim_t i = 0; i < dim0; ++i) {
-            if (filter[getIdx(fstrides, i, j)] > (T)0) {
-                dim_t offset = (j - R1) * strides[1] + (i - R0) * strides[0];
-                offsets.push_back(offset);
+        next.clear();
+        for (dim_t i = 0; i < dim0;) {
+            if (!(filter[getIdx(fstrides, i, j)] > (T)0)) {
+                ++i;
+                continue;
+            }
+            dim_t end = i + 1;
+            while (end < dim0 && filter[getIdx(fstrides, end, j)] > (T)0) {
+                ++end;
+            }
+
+            const dim_t len    = end - i;
+            const dim_t pieces = len < MORPH_RUNNING_MIN ? len : 1;
+            for (dim_t p = 0; p < pieces; ++p) {
+                const dim_t row  = i + p;
+                const dim_t plen = len / pieces;
+                auto prev =
+                    std::find_if(open.begin(), open.end(), [&](size_t r) {
+                        return rects[r].row == row && rects[r].len == plen;
+                    });
+                if (prev != open.end()) {
+                    rects[*prev].width++;
+                    next.push_back(*prev);
+                } else {
+                    next.push_back(rects.size());
+                    rects.push_back({row, plen, j, 1});
+                }
             }
+            i = end;
         }
+        open.swap(next);
     }
+
+    std::vector<MorphRect> out;
+    for (const MorphRect& r : rects) {
+        if (r.width < MORPH_RUNNING_MIN) {
+            for (dim_t c = 0; c < r.width; ++c) {
+                out.push_back({r.row, r.len, r.col + c, 1});
+            }
+        } else {
+            out.push_back(r);
+        }
+    }
+    std::stable_sort(out.begin(), out.end(),
+                     [](const MorphRect& a, const MorphRect& b) {
+                         return a.len < b.len;
+                     });
+    return out;
 }
 
-template<typename T, bool IsDilation>
-struct MorphFilterOp {
-    T operator()(const T& a, const T& b) {
-        return IsDilation ? std::max(a, b) : std::min(a, b);
+/// Computes out[k] = op(in[k], ..., in[k + wlen - 1]) for k in
+/// [0, len - wlen] with the van Herk/Gil-Werman algorithm, which takes three
+/// comparisons per output for any \p wlen
+///
+/// Every element is a run of \p width contiguous values. The element k of
+/// \p in starts at in + k * istride and the output k at out + k * ostride.
+/// If Accumulate is true the extrema are combined with the values in \p out.
+/// \p suffix holds len * width values and \p prefix holds width values.
+template<typename T, bool IsDilation, bool Accumulate>
+void runningExtrema(T* out, dim_t ostride, const T* in, dim_t istride,
+                    dim_t len, dim_t width, dim_t wlen, T* suffix, T* prefix) {
+    MorphFilterOp<T, IsDilation> op;
+
+    // Extrema from every element to the end of its block of wlen elements
+    for (dim_t k = len - 1; k >= 0; --k) {
+        const T* ik = in + k * istride;
+        T* sk       = suffix + k * width;
+        if (k == len - 1 || (k + 1) % wlen == 0) {
+            std::copy(ik, ik + width, sk);
+        } else {
+            const T* sn = sk + width;
+            for (dim_t w = 0; w < width; ++w) { sk[w] = op(ik[w], sn[w]); }
+        }
     }
-};
 
+    // The extrema from the start of the block of k to k complete the window
+    // ending at k
+    for (dim_t k = 0; k < len; ++k) {
+        const T* ik = in + k * istride;
+        if (k % wlen == 0) {
+            std::copy(ik, ik + width, prefix);
+        } else {
+            for (dim_t w = 0; w < width; ++w) {
+                prefix[w] = op(prefix[w], ik[w]);
+            }
+        }
+        if (k + 1 < wlen) { continue; }
+
+        const T* sk = suffix + (k + 1 - wlen) * width;
+        T* ok       = out + (k + 1 - wlen) * ostride;
+        for (dim_t w = 0; w < width; ++w) {
+            const T val = op(sk[w], prefix[w]);
+            ok[w]       = Accumulate ? op(ok[w], val) : val;
+        }
+    }
+}
+
+/// Dilates or erodes the images of \p paddedIn, which is padded by half the
+/// mask size on both sides of the first two dimensions. Both arrays must be
+/// contiguous along the first dimension.
+///
+/// The mask is split into rectangles of ones. The rectangles are reduced
+/// with running extrema along the columns and then along the rows, so the
+/// cost of a rectangle does not depend on its size. Single mask values are
+/// applied with a loop over the contiguous outputs of a column.
 template<typename T, bool IsDilation>
-void morph(Param<T> paddedOut, CParam<T> paddedIn, CParam<T> mask) {
+void morph(Param<T> out, CParam<T> paddedIn, CParam<T> mask) {
     MorphFilterOp<T, IsDilation> filterOp;
-    T init =
+    const T init =
         IsDilation ? Binary<T, af_max_t>::init() : Binary<T, af_min_t>::init();
 
-    const af::dim4 ostrides = paddedOut.strides();
-    T* outData              = paddedOut.get();
+    const af::dim4 odims    = out.dims();
+    const af::dim4 ostrides = out.strides();
     const af::dim4 istrides = paddedIn.strides();
-    const af::dim4 dims     = paddedIn.dims();
-    const T* inData         = paddedIn.get();
-
-    std::vector<dim_t> offsets;
-    getOffsets(offsets, istrides, mask);
-
-    const dim_t batchSize = dims[0] * dims[1];
-    const int batchCount  = dims[2] * dims[3];
-    for (int b = 0; b < batchCount; ++b) {
-        for (dim_t n = 0; n < batchSize; ++n) {
-            T filterResult = init;
-            for (size_t oi = 0; oi < offsets.size(); ++oi) {
-                dim_t x = n + offsets[oi];
-                if (x >= 0 && x < batchSize)
-                    filterResult = filterOp(filterResult, inData[x]);
+    const af::dim4 mdims    = mask.dims();
+
+    const std::vector<MorphRect> rects = getRects(mask);
+
+    const dim_t tile0   = std::max(MORPH_TILE, 2 * mdims[0]);
+    const dim_t tile1   = std::max(MORPH_TILE, 2 * mdims[1]);
+    const dim_t ntiles0 = divup(odims[0], tile0);
+    const dim_t ntiles  = ntiles0 * divup(odims[1], tile1);
+    const dim_t nimages = odims[2] * odims[3];
+    const dim_t grain   = std::max(dim_t(1), MORPH_GRAIN / (tile0 * tile1));
+
+    parallel_for(0, nimages * ntiles, grain, [&](dim_t begin, dim_t end) {
+        std::vector<T> colExtrema((tile0 + mdims[0]) * (tile1 + mdims[1]));
+        std::vector<T> suffix(
+            std::max(tile0 + mdims[0], (tile1 + mdims[1]) * tile0));
+        std::vector<T> prefix(tile0);
+
+        for (dim_t t = begin; t < end; ++t) {
+            const dim_t image = t / ntiles;
+            const dim_t tile  = t % ntiles;
+            const dim_t b2    = image % odims[2];
+            const dim_t b3    = image / odims[2];
+            const T* inData =
+                paddedIn.get() + b2 * istrides[2] + b3 * istrides[3];
+            T* outData = out.get() + b2 * ostrides[2] + b3 * ostrides[3];
+
+            const dim_t i0   = (tile % ntiles0) * tile0;
+            const dim_t j0   = (tile / ntiles0) * tile1;
+            const dim_t rows = std::min(odims[0], i0 + tile0) - i0;
+            const dim_t cols = std::min(odims[1], j0 + tile1) - j0;
+
+            T* outTile = outData + i0 + j0 * ostrides[1];
+            for (dim_t c = 0; c < cols; ++c) {
+                std::fill_n(outTile + c * ostrides[1], rows, init);
+            }
+
+            for (size_t r = 0; r < rects.size();) {
+                // The rectangles [r, rEnd) have the same length and share
+                // the running extrema along the columns
+                const dim_t len = rects[r].len;
+                dim_t rowMin = rects[r].row, rowMax = rects[r].row;
+                dim_t colMin = rects[r].col, colEnd = rects[r].col;
+                size_t rEnd = r;
+                for (; rEnd < rects.size() && rects[rEnd].len == len; ++rEnd) {
+                    rowMin = std::min(rowMin, rects[rEnd].row);
+                    rowMax = std::max(rowMax, rects[rEnd].row);
+                    colMin = std::min(colMin, rects[rEnd].col);
+                    colEnd =
+                        std::max(colEnd, rects[rEnd].col + rects[rEnd].width);
+                }
+
+                const T* src    = inData;
+                dim_t srcStride = istrides[1];
+                dim_t rowBase = 0, colBase = 0;
+                if (len >= MORPH_RUNNING_MIN) {
+                    rowBase           = i0 + rowMin;
+                    colBase           = j0 + colMin;
+                    const dim_t vrows = rows + rowMax - rowMin;
+                    const dim_t vcols = cols + colEnd - 1 - colMin;
+                    for (dim_t c = 0; c < vcols; ++c) {
+                        runningExtrema<T, IsDilation, false>(
+                            colExtrema.data() + c * vrows, 1,
+                            inData + (colBase + c) * istrides[1] + rowBase, 1,
+                            vrows + len - 1, 1, len, suffix.data(),
+                            prefix.data());
+                    }
+                    src       = colExtrema.data();
+                    srcStride = vrows;
+                }
+
+                for (; r < rEnd; ++r) {
+                    const MorphRect& rect = rects[r];
+                    const T* srcTile      = src + (i0 + rect.row - rowBase) +
+                                       (j0 + rect.col - colBase) * srcStride;
+                    if (rect.width >= MORPH_RUNNING_MIN) {
+                        runningExtrema<T, IsDilation, true>(
+                            outTile, ostrides[1], srcTile, srcStride,
+                            cols + rect.width - 1, rows, rect.width,
+                            suffix.data(), prefix.data());
+                        continue;
+                    }
+                    for (dim_t c = 0; c < cols; ++c) {
+                        T* o       = outTile + c * ostrides[1];
+                        const T* s = srcTile + c * srcStride;
+                        for (dim_t i = 0; i < rows; ++i) {
+                            o[i] = filterOp(o[i], s[i]);
+                        }
+                    }
+                }
             }
-            outData[n] = filterResult;
         }
-        outData += ostrides[2];
-        inData += istrides[2];
-    }
+    });
 }
 
 template<typename T, bool IsDilation>
@@ -9,17 +9,36 @@
 
 #pragma once
 #include <Param.hpp>
+#include <thread_pool.hpp>
 
-namespace cpu {
-namespace kernel {
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
 
 #if defined(_WIN32) || defined(_MSC_VER)
 
 #include <intrin.h>
 #define __builtin_popcount __popcnt
+#define __builtin_popcountll __popcnt64
 
 #endif
 
+namespace cpu {
+namespace kernel {
+
+/// Number of queries whose distances are computed together. The train
+/// samples of a tile are reused from the cache for all of them.
+constexpr dim_t NN_QUERY_TILE = 16;
+
+/// Number of train samples whose distances are computed together
+constexpr dim_t NN_TRAIN_TILE = 256;
+
+/// Minimum number of distance terms computed by a thread
+constexpr dim_t NN_GRAIN = 65536;
+
 template<typename T, typename To, af_match_type dist_type>
 struct dist_op {
     To operator()(T v1, T v2) {
@@ -44,7 +63,9 @@ struct dist_op<uint, To, AF_SHD> {
 
 template<typename To>
 struct dist_op<uintl, To, AF_SHD> {
-    To operator()(uintl v1, uintl v2) { return __builtin_popcount(v1 ^ v2); }
+    To operator()(uintl v1, uintl v2) {
+        return __builtin_popcountll(v1 ^ v2);
+    }
 };
 
 template<typename To>
@@ -57,42 +78,161 @@ struct dist_op<ushort, To, AF_SHD> {
     To operator()(ushort v1, ushort v2) { return __builtin_popcount(v1 ^ v2); }
 };
 
+/// Distance between the \p len contiguous features of \p q and \p t
+template<typename T, typename To, af_match_type dist_type>
+struct contiguous_dist {
+    To operator()(const T *q, const T *t, dim_t len) {
+        dist_op<T, To, dist_type> op;
+        To dist = 0;
+        for (dim_t k = 0; k < len; ++k) { dist += op(q[k], t[k]); }
+        return dist;
+    }
+};
+
+/// Hamming distance of contiguous features computed 64 bits at a time
+template<typename T, typename To>
+struct contiguous_dist<T, To, AF_SHD> {
+    To operator()(const T *q, const T *t, dim_t len) {
+        constexpr dim_t perWord = sizeof(uint64_t) / sizeof(T);
+        const dim_t nwords      = len / perWord;
+
+        To dist = 0;
+        for (dim_t w = 0; w < nwords; ++w) {
+            uint64_t qw, tw;
+            std::memcpy(&qw, q + w * perWord, sizeof(uint64_t));
+            std::memcpy(&tw, t + w * perWord, sizeof(uint64_t));
+            dist += __builtin_popcountll(qw ^ tw);
+        }
+
+        dist_op<T, To, AF_SHD> op;
+        for (dim_t k = nwords * perWord; k < len; ++k) {
+            dist += op(q[k], t[k]);
+        }
+        return dist;
+    }
+};
+
+/// Keeps the \p k smallest (distance, index) pairs pushed into it
+template<typename To>
+class BoundedHeap {
+   public:
+    using Entry = std::pair<To, uint>;
+
+    explicit BoundedHeap(uint k) : k(k) { entries.reserve(k); }
+
+    void clear() { entries.clear(); }
+
+    void push(To dist, uint idx) {
+        const Entry entry(dist, idx);
+        if (entries.size() < k) {
+            entries.push_back(entry);
+            std::push_heap(entries.begin(), entries.end());
+        } else if (entry < entries.front()) {
+            std::pop_heap(entries.begin(), entries.end());
+            entries.back() = entry;
+            std::push_heap(entries.begin(), entries.end());
+        }
+    }
+
+    /// Sorts the entries from the smallest to the largest distance
+    const std::vector<Entry> &sorted() {
+        std::sort_heap(entries.begin(), entries.end());
+        return entries;
+    }
+
+   private:
+    uint k;
+    std::vector<Entry> entries;
+};
+
+/// Finds the \p n_dist train samples closest to every query
+///
+/// The distances are computed for tiles of NN_QUERY_TILE queries and
+/// NN_TRAIN_TILE train samples and each query keeps the closest samples seen
+/// so far in a bounded heap, so the memory used is independent of the number
+/// of train samples. Blocks of queries are split between the threads of the
+/// thread pool. Samples at the same distance are ordered by their index.
 template<typename T, typename To, af_match_type dist_type>
-void nearest_neighbour(Param<To> dists, CParam<T> query, CParam<T> train,
-                       const uint dist_dim) {
-    uint sample_dim  = (dist_dim == 0) ? 1 : 0;
-    const dim4 qDims = query.dims();
-    const dim4 tDims = train.dims();
-
-    const unsigned distLength = qDims[dist_dim];
-    const unsigned nQuery     = qDims[sample_dim];
-    const unsigned nTrain     = tDims[sample_dim];
-
-    const T* qPtr = query.get();
-    const T* tPtr = train.get();
-    To* dPtr      = dists.get();
-
-    dist_op<T, To, dist_type> op;
-
-    for (unsigned i = 0; i < nQuery; i++) {
-        for (unsigned j = 0; j < nTrain; j++) {
-            To local_dist = 0;
-            for (unsigned k = 0; k < distLength; k++) {
-                size_t qIdx, tIdx;
-                if (sample_dim == 0) {
-                    qIdx = k * qDims[0] + i;
-                    tIdx = k * tDims[0] + j;
+void nearest_neighbour(Param<uint> idx, Param<To> dist, CParam<T> query,
+                       CParam<T> train, const uint dist_dim,
+                       const uint n_dist) {
+    const uint sample_dim = (dist_dim == 0) ? 1 : 0;
+    const af::dim4 qDims  = query.dims();
+    const af::dim4 tDims  = train.dims();
+
+    const dim_t distLength = qDims[dist_dim];
+    const dim_t nQuery     = qDims[sample_dim];
+    const dim_t nTrain     = tDims[sample_dim];
+    const dim_t qStride    = query.strides()[1];
+    const dim_t tStride    = train.strides()[1];
+
+    const T *qPtr = query.get();
+    const T *tPtr = train.get();
+    uint *iPtr    = idx.get();
+    To *dPtr      = dist.get();
+
+    const dim_t grain =
+        std::max(dim_t(1), NN_GRAIN / std::max(dim_t(1), nTrain * distLength));
+
+    parallel_for(0, nQuery, grain, [&](dim_t qBegin, dim_t qEnd) {
+        std::vector<To> tile(NN_QUERY_TILE * NN_TRAIN_TILE);
+        std::vector<BoundedHeap<To>> heaps(NN_QUERY_TILE,
+                                           BoundedHeap<To>(n_dist));
+        dist_op<T, To, dist_type> op;
+        contiguous_dist<T, To, dist_type> cdist;
+
+        for (dim_t q0 = qBegin; q0 < qEnd; q0 += NN_QUERY_TILE) {
+            const dim_t nq = std::min(NN_QUERY_TILE, qEnd - q0);
+            for (dim_t i = 0; i < nq; ++i) { heaps[i].clear(); }
+
+            for (dim_t t0 = 0; t0 < nTrain; t0 += NN_TRAIN_TILE) {
+                const dim_t nt = std::min(NN_TRAIN_TILE, nTrain - t0);
+
+                if (sample_dim == 1) {
+                    // The features of every sample are contiguous
+                    for (dim_t i = 0; i < nq; ++i) {
+                        const T *q = qPtr + (q0 + i) * qStride;
+                        To *d      = tile.data() + i * NN_TRAIN_TILE;
+                        for (dim_t j = 0; j < nt; ++j) {
+                            d[j] = cdist(q, tPtr + (t0 + j) * tStride,
+                                         distLength);
+                        }
+                    }
                 } else {
-                    qIdx = i * qDims[0] + k;
-                    tIdx = j * tDims[0] + k;
+                    // The samples are contiguous, so each feature is
+                    // accumulated over the whole tile of train samples
+                    for (dim_t i = 0; i < nq; ++i) {
+                        To *d = tile.data() + i * NN_TRAIN_TILE;
+                        std::fill(d, d + nt, To(0));
+                        for (dim_t k = 0; k < distLength; ++k) {
+                            const T qv  = qPtr[k * qStride + q0 + i];
+                            const T *tk = tPtr + k * tStride + t0;
+                            for (dim_t j = 0; j < nt; ++j) {
+                                d[j] += op(qv, tk[j]);
+                            }
+                        }
+                    }
                 }
 
-                local_dist += op(qPtr[qIdx], tPtr[tIdx]);
+                for (dim_t i = 0; i < nq; ++i) {
+                    const To *d = tile.data() + i * NN_TRAIN_TILE;
+                    for (dim_t j = 0; j < nt; ++j) {
+                        heaps[i].push(d[j], static_cast<uint>(t0 + j));
+                    }
+                }
             }
 
-            dPtr[i * nTrain + j] = local_dist;
+            for (dim_t i = 0; i < nq; ++i) {
+                const auto &best = heaps[i].sorted();
+                uint *iOut       = iPtr + (q0 + i) * idx.strides()[1];
+                To *dOut         = dPtr + (q0 + i) * dist.strides()[1];
+                for (size_t r = 0; r < best.size(); ++r) {
+                    dOut[r] = best[r].first;
+                    iOut[r] = best[r].second;
+                }
+            }
         }
-    }
+    });
 }
 
 }  // namespace kernel
@@ -0,0 +1,395 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+#include <common/dispatch.hpp>
+#include <thread_pool.hpp>
+#include <af/dim4.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cpu {
+namespace kernel {
+
+/// Minimum number of elements sorted by a thread
+constexpr dim_t SORT_GRAIN = 65536;
+
+/// Columns shorter than this are merge sorted even if their keys can be
+/// radix sorted because clearing and scanning the histograms costs more than
+/// sorting the keys
+constexpr dim_t RADIX_MIN_ELEMENTS = 256;
+
+/// Number of bits of the keys sorted by each pass of the radix sort
+constexpr int RADIX_BITS    = 8;
+constexpr int RADIX_BUCKETS = 1 << RADIX_BITS;
+
+/// Length of the runs which are insertion sorted before they are merged
+constexpr dim_t MERGE_RUN = 16;
+
+/// Maps keys to unsigned integers with the same order so that the keys can
+/// be radix sorted. Only the integral and floating point types have a map.
+template<typename T, typename Enable = void>
+struct RadixKey {
+    static constexpr bool value = false;
+};
+
+template<typename T>
+struct RadixKey<T, typename std::enable_if<std::is_integral<T>::value>::type> {
+    static constexpr bool value = true;
+    using type                  = typename std::make_unsigned<T>::type;
+
+    // Flipping the sign bit moves the negative numbers before the positive
+    static constexpr type flip =
+        std::is_signed<T>::value ? type(type(1) << (8 * sizeof(T) - 1))
+                                 : type(0);
+
+    static type encode(T val) { return type(type(val) ^ flip); }
+    static T decode(type bits) { return T(type(bits ^ flip)); }
+    static bool isNegativeZero(T) { return false; }
+};
+
+template<typename T>
+struct RadixKey<
+    T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static constexpr bool value = sizeof(T) == 4 || sizeof(T) == 8;
+    using type = typename std::conditional<sizeof(T) == 4, uint32_t,
+                                           uint64_t>::type;
+
+    static constexpr type sign = type(1) << (8 * sizeof(T) - 1);
+
+    // All the bits of the negative numbers are flipped so that the larger
+    // magnitudes come first. -0.0 compares equal to 0.0 and gets its key.
+    static type encode(T val) {
+        type bits;
+        if (val == T(0)) { val = T(0); }
+        std::memcpy(&bits, &val, sizeof(T));
+        return (bits & sign) ? type(~bits) : type(bits | sign);
+    }
+
+    static T decode(type bits) {
+        bits = (bits & sign) ? type(bits ^ sign) : type(~bits);
+        T val;
+        std::memcpy(&val, &bits, sizeof(T));
+        return val;
+    }
+
+    static bool isNegativeZero(T val) {
+        return val == T(0) && std::signbit(val);
+    }
+};
+
+/// Calls \p func with every thread index in [0, \p nthreads) on the thread
+/// pool, or on the calling thread if \p nthreads is one
+inline void runThreads(int nthreads, const std::function<void(int)> &func) {
+    if (nthreads == 1) {
+        func(0);
+    } else {
+        getThreadPool().run(nthreads, func);
+    }
+}
+
+/// Stable LSD radix sort of \p n keys and the values in \p vals, which can be
+/// null. Every thread histograms and scatters a contiguous block of the keys
+/// and the blocks are scattered in order, which keeps the sort stable.
+template<typename Tk, typename Tv>
+void radixSort(Tk *keys, Tv *vals, dim_t n, bool isAscending, int nthreads) {
+    using Radix = RadixKey<Tk>;
+    using U     = typename Radix::type;
+
+    constexpr int passes = 8 * sizeof(U) / RADIX_BITS;
+    const U order        = isAscending ? U(0) : U(~U(0));
+    const dim_t block    = divup(n, nthreads);
+
+    std::vector<U> ubuf(2 * n);
+    std::vector<Tv> vbuf(vals ? n : 0);
+    U *usrc  = ubuf.data();
+    U *udst  = usrc + n;
+    Tv *vsrc = vals;
+    Tv *vdst = vbuf.data();
+
+    // Descending keys are sorted as ascending keys with all the bits flipped
+    std::vector<char> negzero(nthreads, 0);
+    runThreads(nthreads, [&](int t) {
+        const dim_t end = std::min(n, (t + 1) * block);
+        for (dim_t i = t * block; i < end; ++i) {
+            usrc[i] = U(Radix::encode(keys[i]) ^ order);
+            negzero[t] |= Radix::isNegativeZero(keys[i]);
+        }
+    });
+
+    // The zeros are decoded as 0.0, so their signs are restored in the order
+    // of the stable sort afterwards
+    std::vector<Tk> zeros;
+    if (std::find(negzero.begin(), negzero.end(), 1) != negzero.end()) {
+        std::copy_if(keys, keys + n, std::back_inserter(zeros),
+                     [](Tk key) { return key == Tk(0); });
+    }
+
+    std::vector<std::array<dim_t, RADIX_BUCKETS>> offsets(nthreads);
+    for (int pass = 0; pass < passes; ++pass) {
+        const int shift = pass * RADIX_BITS;
+        auto digit      = [shift](U bits) {
+            return static_cast<int>((bits >> shift) & (RADIX_BUCKETS - 1));
+        };
+
+        runThreads(nthreads, [&](int t) {
+            auto &count     = offsets[t];
+            const dim_t end = std::min(n, (t + 1) * block);
+            count.fill(0);
+            for (dim_t i = t * block; i < end; ++i) { count[digit(usrc[i])]++; }
+        });
+
+        // The pass does not move the keys if they all have the same digit
+        bool skip    = false;
+        dim_t offset = 0;
+        for (int d = 0; d < RADIX_BUCKETS; ++d) {
+            dim_t total = 0;
+            for (int t = 0; t < nthreads; ++t) {
+                const dim_t count = offsets[t][d];
+                offsets[t][d]     = offset + total;
+                total += count;
+            }
+            skip |= (total == n);
+            offset += total;
+        }
+        if (skip) { continue; }
+
+        runThreads(nthreads, [&](int t) {
+            auto &next      = offsets[t];
+            const dim_t end = std::min(n, (t + 1) * block);
+            if (vsrc) {
+                for (dim_t i = t * block; i < end; ++i) {
+                    const dim_t pos = next[digit(usrc[i])]++;
+                    udst[pos]       = usrc[i];
+                    vdst[pos]       = vsrc[i];
+                }
+            } else {
+                for (dim_t i = t * block; i < end; ++i) {
+                    udst[next[digit(usrc[i])]++] = usrc[i];
+                }
+            }
+        });
+        std::swap(usrc, udst);
+        std::swap(vsrc, vdst);
+    }
+
+    runThreads(nthreads, [&](int t) {
+        const dim_t begin = std::min(n, t * block);
+        const dim_t end   = std::min(n, (t + 1) * block);
+        for (dim_t i = begin; i < end; ++i) {
+            keys[i] = Radix::decode(U(usrc[i] ^ order));
+        }
+        if (vsrc != vals) { std::copy(vsrc + begin, vsrc + end, vals + begin); }
+    });
+
+    if (!zeros.empty()) {
+        Tk *zero = std::find(keys, keys + n, Tk(0));
+        std::copy(zeros.begin(), zeros.end(), zero);
+    }
+}
+
+/// Returns the number of elements of \p a which are among the first \p k
+/// elements of the stable merge of \p a and \p b
+template<typename Tk, typename Compare>
+dim_t mergeSplit(const Tk *a, dim_t na, const Tk *b, dim_t nb, dim_t k,
+                 Compare comp) {
+    dim_t lo = std::max(dim_t(0), k - nb);
+    dim_t hi = std::min(k, na);
+    while (lo < hi) {
+        const dim_t i = lo + (hi - lo) / 2;
+        const dim_t j = k - i;
+        // a[i] is merged before b[j - 1] unless b[j - 1] is smaller
+        if (i < na && j > 0 && !comp(b[j - 1], a[i])) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+    return lo;
+}
+
+/// Stable merge of the first \p len elements of the merge of [a, a + na) and
+/// [b, b + nb), starting after \p ia elements of a and \p ib elements of b
+template<typename Tk, typename Tv, typename Compare>
+void mergeRange(const Tk *ak, const Tv *av, dim_t na, const Tk *bk,
+                const Tv *bv, dim_t nb, dim_t ia, dim_t ib, dim_t len,
+                Tk *ok, Tv *ov, Compare comp) {
+    for (dim_t o = 0; o < len; ++o) {
+        const bool fromB = ia == na || (ib < nb && comp(bk[ib], ak[ia]));
+        if (fromB) {
+            ok[o] = bk[ib];
+            if (ov) { ov[o] = bv[ib]; }
+            ++ib;
+        } else {
+            ok[o] = ak[ia];
+            if (ov) { ov[o] = av[ia]; }
+            ++ia;
+        }
+    }
+}
+
+/// Stable merge sort of \p n keys and the values in \p vals, which can be
+/// null. Short runs are insertion sorted and then merged in pairs. Each merge
+/// is split between the threads with mergeSplit when there are fewer pairs
+/// than threads.
+template<typename Tk, typename Tv, typename Compare>
+void mergeSort(Tk *keys, Tv *vals, dim_t n, Compare comp, int nthreads) {
+    const dim_t nruns = divup(n, MERGE_RUN);
+    const dim_t block = divup(nruns, dim_t(nthreads));
+    runThreads(nthreads, [&](int t) {
+        const dim_t end = std::min(nruns, (t + 1) * block);
+        for (dim_t r = t * block; r < end; ++r) {
+            const dim_t first = r * MERGE_RUN;
+            const dim_t last  = std::min(n, first + MERGE_RUN);
+            for (dim_t i = first + 1; i < last; ++i) {
+                Tk key = keys[i];
+                Tv val = vals ? vals[i] : Tv();
+                dim_t j = i;
+                for (; j > first && comp(key, keys[j - 1]); --j) {
+                    keys[j] = keys[j - 1];
+                    if (vals) { vals[j] = vals[j - 1]; }
+                }
+                keys[j] = key;
+                if (vals) { vals[j] = val; }
+            }
+        }
+    });
+    if (nruns == 1) { return; }
+
+    std::vector<Tk> kbuf(n);
+    std::vector<Tv> vbuf(vals ? n : 0);
+    Tk *ksrc = keys;
+    Tv *vsrc = vals;
+    Tk *kdst = kbuf.data();
+    Tv *vdst = vals ? vbuf.data() : nullptr;
+
+    for (dim_t width = MERGE_RUN; width < n; width *= 2) {
+        const dim_t npairs = divup(n, 2 * width);
+        const dim_t pieces = std::max(dim_t(1), nthreads / npairs);
+        const dim_t ntasks = npairs * pieces;
+
+        auto task = [&](dim_t item) {
+            const dim_t pair  = item / pieces;
+            const dim_t piece = item % pieces;
+            const dim_t first = pair * 2 * width;
+            const dim_t na    = std::min(width, n - first);
+            const dim_t nb    = std::min(width, n - first - na);
+            const dim_t total = na + nb;
+            const dim_t len   = divup(total, pieces);
+            const dim_t begin = std::min(total, piece * len);
+            const dim_t end   = std::min(total, begin + len);
+
+            const Tk *ak = ksrc + first;
+            const Tk *bk = ak + na;
+            const Tv *av = vsrc ? vsrc + first : nullptr;
+            const Tv *bv = vsrc ? av + na : nullptr;
+
+            const dim_t ia = mergeSplit(ak, na, bk, nb, begin, comp);
+            mergeRange(ak, av, na, bk, bv, nb, ia, begin - ia, end - begin,
+                       kdst + first + begin,
+                       vdst ? vdst + first + begin : nullptr, comp);
+        };
+
+        if (nthreads == 1) {
+            for (dim_t item = 0; item < ntasks; ++item) { task(item); }
+        } else {
+            parallel_for(0, ntasks, 1, [&](dim_t b, dim_t e) {
+                for (dim_t item = b; item < e; ++item) { task(item); }
+            });
+        }
+        std::swap(ksrc, kdst);
+        std::swap(vsrc, vdst);
+    }
+
+    if (ksrc != keys) {
+        std::copy(ksrc, ksrc + n, keys);
+        if (vals) { std::copy(vsrc, vsrc + n, vals); }
+    }
+}
+
+template<typename Tk, typename Tv>
+void sortColumn(Tk *keys, Tv *vals, dim_t n, bool isAscending, int nthreads,
+                std::false_type) {
+    if (isAscending) {
+        mergeSort(keys, vals, n, std::less<Tk>(), nthreads);
+    } else {
+        mergeSort(keys, vals, n, std::greater<Tk>(), nthreads);
+    }
+}
+
+template<typename Tk, typename Tv>
+void sortColumn(Tk *keys, Tv *vals, dim_t n, bool isAscending, int nthreads,
+                std::true_type) {
+    if (n >= RADIX_MIN_ELEMENTS) {
+        radixSort(keys, vals, n, isAscending, nthreads);
+    } else {
+        sortColumn(keys, vals, n, isAscending, 1, std::false_type());
+    }
+}
+
+/// Stable sort of the \p n keys in \p keys and the values in \p vals, which
+/// can be null, on \p nthreads threads. The keys of the integral and floating
+/// point types are radix sorted and the others are merge sorted.
+template<typename Tk, typename Tv>
+void sortColumn(Tk *keys, Tv *vals, dim_t n, bool isAscending, int nthreads) {
+    if (n < 2) { return; }
+    sortColumn(keys, vals, n, isAscending, nthreads,
+               std::integral_constant<bool, RadixKey<Tk>::value>());
+}
+
+/// Sorts every column of \p keys along dimension 0 and moves the values in
+/// \p vals, which can be null, with their keys
+///
+/// Batches of columns are split between the threads of the thread pool. If
+/// there are fewer columns than threads, each column is sorted by all the
+/// threads one after the other.
+template<typename Tk, typename Tv>
+void sortColumns(Tk *keys, const af::dim4 &kstrides, Tv *vals,
+                 const af::dim4 &vstrides, const af::dim4 &dims,
+                 bool isAscending) {
+    const dim_t n     = dims[0];
+    const dim_t ncols = dims[1] * dims[2] * dims[3];
+    if (n < 2 || ncols == 0) { return; }
+
+    auto sortCol = [&](dim_t col, int nthreads) {
+        const dim_t y = col % dims[1];
+        const dim_t z = (col / dims[1]) % dims[2];
+        const dim_t w = col / (dims[1] * dims[2]);
+        Tk *kptr = keys + y * kstrides[1] + z * kstrides[2] + w * kstrides[3];
+        Tv *vptr = vals ? vals + y * vstrides[1] + z * vstrides[2] +
+                              w * vstrides[3]
+                        : nullptr;
+        sortColumn(kptr, vptr, n, isAscending, nthreads);
+    };
+
+    const dim_t nthreads = std::min(static_cast<dim_t>(getThreadPool().size()),
+                                    n / SORT_GRAIN);
+    if (ncols >= nthreads || nthreads <= 1) {
+        const dim_t grain = std::max(dim_t(1), SORT_GRAIN / n);
+        parallel_for(0, ncols, grain, [&](dim_t begin, dim_t end) {
+            for (dim_t col = begin; col < end; ++col) { sortCol(col, 1); }
+        });
+    } else {
+        for (dim_t col = 0; col < ncols; ++col) {
+            sortCol(col, static_cast<int>(nthreads));
+        }
+    }
+}
+
+}  // namespace kernel
+}  // namespace cpu
@@ -9,56 +9,222 @@
 
 #pragma once
 #include <Param.hpp>
+#include <common/dispatch.hpp>
 #include <common/half.hpp>
 #include <ops.hpp>
+#include <thread_pool.hpp>
+
+#include <algorithm>
+#include <array>
+#include <vector>
 
 namespace cpu {
 namespace kernel {
 
-template<af_op_t op, typename Ti, typename To, int D>
-struct reduce_dim {
-    void operator()(Param<To> out, const dim_t outOffset, CParam<Ti> in,
-                    const dim_t inOffset, const int dim, bool change_nan,
-                    double nanval) {
-        static const int D1 = D - 1;
-        reduce_dim<op, Ti, To, D1> reduce_dim_next;
+/// Minimum number of input elements reduced by a thread
+constexpr dim_t REDUCE_GRAIN = 32768;
 
-        const af::dim4 ostrides = out.strides();
-        const af::dim4 istrides = in.strides();
-        const af::dim4 odims    = out.dims();
+/// Number of independent accumulators used to reduce a contiguous row
+constexpr int REDUCE_LANES = 8;
 
-        for (dim_t i = 0; i < odims[D1]; i++) {
-            reduce_dim_next(out, outOffset + i * ostrides[D1], in,
-                            inOffset + i * istrides[D1], dim, change_nan,
-                            nanval);
-        }
+/// Number of elements along dimension 0 which are accumulated together when
+/// reducing along one of the other dimensions
+constexpr dim_t REDUCE_TILE = 512;
+
+/// Returns the dimensions other than \p dim in increasing order
+inline std::array<int, 3> otherDims(const int dim) {
+    std::array<int, 3> dims;
+    for (int i = 0, j = 0; i < 4; i++) {
+        if (i != dim) { dims[j++] = i; }
+    }
+    return dims;
+}
+
+template<af_op_t op, typename Ti, typename To, bool change_nan>
+struct reduce_op {
+    using Tc = compute_t<To>;
+    Transform<data_t<Ti>, Tc, op> transform;
+    Binary<Tc, op> reduce;
+    double nanval;
+
+    explicit reduce_op(double nanval) : nanval(nanval) {}
+
+    Tc operator()(data_t<Ti> in, Tc acc) {
+        Tc in_val = transform(in);
+        if (change_nan) { in_val = IS_NAN(in_val) ? nanval : in_val; }
+        return reduce(in_val, acc);
     }
 };
 
-template<af_op_t op, typename Ti, typename To>
-struct reduce_dim<op, Ti, To, 0> {
-    Transform<data_t<Ti>, compute_t<To>, op> transform;
-    Binary<compute_t<To>, op> reduce;
-    void operator()(Param<To> out, const dim_t outOffset, CParam<Ti> in,
-                    const dim_t inOffset, const int dim, bool change_nan,
-                    double nanval) {
-        const af::dim4 istrides = in.strides();
-        const af::dim4 idims    = in.dims();
-
-        data_t<To> *const outPtr      = out.get() + outOffset;
-        data_t<Ti> const *const inPtr = in.get() + inOffset;
-        dim_t stride                  = istrides[dim];
-
-        compute_t<To> out_val = Binary<compute_t<To>, op>::init();
-        for (dim_t i = 0; i < idims[dim]; i++) {
-            compute_t<To> in_val = transform(inPtr[i * stride]);
-            if (change_nan) in_val = IS_NAN(in_val) ? nanval : in_val;
-            out_val = reduce(in_val, out_val);
+/// Reduces \p n elements of \p in which are \p stride elements apart.
+/// Consecutive elements are reduced into separate accumulators so the loop
+/// is not limited by the latency of the reduction operation.
+template<af_op_t op, typename Ti, typename To, bool change_nan>
+compute_t<To> reduce_row(const data_t<Ti> *in, const dim_t n,
+                         const dim_t stride, double nanval) {
+    using Tc = compute_t<To>;
+    reduce_op<op, Ti, To, change_nan> rop(nanval);
+
+    Tc acc[REDUCE_LANES];
+    std::fill(acc, acc + REDUCE_LANES, Binary<Tc, op>::init());
+
+    dim_t i = 0;
+    for (; i + REDUCE_LANES <= n; i += REDUCE_LANES) {
+        for (int l = 0; l < REDUCE_LANES; l++) {
+            acc[l] = rop(in[(i + l) * stride], acc[l]);
         }
+    }
+    for (; i < n; i++) { acc[0] = rop(in[i * stride], acc[0]); }
 
-        *outPtr = data_t<To>(out_val);
+    Tc out_val = acc[0];
+    for (int l = 1; l < REDUCE_LANES; l++) {
+        out_val = rop.reduce(acc[l], out_val);
     }
-};
+    return out_val;
+}
+
+/// Reduces each row along \p dim separately. Rows are split between the
+/// threads when there are fewer rows than threads.
+template<af_op_t op, typename Ti, typename To, bool change_nan>
+void reduce_dim_rows(Param<To> out, CParam<Ti> in, const int dim,
+                     double nanval) {
+    using Tc                    = compute_t<To>;
+    const af::dim4 odims        = out.dims();
+    const af::dim4 ostrides     = out.strides();
+    const af::dim4 istrides     = in.strides();
+    const std::array<int, 3> od = otherDims(dim);
+
+    const dim_t n      = in.dims(dim);
+    const dim_t stride = istrides[dim];
+    const dim_t nrows  = odims[od[0]] * odims[od[1]] * odims[od[2]];
+
+    const dim_t nthreads = getThreadPool().size();
+    dim_t nchunks        = 1;
+    if (nrows < nthreads) {
+        nchunks = std::max(dim_t(1), std::min(divup(nthreads, nrows),
+                                              n / REDUCE_GRAIN));
+    }
+    const dim_t chunk = divup(n, nchunks);
+
+    auto offset = [&](dim_t r, const af::dim4 &strides) {
+        const dim_t i0 = r % odims[od[0]];
+        r /= odims[od[0]];
+        const dim_t i1 = r % odims[od[1]];
+        const dim_t i2 = r / odims[od[1]];
+        return i0 * strides[od[0]] + i1 * strides[od[1]] +
+               i2 * strides[od[2]];
+    };
+
+    const data_t<Ti> *const inPtr = in.get();
+    data_t<To> *const outPtr      = out.get();
+    std::vector<Tc> partials(nchunks > 1 ? nrows * nchunks : 0);
+
+    const dim_t grain =
+        std::max(dim_t(1), REDUCE_GRAIN / std::max(chunk, dim_t(1)));
+    parallel_for(0, nrows * nchunks, grain, [&](dim_t begin, dim_t end) {
+        for (dim_t item = begin; item < end; item++) {
+            const dim_t r     = item / nchunks;
+            const dim_t first = (item % nchunks) * chunk;
+            const dim_t len   = std::min(n, first + chunk) - first;
+
+            Tc val = reduce_row<op, Ti, To, change_nan>(
+                inPtr + offset(r, istrides) + first * stride, len, stride,
+                nanval);
+            if (nchunks > 1) {
+                partials[item] = val;
+            } else {
+                outPtr[offset(r, ostrides)] = data_t<To>(val);
+            }
+        }
+    });
+
+    if (nchunks > 1) {
+        Binary<Tc, op> reduce;
+        for (dim_t r = 0; r < nrows; r++) {
+            Tc val = partials[r * nchunks];
+            for (dim_t c = 1; c < nchunks; c++) {
+                val = reduce(partials[r * nchunks + c], val);
+            }
+            outPtr[offset(r, ostrides)] = data_t<To>(val);
+        }
+    }
+}
+
+/// Reduces along \p dim > 0 by sweeping over tiles of contiguous elements
+/// along dimension 0 so that the input is read in memory order and every
+/// element of a tile has its own accumulator.
+template<af_op_t op, typename Ti, typename To, bool change_nan,
+         bool contiguous>
+void reduce_dim_tiles(Param<To> out, CParam<Ti> in, const int dim,
+                      double nanval) {
+    using Tc                    = compute_t<To>;
+    const af::dim4 odims        = out.dims();
+    const af::dim4 ostrides     = out.strides();
+    const af::dim4 istrides     = in.strides();
+    const std::array<int, 3> od = otherDims(dim);
+
+    const dim_t n      = in.dims(dim);
+    const dim_t n0     = odims[0];
+    const dim_t is0    = contiguous ? 1 : istrides[0];
+    const dim_t ntiles = divup(n0, REDUCE_TILE);
+    const dim_t nitems = ntiles * odims[od[1]] * odims[od[2]];
+
+    const data_t<Ti> *const inPtr = in.get();
+    data_t<To> *const outPtr      = out.get();
+
+    const dim_t tile  = std::min(n0, REDUCE_TILE);
+    const dim_t grain = std::max(dim_t(1), REDUCE_GRAIN / (tile * n));
+    parallel_for(0, nitems, grain, [&](dim_t begin, dim_t end) {
+        reduce_op<op, Ti, To, change_nan> rop(nanval);
+        Tc acc[REDUCE_TILE];
+        for (dim_t item = begin; item < end; item++) {
+            const dim_t first = (item % ntiles) * REDUCE_TILE;
+            const dim_t len   = std::min(n0, first + REDUCE_TILE) - first;
+            const dim_t r     = item / ntiles;
+            const dim_t i1    = r % odims[od[1]];
+            const dim_t i2    = r / odims[od[1]];
+
+            const data_t<Ti> *iptr = inPtr + i1 * istrides[od[1]] +
+                                     i2 * istrides[od[2]] + first * is0;
+            std::fill(acc, acc + len, Binary<Tc, op>::init());
+            for (dim_t j = 0; j < n; j++) {
+                const data_t<Ti> *row = iptr + j * istrides[dim];
+                for (dim_t i = 0; i < len; i++) {
+                    acc[i] = rop(row[i * is0], acc[i]);
+                }
+            }
+
+            data_t<To> *optr = outPtr + i1 * ostrides[od[1]] +
+                               i2 * ostrides[od[2]] + first * ostrides[0];
+            for (dim_t i = 0; i < len; i++) {
+                optr[i * ostrides[0]] = data_t<To>(acc[i]);
+            }
+        }
+    });
+}
+
+template<af_op_t op, typename Ti, typename To, bool change_nan>
+void reduce_dim_impl(Param<To> out, CParam<Ti> in, const int dim,
+                     double nanval) {
+    if (dim == 0 || in.dims(0) == 1) {
+        reduce_dim_rows<op, Ti, To, change_nan>(out, in, dim, nanval);
+    } else if (in.strides(0) == 1) {
+        reduce_dim_tiles<op, Ti, To, change_nan, true>(out, in, dim, nanval);
+    } else {
+        reduce_dim_tiles<op, Ti, To, change_nan, false>(out, in, dim, nanval);
+    }
+}
+
+/// Reduces \p in along \p dim using all the threads of the ThreadPool
+template<af_op_t op, typename Ti, typename To>
+void reduce_dim(Param<To> out, CParam<Ti> in, const int dim, bool change_nan,
+                double nanval) {
+    if (change_nan) {
+        reduce_dim_impl<op, Ti, To, true>(out, in, dim, nanval);
+    } else {
+        reduce_dim_impl<op, Ti, To, false>(out, in, dim, nanval);
+    }
+}
 
 template<typename Tk>
 void n_reduced_keys(Param<Tk> okeys, int *n_reduced, CParam<Tk> keys) {
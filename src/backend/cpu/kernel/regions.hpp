@@ -9,160 +9,209 @@
 
 #pragma once
 #include <Param.hpp>
-#include <memory.hpp>
-#include <map>
-#include <set>
+#include <common/dispatch.hpp>
+#include <thread_pool.hpp>
+
+#include <algorithm>
+#include <vector>
 
 namespace cpu {
 namespace kernel {
 
-template<typename T>
-class LabelNode {
-   private:
-    T label;
-    T minLabel;
-    unsigned rank;
-    LabelNode* parent;
-
-   public:
-    LabelNode() : label(0), minLabel(0), rank(0), parent(this) {}
-    LabelNode(T label) : label(label), minLabel(label), rank(0), parent(this) {}
-
-    T getLabel() { return label; }
-
-    T getMinLabel() { return minLabel; }
-
-    LabelNode* getParent() { return parent; }
-
-    unsigned getRank() { return rank; }
-
-    void setMinLabel(T l) { minLabel = l; }
-
-    void setParent(LabelNode* p) { parent = p; }
+/// Minimum number of pixels labeled by a thread
+constexpr dim_t REGIONS_GRAIN = 65536;
 
-    void setRank(unsigned r) { rank = r; }
-};
+/// Provisional label of a pixel. Label 0 is the background.
+typedef unsigned RegionLabel;
 
-template<typename T>
-static LabelNode<T>* find(LabelNode<T>* x) {
-    if (x->getParent() != x) x->setParent(find(x->getParent()));
-    return x->getParent();
+/// Returns the root of the set containing \p l. Every label points to a
+/// smaller or equal label, so the root is the smallest label of its set.
+static inline RegionLabel findRoot(RegionLabel const* parent, RegionLabel l) {
+    while (parent[l] < l) { l = parent[l]; }
+    return l;
 }
 
-template<typename T>
-static void setUnion(LabelNode<T>* x, LabelNode<T>* y) {
-    LabelNode<T>* xRoot = find(x);
-    LabelNode<T>* yRoot = find(y);
-    if (xRoot == yRoot) return;
-
-    T xMinLabel = xRoot->getMinLabel();
-    T yMinLabel = yRoot->getMinLabel();
-    xRoot->setMinLabel(std::min(xMinLabel, yMinLabel));
-    yRoot->setMinLabel(std::min(xMinLabel, yMinLabel));
-
-    if (xRoot->getRank() < yRoot->getRank())
-        xRoot->setParent(yRoot);
-    else if (xRoot->getRank() > yRoot->getRank())
-        yRoot->setParent(xRoot);
-    else {
-        yRoot->setParent(xRoot);
-        xRoot->setRank(xRoot->getRank() + 1);
+/// Joins the sets containing \p a and \p b and returns the root of the
+/// result
+static inline RegionLabel mergeLabels(RegionLabel* parent, RegionLabel a,
+                                      RegionLabel b) {
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a < b) {
+        parent[b] = a;
+        return a;
     }
+    parent[a] = b;
+    return b;
 }
 
-template<typename T>
-void regions(Param<T> out, CParam<char> in, af_connectivity connectivity) {
-    const af::dim4 inDims = in.dims();
-    const char* inPtr     = in.get();
-    T* outPtr             = out.get();
-
-    // Map labels
-    typedef typename std::unique_ptr<LabelNode<T>> UnqLabelPtr;
-    typedef typename std::map<T, UnqLabelPtr> LabelMap;
-    typedef typename LabelMap::iterator LabelMapIterator;
-
-    LabelMap lmap;
-
-    // Initial label
-    T label = (T)1;
-
-    for (int j = 0; j < (int)inDims[1]; j++) {
-        for (int i = 0; i < (int)inDims[0]; i++) {
-            int idx = j * inDims[0] + i;
-            if (inPtr[idx] != 0) {
-                std::vector<T> l;
-
-                // Test neighbors
-                if (i > 0 && outPtr[j * (int)inDims[0] + i - 1] > 0)
-                    l.push_back(outPtr[j * inDims[0] + i - 1]);
-                if (j > 0 && outPtr[(j - 1) * (int)inDims[0] + i] > 0)
-                    l.push_back(outPtr[(j - 1) * inDims[0] + i]);
-                if (connectivity == AF_CONNECTIVITY_8 && i > 0 && j > 0 &&
-                    outPtr[(j - 1) * inDims[0] + i - 1] > 0)
-                    l.push_back(outPtr[(j - 1) * inDims[0] + i - 1]);
-                if (connectivity == AF_CONNECTIVITY_8 &&
-                    i < (int)inDims[0] - 1 && j > 0 &&
-                    outPtr[(j - 1) * inDims[0] + i + 1] != 0)
-                    l.push_back(outPtr[(j - 1) * inDims[0] + i + 1]);
-
-                if (!l.empty()) {
-                    T minl = l[0];
-                    for (size_t k = 0; k < l.size(); k++) {
-                        minl                        = std::min(l[k], minl);
-                        LabelMapIterator currentMap = lmap.find(l[k]);
-                        LabelNode<T>* node          = currentMap->second.get();
-                        // Group labels of the same region under a disjoint set
-                        for (size_t m = k + 1; m < l.size(); m++)
-                            setUnion(node, lmap.find(l[m])->second.get());
+/// Assigns provisional labels to the columns [\p begin, \p end) of an image
+/// with \p len rows
+///
+/// New labels are taken from \p next onwards and every label is linked to
+/// the labels of its already visited neighbours. The first column only
+/// looks at pixels above it; its left neighbours are joined by
+/// mergeColumns. Returns the next unused label.
+template<bool FullConnectivity>
+RegionLabel labelColumns(RegionLabel* labels, RegionLabel* parent,
+                         char const* in, dim_t len, dim_t stride, dim_t begin,
+                         dim_t end, RegionLabel next) {
+    for (dim_t j = begin; j < end; ++j) {
+        char const* col    = in + j * stride;
+        char const* left   = col - stride;
+        RegionLabel* lab   = labels + j * len;
+        RegionLabel* llab  = lab - len;
+        bool const hasLeft = j > begin;
+
+        for (dim_t i = 0; i < len; ++i) {
+            if (!col[i]) {
+                lab[i] = 0;
+                continue;
+            }
+
+            bool const up    = i > 0 && col[i - 1];
+            RegionLabel l    = up ? lab[i - 1] : 0;
+            auto const merge = [&](RegionLabel n) {
+                l = l == 0 ? n : (l == n ? l : mergeLabels(parent, l, n));
+            };
+
+            if (hasLeft) {
+                if (left[i]) {
+                    // With 8-connectivity the pixel above is a neighbour of
+                    // the left pixel and is already in its set
+                    if (FullConnectivity) {
+                        l = llab[i];
+                    } else {
+                        merge(llab[i]);
                     }
-                    // Set label to smallest neighbor label
-                    outPtr[idx] = minl;
-                } else {
-                    // Insert new label in map
-                    lmap.insert(std::make_pair(
-                        label, UnqLabelPtr(new LabelNode<T>(label))));
-                    outPtr[idx] = label++;
+                } else if (FullConnectivity) {
+                    // The pixel above already joined the upper left pixel
+                    if (!up && i > 0 && left[i - 1]) { merge(llab[i - 1]); }
+                    if (i + 1 < len && left[i + 1]) { merge(llab[i + 1]); }
                 }
             }
+
+            if (l == 0) {
+                l         = next++;
+                parent[l] = l;
+            }
+            lab[i] = l;
         }
     }
+    return next;
+}
 
-    std::set<T> removed;
-
-    for (int j = 0; j < (int)inDims[1]; j++) {
-        for (int i = 0; i < (int)inDims[0]; i++) {
-            int idx = j * (int)inDims[0] + i;
-            if (inPtr[idx] != 0) {
-                T l                         = outPtr[idx];
-                LabelMapIterator currentMap = lmap.find(l);
+/// Joins the labels of column \p j with the labels of the column on its
+/// left
+template<bool FullConnectivity>
+void mergeColumns(RegionLabel const* labels, RegionLabel* parent,
+                  char const* in, dim_t len, dim_t stride, dim_t j) {
+    char const* col         = in + j * stride;
+    char const* left        = col - stride;
+    RegionLabel const* lab  = labels + j * len;
+    RegionLabel const* llab = lab - len;
+
+    for (dim_t i = 0; i < len; ++i) {
+        if (!col[i]) { continue; }
+        if (left[i]) {
+            mergeLabels(parent, lab[i], llab[i]);
+        } else if (FullConnectivity) {
+            if (i > 0 && left[i - 1]) {
+                mergeLabels(parent, lab[i], llab[i - 1]);
+            }
+            if (i + 1 < len && left[i + 1]) {
+                mergeLabels(parent, lab[i], llab[i + 1]);
+            }
+        }
+    }
+}
 
-                if (currentMap != lmap.end()) {
-                    LabelNode<T>* node = currentMap->second.get();
+/// Labels the connected components of a single image
+///
+/// The columns are split into strips that are labeled in parallel with
+/// disjoint ranges of provisional labels. The sets of neighbouring strips
+/// are joined at their shared edges, and the roots are then numbered in
+/// increasing order. Labels increase in scan order, so the components are
+/// numbered in the order of their first pixel. \p stride and \p outStride
+/// are the column strides of \p in and \p out.
+template<typename T, bool FullConnectivity>
+void regionsImage(T* out, char const* in, dim_t len, dim_t ncols,
+                  dim_t stride, dim_t outStride) {
+    // A column has at most one new label for every two pixels
+    dim_t const colLabels = (len + 1) / 2;
+    std::vector<RegionLabel> labels(len * ncols);
+    std::vector<RegionLabel> parent(1 + colLabels * ncols, 0);
+
+    ThreadPool& pool = getThreadPool();
+    dim_t const nstrips =
+        std::max(dim_t(1), std::min(static_cast<dim_t>(pool.size()),
+                                    std::min(ncols, len * ncols /
+                                                        REGIONS_GRAIN)));
+    dim_t const stripCols = divup(ncols, nstrips);
+    std::vector<RegionLabel> ends(nstrips, 0);
+
+    auto stripBase = [&](dim_t strip) {
+        return static_cast<RegionLabel>(1 + strip * stripCols * colLabels);
+    };
+
+    parallel_for(0, nstrips, 1, [&](dim_t begin, dim_t end) {
+        for (dim_t strip = begin; strip < end; ++strip) {
+            dim_t const first = std::min(ncols, strip * stripCols);
+            ends[strip]       = labelColumns<FullConnectivity>(
+                labels.data(), parent.data(), in, len, stride, first,
+                std::min(ncols, first + stripCols), stripBase(strip));
+        }
+    });
 
-                    LabelNode<T>* nodeRoot = find(node);
-                    outPtr[idx]            = nodeRoot->getMinLabel();
+    for (dim_t strip = 1; strip < nstrips; ++strip) {
+        dim_t const first = strip * stripCols;
+        if (first >= ncols) { break; }
+        mergeColumns<FullConnectivity>(labels.data(), parent.data(), in, len,
+                                       stride, first);
+    }
 
-                    // Mark removed labels (those that are part of a region
-                    // that contains a smaller label)
-                    if (node->getMinLabel() < l || nodeRoot->getMinLabel() < l)
-                        removed.insert(l);
-                    if (node->getLabel() > node->getMinLabel())
-                        removed.insert(node->getLabel());
-                }
-            }
+    // Every label points to a smaller label, which is already numbered
+    RegionLabel count = 0;
+    for (dim_t strip = 0; strip < nstrips; ++strip) {
+        for (RegionLabel l = stripBase(strip); l < ends[strip]; ++l) {
+            parent[l] = parent[l] == l ? ++count : parent[parent[l]];
         }
     }
 
-    // Calculate final neighbors (ensure final labels are sequential)
-    for (int j = 0; j < (int)inDims[1]; j++) {
-        for (int i = 0; i < (int)inDims[0]; i++) {
-            int idx = j * (int)inDims[0] + i;
-            if (outPtr[idx] > 0) {
-                outPtr[idx] -=
-                    distance(removed.begin(), removed.lower_bound(outPtr[idx]));
+    parallel_for(0, ncols, divup(REGIONS_GRAIN, len), [&](dim_t begin,
+                                                          dim_t end) {
+        for (dim_t j = begin; j < end; ++j) {
+            RegionLabel const* lab = labels.data() + j * len;
+            T* col                 = out + j * outStride;
+            for (dim_t i = 0; i < len; ++i) {
+                col[i] = static_cast<T>(parent[lab[i]]);
             }
         }
-    }
+    });
+}
+
+template<typename T>
+void regions(Param<T> out, CParam<char> in, af_connectivity connectivity) {
+    af::dim4 const inDims   = in.dims();
+    af::dim4 const iStrides = in.strides();
+    af::dim4 const oStrides = out.strides();
+    dim_t const nimages     = inDims[2] * inDims[3];
+
+    auto labelImage =
+        connectivity == AF_CONNECTIVITY_8 ? regionsImage<T, true>
+                                          : regionsImage<T, false>;
+
+    // The images of a batch are labeled concurrently. A single image is split
+    // into strips instead.
+    parallel_for(0, nimages, 1, [&](dim_t begin, dim_t end) {
+        for (dim_t image = begin; image < end; ++image) {
+            dim_t const b2 = image % inDims[2];
+            dim_t const b3 = image / inDims[2];
+            labelImage(out.get() + b2 * oStrides[2] + b3 * oStrides[3],
+                       in.get() + b2 * iStrides[2] + b3 * iStrides[3],
+                       inDims[0], inDims[1], iStrides[1], oStrides[1]);
+        }
+    });
 }
 
 }  // namespace kernel
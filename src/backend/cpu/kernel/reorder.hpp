@@ -9,10 +9,23 @@
 
 #pragma once
 #include <Param.hpp>
+#include <kernel/transpose.hpp>
+#include <thread_pool.hpp>
+
+#include <algorithm>
 
 namespace cpu {
 namespace kernel {
 
+/// Minimum number of elements reordered by a thread
+constexpr dim_t REORDER_GRAIN = 65536;
+
+/// Reorders \p in into \p out
+///
+/// The loops are chosen so that the reads stay contiguous. When the first
+/// dimension is kept, whole rows are copied. Otherwise the output dimension
+/// that is contiguous in the input is transposed with the first output
+/// dimension, one pair of tiles at a time.
 template<typename T>
 void reorder(Param<T> out, CParam<T> in, const af::dim4 oDims,
              const af::dim4 rdims) {
@@ -22,28 +35,41 @@ void reorder(Param<T> out, CParam<T> in, const af::dim4 oDims,
     const af::dim4 ist = in.strides();
     const af::dim4 ost = out.strides();
 
-    dim_t ids[4] = {0};
-    for (dim_t ow = 0; ow < oDims[3]; ow++) {
-        const dim_t oW = ow * ost[3];
-        ids[rdims[3]]  = ow;
-        for (dim_t oz = 0; oz < oDims[2]; oz++) {
-            const dim_t oZW = oW + oz * ost[2];
-            ids[rdims[2]]   = oz;
-            for (dim_t oy = 0; oy < oDims[1]; oy++) {
-                const dim_t oYZW = oZW + oy * ost[1];
-                ids[rdims[1]]    = oy;
-                for (dim_t ox = 0; ox < oDims[0]; ox++) {
-                    const dim_t oIdx = oYZW + ox;
-
-                    ids[rdims[0]]    = ox;
-                    const dim_t iIdx = ids[3] * ist[3] + ids[2] * ist[2] +
-                                       ids[1] * ist[1] + ids[0];
-
-                    outPtr[oIdx] = inPtr[iIdx];
-                }
+    // Input strides along the output dimensions
+    af::dim4 rst;
+    for (int i = 0; i < 4; i++) { rst[i] = ist[rdims[i]]; }
+
+    if (rdims[0] == 0) {
+        const dim_t nrows = oDims[1] * oDims[2] * oDims[3];
+        const dim_t grain =
+            std::max(dim_t(1), REORDER_GRAIN / std::max(oDims[0], dim_t(1)));
+        parallel_for(0, nrows, grain, [&](dim_t begin, dim_t end) {
+            for (dim_t row = begin; row < end; row++) {
+                const dim_t oy = row % oDims[1];
+                const dim_t oz = (row / oDims[1]) % oDims[2];
+                const dim_t ow = row / (oDims[1] * oDims[2]);
+                const T* src =
+                    inPtr + ow * rst[3] + oz * rst[2] + oy * rst[1];
+                std::copy(src, src + oDims[0],
+                          outPtr + ow * ost[3] + oz * ost[2] + oy * ost[1]);
             }
-        }
+        });
+        return;
     }
+
+    int p = 1;
+    while (rdims[p] != 0) { p++; }
+    const int q = p == 1 ? 2 : 1;
+    const int r = p == 3 ? 2 : 3;
+
+    transposePlanes<T, false>(
+        outPtr, ost[p], inPtr, rst[0], oDims[0], oDims[p], oDims[q] * oDims[r],
+        [&](dim_t plane) {
+            return (plane % oDims[q]) * ost[q] + (plane / oDims[q]) * ost[r];
+        },
+        [&](dim_t plane) {
+            return (plane % oDims[q]) * rst[q] + (plane / oDims[q]) * rst[r];
+        });
 }
 
 }  // namespace kernel
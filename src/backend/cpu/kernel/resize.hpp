@@ -9,10 +9,15 @@
 
 #pragma once
 #include <Param.hpp>
-#include <common/complex.hpp>
+#include <kernel/interp.hpp>
 #include <math.hpp>
+#include <thread_pool.hpp>
 #include <af/traits.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 namespace cpu {
 namespace kernel {
 
@@ -27,129 +32,25 @@ namespace kernel {
  */
 dim_t round2int(float value) { return (dim_t)(value + 0.5f); }
 
-using std::conditional;
-using std::is_same;
-
-template<typename T>
-using wtype_t =
-    typename conditional<is_same<T, double>::value, double, float>::type;
-
-template<typename T>
-using vtype_t =
-    typename conditional<common::is_complex<T>::value, T, wtype_t<T>>::type;
-
-template<typename T, af_interp_type method>
-struct resize_op {
-    void operator()(T *outPtr, const T *inPtr, const af::dim4 &odims,
-                    const af::dim4 &idims, const af::dim4 &ostrides,
-                    const af::dim4 &istrides, const dim_t x, const dim_t y) {
-        UNUSED(outPtr);
-        UNUSED(inPtr);
-        UNUSED(odims);
-        UNUSED(idims);
-        UNUSED(ostrides);
-        UNUSED(istrides);
-        UNUSED(x);
-        UNUSED(y);
-        return;
-    }
-};
-
-template<typename T>
-struct resize_op<T, AF_INTERP_NEAREST> {
-    void operator()(T *outPtr, const T *inPtr, const af::dim4 &odims,
-                    const af::dim4 &idims, const af::dim4 &ostrides,
-                    const af::dim4 &istrides, const dim_t x, const dim_t y) {
-        // Compute Indices
-        dim_t i_x = round2int((float)x / (odims[0] / (float)idims[0]));
-        dim_t i_y = round2int((float)y / (odims[1] / (float)idims[1]));
-
-        if (i_x >= idims[0]) i_x = idims[0] - 1;
-        if (i_y >= idims[1]) i_y = idims[1] - 1;
-
-        dim_t i_off = i_y * istrides[1] + i_x;
-        dim_t o_off = y * ostrides[1] + x;
-        // Copy values from all channels
-        for (dim_t w = 0; w < odims[3]; w++) {
-            dim_t wost = w * ostrides[3];
-            dim_t wist = w * istrides[3];
-            for (dim_t z = 0; z < odims[2]; z++) {
-                outPtr[o_off + z * ostrides[2] + wost] =
-                    inPtr[i_off + z * istrides[2] + wist];
-            }
-        }
-    }
-};
-
-template<typename T>
-struct resize_op<T, AF_INTERP_BILINEAR> {
-    void operator()(T *outPtr, const T *inPtr, const af::dim4 &odims,
-                    const af::dim4 &idims, const af::dim4 &ostrides,
-                    const af::dim4 &istrides, const dim_t x, const dim_t y) {
-        // Compute Indices
-        float f_x = (float)x / (odims[0] / (float)idims[0]);
-        float f_y = (float)y / (odims[1] / (float)idims[1]);
-
-        dim_t i1_x = floor(f_x);
-        dim_t i1_y = floor(f_y);
-
-        if (i1_x >= idims[0]) i1_x = idims[0] - 1;
-        if (i1_y >= idims[1]) i1_y = idims[1] - 1;
-
-        float b = f_x - i1_x;
-        float a = f_y - i1_y;
-
-        dim_t i2_x = (i1_x + 1 >= idims[0] ? idims[0] - 1 : i1_x + 1);
-        dim_t i2_y = (i1_y + 1 >= idims[1] ? idims[1] - 1 : i1_y + 1);
-
-        typedef typename af::dtype_traits<T>::base_type BT;
-        typedef wtype_t<BT> WT;
-        typedef vtype_t<T> VT;
-
-        dim_t o_off = y * ostrides[1] + x;
-        // Copy values from all channels
-        for (dim_t w = 0; w < odims[3]; w++) {
-            dim_t wst = w * istrides[3];
-            for (dim_t z = 0; z < odims[2]; z++) {
-                dim_t zst         = z * istrides[2];
-                dim_t channel_off = zst + wst;
-                VT p1 = inPtr[i1_y * istrides[1] + i1_x + channel_off];
-                VT p2 = inPtr[i2_y * istrides[1] + i1_x + channel_off];
-                VT p3 = inPtr[i1_y * istrides[1] + i2_x + channel_off];
-                VT p4 = inPtr[i2_y * istrides[1] + i2_x + channel_off];
-
-                outPtr[o_off + z * ostrides[2] + w * ostrides[3]] =
-                    scalar<WT>((1.0f - a) * (1.0f - b)) * p1 +
-                    scalar<WT>((a) * (1.0f - b)) * p2 +
-                    scalar<WT>((1.0f - a) * (b)) * p3 +
-                    scalar<WT>((a) * (b)) * p4;
-            }
-        }
-    }
-};
-
-template<typename T>
-struct resize_op<T, AF_INTERP_LOWER> {
-    void operator()(T *outPtr, const T *inPtr, const af::dim4 &odims,
-                    const af::dim4 &idims, const af::dim4 &ostrides,
-                    const af::dim4 &istrides, const dim_t x, const dim_t y) {
-        // Compute Indices
-        dim_t i_x = floor((float)x / (odims[0] / (float)idims[0]));
-        dim_t i_y = floor((float)y / (odims[1] / (float)idims[1]));
-
-        if (i_x >= idims[0]) i_x = idims[0] - 1;
-        if (i_y >= idims[1]) i_y = idims[1] - 1;
-
-        dim_t i_off = i_y * istrides[1] + i_x;
-        dim_t o_off = y * ostrides[1] + x;
-        // Copy values from all channels
-        for (dim_t w = 0; w < odims[3]; w++) {
-            dim_t wost = w * ostrides[3];
-            dim_t wist = w * istrides[3];
-            for (dim_t z = 0; z < odims[2]; z++) {
-                outPtr[o_off + z * ostrides[2] + wost] =
-                    inPtr[i_off + z * istrides[2] + wist];
-            }
+/// Input coordinates of every output column or row. Resizing is separable,
+/// so the coordinates are computed once per column and once per row instead
+/// of once per output element.
+template<af_interp_type method>
+struct ResizeTable {
+    std::vector<dim_t> lo;
+    std::vector<dim_t> hi;
+    std::vector<float> frac;
+
+    ResizeTable(dim_t olen, dim_t ilen) : lo(olen), hi(olen), frac(olen) {
+        for (dim_t o = 0; o < olen; o++) {
+            float f = (float)o / (olen / (float)ilen);
+            dim_t i = (method == AF_INTERP_NEAREST ? round2int(f)
+                                                   : (dim_t)floor(f));
+            if (i >= ilen) i = ilen - 1;
+
+            lo[o]   = i;
+            hi[o]   = (i + 1 >= ilen ? ilen - 1 : i + 1);
+            frac[o] = f - i;
         }
     }
 };
@@ -163,12 +64,53 @@ void resize(Param<T> out, CParam<T> in) {
     af::dim4 ostrides = out.strides();
     af::dim4 istrides = in.strides();
 
-    resize_op<T, method> op;
-    for (dim_t y = 0; y < odims[1]; y++) {
-        for (dim_t x = 0; x < odims[0]; x++) {
-            op(outPtr, inPtr, odims, idims, ostrides, istrides, x, y);
+    typedef typename af::dtype_traits<T>::base_type BT;
+    typedef wtype_t<BT> WT;
+    typedef vtype_t<T> VT;
+
+    const ResizeTable<method> xt(odims[0], idims[0]);
+    const ResizeTable<method> yt(odims[1], idims[1]);
+
+    // Every output row of every channel is independent
+    const dim_t nrows = odims[1] * odims[2] * odims[3];
+    const dim_t grain =
+        std::max(dim_t(1), INTERP_GRAIN / std::max(odims[0], dim_t(1)));
+
+    parallel_for(0, nrows, grain, [&](dim_t begin, dim_t end) {
+        for (dim_t row = begin; row < end; row++) {
+            const dim_t y = row % odims[1];
+            const dim_t z = (row / odims[1]) % odims[2];
+            const dim_t w = row / (odims[1] * odims[2]);
+
+            const T *in_ = inPtr + z * istrides[2] + w * istrides[3];
+            T *o = outPtr + y * ostrides[1] + z * ostrides[2] + w * ostrides[3];
+
+            if (method != AF_INTERP_BILINEAR) {
+                const T *irow = in_ + yt.lo[y] * istrides[1];
+                for (dim_t x = 0; x < odims[0]; x++) { o[x] = irow[xt.lo[x]]; }
+                continue;
+            }
+
+            const T *irow1 = in_ + yt.lo[y] * istrides[1];
+            const T *irow2 = in_ + yt.hi[y] * istrides[1];
+            const float a  = yt.frac[y];
+            for (dim_t x = 0; x < odims[0]; x++) {
+                const dim_t i1_x = xt.lo[x];
+                const dim_t i2_x = xt.hi[x];
+                const float b    = xt.frac[x];
+
+                VT p1 = irow1[i1_x];
+                VT p2 = irow2[i1_x];
+                VT p3 = irow1[i2_x];
+                VT p4 = irow2[i2_x];
+
+                o[x] = scalar<WT>((1.0f - a) * (1.0f - b)) * p1 +
+                       scalar<WT>((a) * (1.0f - b)) * p2 +
+                       scalar<WT>((1.0f - a) * (b)) * p3 +
+                       scalar<WT>((a) * (b)) * p4;
+            }
         }
-    }
+    });
 }
 
 }  // namespace kernel
@@ -11,9 +11,12 @@
 #include <Param.hpp>
 #include <err_cpu.hpp>
 #include <math.hpp>
+#include <thread_pool.hpp>
 #include <af/traits.hpp>
 #include "interp.hpp"
 
+#include <algorithm>
+
 using af::dtype_traits;
 
 namespace cpu {
@@ -24,7 +27,7 @@ void rotate(Param<T> output, CParam<T> input, const float theta,
             af_interp_type method) {
     typedef typename dtype_traits<T>::base_type BT;
     typedef wtype_t<BT> WT;
-    Interp2<T, WT, order> interp;
+    InterpRow<T, WT, order> interpRow;
 
     const af::dim4 odims    = output.dims();
     const af::dim4 idims    = input.dims();
@@ -51,40 +54,48 @@ void rotate(Param<T> output, CParam<T> input, const float theta,
     };
 
     int nimages = odims[2];
-    T *out      = output.get();
-
-    for (int idw = 0; idw < (int)odims[3]; idw++) {
-        int out_offw = idw * ostrides[3];
-        int in_offw  = idw * istrides[3];
-
-        // Do transform for image
-        for (int idy = 0; idy < (int)odims[1]; idy++) {
-            for (int idx = 0; idx < (int)odims[0]; idx++) {
-                WT xidi = idx * tmat[0] + idy * tmat[1] + tmat[2];
-                WT yidi = idx * tmat[3] + idy * tmat[4] + tmat[5];
-
-                // Special conditions to deal with boundaries for bilinear and
-                // bicubic
-                // FIXME: Ideally this condition should be removed or be present
-                // for all methods But tests are expecting a different behavior
-                // for bilinear and nearest
-                bool condX = xidi >= -0.0001 && xidi < idims[0];
-                bool condY = yidi >= -0.0001 && yidi < idims[1];
-                int ooff   = out_offw + idy * ostrides[1] + idx;
-                if (order == 1 || (condX && condY)) {
-                    // FIXME: Nearest and lower do not do clamping, but other
-                    // methods do Make it consistent
-                    bool clamp = order != 1;
-                    interp(output, ooff, input, in_offw, xidi, yidi, method,
-                           nimages, clamp);
-                } else {
-                    for (int n = 0; n < nimages; n++) {
-                        out[ooff + n * ostrides[2]] = scalar<T>(0);
-                    }
+
+    // FIXME: Nearest and lower do not do clamping, but other
+    // methods do Make it consistent
+    const bool clamp = order != 1;
+
+    const dim_t nrows = odims[1] * odims[3];
+    const dim_t grain = std::max(
+        dim_t(1), INTERP_GRAIN / std::max(odims[0] * nimages, dim_t(1)));
+
+    parallel_for(0, nrows, grain, [&](dim_t begin, dim_t end) {
+        WT xs[INTERP_ROW_WIDTH];
+        WT ys[INTERP_ROW_WIDTH];
+        bool inside[INTERP_ROW_WIDTH];
+
+        for (dim_t row = begin; row < end; row++) {
+            int idy      = row % odims[1];
+            int idw      = row / odims[1];
+            int out_offw = idw * ostrides[3];
+            int in_offw  = idw * istrides[3];
+
+            for (int x0 = 0; x0 < (int)odims[0]; x0 += INTERP_ROW_WIDTH) {
+                int len = std::min(INTERP_ROW_WIDTH, (int)odims[0] - x0);
+                for (int i = 0; i < len; i++) {
+                    int idx = x0 + i;
+                    xs[i]   = idx * tmat[0] + idy * tmat[1] + tmat[2];
+                    ys[i]   = idx * tmat[3] + idy * tmat[4] + tmat[5];
+
+                    // Special conditions to deal with boundaries for bilinear
+                    // and bicubic
+                    // FIXME: Ideally this condition should be removed or be
+                    // present for all methods But tests are expecting a
+                    // different behavior for bilinear and nearest
+                    bool condX = xs[i] >= -0.0001 && xs[i] < idims[0];
+                    bool condY = ys[i] >= -0.0001 && ys[i] < idims[1];
+                    inside[i]  = order == 1 || (condX && condY);
                 }
+                interpRow(output, out_offw + idy * ostrides[1] + x0, input,
+                          in_offw, xs, ys, inside, len, method, nimages,
+                          clamp);
             }
         }
-    }
+    });
 }
 
 }  // namespace kernel
@@ -13,13 +13,8 @@
 namespace cpu {
 namespace kernel {
 
-template<typename Tk, typename Tv>
-void sort0ByKeyIterative(Param<Tk> okey, Param<Tv> oval, bool isAscending);
-
-template<typename Tk, typename Tv>
-void sortByKeyBatched(Param<Tk> okey, Param<Tv> oval, const int dim,
-                      bool isAscending);
-
+/// Sorts every column of \p okey along dimension 0 and reorders the
+/// columns of \p oval the same way. The sort is stable.
 template<typename Tk, typename Tv>
 void sort0ByKey(Param<Tk> okey, Param<Tv> oval, bool isAscending);
 
@@ -9,8 +9,11 @@
 
 #pragma once
 #include <Param.hpp>
+#include <common/dispatch.hpp>
 #include <err_cpu.hpp>
+#include <thread_pool.hpp>
 #include <af/traits.hpp>
+#include <algorithm>
 #include <type_traits>
 #include "interp.hpp"
 
@@ -83,59 +86,65 @@ void transform(Param<T> output, CParam<T> input, CParam<float> transform,
     const af::dim4 istrides = input.strides();
     const af::dim4 ostrides = output.strides();
 
-    T *out          = output.get();
     const float *tf = transform.get();
 
     int batch_size = 1;
     if (idims[2] != tdims[2]) batch_size = idims[2];
 
-    Interp2<T, WT, order> interp;
-    for (int idw = 0; idw < (int)odims[3]; idw++) {
-        dim_t out_offw = idw * ostrides[3];
-        dim_t in_offw  = (idims[3] > 1) * idw * istrides[3];
-        dim_t tf_offw  = (tdims[3] > 1) * idw * tstrides[3];
-
-        for (int idz = 0; idz < (int)odims[2]; idz += batch_size) {
-            dim_t out_offzw = out_offw + idz * ostrides[2];
-            dim_t in_offzw  = in_offw + (idims[2] > 1) * idz * istrides[2];
-            dim_t tf_offzw  = tf_offw + (tdims[2] > 1) * idz * tstrides[2];
-
-            const float *tptr = tf + tf_offzw;
+    // FIXME: Nearest and lower do not do clamping, but other
+    // methods do Make it consistent
+    const bool clamp = order != 1;
+
+    // Rows of every batch of images that share a transform
+    const dim_t nbatch = divup(odims[2], dim_t(batch_size));
+    const dim_t nrows  = odims[1] * nbatch * odims[3];
+    const dim_t grain  = std::max(
+        dim_t(1), INTERP_GRAIN / std::max(odims[0] * batch_size, dim_t(1)));
+
+    InterpRow<T, WT, order> interpRow;
+    parallel_for(0, nrows, grain, [&](dim_t begin, dim_t end) {
+        WT xs[INTERP_ROW_WIDTH];
+        WT ys[INTERP_ROW_WIDTH];
+        bool inside[INTERP_ROW_WIDTH];
+
+        for (dim_t row = begin; row < end; row++) {
+            int idy = row % odims[1];
+            int idz = ((row / odims[1]) % nbatch) * batch_size;
+            int idw = row / (odims[1] * nbatch);
+
+            dim_t out_offzw = idw * ostrides[3] + idz * ostrides[2];
+            dim_t in_offzw  = (idims[3] > 1) * idw * istrides[3] +
+                             (idims[2] > 1) * idz * istrides[2];
+            dim_t tf_offzw  = (tdims[3] > 1) * idw * tstrides[3] +
+                             (tdims[2] > 1) * idz * tstrides[2];
 
             float tmat[9];
-            calc_transform_inverse(tmat, tptr, inverse, perspective,
+            calc_transform_inverse(tmat, tf + tf_offzw, inverse, perspective,
                                    perspective ? 9 : 6);
 
-            for (int idy = 0; idy < (int)odims[1]; idy++) {
-                for (int idx = 0; idx < (int)odims[0]; idx++) {
-                    WT xidi = idx * tmat[0] + idy * tmat[1] + tmat[2];
-                    WT yidi = idx * tmat[3] + idy * tmat[4] + tmat[5];
+            for (int x0 = 0; x0 < (int)odims[0]; x0 += INTERP_ROW_WIDTH) {
+                int len = std::min(INTERP_ROW_WIDTH, (int)odims[0] - x0);
+                for (int i = 0; i < len; i++) {
+                    int idx = x0 + i;
+                    xs[i]   = idx * tmat[0] + idy * tmat[1] + tmat[2];
+                    ys[i]   = idx * tmat[3] + idy * tmat[4] + tmat[5];
 
                     if (perspective) {
                         WT W = idx * tmat[6] + idy * tmat[7] + tmat[8];
-                        xidi /= W;
-                        yidi /= W;
+                        xs[i] /= W;
+                        ys[i] /= W;
                     }
 
-                    // FIXME: Nearest and lower do not do clamping, but other
-                    // methods do Make it consistent
-                    bool clamp = order != 1;
-                    bool condX = xidi >= -0.0001 && xidi < idims[0];
-                    bool condY = yidi >= -0.0001 && yidi < idims[1];
-
-                    int ooff = out_offzw + idy * ostrides[1] + idx;
-                    if (condX && condY) {
-                        interp(output, ooff, input, in_offzw, xidi, yidi,
-                               method, batch_size, clamp);
-                    } else {
-                        for (int n = 0; n < batch_size; n++) {
-                            out[ooff + n * ostrides[2]] = scalar<T>(0);
-                        }
-                    }
+                    bool condX = xs[i] >= -0.0001 && xs[i] < idims[0];
+                    bool condY = ys[i] >= -0.0001 && ys[i] < idims[1];
+                    inside[i]  = condX && condY;
                 }
+                interpRow(output, out_offzw + idy * ostrides[1] + x0, input,
+                          in_offzw, xs, ys, inside, len, method, batch_size,
+                          clamp);
             }
         }
-    }
+    });
 }
 
 }  // namespace kernel
@@ -9,12 +9,22 @@
 
 #pragma once
 #include <Param.hpp>
+#include <common/dispatch.hpp>
 #include <err_cpu.hpp>
+#include <thread_pool.hpp>
 #include <utility.hpp>
 
+#include <algorithm>
+
 namespace cpu {
 namespace kernel {
 
+/// Side of the square tiles that are transposed through the cache
+constexpr dim_t TRANSPOSE_TILE = 32;
+
+/// Minimum number of elements transposed by a thread
+constexpr dim_t TRANSPOSE_GRAIN = 65536;
+
 template<typename T>
 T getConjugate(const T &in) {
     // For non-complex types return same
@@ -22,119 +32,138 @@ T getConjugate(const T &in) {
 }
 
 template<>
-cfloat getConjugate(const cfloat &in) {
+inline cfloat getConjugate(const cfloat &in) {
     return std::conj(in);
 }
 
 template<>
-cdouble getConjugate(const cdouble &in) {
+inline cdouble getConjugate(const cdouble &in) {
     return std::conj(in);
 }
 
-template<typename T, int M, int N>
-void transpose_kernel(T *output, const T *input, int ostride, int istride) {
+template<typename T, bool conjugate>
+T transposeOp(const T &in) {
+    return conjugate ? getConjugate(in) : in;
+}
+
+template<typename T, bool conjugate, int M, int N>
+void transpose_kernel(T *output, const T *input, dim_t ostride,
+                      dim_t istride) {
     for (int j = 0; j < N; j++) {
-        for (int i = 0; i < M; i++) { output[i * ostride] = input[i]; }
+        for (int i = 0; i < M; i++) {
+            output[i * ostride] = transposeOp<T, conjugate>(input[i]);
+        }
         input += istride;
         output++;
     }
 }
 
-template<typename T>
-void transpose_real(Param<T> output, CParam<T> input) {
-    const af::dim4 odims    = output.dims();
-    const af::dim4 ostrides = output.strides();
-    const af::dim4 istrides = input.strides();
-
-    T *out            = output.get();
-    T const *const in = input.get();
-
+/// Sets out[i + j * ostride] to in[j + i * istride] for the \p rows x \p cols
+/// block starting at \p out
+///
+/// Full 8x8 blocks are transposed with fixed trip counts so that the compiler
+/// can keep them in registers. This header is compiled for the baseline
+/// instruction set for every type, unlike the per-ISA loops of
+/// jit/vector_ops_*.cpp, so the shuffles are left to the compiler.
+template<typename T, bool conjugate>
+void transposeBlock(T *out, dim_t ostride, const T *in, dim_t istride,
+                    dim_t rows, dim_t cols) {
     constexpr int M = 8;
     constexpr int N = 8;
 
-    dim_t odims1_down = floor(odims[1] / N) * N;
-    dim_t odims0_down = floor(odims[0] / M) * M;
-
-    for (dim_t l = 0; l < odims[3]; ++l) {
-        for (dim_t k = 0; k < odims[2]; ++k) {
-            // Outermost loop handles batch mode
-            // if input has no data along third dimension
-            // this loop runs only once
-            T *out_      = out + l * ostrides[3] + k * ostrides[2];
-            const T *in_ = in + l * istrides[3] + k * istrides[2];
-
-            if (odims1_down > 0) {
-                for (dim_t j = 0; j <= odims1_down; j += N) {
-                    for (dim_t i = 0; i < odims0_down; i += M) {
-                        transpose_kernel<T, M, N>(out_, in_, ostrides[1],
-                                                  istrides[1]);
-                        out_ += M;
-                        in_ += istrides[1] * N;
-                    }
-
-                    for (dim_t jj = 0; jj < N; jj++) {
-                        for (dim_t i = odims0_down; i < odims[0]; i++) {
-                            *out_ = *in_;
-                            out_++;
-                            in_ += istrides[1];
-                        }
-                        out_ += ostrides[1] - (odims[0] - odims0_down);
-                        in_ -= (odims[0] - odims0_down) * istrides[1] - 1;
-                    }
-                    out_ = out + l * ostrides[3] + k * ostrides[2] +
-                           j * ostrides[1];
-                    in_ = in + l * istrides[3] + k * istrides[2] + j;
-                }
-            }
-            for (dim_t j = odims1_down; j < odims[1]; j++) {
-                out_ =
-                    out + l * ostrides[3] + k * ostrides[2] + j * ostrides[1];
-                in_ = in + l * istrides[3] + k * istrides[2] + j;
-                for (dim_t i = 0; i < odims[0]; i++) {
-                    *out_ = *in_;
-                    out_++;
-                    in_ += istrides[1];
-                }
-            }
+    dim_t const rowsDown = rows - rows % N;
+    dim_t const colsDown = cols - cols % M;
+
+    for (dim_t i = 0; i < rowsDown; i += N) {
+        for (dim_t j = 0; j < colsDown; j += M) {
+            transpose_kernel<T, conjugate, M, N>(
+                out + i + j * ostride, in + j + i * istride, ostride, istride);
+        }
+    }
+    for (dim_t j = 0; j < cols; ++j) {
+        dim_t const first = j < colsDown ? rowsDown : 0;
+        for (dim_t i = first; i < rows; ++i) {
+            out[i + j * ostride] = transposeOp<T, conjugate>(in[j + i * istride]);
         }
     }
 }
 
-template<typename T>
-void transpose_conj(Param<T> output, CParam<T> input) {
+/// Transposes \p nplanes planes of \p rows x \p cols output elements
+///
+/// Plane p starts at out + oplane(p) and in + iplane(p). The planes are
+/// split into strips of TRANSPOSE_TILE output columns, which are shared
+/// between the threads and walked one tile at a time.
+template<typename T, bool conjugate, typename OutPlane, typename InPlane>
+void transposePlanes(T *out, dim_t ostride, const T *in, dim_t istride,
+                     dim_t rows, dim_t cols, dim_t nplanes, OutPlane oplane,
+                     InPlane iplane) {
+    dim_t const nstrips = divup(cols, TRANSPOSE_TILE);
+    dim_t const grain =
+        std::max(dim_t(1), TRANSPOSE_GRAIN / std::max(dim_t(1),
+                                                      rows * TRANSPOSE_TILE));
+
+    parallel_for(0, nplanes * nstrips, grain, [&](dim_t begin, dim_t end) {
+        for (dim_t s = begin; s < end; ++s) {
+            dim_t const plane = s / nstrips;
+            dim_t const j     = (s % nstrips) * TRANSPOSE_TILE;
+            dim_t const ncols = std::min(TRANSPOSE_TILE, cols - j);
+            T *o              = out + oplane(plane) + j * ostride;
+            const T *x        = in + iplane(plane) + j;
+            for (dim_t i = 0; i < rows; i += TRANSPOSE_TILE) {
+                transposeBlock<T, conjugate>(
+                    o + i, ostride, x + i * istride, istride,
+                    std::min(TRANSPOSE_TILE, rows - i), ncols);
+            }
+        }
+    });
+}
+
+template<typename T, bool conjugate>
+void transpose(Param<T> output, CParam<T> input) {
     const af::dim4 odims    = output.dims();
     const af::dim4 ostrides = output.strides();
     const af::dim4 istrides = input.strides();
 
-    T *out            = output.get();
-    T const *const in = input.get();
-
-    for (dim_t l = 0; l < odims[3]; ++l) {
-        for (dim_t k = 0; k < odims[2]; ++k) {
-            // Outermost loop handles batch mode
-            // if input has no data along third dimension
-            // this loop runs only once
-
-            for (dim_t j = 0; j < odims[1]; ++j) {
-                for (dim_t i = 0; i < odims[0]; ++i) {
-                    // calculate array indices based on offsets and strides
-                    // the helper getIdx takes care of indices
-                    const dim_t inIdx  = getIdx(istrides, j, i, k, l);
-                    const dim_t outIdx = getIdx(ostrides, i, j, k, l);
-                    out[outIdx]        = getConjugate(in[inIdx]);
-                }
-            }
-            // outData and inData pointers doesn't need to be
-            // offset as the getIdx function is taking care
-            // of the batch parameter
-        }
-    }
+    // Outermost dimensions handle batch mode
+    transposePlanes<T, conjugate>(
+        output.get(), ostrides[1], input.get(), istrides[1], odims[0],
+        odims[1], odims[2] * odims[3],
+        [&](dim_t p) {
+            return (p % odims[2]) * ostrides[2] + (p / odims[2]) * ostrides[3];
+        },
+        [&](dim_t p) {
+            return (p % odims[2]) * istrides[2] + (p / odims[2]) * istrides[3];
+        });
 }
 
 template<typename T>
 void transpose(Param<T> out, CParam<T> in, const bool conjugate) {
-    return (conjugate ? transpose_conj<T>(out, in)
-                      : transpose_real<T>(out, in));
+    return (conjugate ? transpose<T, true>(out, in)
+                      : transpose<T, false>(out, in));
+}
+
+/// Swaps the tile at (\p i, \p j) with the transpose of the tile at
+/// (\p j, \p i). Diagonal tiles are transposed in place.
+template<typename T, bool conjugate>
+void transposeTileInplace(T *in, dim_t stride, dim_t n, dim_t i, dim_t j) {
+    dim_t const rows = std::min(TRANSPOSE_TILE, n - i);
+    dim_t const cols = std::min(TRANSPOSE_TILE, n - j);
+    T *a             = in + i + j * stride;
+    T *b             = in + j + i * stride;
+
+    for (dim_t jj = 0; jj < cols; ++jj) {
+        dim_t const first = i == j ? jj + 1 : 0;
+        if (i == j) {
+            a[jj + jj * stride] = transposeOp<T, conjugate>(a[jj + jj * stride]);
+        }
+        for (dim_t ii = first; ii < rows; ++ii) {
+            T &x = a[ii + jj * stride];
+            T &y = b[jj + ii * stride];
+            T t  = transposeOp<T, conjugate>(x);
+            x    = transposeOp<T, conjugate>(y);
+            y    = t;
+        }
+    }
 }
 
 template<typename T, bool conjugate>
@@ -144,30 +173,39 @@ void transpose_inplace(Param<T> input) {
 
     T *in = input.get();
 
-    for (dim_t l = 0; l < idims[3]; ++l) {
-        for (dim_t k = 0; k < idims[2]; ++k) {
-            // Outermost loop handles batch mode
-            // if input has no data along third dimension
-            // this loop runs only once
-            //
-            // Run only bottom triangle. std::swap swaps with upper triangle
-            for (dim_t j = 0; j < idims[1]; ++j) {
-                for (dim_t i = j + 1; i < idims[0]; ++i) {
-                    // calculate array indices based on offsets and strides
-                    // the helper getIdx takes care of indices
-                    const dim_t iIdx = getIdx(istrides, j, i, k, l);
-                    const dim_t oIdx = getIdx(istrides, i, j, k, l);
-                    if (conjugate) {
-                        in[iIdx] = getConjugate(in[iIdx]);
-                        in[oIdx] = getConjugate(in[oIdx]);
-                        std::swap(in[iIdx], in[oIdx]);
-                    } else {
-                        std::swap(in[iIdx], in[oIdx]);
-                    }
-                }
+    // The tiles of the lower triangle are swapped with the upper triangle.
+    // Tile row r is paired with row ntiles - 1 - r so that every task swaps
+    // about the same number of tiles.
+    dim_t const n       = idims[0];
+    dim_t const ntiles  = divup(n, TRANSPOSE_TILE);
+    dim_t const npairs  = divup(ntiles, dim_t(2));
+    dim_t const nimages = idims[2] * idims[3];
+    dim_t const grain   = std::max(
+        dim_t(1), TRANSPOSE_GRAIN / std::max(dim_t(1),
+                                             n * TRANSPOSE_TILE));
+
+    parallel_for(0, nimages * npairs, grain, [&](dim_t begin, dim_t end) {
+        for (dim_t t = begin; t < end; ++t) {
+            dim_t const image = t / npairs;
+            dim_t const pair  = t % npairs;
+            T *img = in + (image % idims[2]) * istrides[2] +
+                     (image / idims[2]) * istrides[3];
+
+            dim_t const r0 = pair;
+            dim_t const r1 = ntiles - 1 - pair;
+            for (dim_t c = 0; c <= r0; ++c) {
+                transposeTileInplace<T, conjugate>(
+                    img, istrides[1], n, r0 * TRANSPOSE_TILE,
+                    c * TRANSPOSE_TILE);
+            }
+            if (r1 == r0) { continue; }
+            for (dim_t c = 0; c <= r1; ++c) {
+                transposeTileInplace<T, conjugate>(
+                    img, istrides[1], n, r1 * TRANSPOSE_TILE,
+                    c * TRANSPOSE_TILE);
             }
         }
-    }
+    });
 }
 
 template<typename T>
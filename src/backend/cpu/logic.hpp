@@ -10,6 +10,7 @@
 #include <Array.hpp>
 #include <err_cpu.hpp>
 #include <jit/BinaryNode.hpp>
+#include <jit/vector_ops.hpp>
 #include <optypes.hpp>
 #include <types.hpp>
 #include <af/dim4.hpp>
@@ -21,6 +22,9 @@ namespace cpu {
     struct BinOp<char, T, OP> {                                          \
         void eval(jit::array<char> &out, const jit::array<T> &lhs,       \
                   const jit::array<T> &rhs, int lim) {                   \
+            if (jit::evalVector<char, T, OP>(out, lhs, rhs, lim)) {      \
+                return;                                                  \
+            }                                                            \
             for (int i = 0; i < lim; i++) { out[i] = lhs[i] op rhs[i]; } \
         }                                                                \
     };
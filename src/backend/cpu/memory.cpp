@@ -52,6 +52,10 @@ void printMemInfo(const char *msg, const int device) {
     memoryManager().printInfo(msg, device);
 }
 
+void deviceMemoryStats(af_memory_stats *stats, const int device) {
+    memoryManager().getStats(stats, device);
+}
+
 template<typename T>
 unique_ptr<T[], function<void(T *)>> memAlloc(const size_t &elements) {
     // TODO: make memAlloc aware of array shapes
@@ -10,6 +10,7 @@
 
 #include <common/AllocatorInterface.hpp>
 #include <af/defines.h>
+#include <af/device.h>
 
 #include <functional>
 #include <memory>
@@ -45,6 +46,7 @@ void shutdownMemoryManager();
 void pinnedGarbageCollect();
 
 void printMemInfo(const char *msg, const int device);
+void deviceMemoryStats(af_memory_stats *stats, const int device);
 
 float getMemoryPressure();
 float getMemoryPressureThreshold();
@@ -27,10 +27,8 @@ Array<T> morph(const Array<T> &in, const Array<T> &mask, bool isDilation) {
 
     const af::dim4 lpad(mdims[0] / 2, mdims[1] / 2, 0, 0);
     const af::dim4 &upad(lpad);
-    const af::dim4 odims(lpad[0] + idims[0] + upad[0],
-                         lpad[1] + idims[1] + upad[1], idims[2], idims[3]);
 
-    auto out = createEmptyArray<T>(odims);
+    auto out = createEmptyArray<T>(idims);
     auto inp = padArrayBorders(in, lpad, upad, padType);
 
     if (isDilation) {
@@ -39,11 +37,7 @@ Array<T> morph(const Array<T> &in, const Array<T> &mask, bool isDilation) {
         getQueue().enqueue(kernel::morph<T, false>, out, inp, mask);
     }
 
-    std::vector<af_seq> idxs(4, af_span);
-    idxs[0] = af_seq{double(lpad[0]), double(lpad[0] + idims[0] - 1), 1.0};
-    idxs[1] = af_seq{double(lpad[1]), double(lpad[1] + idims[1] - 1), 1.0};
-
-    return createSubArray(out, idxs);
+    return out;
 }
 
 template<typename T>
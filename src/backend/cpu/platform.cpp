@@ -11,7 +11,9 @@
 #include <common/defines.hpp>
 #include <common/host_memory.hpp>
 #include <device_manager.hpp>
+#include <jit/vector_ops.hpp>
 #include <platform.hpp>
+#include <thread_pool.hpp>
 #include <version.hpp>
 #include <af/version.h>
 
@@ -19,6 +21,8 @@
 #include <cctype>
 #include <memory>
 #include <sstream>
+#include <stdexcept>
+#include <thread>
 
 using common::memory::MemoryManagerBase;
 using std::endl;
@@ -118,6 +122,32 @@ unsigned getMaxJitSize() {
     return length;
 }
 
+unsigned getNumThreads() {
+    static const unsigned num_threads = []() {
+        string env_var = getEnvVar("AF_CPU_NUM_THREADS");
+        int threads    = 0;
+        // Malformed values fall back to the hardware concurrency
+        try {
+            if (!env_var.empty()) { threads = stoi(env_var); }
+        } catch (const std::logic_error &) { threads = 0; }
+        if (threads <= 0) {
+            threads = static_cast<int>(std::thread::hardware_concurrency());
+        }
+        return static_cast<unsigned>(std::max(threads, 1));
+    }();
+    return num_threads;
+}
+
+jit::VectorIsa getVectorIsa() {
+    static const jit::VectorIsa isa = []() {
+        const CPUInfo cinfo = DeviceManager::getInstance().getCPUInfo();
+        if (cinfo.hasAVX512()) { return jit::VectorIsa::AVX512; }
+        if (cinfo.hasAVX2()) { return jit::VectorIsa::AVX2; }
+        return jit::VectorIsa::Generic;
+    }();
+    return isa;
+}
+
 int getDeviceCount() { return DeviceManager::NUM_DEVICES; }
 
 // Get the currently active device id
@@ -147,6 +177,10 @@ queue& getQueue(int device) {
     return DeviceManager::getInstance().queues[device];
 }
 
+ThreadPool& getThreadPool() {
+    return *(DeviceManager::getInstance().threadPool);
+}
+
 void sync(int device) { getQueue(device).sync(); }
 
 bool& evalFlag() {
@@ -26,6 +26,12 @@ using common::memory::MemoryManagerBase;
 
 namespace cpu {
 
+class ThreadPool;
+
+namespace jit {
+enum class VectorIsa;
+}
+
 int getBackend();
 
 std::string getDeviceInfo() noexcept;
@@ -38,6 +44,12 @@ void devprop(char* d_name, char* d_platform, char* d_toolkit, char* d_compute);
 
 unsigned getMaxJitSize();
 
+unsigned getNumThreads();
+
+/// Returns the widest instruction set supported by this machine for which
+/// the JIT loops are compiled
+jit::VectorIsa getVectorIsa();
+
 int getDeviceCount();
 
 unsigned getActiveDeviceId();
@@ -50,6 +62,8 @@ int setDevice(int device);
 
 queue& getQueue(int device = 0);
 
+ThreadPool& getThreadPool();
+
 void sync(int device);
 
 bool& evalFlag();
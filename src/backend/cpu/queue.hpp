@@ -40,27 +40,24 @@ class queue_impl {
 
 #else
 
-#include <threads/async_queue.hpp>
-#include <threads/event.hpp>
+#include <task_queue.hpp>
 #define __SYNCHRONOUS_ARCH 0
-using queue_impl = threads::async_queue;
-using event_impl = threads::event;
+using queue_impl = cpu::TaskQueue;
+using event_impl = cpu::TaskEvent;
 
 #endif
 
 namespace cpu {
 
-/// Wraps the async_queue class
+/// Wraps the TaskQueue class
 class queue {
    public:
     queue()
-        : count(0)
-        , sync_calls(__SYNCHRONOUS_ARCH == 1 ||
+        : sync_calls(__SYNCHRONOUS_ARCH == 1 ||
                      getEnvVar("AF_SYNCHRONOUS_CALLS") == "1") {}
 
     template<typename F, typename... Args>
     void enqueue(const F func, Args &&... args) {
-        count++;
         if (sync_calls) {
             func(toParam(std::forward<Args>(args))...);
         } else {
@@ -69,15 +66,11 @@ class queue {
 #ifndef NDEBUG
         sync();
 #else
-        if (getMemoryPressure() >= getMemoryPressureThreshold() ||
-            count >= 25) {
-            sync();
-        }
+        if (getMemoryPressure() >= getMemoryPressureThreshold()) { sync(); }
 #endif
     }
 
     void sync() {
-        count = 0;
         if (!sync_calls) aQueue.sync();
     }
 
@@ -88,7 +81,6 @@ class queue {
     friend class queue_event;
 
    private:
-    int count;
     const bool sync_calls;
     queue_impl aQueue;
 };
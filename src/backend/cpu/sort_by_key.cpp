@@ -13,45 +13,33 @@
 #include <kernel/sort_by_key.hpp>
 #include <platform.hpp>
 #include <queue.hpp>
-#include <range.hpp>
 #include <reorder.hpp>
 #include <sort_by_key.hpp>
 
+#include <utility>
+
 namespace cpu {
 
 template<typename Tk, typename Tv>
 void sort_by_key(Array<Tk> &okey, Array<Tv> &oval, const Array<Tk> &ikey,
                  const Array<Tv> &ival, const uint dim, bool isAscending) {
-    okey = copyArray<Tk>(ikey);
-    oval = copyArray<Tv>(ival);
+    if (dim > 3) { AF_ERROR("Not Supported", AF_ERR_NOT_SUPPORTED); }
 
-    switch (dim) {
-        case 0:
-            getQueue().enqueue(kernel::sort0ByKey<Tk, Tv>, okey, oval,
-                               isAscending);
-            break;
-        case 1:
-        case 2:
-        case 3:
-            getQueue().enqueue(kernel::sortByKeyBatched<Tk, Tv>, okey, oval,
-                               dim, isAscending);
-            break;
-        default: AF_ERROR("Not Supported", AF_ERR_NOT_SUPPORTED);
-    }
+    // The columns are sorted along dimension 0, so dim is swapped with it
+    af::dim4 reorderDims(0, 1, 2, 3);
+    std::swap(reorderDims[0], reorderDims[dim]);
 
-    if (dim != 0) {
-        af::dim4 preorderDims = okey.dims();
-        af::dim4 reorderDims(0, 1, 2, 3);
-        reorderDims[dim] = 0;
-        preorderDims[0]  = okey.dims()[dim];
-        for (int i = 1; i <= static_cast<int>(dim); i++) {
-            reorderDims[i - 1] = i;
-            preorderDims[i]    = okey.dims()[i - 1];
-        }
+    if (dim == 0) {
+        okey = copyArray<Tk>(ikey);
+        oval = copyArray<Tv>(ival);
+    } else {
+        okey = reorder<Tk>(ikey, reorderDims);
+        oval = reorder<Tv>(ival, reorderDims);
+    }
 
-        okey.setDataDims(preorderDims);
-        oval.setDataDims(preorderDims);
+    getQueue().enqueue(kernel::sort0ByKey<Tk, Tv>, okey, oval, isAscending);
 
+    if (dim != 0) {
         okey = reorder<Tk>(okey, reorderDims);
         oval = reorder<Tv>(oval, reorderDims);
     }
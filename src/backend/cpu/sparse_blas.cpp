@@ -14,17 +14,21 @@
 #endif
 
 #include <common/complex.hpp>
+#include <common/dispatch.hpp>
 #include <common/err_common.hpp>
 #include <complex.hpp>
 #include <math.hpp>
 #include <platform.hpp>
 #include <queue.hpp>
+#include <thread_pool.hpp>
 #include <types.hpp>
 #include <af/dim4.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace cpu {
 
@@ -290,51 +294,155 @@ cdouble getConjugate(const cdouble &in) {
     return std::conj(in);
 }
 
-template<typename T, bool conjugate>
-void mv(Param<T> output, CParam<T> values, CParam<int> rowIdx,
-        CParam<int> colIdx, CParam<T> right, int M) {
-    UNUSED(M);
-    const T *valPtr   = values.get();
-    const int *rowPtr = rowIdx.get();
-    const int *colPtr = colIdx.get();
-    const T *rightPtr = right.get();
+// Minimum number of non-zeros and rows processed by a thread
+constexpr dim_t SPARSE_GRAIN = 16384;
 
-    T *outPtr = output.get();
+template<bool conjugate, typename T>
+T conjugateIf(const T &in) {
+    return conjugate ? getConjugate(in) : in;
+}
 
-    for (int i = 0; i < rowIdx.dims(0) - 1; ++i) {
-        outPtr[i] = scalar<T>(0);
-        for (int j = rowPtr[i]; j < rowPtr[i + 1]; ++j) {
-            // If stride[0] of right is not 1 then rightPtr[colPtr[j]*stride]
-            if (conjugate) {
-                outPtr[i] += getConjugate(valPtr[j]) * rightPtr[colPtr[j]];
+/// Number of threads used for \p work non-zeros and rows
+int sparseBlocks(dim_t work) {
+    const dim_t threads = getThreadPool().size();
+    return static_cast<int>(
+        std::min(threads, std::max(divup(work, SPARSE_GRAIN), dim_t(1))));
+}
+
+/// Splits the rows of a CSR matrix into \p blocks ranges with about the
+/// same number of non-zeros and calls \p func(block, row_begin, row_end) for
+/// each of them in parallel. Every row is counted as an extra non-zero so
+/// that empty rows are also balanced.
+template<typename F>
+void parallel_for_rows(const int *rowPtr, int nrows, int blocks, F &&func) {
+    if (blocks <= 1) {
+        func(0, 0, nrows);
+        return;
+    }
+
+    const dim_t work = rowPtr[nrows] - rowPtr[0] + nrows;
+
+    // First row which starts at or after b / blocks of the work
+    auto rowBegin = [&](int b) {
+        const dim_t target = b * work / blocks;
+        int lo             = 0;
+        int hi             = nrows;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (rowPtr[mid] - rowPtr[0] + mid < target) {
+                lo = mid + 1;
             } else {
-                outPtr[i] += valPtr[j] * rightPtr[colPtr[j]];
+                hi = mid;
             }
         }
+        return lo;
+    };
+    getThreadPool().run(blocks,
+                        [&](int b) { func(b, rowBegin(b), rowBegin(b + 1)); });
+}
+
+/// Dot product of a row of the sparse matrix with \p right
+template<typename T, bool conjugate>
+T rowDot(const T *valPtr, const int *colPtr, const T *rightPtr, int begin,
+         int end) {
+    // Independent partial sums let the loads of the gathered elements of
+    // right overlap instead of waiting on a single accumulator
+    T sum0 = scalar<T>(0);
+    T sum1 = scalar<T>(0);
+    T sum2 = scalar<T>(0);
+    T sum3 = scalar<T>(0);
+
+    int j = begin;
+    for (; j + 4 <= end; j += 4) {
+        sum0 += conjugateIf<conjugate>(valPtr[j + 0]) * rightPtr[colPtr[j + 0]];
+        sum1 += conjugateIf<conjugate>(valPtr[j + 1]) * rightPtr[colPtr[j + 1]];
+        sum2 += conjugateIf<conjugate>(valPtr[j + 2]) * rightPtr[colPtr[j + 2]];
+        sum3 += conjugateIf<conjugate>(valPtr[j + 3]) * rightPtr[colPtr[j + 3]];
+    }
+    for (; j < end; ++j) {
+        sum0 += conjugateIf<conjugate>(valPtr[j]) * rightPtr[colPtr[j]];
     }
+    return (sum0 + sum1) + (sum2 + sum3);
 }
 
+/// Adds the rows [\p begin, \p end) of the sparse matrix scaled by the
+/// elements of \p right to \p outPtr
 template<typename T, bool conjugate>
-void mtv(Param<T> output, CParam<T> values, CParam<int> rowIdx,
-         CParam<int> colIdx, CParam<T> right, int M) {
+void scatterRows(T *outPtr, const T *valPtr, const int *rowPtr,
+                 const int *colPtr, const T *rightPtr, int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+        const T r = rightPtr[i];
+        for (int j = rowPtr[i]; j < rowPtr[i + 1]; ++j) {
+            outPtr[colPtr[j]] += conjugateIf<conjugate>(valPtr[j]) * r;
+        }
+    }
+}
+
+/// Computes one column of the product of the transposed sparse matrix with
+/// a dense matrix. Every thread scatters its rows into a private copy of
+/// the output so that no two threads update the same element. The copies
+/// are added together at the end.
+template<typename T, bool conjugate>
+void mtvColumn(T *outPtr, const T *valPtr, const int *rowPtr,
+               const int *colPtr, const T *rightPtr, int nrows, int M) {
+    const dim_t work = rowPtr[nrows] - rowPtr[0] + nrows;
+    // Each private copy costs about M operations to clear and add
+    const int blocks =
+        std::min(sparseBlocks(work),
+                 static_cast<int>(std::max(work / std::max(M, 1), dim_t(1))));
+
+    std::fill(outPtr, outPtr + M, scalar<T>(0));
+    if (blocks <= 1) {
+        scatterRows<T, conjugate>(outPtr, valPtr, rowPtr, colPtr, rightPtr, 0,
+                                  nrows);
+        return;
+    }
+
+    // The first block accumulates in the output itself
+    std::vector<T> partial(static_cast<size_t>(blocks - 1) * M, scalar<T>(0));
+    parallel_for_rows(rowPtr, nrows, blocks, [&](int b, int begin, int end) {
+        T *acc = (b == 0) ? outPtr : partial.data() + (b - 1) * size_t(M);
+        scatterRows<T, conjugate>(acc, valPtr, rowPtr, colPtr, rightPtr, begin,
+                                  end);
+    });
+
+    parallel_for(0, M, SPARSE_GRAIN, [&](dim_t begin, dim_t end) {
+        for (int b = 1; b < blocks; ++b) {
+            const T *acc = partial.data() + (b - 1) * size_t(M);
+            for (dim_t i = begin; i < end; ++i) { outPtr[i] += acc[i]; }
+        }
+    });
+}
+
+template<typename T, bool conjugate>
+void mv(Param<T> output, CParam<T> values, CParam<int> rowIdx,
+        CParam<int> colIdx, CParam<T> right, int M) {
+    UNUSED(M);
     const T *valPtr   = values.get();
     const int *rowPtr = rowIdx.get();
     const int *colPtr = colIdx.get();
     const T *rightPtr = right.get();
     T *outPtr         = output.get();
 
-    for (int i = 0; i < M; ++i) { outPtr[i] = scalar<T>(0); }
+    const int nrows  = rowIdx.dims(0) - 1;
+    const int blocks = sparseBlocks(rowPtr[nrows] - rowPtr[0] + nrows);
 
-    for (int i = 0; i < rowIdx.dims(0) - 1; ++i) {
-        for (int j = rowPtr[i]; j < rowPtr[i + 1]; ++j) {
-            // If stride[0] of right is not 1 then rightPtr[i*stride]
-            if (conjugate) {
-                outPtr[colPtr[j]] += getConjugate(valPtr[j]) * rightPtr[i];
-            } else {
-                outPtr[colPtr[j]] += valPtr[j] * rightPtr[i];
-            }
+    parallel_for_rows(rowPtr, nrows, blocks, [&](int, int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            // If stride[0] of right is not 1 then rightPtr[colPtr[j]*stride]
+            outPtr[i] = rowDot<T, conjugate>(valPtr, colPtr, rightPtr,
+                                             rowPtr[i], rowPtr[i + 1]);
         }
-    }
+    });
+}
+
+template<typename T, bool conjugate>
+void mtv(Param<T> output, CParam<T> values, CParam<int> rowIdx,
+         CParam<int> colIdx, CParam<T> right, int M) {
+    const int nrows = rowIdx.dims(0) - 1;
+    // If stride[0] of right is not 1 then rightPtr[i*stride]
+    mtvColumn<T, conjugate>(output.get(), values.get(), rowIdx.get(),
+                            colIdx.get(), right.get(), nrows, M);
 }
 
 template<typename T, bool conjugate>
@@ -347,22 +455,22 @@ void mm(Param<T> output, CParam<T> values, CParam<int> rowIdx,
     const T *rightPtr = right.get();
     T *outPtr         = output.get();
 
-    for (int o = 0; o < N; ++o) {
-        for (int i = 0; i < rowIdx.dims(0) - 1; ++i) {
-            outPtr[i] = scalar<T>(0);
-            for (int j = rowPtr[i]; j < rowPtr[i + 1]; ++j) {
-                // If stride[0] of right is not 1 then
-                // rightPtr[colPtr[j]*stride]
-                if (conjugate) {
-                    outPtr[i] += getConjugate(valPtr[j]) * rightPtr[colPtr[j]];
-                } else {
-                    outPtr[i] += valPtr[j] * rightPtr[colPtr[j]];
-                }
+    const int nrows  = rowIdx.dims(0) - 1;
+    const dim_t work = dim_t(rowPtr[nrows] - rowPtr[0] + nrows) * N;
+    const int blocks = sparseBlocks(work);
+
+    // Each thread computes all the columns of its rows so that their values
+    // and indices stay in cache
+    parallel_for_rows(rowPtr, nrows, blocks, [&](int, int begin, int end) {
+        for (int o = 0; o < N; ++o) {
+            const T *rightCol = rightPtr + o * size_t(ldb);
+            T *outCol         = outPtr + o * size_t(ldc);
+            for (int i = begin; i < end; ++i) {
+                outCol[i] = rowDot<T, conjugate>(valPtr, colPtr, rightCol,
+                                                 rowPtr[i], rowPtr[i + 1]);
             }
         }
-        rightPtr += ldb;
-        outPtr += ldc;
-    }
+    });
 }
 
 template<typename T, bool conjugate>
@@ -374,21 +482,25 @@ void mtm(Param<T> output, CParam<T> values, CParam<int> rowIdx,
     const T *rightPtr = right.get();
     T *outPtr         = output.get();
 
-    for (int o = 0; o < N; ++o) {
-        for (int i = 0; i < M; ++i) { outPtr[i] = scalar<T>(0); }
-
-        for (int i = 0; i < rowIdx.dims(0) - 1; ++i) {
-            for (int j = rowPtr[i]; j < rowPtr[i + 1]; ++j) {
-                // If stride[0] of right is not 1 then rightPtr[i*stride]
-                if (conjugate) {
-                    outPtr[colPtr[j]] += getConjugate(valPtr[j]) * rightPtr[i];
-                } else {
-                    outPtr[colPtr[j]] += valPtr[j] * rightPtr[i];
-                }
+    const int nrows = rowIdx.dims(0) - 1;
+
+    // The columns are independent. Split them between the threads when there
+    // are enough of them instead of keeping private copies of the output.
+    if (N >= static_cast<int>(getThreadPool().size())) {
+        parallel_for(0, N, 1, [&](dim_t begin, dim_t end) {
+            for (dim_t o = begin; o < end; ++o) {
+                T *outCol = outPtr + o * ldc;
+                std::fill(outCol, outCol + M, scalar<T>(0));
+                scatterRows<T, conjugate>(outCol, valPtr, rowPtr, colPtr,
+                                          rightPtr + o * ldb, 0, nrows);
             }
+        });
+    } else {
+        for (int o = 0; o < N; ++o) {
+            mtvColumn<T, conjugate>(outPtr + o * size_t(ldc), valPtr, rowPtr,
+                                    colPtr, rightPtr + o * size_t(ldb), nrows,
+                                    M);
         }
-        rightPtr += ldb;
-        outPtr += ldc;
     }
 }
 
@@ -0,0 +1,269 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <task_queue.hpp>
+
+#include <jit/Node.hpp>
+#include <platform.hpp>
+
+#include <algorithm>
+#include <unordered_set>
+
+using std::condition_variable;
+using std::exception_ptr;
+using std::function;
+using std::lock_guard;
+using std::make_shared;
+using std::move;
+using std::mutex;
+using std::shared_ptr;
+using std::unique_lock;
+using std::unique_ptr;
+using std::unordered_set;
+using std::vector;
+
+namespace cpu {
+
+namespace {
+// Maximum number of workers executing the tasks of a queue. Most kernels are
+// already split across the ThreadPool so only a few of them need to run at
+// the same time to keep the cores busy.
+constexpr unsigned MAX_QUEUE_THREADS = 4;
+
+// Maximum number of incomplete tasks after which enqueue blocks. This limits
+// the memory held by the tasks and the cost of finding their dependencies.
+constexpr size_t MAX_PENDING_TASKS = 64;
+
+// The queue whose task is being executed on this thread
+thread_local const TaskQueue *current_queue = nullptr;
+
+// True if the tasks access the same memory and one of them writes to it
+bool conflicts(const vector<MemoryAccess> &lhs,
+               const vector<MemoryAccess> &rhs) {
+    for (const MemoryAccess &l : lhs) {
+        for (const MemoryAccess &r : rhs) {
+            if ((l.write || r.write) && l.begin < r.end && r.begin < l.end) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+}  // namespace
+
+namespace queue_detail {
+
+void addAccess(AccessList &list, const shared_ptr<jit::Node> &node, bool) {
+    unordered_set<const jit::Node *> visited;
+    vector<const jit::Node *> stack{node.get()};
+    while (!stack.empty()) {
+        const jit::Node *n = stack.back();
+        stack.pop_back();
+        if (n == nullptr || !visited.insert(n).second) { continue; }
+
+        list.add(n->getData(), n->getBytes(), false);
+        for (int i = 0; i < jit::Node::kMaxChildren; i++) {
+            stack.push_back(n->getChild(i));
+        }
+    }
+}
+
+void addAccess(AccessList &list, const vector<shared_ptr<jit::Node>> &nodes,
+               bool) {
+    for (const auto &node : nodes) { addAccess(list, node, true); }
+}
+
+void addAccess(AccessList &list, const vector<jit::Output> &outputs, bool) {
+    for (const auto &output : outputs) {
+        list.add(output.ptr, output.bytes, true);
+        addAccess(list, output.node, true);
+    }
+}
+
+}  // namespace queue_detail
+
+struct TaskQueue::Task {
+    function<void()> func;
+    vector<MemoryAccess> accesses;
+    bool barrier;
+    // Number of incomplete tasks this task depends on
+    int remaining;
+    vector<Task *> dependents;
+};
+
+TaskQueue::TaskQueue() : num_ready(0), stop(false) {
+    unsigned nthreads = std::min(getNumThreads(), MAX_QUEUE_THREADS);
+    ready.resize(nthreads);
+    for (unsigned i = 0; i < nthreads; ++i) {
+        workers.emplace_back([this, i] { work(i); });
+    }
+}
+
+TaskQueue::~TaskQueue() {
+    {
+        unique_lock<mutex> lock(task_mutex);
+        done_cv.wait(lock, [this] { return tasks.empty(); });
+        stop = true;
+    }
+    work_cv.notify_all();
+    for (auto &worker : workers) { worker.join(); }
+}
+
+void TaskQueue::submit(function<void()> func, vector<MemoryAccess> accesses,
+                       bool barrier) {
+    unique_ptr<Task> task(new Task{move(func), move(accesses), barrier, 0, {}});
+
+    unique_lock<mutex> lock(task_mutex);
+    done_cv.wait(lock, [this] { return tasks.size() < MAX_PENDING_TASKS; });
+
+    for (auto &prev : tasks) {
+        if (task->barrier || prev->barrier ||
+            conflicts(prev->accesses, task->accesses)) {
+            prev->dependents.push_back(task.get());
+            task->remaining++;
+        }
+    }
+
+    if (task->remaining == 0) {
+        injected.push_back(task.get());
+        num_ready++;
+        work_cv.notify_one();
+    }
+    tasks.push_back(move(task));
+}
+
+void TaskQueue::enqueueBarrier(function<void()> func) {
+    submit(move(func), {}, true);
+}
+
+bool TaskQueue::popTask(unsigned worker, Task *&task) {
+    if (num_ready == 0) { return false; }
+
+    // Newest task of this worker first as its inputs were just written here,
+    // then the oldest tasks of the queue and the other workers.
+    if (!ready[worker].empty()) {
+        task = ready[worker].back();
+        ready[worker].pop_back();
+    } else if (!injected.empty()) {
+        task = injected.front();
+        injected.pop_front();
+    } else {
+        for (unsigned i = 1; i < ready.size(); ++i) {
+            auto &victim = ready[(worker + i) % ready.size()];
+            if (!victim.empty()) {
+                task = victim.front();
+                victim.pop_front();
+                break;
+            }
+        }
+    }
+    num_ready--;
+    return true;
+}
+
+void TaskQueue::work(unsigned worker) {
+    current_queue = this;
+    while (true) {
+        Task *task = nullptr;
+        {
+            unique_lock<mutex> lock(task_mutex);
+            work_cv.wait(lock, [&] { return stop || popTask(worker, task); });
+            if (task == nullptr) { return; }
+        }
+
+        exception_ptr err;
+        try {
+            task->func();
+        } catch (...) { err = std::current_exception(); }
+
+        lock_guard<mutex> lock(task_mutex);
+        if (err && !error) { error = err; }
+
+        size_t released = 0;
+        for (Task *dependent : task->dependents) {
+            if (--dependent->remaining == 0) {
+                ready[worker].push_back(dependent);
+                released++;
+            }
+        }
+        num_ready += released;
+        // This worker picks up one of the released tasks itself
+        if (released > 1) { work_cv.notify_all(); }
+
+        tasks.erase(std::find_if(
+            begin(tasks), end(tasks),
+            [task](const unique_ptr<Task> &t) { return t.get() == task; }));
+        done_cv.notify_all();
+    }
+}
+
+void TaskQueue::sync() {
+    exception_ptr err;
+    {
+        unique_lock<mutex> lock(task_mutex);
+        done_cv.wait(lock, [this] { return tasks.empty(); });
+        err   = move(error);
+        error = nullptr;
+    }
+    if (err) { std::rethrow_exception(err); }
+}
+
+bool TaskQueue::is_worker() const { return current_queue == this; }
+
+TaskEvent::TaskEvent(int val) {
+    if (val != 0) { create(); }
+}
+
+int TaskEvent::create() {
+    state = make_shared<State>();
+    return 0;
+}
+
+int TaskEvent::mark(TaskQueue &queue) {
+    if (!state) { return 1; }
+    shared_ptr<State> s = state;
+    unsigned mark;
+    {
+        lock_guard<mutex> lock(s->mutex);
+        mark = ++s->marked;
+    }
+    queue.enqueueBarrier([s, mark] {
+        {
+            lock_guard<mutex> lock(s->mutex);
+            s->completed = std::max(s->completed, mark);
+        }
+        s->cv.notify_all();
+    });
+    return 0;
+}
+
+int TaskEvent::wait(TaskQueue &queue) {
+    if (!state) { return 1; }
+    shared_ptr<State> s = state;
+    unsigned mark;
+    {
+        lock_guard<mutex> lock(s->mutex);
+        mark = s->marked;
+    }
+    queue.enqueueBarrier([s, mark] {
+        unique_lock<mutex> lock(s->mutex);
+        s->cv.wait(lock, [&] { return s->completed >= mark; });
+    });
+    return 0;
+}
+
+int TaskEvent::sync() noexcept {
+    if (!state) { return 1; }
+    unique_lock<mutex> lock(state->mutex);
+    unsigned mark = state->marked;
+    state->cv.wait(lock, [&] { return state->completed >= mark; });
+    return 0;
+}
+
+}  // namespace cpu
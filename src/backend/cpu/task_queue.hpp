@@ -0,0 +1,212 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+
+#include <Param.hpp>
+#include <common/defines.hpp>
+#include <af/dim4.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cpu {
+
+namespace jit {
+class Node;
+struct Output;
+}  // namespace jit
+
+/// A range of host memory read or written by a task
+struct MemoryAccess {
+    uintptr_t begin;
+    uintptr_t end;
+    bool write;
+};
+
+namespace queue_detail {
+
+/// The memory accessed by the arguments of a task. If any of the arguments
+/// can reference memory which cannot be tracked, \p tracked is set to false
+/// and the task is executed as a barrier.
+struct AccessList {
+    std::vector<MemoryAccess> accesses;
+    bool tracked = true;
+
+    void add(const void *ptr, size_t bytes, bool write) {
+        if (ptr == nullptr || bytes == 0) { return; }
+        uintptr_t begin = reinterpret_cast<uintptr_t>(ptr);
+        accesses.push_back({begin, begin + bytes, write});
+    }
+};
+
+template<typename T>
+size_t paramBytes(const af::dim4 &dims, const af::dim4 &strides) {
+    dim_t last = 0;
+    for (int i = 0; i < 4; i++) {
+        if (dims[i] == 0) { return 0; }
+        last += (dims[i] - 1) * strides[i];
+    }
+    return (last + 1) * sizeof(T);
+}
+
+/// Parameters of type CParam are only read by the kernel even if the
+/// argument passed to the queue is a Param
+template<typename P>
+struct is_read_only : std::false_type {};
+
+template<typename T>
+struct is_read_only<CParam<T>> : std::true_type {};
+
+template<typename T>
+void addAccess(AccessList &list, Param<T> param, bool read_only) {
+    list.add(param.get(), paramBytes<T>(param.dims(), param.strides()),
+             !read_only);
+}
+
+template<typename T>
+void addAccess(AccessList &list, const CParam<T> &param, bool) {
+    list.add(param.get(), paramBytes<T>(param.dims(), param.strides()),
+             false);
+}
+
+template<typename T>
+void addAccess(AccessList &list, const std::vector<Param<T>> &params,
+               bool read_only) {
+    for (const auto &param : params) { addAccess(list, param, read_only); }
+}
+
+void addAccess(AccessList &list, const std::shared_ptr<jit::Node> &node,
+               bool);
+void addAccess(AccessList &list,
+               const std::vector<std::shared_ptr<jit::Node>> &nodes, bool);
+void addAccess(AccessList &list, const std::vector<jit::Output> &outputs,
+               bool);
+
+inline void addAccess(AccessList &, const af::dim4 &, bool) {}
+
+template<typename T>
+typename std::enable_if<std::is_arithmetic<T>::value ||
+                        std::is_enum<T>::value>::type
+addAccess(AccessList &, const T &, bool) {}
+
+template<typename T>
+typename std::enable_if<!std::is_arithmetic<T>::value &&
+                        !std::is_enum<T>::value>::type
+addAccess(AccessList &list, const T &, bool) {
+    list.tracked = false;
+}
+
+}  // namespace queue_detail
+
+/// Executes the kernels enqueued on a cpu::queue on a set of worker threads
+///
+/// Each task records the ranges of memory its Param, CParam and JIT tree
+/// arguments read and write. A task only waits for the earlier tasks which
+/// write memory it accesses or read memory it writes, so independent kernels
+/// run concurrently while the results are the same as executing the tasks in
+/// order. Tasks become ready on the worker which finished their last
+/// dependency so that they run where their inputs are in cache. Idle workers
+/// steal ready tasks from the other workers.
+///
+/// Only function pointers are tracked. Lambdas and functors can capture
+/// memory and may call into libraries which are not thread safe, so they are
+/// executed as barriers, as are tasks with arguments of any other type.
+class TaskQueue {
+   public:
+    TaskQueue();
+    ~TaskQueue();
+
+    TaskQueue(const TaskQueue &) = delete;
+    TaskQueue &operator=(const TaskQueue &) = delete;
+
+    template<typename R, typename... P, typename... Args>
+    void enqueue(R (*func)(P...), Args... args) {
+        queue_detail::AccessList list;
+        int dummy[] = {0, (queue_detail::addAccess(
+                               list, args,
+                               queue_detail::is_read_only<P>::value),
+                           0)...};
+        UNUSED(dummy);
+        submit([=]() mutable { func(args...); }, std::move(list.accesses),
+               !list.tracked);
+    }
+
+    template<typename F, typename... Args>
+    void enqueue(const F func, Args... args) {
+        submit([=]() mutable { func(args...); }, {}, true);
+    }
+
+    /// Enqueues \p func after all the tasks in the queue. Tasks enqueued
+    /// later wait for it to finish.
+    void enqueueBarrier(std::function<void()> func);
+
+    /// Blocks until all the enqueued tasks are complete. If a task threw an
+    /// exception, the first one is rethrown here.
+    void sync();
+
+    /// Returns true if called from one of the workers of this queue
+    bool is_worker() const;
+
+   private:
+    struct Task;
+
+    void submit(std::function<void()> func, std::vector<MemoryAccess> accesses,
+                bool barrier);
+    bool popTask(unsigned worker, Task *&task);
+    void work(unsigned worker);
+
+    std::vector<std::thread> workers;
+
+    std::mutex task_mutex;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+
+    // Tasks which are not complete in the order they were enqueued
+    std::vector<std::unique_ptr<Task>> tasks;
+    // Ready tasks of each worker and the ones ready when they were enqueued
+    std::vector<std::deque<Task *>> ready;
+    std::deque<Task *> injected;
+    size_t num_ready;
+    bool stop;
+    std::exception_ptr error;
+};
+
+/// Signals the host and other queues when the tasks enqueued on a TaskQueue
+/// before it was marked are complete
+class TaskEvent {
+    struct State {
+        std::mutex mutex;
+        std::condition_variable cv;
+        unsigned marked    = 0;
+        unsigned completed = 0;
+    };
+    std::shared_ptr<State> state;
+
+   public:
+    TaskEvent() = default;
+    TaskEvent(int val);
+
+    int create();
+    int mark(TaskQueue &queue);
+    int wait(TaskQueue &queue);
+    int sync() noexcept;
+    operator bool() const noexcept { return state != nullptr; }
+};
+
+}  // namespace cpu
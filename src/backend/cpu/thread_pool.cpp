@@ -0,0 +1,119 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#include <thread_pool.hpp>
+
+#include <utility>
+
+using std::condition_variable;
+using std::exception_ptr;
+using std::function;
+using std::lock_guard;
+using std::mutex;
+using std::unique_lock;
+
+namespace cpu {
+
+namespace {
+// Set on the pool workers so that nested parallel regions run serially
+thread_local bool is_pool_thread = false;
+}  // namespace
+
+ThreadPool::ThreadPool(unsigned nthreads)
+    : current_task(nullptr)
+    , current_ntasks(0)
+    , next_task(0)
+    , pending_tasks(0)
+    , generation(0)
+    , stop(false) {
+    for (unsigned i = 1; i < nthreads; ++i) {
+        workers.emplace_back([this] { work(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(task_mutex);
+        stop = true;
+    }
+    start_cv.notify_all();
+    for (auto &worker : workers) { worker.join(); }
+}
+
+void ThreadPool::execute(unsigned job) {
+    while (true) {
+        int idx;
+        const function<void(int)> *task;
+        {
+            lock_guard<mutex> lock(task_mutex);
+            // The job may have finished before a late worker woke up
+            if (generation != job || next_task >= current_ntasks) { return; }
+            idx  = next_task++;
+            task = current_task;
+        }
+
+        exception_ptr err;
+        try {
+            (*task)(idx);
+        } catch (...) { err = std::current_exception(); }
+
+        lock_guard<mutex> lock(task_mutex);
+        if (err && !error) { error = err; }
+        if (--pending_tasks == 0) { done_cv.notify_all(); }
+    }
+}
+
+void ThreadPool::work() {
+    is_pool_thread = true;
+    unsigned seen  = 0;
+    while (true) {
+        {
+            unique_lock<mutex> lock(task_mutex);
+            start_cv.wait(lock, [&] { return stop || generation != seen; });
+            if (stop) { return; }
+            seen = generation;
+        }
+        execute(seen);
+    }
+}
+
+void ThreadPool::run(int ntasks, const function<void(int)> &task) {
+    unique_lock<mutex> submit(submit_mutex, std::try_to_lock);
+    if (is_pool_thread || workers.empty() || ntasks <= 1 || !submit) {
+        for (int i = 0; i < ntasks; ++i) { task(i); }
+        return;
+    }
+
+    unsigned job;
+    {
+        lock_guard<mutex> lock(task_mutex);
+        current_task   = &task;
+        current_ntasks = ntasks;
+        next_task      = 0;
+        pending_tasks  = ntasks;
+        error          = nullptr;
+        job            = ++generation;
+    }
+    start_cv.notify_all();
+
+    is_pool_thread = true;
+    execute(job);
+    is_pool_thread = false;
+
+    exception_ptr err;
+    {
+        unique_lock<mutex> lock(task_mutex);
+        done_cv.wait(lock, [this] { return pending_tasks == 0; });
+        current_task = nullptr;
+        err          = std::move(error);
+    }
+    if (err) { std::rethrow_exception(err); }
+}
+
+}  // namespace cpu
@@ -0,0 +1,96 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+#pragma once
+
+#include <af/defines.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cpu {
+
+/// A fixed size pool of worker threads used to split data parallel kernels
+///
+/// Kernels are still enqueued on the cpu::queue. The pool is only used from
+/// within a kernel to partition its iteration space so that a single kernel
+/// can make use of all the cores on the machine.
+class ThreadPool {
+   public:
+    /// Creates a pool which runs tasks on \p nthreads threads. The calling
+    /// thread participates in the work so only nthreads - 1 workers are
+    /// spawned.
+    explicit ThreadPool(unsigned nthreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /// Number of threads(including the calling thread) used by run
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    /// Calls \p task with every index in [0, ntasks) and blocks until all the
+    /// tasks are complete. If a task throws, the first exception is rethrown
+    /// on the calling thread after all the tasks finish.
+    ///
+    /// Calls made from a pool thread or while another thread is using the
+    /// pool are executed serially on the calling thread.
+    void run(int ntasks, const std::function<void(int)> &task);
+
+   private:
+    void work();
+    void execute(unsigned job);
+
+    std::vector<std::thread> workers;
+    std::mutex submit_mutex;
+
+    std::mutex task_mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    const std::function<void(int)> *current_task;
+    int current_ntasks;
+    int next_task;
+    int pending_tasks;
+    unsigned generation;
+    bool stop;
+    std::exception_ptr error;
+};
+
+ThreadPool &getThreadPool();
+
+/// Splits [\p begin, \p end) into at most getThreadPool().size() contiguous
+/// blocks of at least \p grain elements and calls \p func(block_begin,
+/// block_end) for each of them in parallel.
+template<typename F>
+void parallel_for(dim_t begin, dim_t end, dim_t grain, F &&func) {
+    const dim_t len = end - begin;
+    if (len <= 0) { return; }
+
+    ThreadPool &pool   = getThreadPool();
+    const dim_t blocks = std::min(static_cast<dim_t>(pool.size()),
+                                  (len + grain - 1) / std::max(grain, dim_t(1)));
+    if (blocks <= 1) {
+        func(begin, end);
+        return;
+    }
+
+    const dim_t block_len = (len + blocks - 1) / blocks;
+    pool.run(static_cast<int>(blocks), [&](int b) {
+        dim_t b_begin = begin + b * block_len;
+        dim_t b_end   = std::min(end, b_begin + block_len);
+        if (b_begin < b_end) { func(b_begin, b_end); }
+    });
+}
+
+}  // namespace cpu
@@ -18,18 +18,22 @@ namespace cuda {
 
 template<typename inType, typename outType, bool isColor>
 Array<outType> bilateral(const Array<inType> &in, const float &s_sigma,
-                         const float &c_sigma) {
+                         const float &c_sigma, const af_bilateral_mode mode) {
+    // The bilateral grid is only implemented by the CPU backend
+    UNUSED(mode);
     UNUSED(isColor);
     Array<outType> out = createEmptyArray<outType>(in.dims());
     kernel::bilateral<inType, outType>(out, in, s_sigma, c_sigma);
     return out;
 }
 
-#define INSTANTIATE(inT, outT)                                             \
-    template Array<outT> bilateral<inT, outT, true>(                       \
-        const Array<inT> &in, const float &s_sigma, const float &c_sigma); \
-    template Array<outT> bilateral<inT, outT, false>(                      \
-        const Array<inT> &in, const float &s_sigma, const float &c_sigma);
+#define INSTANTIATE(inT, outT)                                            \
+    template Array<outT> bilateral<inT, outT, true>(                      \
+        const Array<inT> &in, const float &s_sigma, const float &c_sigma, \
+        const af_bilateral_mode mode);                                    \
+    template Array<outT> bilateral<inT, outT, false>(                     \
+        const Array<inT> &in, const float &s_sigma, const float &c_sigma, \
+        const af_bilateral_mode mode);
 
 INSTANTIATE(double, double)
 INSTANTIATE(float, float)
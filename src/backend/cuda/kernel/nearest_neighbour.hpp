@@ -52,7 +52,7 @@ struct dist_op<uint, To, AF_SHD> {
 
 template<typename To>
 struct dist_op<uintl, To, AF_SHD> {
-    __device__ To operator()(uintl v1, uintl v2) { return __popc(v1 ^ v2); }
+    __device__ To operator()(uintl v1, uintl v2) { return __popcll(v1 ^ v2); }
 };
 
 template<typename To>
@@ -9,6 +9,7 @@
 #pragma once
 
 #include <common/AllocatorInterface.hpp>
+#include <af/device.h>
 
 #include <cstdlib>
 #include <functional>
@@ -52,6 +53,7 @@ void shutdownMemoryManager();
 void pinnedGarbageCollect();
 
 void printMemInfo(const char *msg, const int device);
+void deviceMemoryStats(af_memory_stats *stats, const int device);
 
 float getMemoryPressure();
 float getMemoryPressureThreshold();
@@ -621,7 +621,7 @@ MemoryManagerBase& memoryManager() {
 
     std::call_once(flag, [&]() {
         // By default, create an instance of the default memory manager
-        inst.memManager = std::make_unique<common::DefaultMemoryManager>(
+        inst.memManager = common::createDefaultMemoryManager(
             getDeviceCount(), common::MAX_BUFFERS,
             AF_MEM_DEBUG || AF_OPENCL_MEM_DEBUG);
         // Set the memory manager's device memory manager
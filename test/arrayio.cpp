@@ -13,6 +13,7 @@
 #include <testHelpers.hpp>
 
 #include <complex>
+#include <fstream>
 #include <string>
 #include <vector>
 
@@ -20,8 +21,13 @@ using af::allTrue;
 using af::array;
 using af::constant;
 using af::dim4;
+using af::randu;
+using af::range;
 using af::readArray;
+using af::readArrayCheck;
 using af::saveArray;
+using af::seq;
+using af::span;
 using std::complex;
 using std::string;
 using std::vector;
@@ -125,3 +131,88 @@ TEST(ArrayIO, Save) {
     ASSERT_ARRAYS_EQ(a, aread);
     ASSERT_ARRAYS_EQ(b, bread);
 }
+
+TEST(ArrayIO, SaveAppendTypes) {
+    array a = randu(100, 20);
+    array b = randu(7, 3, 2, c64);
+    array c = range(dim4(5, 5), 1, s16);
+    array e;
+
+    ASSERT_EQ(0, saveArray("a", a, "arr_types.af"));
+    ASSERT_EQ(1, saveArray("e", e, "arr_types.af", true));
+    ASSERT_EQ(2, saveArray("b", b, "arr_types.af", true));
+    ASSERT_EQ(3, saveArray("c", c, "arr_types.af", true));
+
+    ASSERT_EQ(2, readArrayCheck("arr_types.af", "b"));
+    ASSERT_EQ(-1, readArrayCheck("arr_types.af", "d"));
+
+    ASSERT_ARRAYS_EQ(a, readArray("arr_types.af", "a"));
+    ASSERT_ARRAYS_EQ(b, readArray("arr_types.af", "b"));
+    ASSERT_ARRAYS_EQ(c, readArray("arr_types.af", 3u));
+    ASSERT_TRUE(readArray("arr_types.af", "e").isempty());
+
+    // Overwriting the file discards the other arrays
+    ASSERT_EQ(0, saveArray("c", c, "arr_types.af"));
+    ASSERT_EQ(-1, readArrayCheck("arr_types.af", "a"));
+    ASSERT_ARRAYS_EQ(c, readArray("arr_types.af", 0u));
+}
+
+TEST(ArrayIO, ReadSlice) {
+    array a = randu(100, 50, 3);
+    saveArray("a", a, "arr_slice.af");
+
+    ASSERT_ARRAYS_EQ(
+        a(seq(10, 19), seq(5, 40, 5)),
+        readArray("arr_slice.af", "a", seq(10, 19), seq(5, 40, 5)));
+    ASSERT_ARRAYS_EQ(a(span, seq(10, 20)),
+                     readArray("arr_slice.af", "a", span, seq(10, 20)));
+    ASSERT_ARRAYS_EQ(a(seq(99, 0, -1), span, 2),
+                     readArray("arr_slice.af", "a", seq(99, 0, -1), span,
+                               seq(2, 2)));
+}
+
+TEST(ArrayIO, ReadSliceVersion1) {
+    string file = string(TEST_DIR) + "/arrayio/f32.arr";
+    array a     = readArray(file.c_str(), "f32");
+
+    ASSERT_ARRAYS_EQ(a(seq(2, 4), seq(1, 9, 2)),
+                     readArray(file.c_str(), "f32", seq(2, 4), seq(1, 9, 2)));
+}
+
+TEST(ArrayIO, ReadSliceOutOfBounds) {
+    array a = randu(10, 10);
+    saveArray("a", a, "arr_slice_bounds.af");
+
+    ASSERT_THROW(readArray("arr_slice_bounds.af", "a", seq(20, 0, -1)),
+                 af::exception);
+    ASSERT_THROW(readArray("arr_slice_bounds.af", "a", seq(5, 10)),
+                 af::exception);
+}
+
+TEST(ArrayIO, AppendGrowsLinearly) {
+    const int n = 100;
+    for (int i = 0; i < n; i++) {
+        saveArray(std::to_string(i).c_str(), constant(i, 1), "arr_grow.af",
+                  i > 0);
+    }
+
+    // Each array adds its aligned data and an index entry with a short key
+    std::ifstream fs("arr_grow.af", std::ifstream::binary | std::ifstream::ate);
+    ASSERT_LE(static_cast<long long>(fs.tellg()), 64 + n * (64 + 64));
+    ASSERT_ARRAYS_EQ(constant(42, 1), readArray("arr_grow.af", "42"));
+}
+
+TEST(ArrayIO, CorruptIndex) {
+    saveArray("a", randu(10, 10), "arr_corrupt.af");
+
+    // Point the index past the end of the file
+    std::fstream fs("arr_corrupt.af", std::fstream::in | std::fstream::out |
+                                          std::fstream::binary);
+    long long index_offset = 1 << 20;
+    fs.seekp(8);
+    fs.write(reinterpret_cast<char *>(&index_offset), sizeof(index_offset));
+    fs.close();
+
+    ASSERT_THROW(readArray("arr_corrupt.af", "a"), af::exception);
+    ASSERT_THROW(readArrayCheck("arr_corrupt.af", "a"), af::exception);
+}
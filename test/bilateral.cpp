@@ -16,8 +16,17 @@
 #include <string>
 #include <vector>
 
+using af::array;
+using af::bilateral;
+using af::constant;
 using af::dim4;
 using af::dtype_traits;
+using af::iota;
+using af::max;
+using af::mean;
+using af::seq;
+using af::sin;
+using af::span;
 using std::abs;
 using std::string;
 using std::vector;
@@ -154,9 +163,6 @@ TYPED_TEST(BilateralOnData, InvalidArgs) {
 
 // C++ unit tests
 
-using af::array;
-using af::bilateral;
-
 TEST(Bilateral, CPP) {
     vector<dim4> numDims;
     vector<vector<float> > in;
@@ -181,12 +187,6 @@ TEST(Bilateral, CPP) {
     }
 }
 
-using af::constant;
-using af::iota;
-using af::max;
-using af::seq;
-using af::span;
-
 TEST(bilateral, GFOR) {
     dim4 dims = dim4(10, 10, 3);
     array A   = iota(dims);
@@ -200,3 +200,26 @@ TEST(bilateral, GFOR) {
         ASSERT_EQ(max<double>(abs(c_ii - b_ii)) < 1E-5, true);
     }
 }
+
+TEST(bilateral, GridApproximatesExact) {
+    const dim4 dims(200, 160);
+    array x   = iota(dims, dim4(1), f32);
+    array y   = iota(dim4(1, dims[1]), dim4(dims[0]), f32);
+    array in  = 60.0f + 120.0f * (((x / 40).as(s32) + (y / 40).as(s32)) % 2) +
+               30.0f * sin(0.02f * x);
+    array ref = bilateral(in, 5.0f, 20.0f, false, AF_BILATERAL_EXACT);
+    array out = bilateral(in, 5.0f, 20.0f, false, AF_BILATERAL_GRID);
+
+    ASSERT_LT(mean<float>(abs(ref - out)), 1.0f);
+    ASSERT_LT(max<float>(abs(ref - out)), 8.0f);
+}
+
+TEST(bilateral, InvalidMode) {
+    af_array in  = 0;
+    af_array out = 0;
+    dim_t dims[] = {10, 10};
+    ASSERT_SUCCESS(af_randu(&in, 2, dims, f32));
+    ASSERT_EQ(AF_ERR_ARG, af_bilateral_v2(&out, in, 2.25f, 25.56f, false,
+                                          (af_bilateral_mode)3));
+    ASSERT_SUCCESS(af_release_array(in));
+}
@@ -825,6 +825,49 @@ TEST(Convolve, CuboidBatchLaunchBugFix) {
     ASSERT_VEC_ARRAY_NEAR(tests[0], sDims, output, 1.0e-3);
 }
 
+TEST(Convolve, AutoDomainMatchesSpatial) {
+    // Large enough for the CPU backend to pick the FFT for a filter size
+    // which is convolved spatially by the GPU backends
+    array signal = randu(1000, 1000);
+    array filter = randu(15, 15);
+
+    array spatial = convolve2(signal, filter, AF_CONV_DEFAULT, AF_CONV_SPATIAL);
+    array autodom = convolve2(signal, filter, AF_CONV_DEFAULT, AF_CONV_AUTO);
+
+    ASSERT_ARRAYS_NEAR(spatial, autodom, 1e-3);
+
+    // The CPU backend picks the FFT, which gives the same result as asking
+    // for it
+    if (af::getActiveBackend() == AF_BACKEND_CPU) {
+        array freq = convolve2(signal, filter, AF_CONV_DEFAULT, AF_CONV_FREQ);
+        ASSERT_ARRAYS_EQ(freq, autodom);
+    }
+}
+
+TEST(Convolve, AutoDomainIntegerIsSpatial) {
+    // The sums need more bits than the mantissa of a float, so only the
+    // spatial convolution gives the exact result
+    array signal = (randu(1000, 1000) * 1000).as(s32);
+    array filter = (randu(15, 15) * 100).as(s32);
+
+    // The CPU backend picks the FFT for floating point data of these sizes
+    if (af::getActiveBackend() == AF_BACKEND_CPU) {
+        array fsignal = signal.as(f32);
+        array ffilter = filter.as(f32);
+        array ffreq =
+            convolve2(fsignal, ffilter, AF_CONV_DEFAULT, AF_CONV_FREQ);
+        array fauto =
+            convolve2(fsignal, ffilter, AF_CONV_DEFAULT, AF_CONV_AUTO);
+        ASSERT_ARRAYS_EQ(ffreq, fauto);
+    }
+
+    array spatial = convolve2(signal, filter, AF_CONV_DEFAULT, AF_CONV_SPATIAL);
+    array autodom = convolve2(signal, filter, AF_CONV_DEFAULT, AF_CONV_AUTO);
+
+    ASSERT_EQ(s32, autodom.type());
+    ASSERT_ARRAYS_EQ(spatial, autodom);
+}
+
 struct conv2_strided_params {
     string testname_;
     dim4 signal_sz_, filt_sz_, stride_, padding_, dilation_;
@@ -913,3 +913,19 @@ TEST_P(FFTC2R3D, InPlaceIFFT3MatchesOutOfPlace) {
 
     ASSERT_ARRAYS_EQ(a, b);
 }
+
+TEST(fft, PlanCacheReuse) {
+    af::setFFTPlanCacheSize(2);
+
+    // More transforms than cached plans so that plans are evicted and
+    // created again
+    array in[] = {randu(100, c32), randu(64, 4, c32), randu(dim4(37, 3), c64)};
+    vector<array> gold;
+    for (const array &a : in) { gold.push_back(fft(a)); }
+
+    for (int iter = 0; iter < 2; ++iter) {
+        for (int i = 0; i < 3; ++i) { ASSERT_ARRAYS_EQ(gold[i], fft(in[i])); }
+    }
+
+    af::setFFTPlanCacheSize(5);
+}
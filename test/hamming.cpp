@@ -153,3 +153,25 @@ TEST(HammingMatcher, CPP) {
     delete[] outIdx;
     delete[] outDist;
 }
+
+TEST(HammingMatcher, UpperBits64) {
+    using af::array;
+    using af::dim4;
+
+    // The train samples only differ from the query in their upper 32 bits
+    const uintl h_query[2] = {0x0ull, 0xFFFFFFFFFFFFFFFFull};
+    const uintl h_train[6] = {0xFFFF000000000000ull, 0x0ull,
+                              0xF000000000000000ull, 0x0ull,
+                              0xFF00000000000000ull, 0x0ull};
+
+    array query(dim4(2, 1), h_query);
+    array train(dim4(2, 3), h_train);
+
+    array idx, dist;
+    hammingMatcher(idx, dist, query, train, 0, 3);
+
+    const uint h_gold_idx[3]  = {1, 2, 0};
+    const uint h_gold_dist[3] = {68, 72, 80};
+    ASSERT_ARRAYS_EQ(array(dim4(3), h_gold_idx), idx);
+    ASSERT_ARRAYS_EQ(array(dim4(3), h_gold_dist), dist);
+}
@@ -282,3 +282,21 @@ TEST(histogram, LargeBins) {
 
     for (int i = 0; i < nbins; i++) { ASSERT_EQ(hH[i], 0u); }
 }
+
+TEST(histogram, LargeIndexedU16) {
+    const int nbins = 100;
+    const dim_t dim = 1024;
+    array A = (randu(dim + 3, dim, u16) % 1000).as(u16);
+    array B = A(seq(dim), span);
+    array H = histogram(B, nbins, 0, 1000);
+
+    vector<unsigned short> hB(dim * dim);
+    B.host(hB.data());
+
+    vector<unsigned> hH(nbins);
+    H.host(hH.data());
+
+    for (size_t i = 0; i < hB.size(); i++) { hH[hB[i] / 10] -= 1; }
+
+    for (int i = 0; i < nbins; i++) { ASSERT_EQ(hH[i], 0u); }
+}
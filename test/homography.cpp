@@ -285,3 +285,55 @@ TEST(Homography, CPP) {
     delete[] gold_t;
     delete[] out_t;
 }
+
+TEST(Homography, SyntheticManyHypotheses) {
+    // The CPU backend scores the hypotheses in parallel rounds and stops
+    // scoring those that cannot beat the earlier rounds. A fifth of the
+    // points are outliers, so the exact inliers are all found whichever
+    // round finds the first hypothesis made only of them.
+    if (af::getActiveBackend() != AF_BACKEND_CPU) { return; }
+
+    const int n       = 2000;
+    const int ninlier = 1600;
+    const double H0[] = {0.9, -0.1, 30, 0.15, 1.1, -20, 1e-4, -2e-4, 1};
+
+    vector<float> xs(n), ys(n), xd(n), yd(n);
+    for (int i = 0; i < n; i++) {
+        xs[i] = (i * 37) % 200 + 0.25f * (i % 4);
+        ys[i] = (i * 91) % 150 + 0.5f * (i % 3);
+
+        double w = H0[6] * xs[i] + H0[7] * ys[i] + H0[8];
+        double x = (H0[0] * xs[i] + H0[1] * ys[i] + H0[2]) / w;
+        double y = (H0[3] * xs[i] + H0[4] * ys[i] + H0[5]) / w;
+        if (i % 5 == 4) {
+            x += 40 + i % 23;
+            y -= 35 + i % 17;
+        }
+        xd[i] = x;
+        yd[i] = y;
+    }
+
+    array x_src(n, xs.data());
+    array y_src(n, ys.data());
+    array x_dst(n, xd.data());
+    array y_dst(n, yd.data());
+
+    const af_homography_type types[] = {AF_HOMOGRAPHY_RANSAC,
+                                        AF_HOMOGRAPHY_LMEDS};
+    for (af_homography_type htype : types) {
+        af::setSeed(1);
+        array H;
+        int inliers = 0;
+        homography(H, inliers, x_src, y_src, x_dst, y_dst, htype, 3.0f, 1000,
+                   f32);
+
+        ASSERT_EQ(ninlier, inliers) << "for type " << htype;
+
+        vector<float> hH(9);
+        H.host(hH.data());
+        for (int i = 0; i < 9; i++) {
+            ASSERT_NEAR(H0[i], hH[i] / hH[8], 1e-2 * (abs(H0[i]) + 1e-3))
+                << "at " << i << " for type " << htype;
+        }
+    }
+}
@@ -18,6 +18,7 @@
 using af::array;
 using af::cdouble;
 using af::cfloat;
+using af::constant;
 using af::convolve1;
 using af::dim4;
 using af::dtype;
@@ -158,3 +159,45 @@ TYPED_TEST(filter, iirVecMat) {
 TYPED_TEST(filter, iirMatMat) {
     iirTest<TypeParam>(TEST_DIR "/iir/iir_mm.test");
 }
+
+template<typename T>
+void iirLongTest(const int xrows, const int xcols) {
+    SUPPORTED_TYPE_CHECK(T);
+    try {
+        dtype ty = (dtype)dtype_traits<T>::af_type;
+        const double ha[] = {1.0, -1.5, 0.56};
+        const T ta[]      = {T(ha[0]), T(ha[1]), T(ha[2])};
+
+        array x = randu(xrows, xcols, ty);
+        array b = constant(1, 1, ty);
+        array a = array(3, ta);
+
+        array y = iir(b, a, x);
+
+        vector<T> hx(xrows * xcols);
+        vector<T> hy(xrows * xcols);
+        x.host(&hx[0]);
+        y.host(&hy[0]);
+
+        for (int j = 0; j < xcols; j++) {
+            const T *col = &hx[j * xrows];
+            vector<T> gold(xrows);
+            for (int i = 0; i < xrows; i++) {
+                T val = col[i];
+                if (i > 0) { val = val - ha[1] * gold[i - 1]; }
+                if (i > 1) { val = val - ha[2] * gold[i - 2]; }
+                gold[i] = val / ha[0];
+            }
+            for (int i = 0; i < xrows; i++) {
+                ASSERT_NEAR(real(hy[j * xrows + i]), real(gold[i]), 0.01)
+                    << "at: " << i << ", " << j;
+                ASSERT_NEAR(imag(hy[j * xrows + i]), imag(gold[i]), 0.01)
+                    << "at: " << i << ", " << j;
+            }
+        }
+    } catch (exception &ex) { FAIL() << ex.what(); }
+}
+
+TYPED_TEST(filter, iirLongVec) { iirLongTest<TypeParam>(1000000, 1); }
+
+TYPED_TEST(filter, iirLongMat) { iirLongTest<TypeParam>(300000, 2); }
@@ -0,0 +1,104 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+// Runs the chunked IIR filter of the CPU backend with fixed chunk counts.
+// The backend only splits a signal into chunks when its thread pool has at
+// least three threads, so the kernel is linked directly and given a pool of
+// its own.
+
+#include <gtest/gtest.h>
+#include <kernel/iir.hpp>
+
+#include <cmath>
+#include <complex>
+#include <vector>
+
+using std::abs;
+using std::complex;
+using std::vector;
+
+namespace cpu {
+ThreadPool &getThreadPool() {
+    static ThreadPool pool(4);
+    return pool;
+}
+}  // namespace cpu
+
+template<typename T>
+class IirChunks : public ::testing::Test {};
+
+typedef ::testing::Types<float, double, complex<float>, complex<double>>
+    TestTypes;
+TYPED_TEST_CASE(IirChunks, TestTypes);
+
+template<typename T>
+double tolerance() {
+    return 1e-4;
+}
+template<>
+double tolerance<double>() {
+    return 1e-10;
+}
+template<>
+double tolerance<complex<double>>() {
+    return 1e-10;
+}
+
+template<typename T>
+void iirChunksTest(const vector<T> &a, dim_t len) {
+    const int num_a = a.size();
+
+    vector<T> c(len);
+    for (dim_t i = 0; i < len; i++) { c[i] = T((i * 37) % 101 - 50); }
+
+    // Direct form of the recursion
+    vector<T> gold(len);
+    for (dim_t i = 0; i < len; i++) {
+        T sum = c[i];
+        for (int k = 1; k < num_a && k <= i; k++) {
+            sum -= a[k] * gold[i - k];
+        }
+        gold[i] = sum / a[0];
+    }
+
+    // Chunk counts below, at and above the size of the pool
+    for (dim_t nchunks = 2; nchunks <= 9; nchunks++) {
+        vector<T> y(len);
+        cpu::kernel::iirChunks(y.data(), c.data(), a.data(), num_a, len,
+                               nchunks);
+        for (dim_t i = 0; i < len; i++) {
+            ASSERT_NEAR(0, abs(y[i] - gold[i]),
+                        tolerance<T>() * (1 + abs(gold[i])))
+                << "at " << i << " of " << len << " in " << nchunks
+                << " chunks";
+        }
+    }
+}
+
+TYPED_TEST(IirChunks, FirstOrder) {
+    vector<TypeParam> a = {TypeParam(1), TypeParam(-0.9)};
+    iirChunksTest(a, 10000);
+    iirChunksTest(a, 10007);
+}
+
+TYPED_TEST(IirChunks, HigherOrder) {
+    vector<TypeParam> a = {TypeParam(2), TypeParam(-1.2), TypeParam(0.5),
+                           TypeParam(-0.1)};
+    iirChunksTest(a, 10000);
+    iirChunksTest(a, 4099);
+}
+
+TYPED_TEST(IirChunks, ShortChunks) {
+    // Fewer samples per chunk than the order of the filter, and a last
+    // chunk shorter than the others
+    vector<TypeParam> a = {TypeParam(1), TypeParam(-0.5), TypeParam(0.25),
+                           TypeParam(-0.125), TypeParam(0.0625)};
+    iirChunksTest(a, 10);
+    iirChunksTest(a, 23);
+}
@@ -198,6 +198,67 @@ TEST(JIT, CPP_Multi_strided) {
     }
 }
 
+TEST(JIT, CPP_Multi_strided_shared_node) {
+    const dim4 dims(300, 40, 7, 3);
+    array a = randu(dims, s32);
+    array b = randu(dims, s32);
+    array s = a(seq(0, af::end, 2), af::span, af::span, af::span);
+    array t = b(seq(1, af::end, 2), af::span, af::span, af::span);
+
+    // common is shared between both the outputs
+    array common = s * t;
+    array x      = common + s;
+    array y      = common - t;
+    eval(x, y);
+
+    vector<int> hs(s.elements());
+    vector<int> ht(t.elements());
+    s.host(hs.data());
+    t.host(ht.data());
+
+    vector<int> goldx(s.elements());
+    vector<int> goldy(s.elements());
+    for (size_t i = 0; i < hs.size(); i++) {
+        goldx[i] = hs[i] * ht[i] + hs[i];
+        goldy[i] = hs[i] * ht[i] - ht[i];
+    }
+
+    ASSERT_VEC_ARRAY_EQ(goldx, s.dims(), x);
+    ASSERT_VEC_ARRAY_EQ(goldy, s.dims(), y);
+}
+
+TEST(JIT, CPP_Multi_mixed_types) {
+    const int num = 1 << 16;
+    array a       = randu(num, s32);
+    array b       = randu(num, s32);
+    array x       = (a + b).as(f32);
+    array y       = a - b;
+    array z       = a > b;
+    eval(x, y, z);
+
+    ASSERT_EQ(f32, x.type());
+    ASSERT_EQ(s32, y.type());
+    ASSERT_EQ(b8, z.type());
+
+    vector<int> ha(num);
+    vector<int> hb(num);
+    a.host(&ha[0]);
+    b.host(&hb[0]);
+
+    vector<float> goldx(num);
+    vector<int> goldy(num);
+    vector<char> goldz(num);
+    for (int i = 0; i < num; i++) {
+        goldx[i] = static_cast<float>(ha[i] + hb[i]);
+        goldy[i] = ha[i] - hb[i];
+        goldz[i] = ha[i] > hb[i];
+    }
+
+    ASSERT_VEC_ARRAY_EQ(goldx, dim4(num), x);
+    ASSERT_VEC_ARRAY_EQ(goldy, dim4(num), y);
+    ASSERT_VEC_ARRAY_EQ(goldz, dim4(num), z);
+}
+
 TEST(JIT, CPP_Multi_pre_eval) {
     const int num = 1 << 16;
     array a       = randu(num, s32);
@@ -230,6 +291,121 @@ TEST(JIT, CPP_Multi_pre_eval) {
     }
 }
 
+TEST(JIT, CPP_Multi_scalar_operands) {
+    const dim4 dims(300, 40, 7, 3);
+    array a = randu(dims, s32);
+    array s = a(seq(0, af::end, 2), af::span, af::span, af::span);
+
+    // The scalar nodes are shared between both outputs and both paths
+    array lx = (a + 3) * 2;
+    array ly = 7 - a * 2;
+    array sx = (s + 3) * 2;
+    array sy = 7 - s * 2;
+    eval(lx, ly);
+    eval(sx, sy);
+
+    vector<int> ha(a.elements());
+    vector<int> hs(s.elements());
+    a.host(ha.data());
+    s.host(hs.data());
+
+    vector<int> goldlx(ha.size());
+    vector<int> goldly(ha.size());
+    for (size_t i = 0; i < ha.size(); i++) {
+        goldlx[i] = (ha[i] + 3) * 2;
+        goldly[i] = 7 - ha[i] * 2;
+    }
+    vector<int> goldsx(hs.size());
+    vector<int> goldsy(hs.size());
+    for (size_t i = 0; i < hs.size(); i++) {
+        goldsx[i] = (hs[i] + 3) * 2;
+        goldsy[i] = 7 - hs[i] * 2;
+    }
+
+    ASSERT_VEC_ARRAY_EQ(goldlx, a.dims(), lx);
+    ASSERT_VEC_ARRAY_EQ(goldly, a.dims(), ly);
+    ASSERT_VEC_ARRAY_EQ(goldsx, s.dims(), sx);
+    ASSERT_VEC_ARRAY_EQ(goldsy, s.dims(), sy);
+}
+
+TEST(JIT, CPP_single_op_leaves) {
+    // Operations directly over buffers and scalars. The length is not a
+    // multiple of the chunk size and spans several threads.
+    const int num = 100003;
+    array a       = randu(num, s32) % 1000 - 500;
+    array b       = randu(num, s32) % 1000 - 500;
+    eval(a, b);
+
+    array sum  = a + b;
+    array rsub = 7 - a;
+    array less = a < b;
+    array toF  = a.as(f32);
+    toF.eval();
+    array absA = abs(toF);
+
+    vector<int> ha(num);
+    vector<int> hb(num);
+    a.host(ha.data());
+    b.host(hb.data());
+
+    vector<int> goldSum(num);
+    vector<int> goldRsub(num);
+    vector<char> goldLess(num);
+    vector<float> goldToF(num);
+    vector<float> goldAbs(num);
+    for (int i = 0; i < num; i++) {
+        goldSum[i]  = ha[i] + hb[i];
+        goldRsub[i] = 7 - ha[i];
+        goldLess[i] = ha[i] < hb[i];
+        goldToF[i]  = static_cast<float>(ha[i]);
+        goldAbs[i]  = std::abs(goldToF[i]);
+    }
+
+    ASSERT_VEC_ARRAY_EQ(goldSum, dim4(num), sum);
+    ASSERT_VEC_ARRAY_EQ(goldRsub, dim4(num), rsub);
+    ASSERT_VEC_ARRAY_EQ(goldLess, dim4(num), less);
+    ASSERT_VEC_ARRAY_EQ(goldToF, dim4(num), toF);
+    ASSERT_VEC_ARRAY_EQ(goldAbs, dim4(num), absA);
+}
+
+TEST(JIT, CPP_shared_intermediate_separate_evals) {
+    // The evaluations share the intermediate node c and the buffer nodes of
+    // a and b but are enqueued separately, so the backend may run them at
+    // the same time
+    const int num  = 1 << 16;
+    const int nout = 16;
+    array a        = randu(num, s32);
+    array b        = randu(num, s32);
+    array s        = a(seq(0, af::end, 2));
+    array c        = a + b;
+    array d        = s * 3;
+
+    vector<array> xs;
+    vector<array> ys;
+    for (int i = 0; i < nout; i++) {
+        xs.push_back(c * (i + 2));
+        ys.push_back(d - i);
+    }
+    for (int i = 0; i < nout; i++) {
+        xs[i].eval();
+        ys[i].eval();
+    }
+
+    vector<int> ha(num);
+    vector<int> hb(num);
+    a.host(&ha[0]);
+    b.host(&hb[0]);
+
+    for (int i = 0; i < nout; i++) {
+        vector<int> goldx(num);
+        vector<int> goldy(num / 2);
+        for (int j = 0; j < num; j++) { goldx[j] = (ha[j] + hb[j]) * (i + 2); }
+        for (int j = 0; j < num / 2; j++) { goldy[j] = ha[2 * j] * 3 - i; }
+        ASSERT_VEC_ARRAY_EQ(goldx, dim4(num), xs[i]);
+        ASSERT_VEC_ARRAY_EQ(goldy, dim4(num / 2), ys[i]);
+    }
+}
+
 TEST(JIT, CPP_common_node) {
     array r = seq(-3, 3, 0.5);
 
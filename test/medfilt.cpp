@@ -434,6 +434,8 @@ using af::iota;
 using af::max;
 using af::medfilt;
 using af::medfilt1;
+using af::medfilt2;
+using af::randu;
 using af::seq;
 using af::span;
 
@@ -464,3 +466,40 @@ TEST(MedianFilter1d, GFOR) {
         ASSERT_EQ(max<double>(abs(c_ii - b_ii)) < 1E-5, true);
     }
 }
+
+TEST(MedianFilter1d, Columns) {
+    array A = randu(50, 4, u8);
+    array B = medfilt1(A, 5, AF_PAD_SYM);
+
+    for (int ii = 0; ii < 4; ii++) {
+        array c_ii = medfilt1(A(span, ii), 5, AF_PAD_SYM);
+        ASSERT_ARRAYS_EQ(c_ii, B(span, ii));
+    }
+}
+
+TEST(MedianFilter, LargeWindow) {
+    // 8-bit, 16-bit and floating point inputs take different paths in some
+    // backends and must all give the same medians
+    array A = (randu(64, 48) * 255).as(u8);
+    array B = medfilt2(A, 15, 15, AF_PAD_SYM);
+
+    ASSERT_ARRAYS_EQ(B.as(u16), medfilt2(A.as(u16), 15, 15, AF_PAD_SYM));
+    ASSERT_ARRAYS_EQ(B.as(f32), medfilt2(A.as(f32), 15, 15, AF_PAD_SYM));
+}
+
+TEST(MedianFilter, NaN) {
+    // The medians of the windows without a NaN must not depend on the NaNs
+    // in the windows above them
+    array A = randu(64, 48);
+    A(10, 5)  = af::NaN;
+    A(20, 5)  = af::NaN;
+    A(30, 40) = af::NaN;
+
+    array B = medfilt2(A, 5, 5, AF_PAD_ZERO);
+    array C = medfilt2(af::select(af::isNaN(A), 0.f, A), 5, 5, AF_PAD_ZERO);
+
+    array nearNaN = af::dilate(af::isNaN(A), constant(1, 5, 5, b8));
+    B(nearNaN)    = 0;
+    C(nearNaN)    = 0;
+    ASSERT_ARRAYS_EQ(C, B);
+}
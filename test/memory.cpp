@@ -600,6 +600,35 @@ TEST(Memory, unlock) {
     ASSERT_EQ(lock_bytes, 0u);
 }
 
+TEST(Memory, Stats) {
+    cleanSlate();  // Clean up everything done so far
+
+    // 1000 floats are rounded up to a 4KB buffer
+    const int bucket             = 12;
+    const af_memory_stats before = af::deviceMemStats();
+    {
+        array a = af::constant(1, 1000, f32);
+        a.eval();
+    }
+    {
+        // Reuses the buffer of a
+        array b = af::constant(2, 1000, f32);
+        b.eval();
+    }
+    deviceGC();
+    const af_memory_stats after = af::deviceMemStats();
+
+    EXPECT_EQ(1u, after.cache_misses[bucket] - before.cache_misses[bucket]);
+    EXPECT_EQ(1u, after.cache_hits[bucket] - before.cache_hits[bucket]);
+    EXPECT_EQ(8000u, after.requested_bytes - before.requested_bytes);
+    EXPECT_EQ(8192u, after.rounded_bytes - before.rounded_bytes);
+    EXPECT_EQ(1u, after.native_allocs - before.native_allocs);
+    EXPECT_EQ(1u, after.native_frees - before.native_frees);
+    EXPECT_EQ(1u, after.garbage_collections - before.garbage_collections);
+    EXPECT_LE(4096u, after.peak_lock_bytes);
+    EXPECT_LE(after.peak_lock_bytes, after.peak_alloc_bytes);
+}
+
 TEST(Memory, IndexedDevice) {
     // This test is checking to see if calling .device() will force copy to a
     // new buffer
@@ -893,3 +922,49 @@ TEST(MemoryManagerApi, E2ETest) {
     ASSERT_EQ(payload->initializeCalledTimes, 1);
     ASSERT_EQ(payload->shutdownCalledTimes, af::getDeviceCount());
 }
+
+namespace {
+void setEnv(const char *name, const char *value) {
+#if defined(_WIN32)
+    _putenv_s(name, value);
+#else
+    setenv(name, value, 1);
+#endif
+}
+}  // namespace
+
+TEST(Memory, ArenaSizeClasses) {
+    size_t alloc_bytes, alloc_buffers;
+    size_t lock_bytes, lock_buffers;
+
+    // The default memory manager reads the environment when it is reset
+    setEnv("AF_MEM_ARENA", "1");
+    af_unset_memory_manager();
+    setEnv("AF_MEM_ARENA", "0");
+
+    {
+        // 1300 and 1400 bytes are both rounded up to the 1536 byte class
+        array a = af::constant(1, 325, f32);
+        a.eval();
+        deviceMemInfo(&alloc_bytes, &alloc_buffers, &lock_bytes, &lock_buffers);
+        ASSERT_EQ(alloc_buffers, 1u);
+        ASSERT_EQ(alloc_bytes, 1536u);
+    }
+
+    {
+        array b = af::constant(2, 350, f32);
+        b.eval();
+        deviceMemInfo(&alloc_bytes, &alloc_buffers, &lock_bytes, &lock_buffers);
+        ASSERT_EQ(alloc_buffers, 1u);
+        ASSERT_EQ(lock_buffers, 1u);
+        ASSERT_EQ(lock_bytes, 1536u);
+        ASSERT_EQ(af::sum<float>(b), 700.f);
+    }
+
+    deviceGC();
+    deviceMemInfo(&alloc_bytes, &alloc_buffers, &lock_bytes, &lock_buffers);
+    ASSERT_EQ(alloc_buffers, 0u);
+    ASSERT_EQ(alloc_bytes, 0u);
+
+    af_unset_memory_manager();
+}
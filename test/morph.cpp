@@ -482,6 +482,16 @@ TEST(Morph, EdgeIssue1564) {
     }
 }
 
+TEST(Morph, SeparableRectangle) {
+    array in   = randu(100, 80);
+    array mask = constant(1.0, 31, 21);
+    array col  = constant(1.0, 31, 1);
+    array row  = constant(1.0, 1, 21);
+
+    ASSERT_ARRAYS_EQ(dilate(dilate(in, col), row), dilate(in, mask));
+    ASSERT_ARRAYS_EQ(erode(erode(in, col), row), erode(in, mask));
+}
+
 TEST(Morph, UnsupportedKernel2D) {
     const unsigned ndims = 2;
     const dim_t dims[2]  = {10, 10};
@@ -572,3 +572,84 @@ TEST(NearestNeighbour, DocSnippet2) {
     ASSERT_ARRAYS_EQ(gold_idx, idx);
     ASSERT_ARRAYS_EQ(gold_dist, dist);
 }
+
+TEST(NNIndex, ExactSSD) {
+    // Integer points keep the distances exact on every backend. Points at
+    // the same distance can be returned in any order, so only the distances
+    // are compared.
+    array train = (randu(4, 5000) * 100).as(s32);
+    array query = (randu(4, 300) * 100).as(s32);
+
+    array gold_idx, gold_dist;
+    nearestNeighbour(gold_idx, gold_dist, query, train, 0, 5, AF_SSD);
+
+    af::nnIndex index(train, 0, AF_SSD);
+    array idx, dist;
+    index.search(idx, dist, query, 0, 5);
+    ASSERT_ARRAYS_EQ(gold_dist, dist);
+
+    // The index can also be queried with the other layout
+    index.search(idx, dist, query.T(), 1, 5);
+    ASSERT_ARRAYS_EQ(gold_dist, dist);
+}
+
+TEST(NNIndex, ExactSADDim1) {
+    array train = (randu(3000, 6) * 50).as(s32);
+    array query = (randu(200, 6) * 50).as(s32);
+
+    array gold_idx, gold_dist;
+    nearestNeighbour(gold_idx, gold_dist, query, train, 1, 3, AF_SAD);
+
+    af::nnIndex index(train, 1, AF_SAD);
+    array idx, dist;
+    index.search(idx, dist, query, 1, 3);
+    ASSERT_ARRAYS_EQ(gold_dist, dist);
+}
+
+TEST(NNIndex, ExactSHD) {
+    array train = (randu(32, 4000) * 255).as(u8);
+    array query = (randu(32, 100) * 255).as(u8);
+
+    array gold_idx, gold_dist;
+    hammingMatcher(gold_idx, gold_dist, query, train, 0, 4);
+
+    af::nnIndex index(train, 0, AF_SHD);
+    array idx, dist;
+    index.search(idx, dist, query, 0, 4);
+    ASSERT_ARRAYS_EQ(gold_dist, dist);
+}
+
+TEST(NNIndex, ApproximateChecks) {
+    array train = randu(8, 10000);
+    array query = randu(8, 100);
+
+    af::nnIndex index(train);
+    array idx, dist;
+    index.search(idx, dist, query, 0, 2, 64);
+    ASSERT_EQ(dim4(2, 100), idx.dims());
+    ASSERT_EQ(dim4(2, 100), dist.dims());
+
+    // The approximate neighbours can only be further than the exact ones
+    array gold_idx, gold_dist;
+    nearestNeighbour(gold_idx, gold_dist, query, train, 0, 2);
+    ASSERT_TRUE(af::allTrue<bool>(dist >= gold_dist * (1.f - 1e-5f)));
+}
+
+TEST(NNIndex, InvalidQuery) {
+    af_array train = 0, query = 0;
+    dim_t tdims[] = {4, 100};
+    dim_t qdims[] = {3, 10};
+    ASSERT_SUCCESS(af_randu(&train, 2, tdims, f32));
+    ASSERT_SUCCESS(af_randu(&query, 2, qdims, f32));
+
+    af_nn_index index = 0;
+    ASSERT_SUCCESS(af_create_nn_index(&index, train, 0, AF_SSD));
+
+    af_array idx = 0, dist = 0;
+    ASSERT_EQ(AF_ERR_SIZE,
+              af_nn_index_search(&idx, &dist, index, query, 0, 1, 0));
+
+    ASSERT_SUCCESS(af_release_nn_index(index));
+    ASSERT_SUCCESS(af_release_array(train));
+    ASSERT_SUCCESS(af_release_array(query));
+}
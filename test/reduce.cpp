@@ -1863,6 +1863,62 @@ TEST(Reduce, SNIPPET_count_by_key_dim) {
     ASSERT_VEC_ARRAY_EQ(gold_vals, dim4(2, 3), ovals);
 }
 
+TEST(Reduce, InterleavedWithInPlaceUpdates) {
+    // The reductions read columns of a which are then modified in place. The
+    // results must not depend on the order the backend executes them in.
+    const int nx = 1000;
+    const int ny = 8;
+    array a      = af::range(dim4(nx, ny), 0, s32);
+
+    vector<array> sums;
+    for (int i = 0; i < ny; ++i) {
+        sums.push_back(sum(a(span, i)));
+        a(span, i) += i + 1;
+        sums.push_back(sum(a(span, i)));
+    }
+
+    const int base = nx * (nx - 1) / 2;
+    for (int i = 0; i < ny; ++i) {
+        ASSERT_EQ(base, sums[2 * i].scalar<int>()) << "column " << i;
+        ASSERT_EQ(base + nx * (i + 1), sums[2 * i + 1].scalar<int>())
+            << "column " << i;
+    }
+}
+
+TEST(Reduce, NanSumAllDims) {
+    // Large enough along every dimension to be split between threads
+    const dim4 dims(1031, 3, 70, 2);
+    vector<float> h_in(dims.elements());
+    for (size_t i = 0; i < h_in.size(); ++i) {
+        h_in[i] = (i % 11 == 0) ? NaN : static_cast<float>(i % 7);
+    }
+    array in(dims, h_in.data());
+
+    for (int d = 0; d < 4; ++d) {
+        dim4 odims = dims;
+        odims[d]   = 1;
+        const dim_t ostrides[4] = {1, odims[0], odims[0] * odims[1],
+                                   odims[0] * odims[1] * odims[2]};
+
+        vector<float> gold(odims.elements(), 0.f);
+        dim_t n = 0;
+        for (dim_t l = 0; l < dims[3]; ++l) {
+            for (dim_t k = 0; k < dims[2]; ++k) {
+                for (dim_t j = 0; j < dims[1]; ++j) {
+                    for (dim_t i = 0; i < dims[0]; ++i, ++n) {
+                        dim_t idx[4] = {i, j, k, l};
+                        idx[d]       = 0;
+                        dim_t o = idx[0] * ostrides[0] + idx[1] * ostrides[1] +
+                                  idx[2] * ostrides[2] + idx[3] * ostrides[3];
+                        gold[o] += std::isnan(h_in[n]) ? 2.f : h_in[n];
+                    }
+                }
+            }
+        }
+        ASSERT_VEC_ARRAY_EQ(gold, odims, sum(in, d, 2.0)) << "dim " << d;
+    }
+}
+
 TEST(RaggedMax, simple) {
     const int testKeys[6]      = {1, 2, 3, 4, 5, 6};
     const unsigned testVals[2] = {9, 2};
@@ -266,3 +266,31 @@ TEST(Regions, NoComponentImage) {
     for (int i = 0; i < sz; ++i)
         ASSERT_FLOAT_EQ(gold[i], output[i]) << " mismatch at i=" << i << endl;
 }
+
+TEST(Regions, LargeConnectedStripes) {
+    // Every fourth column is set and the last row joins pairs of them
+    const int dim = 1024;
+    vector<char> input(dim * dim, 0);
+    vector<float> gold(dim * dim, 0.0f);
+    for (int j = 0; j < dim; j += 4) {
+        for (int i = 0; i < dim; ++i) {
+            input[j * dim + i] = 1;
+            gold[j * dim + i]  = j / 8 + 1;
+        }
+        if (j % 8 == 0) {
+            for (int k = j; k <= j + 4; ++k) {
+                input[k * dim + dim - 1] = 1;
+                gold[k * dim + dim - 1]  = j / 8 + 1;
+            }
+        }
+    }
+
+    array in  = array(dim, dim, input.data());
+    array out = regions(in, AF_CONNECTIVITY_4);
+
+    vector<float> output(dim * dim);
+    out.host((void*)output.data());
+
+    for (int i = 0; i < dim * dim; ++i)
+        ASSERT_FLOAT_EQ(gold[i], output[i]) << " mismatch at i=" << i << endl;
+}
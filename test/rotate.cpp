@@ -198,3 +198,29 @@ TEST(Rotate, CPP) {
     // Delete
     delete[] outData;
 }
+
+TEST(Rotate, MultiChannel90) {
+    // Three channels large enough for the rows to be split between threads.
+    // A rotation by 90 degrees maps every output pixel onto an input pixel.
+    const int n  = 200;
+    const int nc = 3;
+    vector<float> hin(n * n * nc);
+    for (size_t i = 0; i < hin.size(); i++) { hin[i] = (i * 37) % 1001; }
+    array input(n, n, nc, &hin.front());
+
+    vector<float> gold(hin.size());
+    for (int c = 0; c < nc; c++) {
+        for (int y = 0; y < n; y++) {
+            for (int x = 0; x < n; x++) {
+                gold[(c * n + y) * n + x] = hin[(c * n + n - 1 - x) * n + y];
+            }
+        }
+    }
+
+    const float theta = 90 * PI / 180.0f;
+    array nearest     = rotate(input, theta, true, AF_INTERP_NEAREST);
+    array bilinear    = rotate(input, theta, true, AF_INTERP_BILINEAR);
+
+    ASSERT_VEC_ARRAY_EQ(gold, dim4(n, n, nc), nearest);
+    ASSERT_VEC_ARRAY_EQ(gold, dim4(n, n, nc), bilinear);
+}
@@ -13,9 +13,12 @@
 #include <af/defines.h>
 #include <af/dim4.hpp>
 #include <af/traits.hpp>
+#include <algorithm>
+#include <cmath>
 #include <complex>
 #include <iostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 using af::array;
@@ -196,3 +199,89 @@ TEST(SortByKey, CPPDim2) {
     ASSERT_VEC_ARRAY_EQ(tests[resultIdx0], idims, out_keys);
     ASSERT_VEC_ARRAY_EQ(tests[resultIdx1], idims, out_vals);
 }
+
+TEST(SortByKey, LargeStable) {
+    // Large enough for the keys to be radix sorted on several threads. The
+    // keys repeat so the values also check that the sort is stable.
+    const int nElems = 1 << 20;
+    const int nKeys  = 1000;
+
+    vector<int> hkeys(nElems);
+    vector<unsigned> hvals(nElems);
+    for (int i = 0; i < nElems; ++i) {
+        hkeys[i] = (i * 7919) % nKeys - nKeys / 2;
+        hvals[i] = i;
+    }
+
+    array keys(nElems, &hkeys.front());
+    array vals(nElems, &hvals.front());
+
+    for (int dir = 0; dir < 2; ++dir) {
+        vector<std::pair<int, unsigned> > gold(nElems);
+        for (int i = 0; i < nElems; ++i) { gold[i] = {hkeys[i], hvals[i]}; }
+        std::stable_sort(gold.begin(), gold.end(),
+                         [dir](const std::pair<int, unsigned> &a,
+                               const std::pair<int, unsigned> &b) {
+                             return dir ? a.first < b.first
+                                        : a.first > b.first;
+                         });
+
+        array out_keys, out_vals;
+        sort(out_keys, out_vals, keys, vals, 0, dir != 0);
+
+        vector<int> gold_keys(nElems);
+        vector<unsigned> gold_vals(nElems);
+        for (int i = 0; i < nElems; ++i) {
+            gold_keys[i] = gold[i].first;
+            gold_vals[i] = gold[i].second;
+        }
+        ASSERT_VEC_ARRAY_EQ(gold_keys, dim4(nElems), out_keys);
+        ASSERT_VEC_ARRAY_EQ(gold_vals, dim4(nElems), out_vals);
+    }
+}
+
+TEST(SortByKey, SignedZerosStable) {
+    // -0.0 and 0.0 are equal keys, so they keep their order in the radix
+    // sort of long columns as well as in the merge sort of short ones. The
+    // GPU backends do not specify the order of signed zeros.
+    if (af::getActiveBackend() != AF_BACKEND_CPU) { return; }
+
+    for (int nElems : {100, 1000}) {
+        vector<float> hkeys(nElems);
+        vector<unsigned> hvals(nElems);
+        for (int i = 0; i < nElems; ++i) {
+            hkeys[i] = (i % 3 == 0) ? -0.f : (i % 3 == 1) ? 0.f : i % 7 - 3.f;
+            hvals[i] = i;
+        }
+
+        array keys(nElems, &hkeys.front());
+        array vals(nElems, &hvals.front());
+
+        for (int dir = 0; dir < 2; ++dir) {
+            vector<std::pair<float, unsigned> > gold(nElems);
+            for (int i = 0; i < nElems; ++i) {
+                gold[i] = {hkeys[i], hvals[i]};
+            }
+            std::stable_sort(gold.begin(), gold.end(),
+                             [dir](const std::pair<float, unsigned> &a,
+                                   const std::pair<float, unsigned> &b) {
+                                 return dir ? a.first < b.first
+                                            : a.first > b.first;
+                             });
+
+            array out_keys, out_vals;
+            sort(out_keys, out_vals, keys, vals, 0, dir != 0);
+
+            vector<float> res_keys(nElems);
+            vector<unsigned> res_vals(nElems);
+            out_keys.host(&res_keys.front());
+            out_vals.host(&res_vals.front());
+            for (int i = 0; i < nElems; ++i) {
+                ASSERT_EQ(gold[i].second, res_vals[i]) << "at " << i;
+                ASSERT_EQ(std::signbit(gold[i].first),
+                          std::signbit(res_keys[i]))
+                    << "at " << i;
+            }
+        }
+    }
+}
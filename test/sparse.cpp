@@ -91,6 +91,68 @@ CAST_TESTS(cfloat, cdouble)
 CAST_TESTS(cdouble, cfloat)
 CAST_TESTS(cdouble, cdouble)
 
+TEST(Sparse, SkewedRowsMatVec) {
+    // A few dense rows among very sparse ones, like the adjacency matrix of
+    // a graph with some highly connected vertices. The matrix is large
+    // enough for every product to be split between several threads.
+    const int m     = 20000;
+    const int n     = 1500;
+    const int dense = 400;
+    const int N     = 3;
+
+    vector<int> rowIdx(1, 0);
+    vector<int> colIdx;
+    vector<float> values;
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            if (i % dense == 0) {
+                colIdx.push_back(j);
+                values.push_back(1 + (i + j) % 3);
+            } else if (i == j) {
+                colIdx.push_back(j);
+                values.push_back(2);
+            }
+        }
+        rowIdx.push_back(colIdx.size());
+    }
+    const int nnz = values.size();
+
+    array sA = af::sparse(m, n, array(nnz, values.data()),
+                          array(m + 1, rowIdx.data()),
+                          array(nnz, colIdx.data()), AF_STORAGE_CSR);
+
+    vector<float> hx(n * N);
+    vector<float> hy(m * N);
+    for (int i = 0; i < n * N; i++) { hx[i] = i % 7; }
+    for (int i = 0; i < m * N; i++) { hy[i] = i % 5; }
+
+    vector<float> goldAx(m * N, 0);
+    vector<float> goldAty(n * N, 0);
+    for (int o = 0; o < N; o++) {
+        for (int i = 0; i < m; i++) {
+            for (int k = rowIdx[i]; k < rowIdx[i + 1]; k++) {
+                goldAx[o * m + i] += values[k] * hx[o * n + colIdx[k]];
+                goldAty[o * n + colIdx[k]] += values[k] * hy[o * m + i];
+            }
+        }
+    }
+
+    array x(n, hx.data());
+    array y(m, hy.data());
+    array X(n, N, hx.data());
+    array Y(m, N, hy.data());
+
+    vector<float> goldAx1(goldAx.begin(), goldAx.begin() + m);
+    vector<float> goldAty1(goldAty.begin(), goldAty.begin() + n);
+
+    ASSERT_VEC_ARRAY_EQ(goldAx1, dim4(m), matmul(sA, x));
+    ASSERT_VEC_ARRAY_EQ(goldAty1, dim4(n),
+                        matmul(sA, y, AF_MAT_TRANS, AF_MAT_NONE));
+    ASSERT_VEC_ARRAY_EQ(goldAx, dim4(m, N), matmul(sA, X));
+    ASSERT_VEC_ARRAY_EQ(goldAty, dim4(n, N),
+                        matmul(sA, Y, AF_MAT_TRANS, AF_MAT_NONE));
+}
+
 TEST(Sparse, ISSUE_1745) {
     using af::where;
 
@@ -620,3 +620,39 @@ TEST(TransformBatching, CPP) {
         }
     }
 }
+
+TEST(Transform, MultiChannelTranslate) {
+    // Three channels large enough for the rows to be split between threads.
+    // A translation by whole pixels maps every output pixel onto an input
+    // pixel or outside of the image.
+    const int nx = 300;
+    const int ny = 200;
+    const int nc = 3;
+    const int tx = 7;
+    const int ty = -4;
+    vector<float> hin(nx * ny * nc);
+    for (size_t i = 0; i < hin.size(); i++) { hin[i] = (i * 37) % 1001; }
+    array input(nx, ny, nc, &hin.front());
+
+    const float htf[] = {1, 0, (float)tx, 0, 1, (float)ty};
+    array tf(3, 2, htf);
+
+    vector<float> gold(hin.size());
+    for (int c = 0; c < nc; c++) {
+        for (int y = 0; y < ny; y++) {
+            for (int x = 0; x < nx; x++) {
+                int sx = x - tx;
+                int sy = y - ty;
+                bool in = sx >= 0 && sx < nx && sy >= 0 && sy < ny;
+                gold[(c * ny + y) * nx + x] =
+                    in ? hin[(c * ny + sy) * nx + sx] : 0;
+            }
+        }
+    }
+
+    array nearest  = transform(input, tf, nx, ny, AF_INTERP_NEAREST, false);
+    array bilinear = transform(input, tf, nx, ny, AF_INTERP_BILINEAR, false);
+
+    ASSERT_VEC_ARRAY_EQ(gold, dim4(nx, ny, nc), nearest);
+    ASSERT_VEC_ARRAY_EQ(gold, dim4(nx, ny, nc), bilinear);
+}
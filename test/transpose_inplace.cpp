@@ -80,3 +80,13 @@ void transposeInPlaceCPPTest() {
 
     ASSERT_ARRAYS_EQ(input, output);
 }
+
+TEST(Transpose, TranposeIPConjugate) {
+    dim4 dims(100, 100, 2, 1);
+
+    array input  = randu(dims, c32);
+    array output = transpose(input, true);
+    transposeInPlace(input, true);
+
+    ASSERT_ARRAYS_EQ(input, output);
+}
@@ -0,0 +1,186 @@
+/*******************************************************
+ * Copyright (c) 2020, ArrayFire
+ * All rights reserved.
+ *
+ * This file is distributed under 3-clause BSD license.
+ * The complete license agreement can be obtained at:
+ * http://arrayfire.com/licenses/BSD-3-Clause
+ ********************************************************/
+
+// Compares the element-wise loops of the CPU JIT compiled for AVX2 and
+// AVX-512 with the generic loops. The loops are linked directly from the
+// cpu_vector_ops object library.
+
+#include <gtest/gtest.h>
+#include <jit/vector_isa.hpp>
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using cpu::jit::BinaryFunc;
+using cpu::jit::UnaryFunc;
+using std::string;
+using std::vector;
+
+namespace generic = cpu::jit::generic;
+namespace avx2    = cpu::jit::avx2;
+namespace avx512  = cpu::jit::avx512;
+
+// Lengths below, at and above the vector widths as well as the JIT chunk
+// size, so that every remainder loop is covered
+static const int lengths[] = {0,   1,   2,   3,   7,   8,    9,   15,
+                              16,  17,  31,  32,  33,  63,   64,  65,
+                              127, 128, 129, 255, 256, 257, 1000, 1023};
+
+#if defined(AF_WITH_X86_VECTOR_OPS) && (defined(__GNUC__) || defined(__clang__))
+#define HAS_CPU_SUPPORTS
+#endif
+
+static bool hasAVX2() {
+#ifdef HAS_CPU_SUPPORTS
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+static bool hasAVX512() {
+#ifdef HAS_CPU_SUPPORTS
+    return hasAVX2() && __builtin_cpu_supports("avx512f") &&
+           __builtin_cpu_supports("avx512bw") &&
+           __builtin_cpu_supports("avx512dq") &&
+           __builtin_cpu_supports("avx512vl");
+#else
+    return false;
+#endif
+}
+
+template<typename T>
+class VectorOps : public ::testing::Test {};
+
+typedef ::testing::Types<float, double, int, unsigned, long long,
+                         unsigned long long, short, unsigned short,
+                         unsigned char, char>
+    TestTypes;
+TYPED_TEST_CASE(VectorOps, TestTypes);
+
+// Values with both signs for the signed types and no zeros, so that the
+// integer divisions are defined. Conversions of negative floating point
+// values to unsigned types are undefined, so casts can ask for positive
+// values only.
+template<typename T>
+vector<T> values(int n, unsigned seed, bool positive = false) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> dist(1, 100);
+    vector<T> out(n);
+    for (int i = 0; i < n; i++) {
+        int val = dist(gen);
+        if (!positive && T(-1) < T(0) && (gen() & 1)) { val = -val; }
+        out[i] = T(val) / (std::is_floating_point<T>::value ? T(7) : T(1));
+    }
+    return out;
+}
+
+// Calls the loops of every supported instruction set on unaligned pointers
+// and checks that their results are identical to the generic loop
+template<typename To, typename Ti>
+void compareBinary(BinaryFunc<To, Ti> gen, BinaryFunc<To, Ti> v2,
+                   BinaryFunc<To, Ti> v512, const string &name) {
+    for (int len : lengths) {
+        vector<Ti> lhs = values<Ti>(len + 1, 1);
+        vector<Ti> rhs = values<Ti>(len + 1, 2);
+        // Equal elements exercise the comparison and min/max ties
+        for (int i = 0; i < len + 1; i += 3) { rhs[i] = lhs[i]; }
+
+        vector<To> gold(len + 1, To(0));
+        gen(gold.data() + 1, lhs.data() + 1, rhs.data() + 1, len);
+
+        if (hasAVX2()) {
+            vector<To> out(len + 1, To(0));
+            v2(out.data() + 1, lhs.data() + 1, rhs.data() + 1, len);
+            ASSERT_EQ(0, memcmp(gold.data(), out.data(),
+                                gold.size() * sizeof(To)))
+                << "AVX2 " << name << " length " << len;
+        }
+        if (hasAVX512()) {
+            vector<To> out(len + 1, To(0));
+            v512(out.data() + 1, lhs.data() + 1, rhs.data() + 1, len);
+            ASSERT_EQ(0, memcmp(gold.data(), out.data(),
+                                gold.size() * sizeof(To)))
+                << "AVX-512 " << name << " length " << len;
+        }
+    }
+}
+
+template<typename To, typename Ti>
+void compareCast(UnaryFunc<To, Ti> gen, UnaryFunc<To, Ti> v2,
+                 UnaryFunc<To, Ti> v512, const string &name) {
+    for (int len : lengths) {
+        vector<Ti> in = values<Ti>(len + 1, 3, To(-1) > To(0));
+
+        vector<To> gold(len + 1, To(0));
+        gen(gold.data() + 1, in.data() + 1, len);
+
+        if (hasAVX2()) {
+            vector<To> out(len + 1, To(0));
+            v2(out.data() + 1, in.data() + 1, len);
+            ASSERT_EQ(0, memcmp(gold.data(), out.data(),
+                                gold.size() * sizeof(To)))
+                << "AVX2 " << name << " length " << len;
+        }
+        if (hasAVX512()) {
+            vector<To> out(len + 1, To(0));
+            v512(out.data() + 1, in.data() + 1, len);
+            ASSERT_EQ(0, memcmp(gold.data(), out.data(),
+                                gold.size() * sizeof(To)))
+                << "AVX-512 " << name << " length " << len;
+        }
+    }
+}
+
+#define COMPARE_BINARY(To, OP)                                            \
+    compareBinary<To, TypeParam>(generic::binary<To, TypeParam, OP>,      \
+                                 avx2::binary<To, TypeParam, OP>,         \
+                                 avx512::binary<To, TypeParam, OP>, #OP)
+
+#define COMPARE_CAST(To)                                                  \
+    compareCast<To, TypeParam>(generic::cast<To, TypeParam>,              \
+                               avx2::cast<To, TypeParam>,                 \
+                               avx512::cast<To, TypeParam>, "cast " #To)
+
+#if defined(AF_WITH_X86_VECTOR_OPS)
+
+TYPED_TEST(VectorOps, Arithmetic) {
+    COMPARE_BINARY(TypeParam, af_add_t);
+    COMPARE_BINARY(TypeParam, af_sub_t);
+    COMPARE_BINARY(TypeParam, af_mul_t);
+    COMPARE_BINARY(TypeParam, af_div_t);
+    COMPARE_BINARY(TypeParam, af_min_t);
+    COMPARE_BINARY(TypeParam, af_max_t);
+}
+
+TYPED_TEST(VectorOps, Compare) {
+    COMPARE_BINARY(char, af_eq_t);
+    COMPARE_BINARY(char, af_neq_t);
+    COMPARE_BINARY(char, af_lt_t);
+    COMPARE_BINARY(char, af_gt_t);
+    COMPARE_BINARY(char, af_le_t);
+    COMPARE_BINARY(char, af_ge_t);
+}
+
+TYPED_TEST(VectorOps, Cast) {
+    COMPARE_CAST(float);
+    COMPARE_CAST(double);
+    COMPARE_CAST(int);
+    COMPARE_CAST(unsigned);
+    COMPARE_CAST(long long);
+    COMPARE_CAST(unsigned long long);
+    COMPARE_CAST(short);
+    COMPARE_CAST(unsigned short);
+    COMPARE_CAST(unsigned char);
+}
+
+#endif